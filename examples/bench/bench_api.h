@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) 2026 Malcolm Beattie
+ * SPDX-License-Identifier: MIT
+ */
+#ifndef _BENCH_API_H
+#define _BENCH_API_H
+
+#include "picochan/cu.h"
+
+//! bench_cu implements a synthetic device for measuring the cost of
+//! Picochan channel programs. It does no real I/O: all time spent is
+//! in the CSS, the channel and the CU.
+
+//! The largest data transfer (in bytes) for a single CCW or, for a
+//! data-chained CCW, for the whole chain of segments.
+#ifndef BENCH_BUF_SIZE
+#define BENCH_BUF_SIZE 4096
+#endif
+
+//! CCW operation codes
+
+//! PCH_CCW_CMD_READ (0x02) sends read_size bytes of a fixed pattern
+//! then ends with normal status. If the CCW (or its data-chained
+//! segments) has less room than read_size, the excess is ignored
+//! and the CSS reports incorrect length unless SLI is set.
+
+//! PCH_CCW_CMD_WRITE (0x01) receives and discards up to
+//! BENCH_BUF_SIZE bytes then ends with normal status.
+
+//! BENCH_CCW_CMD_SET_READ_SIZE (0x03) receives a 2-byte
+//! native-endian read_size, at most BENCH_BUF_SIZE, for subsequent
+//! PCH_CCW_CMD_READ CCWs. The default is 0 which makes a READ end
+//! immediately without sending data.
+#define BENCH_CCW_CMD_SET_READ_SIZE 0x03
+
+//! BENCH_CCW_CMD_READ_SKIP (0x04) is like PCH_CCW_CMD_READ except
+//! that it ends with StatusModifier as well as normal status so
+//! that, when command chaining, the CSS skips the following CCW.
+#define BENCH_CCW_CMD_READ_SKIP 0x04
+
+void bench_cu_init(pch_cu_t *cu, pch_unit_addr_t first_ua, uint16_t num_devices);
+
+#endif
@@ -0,0 +1,1005 @@
+/*
+ * Copyright (c) 2026 Malcolm Beattie
+ * SPDX-License-Identifier: MIT
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+#include "pico/binary_info.h"
+
+#include "picochan/css.h"
+#include "picochan/cu.h"
+#include "picochan/ccw.h"
+#include "picochan/dev_status.h"
+#include "picochan/trc_drain.h"
+
+#include "../bench_api.h"
+
+#ifndef BENCH_CROSS_CORE
+#define BENCH_CROSS_CORE false
+#endif
+
+#ifndef BENCH_BUS_PERF
+#define BENCH_BUS_PERF false
+#endif
+
+#if BENCH_BUS_PERF
+#include "hardware/structs/busctrl.h"
+#endif
+
+/*
+ * bench_memchan measures channel program throughput and latency
+ * with the CSS on core 0 and a bench_cu CU on core 1 connected by a
+ * memchan. Each workload runs one channel program repeatedly with
+ * pch_sch_run_wait() and reports operations (channel programs) per
+ * second, p50/p99 latency of a single operation and data bytes per
+ * second. The same source builds for a Pico and, via
+ * tools/pch_host, as a Linux program for tracking regressions.
+ *
+ * Workloads:
+ *  read1   a single READ CCW of BENCH_READ_SIZE bytes
+ *  write1  a single WRITE CCW of BENCH_READ_SIZE bytes
+ *  readodd a single READ CCW of BENCH_ODD_SIZE bytes, a count that
+ *          the bsize encoding in a Start rounds down
+ *  read2   a single READ CCW of 2 bytes, like a sense, which fits
+ *          in a DataInline packet
+ *  write2  a single WRITE CCW of 2 bytes
+ *  ccchain BENCH_CHAIN_LEN command-chained READs of
+ *          BENCH_SEGMENT_SIZE bytes (end_channel_program ->
+ *          do_command_chain_and_send_start per CCW)
+ *  cdchain one READ data-chained over BENCH_CHAIN_LEN segments of
+ *          BENCH_SEGMENT_SIZE bytes (fetch_chain_data_ccw per
+ *          segment)
+ *  tic     as ccchain but with a TIC between each pair of READs
+ *  skip    as ccchain but with each READ except the last ending with
+ *          StatusModifier (sent with its data as a single DataStatus)
+ *          and followed by an invalid CCW that the CSS must skip
+ *  fanout  the ccchain program started on each of BENCH_NUM_DEVICES
+ *          devices at once and then waited for on each in turn. With
+ *          BENCH_TX_BATCHING, the CSS and CU can each batch command
+ *          packets for different devices into a single channel
+ *          transfer.
+ *  bulkmix a BENCH_BUF_SIZE byte WRITE on the first device started
+ *          together with a read2 on each of the others. Its latency
+ *          is that of the read2s, which share the channel with the
+ *          bulk transfer, so setting BENCH_MAX_SEGMENT to have the
+ *          CSS split the bulk data into pieces with packets of other
+ *          devices between them shows up as lower p50/p99 when data
+ *          takes long enough to transfer (see SIM_DMA_NS_PER_BYTE in
+ *          tools/pch_host).
+ *  contend write1 kept running on each of BENCH_NUM_DEVICES devices,
+ *          started again on each as soon as it completes, until
+ *          BENCH_ITERATIONS have completed in all. Its latency is
+ *          that of each write1. The devices compete for the channel
+ *          so its split of the bytes between them, and the mean
+ *          latency of each, show the effect of BENCH_PRIORITY and
+ *          BENCH_SHARE when Starts wait for the channel rather than
+ *          the CU.
+ *
+ * With BENCH_PRIORITY, every subchannel but the first (the bulk one
+ * in bulkmix) has the PMCW priority flag set. With BENCH_SHARE
+ * non-zero, subchannel i (counting from 0) is given i + 1 times that
+ * byte-budget share. After the workloads, the bytes and channel
+ * programs counted for each subchannel during contend are shown
+ * with its share, the share of the bytes it achieved and its mean
+ * latency.
+ *
+ * With BENCH_PREPARED, each channel program is prepared once with
+ * pch_chanprog_prepare() and started with pch_sch_start_chanprog()
+ * so that the CSS fetches each CCW (and follows each TIC) from its
+ * pre-decoded form. Before the workloads, it checks that a prepared
+ * program suspended at a CCW reached through a TIC, resumed once
+ * the Suspend flag has been cleared, does not suspend there again
+ * when next started.
+ *
+ * With BENCH_PREFETCH, the channel prefetches the next CCW of a
+ * chain while the current segment is transferred.
+ *
+ * With BENCH_EXACT, the channel sends the exact count of a Start
+ * whose bsize encoding would round it down in a Count packet ahead
+ * of it instead of splitting the segment (counted as splits in the
+ * subchannel statistics).
+ *
+ * With BENCH_TRACE_DRAIN (and tracing enabled), CSS trace buffers
+ * are drained as they fill into a BENCH_TRACE_STREAM_SIZE memory
+ * sink, written on the host to BENCH_TRACE_STREAM_FILE for
+ * pch_dump_trace -s, and the frames sent and buffers dropped or
+ * overrun are shown after the workloads.
+ *
+ * With BENCH_COMPLETION_RING, completions are taken from the CSS
+ * I/O interrupt handler through a ring of BENCH_COMPLETION_RING_SIZE
+ * entries and reaped by the benchmark instead of each subchannel
+ * being waited for with pch_sch_wait(). The times the ring was
+ * found full are shown after the workloads.
+ *
+ * With BENCH_WAIT_ANY, the subchannels started together are waited
+ * for with pch_sch_wait_any() instead of one at a time.
+ *
+ * With BENCH_CROSS_CORE, the CSS is initialised with
+ * pch_css_init_cross_core() and started on core 1, alongside
+ * bench_cu, while the benchmark itself still calls the CSS API on
+ * core 0, which signals the CSS through the inter-core FIFO.
+ *
+ * With BENCH_BUS_PERF (on a Pico only), the bus fabric performance
+ * counters count contested accesses to the first two striped main
+ * SRAM banks and to the SCRATCH_X and SCRATCH_Y banks during each
+ * workload, shown after its results, so that a default build can be
+ * compared with one that places the CSS and bench_cu in the scratch
+ * banks of their cores (see PCH_CSS_SRAM_BANK and PCH_CU_SRAM_BANK,
+ * set by BENCH_SRAM_PLACEMENT in CMakeLists.txt).
+ *
+ * With BENCH_POLLED, the memchan is configured as a polled memchan
+ * instead: no DMA or interrupts are used for the channel and core 1
+ * spins in pch_cus_poll() while core 0 spins in pch_css_poll()
+ * waiting for each subchannel to become status pending.
+ */
+
+const pch_unit_addr_t FIRST_UA = 0;
+const pch_cuaddr_t CUADDR = 0;
+const pch_chpid_t CHPID = 0;
+const pch_sid_t FIRST_SID = 0;
+
+#ifndef BENCH_NUM_DEVICES
+#define BENCH_NUM_DEVICES 8
+#endif
+
+#ifndef BENCH_TX_BATCHING
+#define BENCH_TX_BATCHING true
+#endif
+
+#ifndef BENCH_POLLED
+#define BENCH_POLLED false
+#endif
+
+#ifndef BENCH_MAX_SEGMENT
+#define BENCH_MAX_SEGMENT 0
+#endif
+
+#ifndef BENCH_PRIORITY
+#define BENCH_PRIORITY false
+#endif
+
+#ifndef BENCH_SHARE
+#define BENCH_SHARE 0
+#endif
+
+#ifndef BENCH_PREPARED
+#define BENCH_PREPARED false
+#endif
+
+#ifndef BENCH_PREFETCH
+#define BENCH_PREFETCH false
+#endif
+
+#ifndef BENCH_EXACT
+#define BENCH_EXACT false
+#endif
+
+#ifndef BENCH_COMPLETION_RING
+#define BENCH_COMPLETION_RING false
+#endif
+
+#ifndef BENCH_COMPLETION_RING_SIZE
+#define BENCH_COMPLETION_RING_SIZE 8
+#endif
+
+#ifndef BENCH_WAIT_ANY
+#define BENCH_WAIT_ANY false
+#endif
+
+#ifndef BENCH_ENABLE_TRACE
+#define BENCH_ENABLE_TRACE false
+#endif
+
+#ifndef BENCH_TRACE_DRAIN
+#define BENCH_TRACE_DRAIN false
+#endif
+
+#ifndef BENCH_TRACE_STREAM_SIZE
+#define BENCH_TRACE_STREAM_SIZE 65536
+#endif
+
+#ifndef BENCH_TRACE_STREAM_FILE
+#define BENCH_TRACE_STREAM_FILE "bench_css_trace.pts"
+#endif
+
+#ifndef BENCH_ITERATIONS
+#define BENCH_ITERATIONS 2000
+#endif
+
+#ifndef BENCH_READ_SIZE
+#define BENCH_READ_SIZE 256
+#endif
+
+#ifndef BENCH_ODD_SIZE
+#define BENCH_ODD_SIZE 700
+#endif
+
+#ifndef BENCH_CHAIN_LEN
+#define BENCH_CHAIN_LEN 32
+#endif
+
+#ifndef BENCH_SEGMENT_SIZE
+#define BENCH_SEGMENT_SIZE 16
+#endif
+
+static_assert(BENCH_READ_SIZE <= BENCH_BUF_SIZE,
+        "BENCH_READ_SIZE must be at most BENCH_BUF_SIZE");
+static_assert(BENCH_ODD_SIZE <= BENCH_BUF_SIZE,
+        "BENCH_ODD_SIZE must be at most BENCH_BUF_SIZE");
+static_assert(BENCH_CHAIN_LEN * BENCH_SEGMENT_SIZE <= BENCH_BUF_SIZE,
+        "BENCH_CHAIN_LEN * BENCH_SEGMENT_SIZE must be at most BENCH_BUF_SIZE");
+static_assert(!BENCH_CROSS_CORE || !BENCH_POLLED,
+        "BENCH_CROSS_CORE needs the CSS to run from its IRQs on core 1");
+static_assert(!BENCH_BUS_PERF || PICO_ON_DEVICE,
+        "BENCH_BUS_PERF needs the bus performance counters of a Pico");
+static_assert(BENCH_ITERATIONS >= BENCH_NUM_DEVICES,
+        "contend needs an iteration for each device");
+static_assert(BENCH_NUM_DEVICES >= 1 && BENCH_NUM_DEVICES <= 8,
+        "BENCH_NUM_DEVICES must be between 1 and 8");
+
+static pch_cu_t PCH_CU_PLACEMENT bench_cu = PCH_CU_INIT(BENCH_NUM_DEVICES);
+
+#if BENCH_TRACE_DRAIN
+static unsigned char bench_trace_stream[BENCH_TRACE_STREAM_SIZE] __aligned(4);
+static pch_trc_mem_sink_t bench_trace_sink;
+static pch_trc_drain_t bench_trace_drain;
+#endif
+
+static pch_css_completion_t bench_completions[BENCH_COMPLETION_RING_SIZE];
+static pch_css_completion_ring_t bench_completion_ring;
+
+static volatile bool core1_ready;
+
+// setup_css starts the CSS and claims the channel to bench_cu, which
+// must be done before bench_cu configures its side of the memchan
+static void setup_css(void) {
+        // must set CSS dmairqix before this and, with a completion
+        // ring, enable ISC 0 that the subchannels are in
+        pch_css_start(NULL, BENCH_COMPLETION_RING ? 1 : 0);
+        pch_chpid_t chpid = pch_chp_claim_unused(true);
+        assert(chpid == CHPID);
+        pch_chp_alloc(chpid, BENCH_NUM_DEVICES); // allocates SIDs from 0
+        pch_chp_set_trace(chpid, BENCH_ENABLE_TRACE);
+        pch_chp_set_batching(chpid, BENCH_TX_BATCHING);
+        pch_chp_set_max_segment(chpid, BENCH_MAX_SEGMENT);
+        pch_chp_set_prefetch(chpid, BENCH_PREFETCH);
+        pch_chp_set_exact_counts(chpid, BENCH_EXACT);
+}
+
+// start_css_channel configures the CSS side of the memchan, once
+// bench_cu has configured its side, and starts the channel
+static void start_css_channel(void) {
+        pch_channel_t *chpeer = pch_cu_get_channel(CUADDR);
+        if (BENCH_POLLED)
+                pch_chp_configure_memchan_polled(CHPID, chpeer);
+        else
+                pch_chp_configure_memchan(CHPID, chpeer);
+
+        pch_chp_start(CHPID);
+}
+
+static void core1_thread(void) {
+        if (BENCH_CROSS_CORE)
+                setup_css();
+
+        pch_cus_init();
+        pch_cus_set_trace(BENCH_ENABLE_TRACE);
+
+        bench_cu_init(&bench_cu, FIRST_UA, BENCH_NUM_DEVICES);
+        pch_cu_register(&bench_cu, CUADDR);
+        pch_cu_set_batching(CUADDR, BENCH_TX_BATCHING);
+        pch_cus_trace_cu(CUADDR, BENCH_ENABLE_TRACE);
+
+        pch_channel_t *chpeer = pch_chp_get_channel(CHPID);
+        if (BENCH_POLLED)
+                pch_cus_memcu_configure_polled(CUADDR, chpeer);
+        else
+                pch_cus_memcu_configure(CUADDR, chpeer);
+
+        pch_cu_start(CUADDR);
+        if (BENCH_CROSS_CORE)
+                start_css_channel();
+
+        core1_ready = true; // core0 waits for this
+
+        while (1) {
+                if (BENCH_POLLED) {
+                        pch_cus_poll();
+                        tight_loop_contents();
+                } else
+                        __wfe();
+        }
+}
+
+typedef struct bench_workload {
+        const char      *name;
+        pch_ccw_t       *chanprog;
+        uint16_t        read_size;      // sent by device for each READ
+        uint16_t        ccws_per_op;    // excluding TICs
+        uint32_t        bytes_per_op;
+        uint16_t        num_devices;    // started concurrently per op
+        // bulk: the first device runs bulk_prog instead of chanprog
+        // and latency is measured until the others complete
+        bool            bulk;
+        // contend: the devices run chanprog over and over for
+        // BENCH_ITERATIONS ops in all rather than each iteration
+        bool            contend;
+} bench_workload_t;
+
+// All channel program buffers are static because CCW addresses are
+// 32 bits (see tools/pch_host) and are filled in at run time.
+static uint8_t bench_buf[BENCH_BUF_SIZE];
+static uint8_t bench_bulk_buf[BENCH_BUF_SIZE];
+static uint16_t bench_read_size;
+static pch_ccw_t set_read_size_prog[1];
+static pch_ccw_t read1_prog[1];
+static pch_ccw_t readodd_prog[1];
+static pch_ccw_t write1_prog[1];
+static pch_ccw_t read2_prog[1];
+static pch_ccw_t write2_prog[1];
+static pch_ccw_t ccchain_prog[BENCH_CHAIN_LEN];
+static pch_ccw_t cdchain_prog[BENCH_CHAIN_LEN];
+static pch_ccw_t tic_prog[2 * BENCH_CHAIN_LEN - 1];
+static pch_ccw_t skip_prog[2 * BENCH_CHAIN_LEN - 1];
+static pch_ccw_t bulk_prog[1];
+static uint32_t latencies_us[BENCH_ITERATIONS];
+
+// With BENCH_PREPARED, each channel program above is prepared once
+// into bench_prepared, its pre-decoded CCWs taken from bench_ccwds
+#define BENCH_NUM_CCWS (7 + 2 * BENCH_CHAIN_LEN + 2 * (2 * BENCH_CHAIN_LEN - 1))
+#define BENCH_NUM_CHANPROGS 11
+
+typedef struct bench_prepared {
+        pch_ccw_t       *ccws;
+        pch_chanprog_t  cp;
+} bench_prepared_t;
+
+static pch_ccwd_t bench_ccwds[BENCH_NUM_CCWS];
+static uint bench_num_ccwds;
+static bench_prepared_t bench_prepared[BENCH_NUM_CHANPROGS];
+static uint bench_num_prepared;
+
+static inline pch_ccw_t make_ccw(uint8_t cmd, pch_ccw_flags_t flags, uint16_t count, void *addr) {
+        return ((pch_ccw_t){
+                .cmd = cmd,
+                .flags = flags,
+                .count = count,
+                .addr = (uint32_t)addr
+        });
+}
+
+static void build_chanprogs(void) {
+        set_read_size_prog[0] = make_ccw(BENCH_CCW_CMD_SET_READ_SIZE, 0,
+                sizeof(bench_read_size), &bench_read_size);
+
+        read1_prog[0] = make_ccw(PCH_CCW_CMD_READ, 0,
+                BENCH_READ_SIZE, bench_buf);
+        readodd_prog[0] = make_ccw(PCH_CCW_CMD_READ, 0,
+                BENCH_ODD_SIZE, bench_buf);
+
+        // bench_cu asks to receive up to BENCH_BUF_SIZE bytes so
+        // SLI stops the CSS reporting incorrect length
+        write1_prog[0] = make_ccw(PCH_CCW_CMD_WRITE, PCH_CCW_FLAG_SLI,
+                BENCH_READ_SIZE, bench_buf);
+
+        read2_prog[0] = make_ccw(PCH_CCW_CMD_READ, 0, 2, bench_buf);
+        bulk_prog[0] = make_ccw(PCH_CCW_CMD_WRITE, PCH_CCW_FLAG_SLI,
+                BENCH_BUF_SIZE, bench_bulk_buf);
+        write2_prog[0] = make_ccw(PCH_CCW_CMD_WRITE, PCH_CCW_FLAG_SLI,
+                2, bench_buf);
+
+        for (uint i = 0; i < BENCH_CHAIN_LEN; i++) {
+                bool last = i == BENCH_CHAIN_LEN - 1;
+                ccchain_prog[i] = make_ccw(PCH_CCW_CMD_READ,
+                        last ? 0 : PCH_CCW_FLAG_CC,
+                        BENCH_SEGMENT_SIZE, bench_buf);
+                cdchain_prog[i] = make_ccw(PCH_CCW_CMD_READ,
+                        last ? 0 : PCH_CCW_FLAG_CD,
+                        BENCH_SEGMENT_SIZE,
+                        bench_buf + i * BENCH_SEGMENT_SIZE);
+        }
+
+        // READ, TIC, READ, TIC, ..., READ where each TIC points to
+        // the READ immediately after it
+        for (uint i = 0; i < 2 * BENCH_CHAIN_LEN - 1; i += 2) {
+                bool last = i == 2 * BENCH_CHAIN_LEN - 2;
+                tic_prog[i] = make_ccw(PCH_CCW_CMD_READ,
+                        last ? 0 : PCH_CCW_FLAG_CC,
+                        BENCH_SEGMENT_SIZE, bench_buf);
+                if (!last) {
+                        tic_prog[i + 1] = make_ccw(PCH_CCW_CMD_TIC, 0, 0,
+                                &tic_prog[i + 2]);
+                }
+        }
+
+        // READ_SKIP, (skipped), READ_SKIP, (skipped), ..., READ where
+        // each skipped CCW would be rejected by bench_cu if the CSS
+        // ever started it
+        for (uint i = 0; i < 2 * BENCH_CHAIN_LEN - 1; i += 2) {
+                bool last = i == 2 * BENCH_CHAIN_LEN - 2;
+                skip_prog[i] = make_ccw(
+                        last ? PCH_CCW_CMD_READ : BENCH_CCW_CMD_READ_SKIP,
+                        last ? 0 : PCH_CCW_FLAG_CC,
+                        BENCH_SEGMENT_SIZE, bench_buf);
+                if (!last) {
+                        skip_prog[i + 1] = make_ccw(0xfe, PCH_CCW_FLAG_CC,
+                                BENCH_SEGMENT_SIZE, bench_buf);
+                }
+        }
+}
+
+static bool prepare_chanprog(pch_ccw_t *ccws, uint16_t len) {
+        assert(bench_num_prepared < BENCH_NUM_CHANPROGS);
+        assert(bench_num_ccwds + len <= BENCH_NUM_CCWS);
+        bench_prepared_t *bp = &bench_prepared[bench_num_prepared++];
+        bp->ccws = ccws;
+        int i = pch_chanprog_prepare(&bp->cp, ccws, len,
+                &bench_ccwds[bench_num_ccwds]);
+        if (i != -1) {
+                printf("pch_chanprog_prepare: invalid CCW at index %d\n", i);
+                return false;
+        }
+
+        bench_num_ccwds += len;
+        return true;
+}
+
+static bool prepare_chanprogs(void) {
+        return prepare_chanprog(set_read_size_prog, count_of(set_read_size_prog))
+                && prepare_chanprog(read1_prog, count_of(read1_prog))
+                && prepare_chanprog(readodd_prog, count_of(readodd_prog))
+                && prepare_chanprog(write1_prog, count_of(write1_prog))
+                && prepare_chanprog(read2_prog, count_of(read2_prog))
+                && prepare_chanprog(write2_prog, count_of(write2_prog))
+                && prepare_chanprog(ccchain_prog, count_of(ccchain_prog))
+                && prepare_chanprog(cdchain_prog, count_of(cdchain_prog))
+                && prepare_chanprog(tic_prog, count_of(tic_prog))
+                && prepare_chanprog(skip_prog, count_of(skip_prog))
+                && prepare_chanprog(bulk_prog, count_of(bulk_prog));
+}
+
+static pch_chanprog_t *find_prepared(pch_ccw_t *ccws) {
+        for (uint i = 0; i < bench_num_prepared; i++) {
+                if (bench_prepared[i].ccws == ccws)
+                        return &bench_prepared[i].cp;
+        }
+
+        return NULL;
+}
+
+static bench_workload_t workloads[] = {
+        { "read1", read1_prog, BENCH_READ_SIZE, 1, BENCH_READ_SIZE, 1 },
+        { "readodd", readodd_prog, BENCH_ODD_SIZE, 1, BENCH_ODD_SIZE, 1 },
+        { "write1", write1_prog, 0, 1, BENCH_READ_SIZE, 1 },
+        { "read2", read2_prog, 2, 1, 2, 1 },
+        { "write2", write2_prog, 0, 1, 2, 1 },
+        { "ccchain", ccchain_prog, BENCH_SEGMENT_SIZE,
+                BENCH_CHAIN_LEN, BENCH_CHAIN_LEN * BENCH_SEGMENT_SIZE, 1 },
+        { "cdchain", cdchain_prog, BENCH_CHAIN_LEN * BENCH_SEGMENT_SIZE,
+                BENCH_CHAIN_LEN, BENCH_CHAIN_LEN * BENCH_SEGMENT_SIZE, 1 },
+        { "tic", tic_prog, BENCH_SEGMENT_SIZE,
+                BENCH_CHAIN_LEN, BENCH_CHAIN_LEN * BENCH_SEGMENT_SIZE, 1 },
+        { "skip", skip_prog, BENCH_SEGMENT_SIZE,
+                BENCH_CHAIN_LEN, BENCH_CHAIN_LEN * BENCH_SEGMENT_SIZE, 1 },
+        { "fanout", ccchain_prog, BENCH_SEGMENT_SIZE,
+                BENCH_NUM_DEVICES * BENCH_CHAIN_LEN,
+                BENCH_NUM_DEVICES * BENCH_CHAIN_LEN * BENCH_SEGMENT_SIZE,
+                BENCH_NUM_DEVICES },
+        { "bulkmix", read2_prog, 2, BENCH_NUM_DEVICES,
+                BENCH_BUF_SIZE + (BENCH_NUM_DEVICES - 1) * 2,
+                BENCH_NUM_DEVICES, true },
+        { "contend", write1_prog, 0, 1, BENCH_READ_SIZE,
+                BENCH_NUM_DEVICES, false, true },
+};
+
+static bool check_scsw(pch_sid_t sid, pch_scsw_t *scsw) {
+        const uint8_t want = PCH_DEVS_CHANNEL_END | PCH_DEVS_DEVICE_END;
+        if (scsw->devs != want || scsw->schs != 0 || scsw->count != 0) {
+                printf("sid %u: unexpected status devs=0x%02x schs=0x%02x count=%u\n",
+                        sid, scsw->devs, scsw->schs, scsw->count);
+                return false;
+        }
+
+        return true;
+}
+
+// bench_sch_wait is pch_sch_wait() except that, for a polled
+// memchan, nothing but core 0 itself can make the subchannel status
+// pending so it polls the CSS instead of waiting for an interrupt
+static int bench_sch_wait(pch_sid_t sid, pch_scsw_t *scsw) {
+        if (!BENCH_POLLED)
+                return pch_sch_wait(sid, scsw);
+
+        int cc;
+        while ((cc = pch_sch_test(sid, scsw)) == 1) {
+                pch_css_poll();
+                tight_loop_contents();
+        }
+
+        return cc;
+}
+
+// suspend_prog writes, TICs past an unused CCW to a write with the
+// Suspend flag set and ends there
+static pch_ccw_t suspend_prog[4];
+static pch_ccwd_t suspend_ccwds[count_of(suspend_prog)];
+static pch_chanprog_t suspend_cp;
+
+static bool is_suspended(pch_scsw_t *scsw) {
+        return (scsw->ctrl_flags & PCH_AC_SUSPENDED) != 0;
+}
+
+// check_prepared_resume starts suspend_prog prepared, waits for it to
+// suspend, clears the Suspend flag and resumes it, then starts it
+// again and checks it runs to its end without suspending.
+static bool check_prepared_resume(void) {
+        pch_ccw_t *last = &suspend_prog[count_of(suspend_prog) - 1];
+        suspend_prog[0] = make_ccw(PCH_CCW_CMD_WRITE,
+                PCH_CCW_FLAG_CC|PCH_CCW_FLAG_SLI, 2, bench_buf);
+        suspend_prog[1] = make_ccw(PCH_CCW_CMD_TIC, 0, 0, last);
+        suspend_prog[2] = make_ccw(PCH_CCW_CMD_WRITE, PCH_CCW_FLAG_SLI,
+                2, bench_buf);
+        *last = make_ccw(PCH_CCW_CMD_WRITE,
+                PCH_CCW_FLAG_SLI|PCH_CCW_FLAG_S, 2, bench_buf);
+        int i = pch_chanprog_prepare(&suspend_cp, suspend_prog,
+                count_of(suspend_prog), suspend_ccwds);
+        if (i != -1) {
+                printf("pch_chanprog_prepare: invalid CCW at index %d\n", i);
+                return false;
+        }
+
+        pch_scsw_t scsw;
+        int cc = pch_sch_start_chanprog(FIRST_SID, &suspend_cp);
+        if (cc == 0)
+                cc = bench_sch_wait(FIRST_SID, &scsw);
+        if (cc != 0 || !is_suspended(&scsw)) {
+                printf("prepared resume: did not suspend\n");
+                return false;
+        }
+
+        last->flags &= ~PCH_CCW_FLAG_S;
+        cc = pch_sch_resume(FIRST_SID);
+        if (cc == 0)
+                cc = bench_sch_wait(FIRST_SID, &scsw);
+        if (cc != 0 || !check_scsw(FIRST_SID, &scsw))
+                return false;
+
+        cc = pch_sch_start_chanprog(FIRST_SID, &suspend_cp);
+        if (cc == 0)
+                cc = bench_sch_wait(FIRST_SID, &scsw);
+        if (cc != 0 || is_suspended(&scsw)) {
+                printf("prepared resume: suspended again through TIC\n");
+                return false;
+        }
+
+        return check_scsw(FIRST_SID, &scsw);
+}
+
+static bool start_checked(pch_sid_t sid, pch_ccw_t *chanprog) {
+        int cc;
+        if (BENCH_PREPARED)
+                cc = pch_sch_start_chanprog(sid, find_prepared(chanprog));
+        else
+                cc = pch_sch_start(sid, chanprog);
+
+        if (cc != 0) {
+                printf("sid %u: pch_sch_start returned cc=%d\n", sid, cc);
+                return false;
+        }
+
+        return true;
+}
+
+static bool wait_checked(pch_sid_t sid) {
+        pch_scsw_t scsw;
+        int cc = bench_sch_wait(sid, &scsw);
+        if (cc != 0) {
+                printf("sid %u: pch_sch_wait returned cc=%d\n", sid, cc);
+                return false;
+        }
+
+        return check_scsw(sid, &scsw);
+}
+
+// take_completions takes between 0 and max completions of the
+// subchannels in waiting, from the completion ring or with
+// pch_sch_test_any(), waiting for at least one unless polled
+static uint take_completions(const pch_sid_set_t *waiting, pch_css_completion_t *out, uint max) {
+        if (BENCH_POLLED) {
+                pch_css_poll();
+                tight_loop_contents();
+                if (BENCH_COMPLETION_RING)
+                        return pch_css_reap_completions(out, max);
+
+                return pch_sch_test_any(waiting, out, max);
+        }
+
+        if (BENCH_COMPLETION_RING)
+                return pch_css_wait_completions(out, max);
+
+        return pch_sch_wait_any(waiting, out, max);
+}
+
+// wait_all_checked takes completions until num_devices subchannels
+// from FIRST_SID have completed. If small_us is not NULL, it stores
+// in *small_us how long after t0 all subchannels but FIRST_SID had
+// completed.
+static bool wait_all_checked(uint num_devices, uint64_t t0, uint32_t *small_us) {
+        pch_css_completion_t done[BENCH_NUM_DEVICES];
+        pch_sid_set_t waiting;
+        pch_sid_set_clear(&waiting);
+        pch_sid_set_add_range(&waiting, FIRST_SID, num_devices);
+        uint remaining = num_devices;
+        uint small_remaining = small_us ? num_devices - 1 : 0;
+        if (small_us && !small_remaining)
+                *small_us = (uint32_t)(time_us_64() - t0);
+
+        bool ok = true;
+        while (remaining) {
+                uint n = take_completions(&waiting, done, remaining);
+                for (uint i = 0; i < n; i++) {
+                        pch_sid_t sid = done[i].ic.sid;
+                        pch_sid_set_remove(&waiting, sid);
+                        if (!check_scsw(sid, &done[i].scsw))
+                                ok = false;
+
+                        if (small_remaining && sid != FIRST_SID
+                                && --small_remaining == 0)
+                                *small_us = (uint32_t)(time_us_64() - t0);
+                }
+                remaining -= n;
+        }
+
+        return ok;
+}
+
+// run_checked starts chanprog on num_devices consecutive subchannels
+// from FIRST_SID before waiting for any of them so that, for more
+// than one device, the CSS has several operations in flight at once
+static bool run_checked(pch_ccw_t *chanprog, uint num_devices) {
+        for (uint i = 0; i < num_devices; i++) {
+                if (!start_checked(FIRST_SID + i, chanprog))
+                        return false;
+        }
+
+        if (BENCH_COMPLETION_RING || BENCH_WAIT_ANY)
+                return wait_all_checked(num_devices, 0, NULL);
+
+        bool ok = true;
+        for (uint i = 0; i < num_devices; i++) {
+                if (!wait_checked(FIRST_SID + i))
+                        ok = false;
+        }
+
+        return ok;
+}
+
+// run_bulk_checked is run_checked except that FIRST_SID runs
+// bulk_prog. It stores in *small_us how long chanprog took to
+// complete on all the other subchannels.
+static bool run_bulk_checked(pch_ccw_t *chanprog, uint num_devices, uint32_t *small_us) {
+        uint64_t t0 = time_us_64();
+        if (!start_checked(FIRST_SID, bulk_prog))
+                return false;
+
+        for (uint i = 1; i < num_devices; i++) {
+                if (!start_checked(FIRST_SID + i, chanprog))
+                        return false;
+        }
+
+        if (BENCH_COMPLETION_RING || BENCH_WAIT_ANY)
+                return wait_all_checked(num_devices, t0, small_us);
+
+        bool ok = true;
+        for (uint i = 1; i < num_devices; i++) {
+                if (!wait_checked(FIRST_SID + i))
+                        ok = false;
+        }
+
+        *small_us = (uint32_t)(time_us_64() - t0);
+        if (!wait_checked(FIRST_SID))
+                ok = false;
+
+        return ok;
+}
+
+// contend_us holds the total latency of each subchannel's channel
+// programs during contend
+static uint64_t contend_us[BENCH_NUM_DEVICES];
+
+// run_contended_checked keeps chanprog running on num_devices
+// consecutive subchannels from FIRST_SID, starting it again on each
+// as soon as it completes, until BENCH_ITERATIONS channel programs
+// have completed in all. It stores in latencies_us how long each took
+// and adds it to the total in contend_us for its subchannel.
+static bool run_contended_checked(pch_ccw_t *chanprog, uint num_devices) {
+        uint64_t started_us[BENCH_NUM_DEVICES];
+        pch_css_completion_t done[BENCH_NUM_DEVICES];
+        pch_sid_set_t waiting;
+        pch_sid_set_clear(&waiting);
+        pch_sid_set_add_range(&waiting, FIRST_SID, num_devices);
+        for (uint i = 0; i < num_devices; i++) {
+                started_us[i] = time_us_64();
+                if (!start_checked(FIRST_SID + i, chanprog))
+                        return false;
+        }
+
+        uint started = num_devices;
+        uint completed = 0;
+        bool ok = true;
+        while (completed < started) {
+                uint n = take_completions(&waiting, done,
+                        started - completed);
+                uint64_t now = time_us_64();
+                for (uint i = 0; i < n; i++) {
+                        pch_sid_t sid = done[i].ic.sid;
+                        if (!check_scsw(sid, &done[i].scsw))
+                                ok = false;
+
+                        uint d = sid - FIRST_SID;
+                        uint32_t us = (uint32_t)(now - started_us[d]);
+                        latencies_us[completed++] = us;
+                        contend_us[d] += us;
+                        if (started == BENCH_ITERATIONS) {
+                                pch_sid_set_remove(&waiting, sid);
+                                continue;
+                        }
+
+                        started_us[d] = time_us_64();
+                        if (!start_checked(sid, chanprog))
+                                return false;
+
+                        started++;
+                }
+        }
+
+        return ok;
+}
+
+static void print_sch_stats(void) {
+        pch_sch_stats_t stats[BENCH_NUM_DEVICES];
+        uint64_t total_bytes = 0;
+        for (uint i = 0; i < BENCH_NUM_DEVICES; i++) {
+                pch_sch_store_stats(FIRST_SID + i, &stats[i]);
+                total_bytes += stats[i].bytes;
+        }
+
+        if (total_bytes == 0)
+                total_bytes = 1;
+
+        printf("%-8s %8s %8s %10s %8s %8s %8s\n", "sid", "share", "starts",
+                "bytes", "share%", "splits", "mean_us");
+        for (uint i = 0; i < BENCH_NUM_DEVICES; i++) {
+                uint32_t starts = stats[i].starts ? stats[i].starts : 1;
+                printf("%-8u %8u %8lu %10lu %8llu %8lu %8llu\n", FIRST_SID + i,
+                        BENCH_SHARE * (i + 1),
+                        (unsigned long)stats[i].starts,
+                        (unsigned long)stats[i].bytes,
+                        (unsigned long long)stats[i].bytes * 100
+                                / total_bytes,
+                        (unsigned long)stats[i].splits,
+                        (unsigned long long)contend_us[i] / starts);
+        }
+}
+
+static void finish_trace_drain(void) {
+#if BENCH_TRACE_DRAIN
+        pch_trc_drain_flush(&bench_trace_drain);
+        while (!pch_trc_drain_is_idle(&bench_trace_drain))
+                tight_loop_contents();
+
+        printf("trace drain: frames=%lu dropped=%lu overrun=%lu bytes=%lu\n",
+                (unsigned long)bench_trace_drain.frames,
+                (unsigned long)bench_trace_drain.dropped,
+                (unsigned long)bench_trace_drain.overrun,
+                (unsigned long)bench_trace_sink.len);
+#if !PICO_ON_DEVICE
+        FILE *f = fopen(BENCH_TRACE_STREAM_FILE, "wb");
+        if (!f || fwrite(bench_trace_stream, 1, bench_trace_sink.len, f)
+                != bench_trace_sink.len)
+                perror(BENCH_TRACE_STREAM_FILE);
+        if (f)
+                fclose(f);
+#endif
+#endif
+}
+
+#if BENCH_BUS_PERF
+// bench_bus_events are the events counted by the four bus fabric
+// performance counters with BENCH_BUS_PERF
+static const struct {
+        const char              *name;
+        bus_ctrl_perf_counter_t event;
+} bench_bus_events[4] = {
+        {"sram0", arbiter_sram0_perf_event_access_contested},
+        {"sram1", arbiter_sram1_perf_event_access_contested},
+#if PICO_RP2040
+        {"scratch_x", arbiter_sram4_perf_event_access_contested},
+        {"scratch_y", arbiter_sram5_perf_event_access_contested},
+#else
+        {"scratch_x", arbiter_sram8_perf_event_access_contested},
+        {"scratch_y", arbiter_sram9_perf_event_access_contested},
+#endif
+};
+
+static uint32_t bench_bus_counts[count_of(bench_bus_events)];
+#endif
+
+static void start_bus_perf(void) {
+#if BENCH_BUS_PERF
+#if !PICO_RP2040
+        busctrl_hw->perfctr_en = 1;
+#endif
+        for (uint i = 0; i < count_of(bench_bus_events); i++) {
+                busctrl_hw->counter[i].sel = bench_bus_events[i].event;
+                busctrl_hw->counter[i].value = 0; // any write clears
+        }
+#endif
+}
+
+static void stop_bus_perf(void) {
+#if BENCH_BUS_PERF
+        for (uint i = 0; i < count_of(bench_bus_events); i++)
+                bench_bus_counts[i] = busctrl_hw->counter[i].value;
+#endif
+}
+
+static void print_bus_perf(void) {
+#if BENCH_BUS_PERF
+        printf("%-8s", "");
+        for (uint i = 0; i < count_of(bench_bus_events); i++) {
+                printf(" %s=%lu", bench_bus_events[i].name,
+                        (unsigned long)bench_bus_counts[i]);
+        }
+        printf(" (contested)\n");
+#endif
+}
+
+static int compare_uint32(const void *a, const void *b) {
+        uint32_t x = *(const uint32_t *)a;
+        uint32_t y = *(const uint32_t *)b;
+        return (x > y) - (x < y);
+}
+
+static bool run_workload(bench_workload_t *w) {
+        bench_read_size = w->read_size;
+        if (!run_checked(set_read_size_prog, w->num_devices))
+                return false;
+
+        if (w->contend) {
+                for (uint i = 0; i < w->num_devices; i++)
+                        pch_sch_clear_stats(FIRST_SID + i);
+        }
+
+        start_bus_perf();
+        uint64_t start_us = time_us_64();
+        if (w->contend) {
+                if (!run_contended_checked(w->chanprog, w->num_devices)) {
+                        printf("%s: failed\n", w->name);
+                        return false;
+                }
+        }
+        for (uint i = 0; i < BENCH_ITERATIONS && !w->contend; i++) {
+                uint64_t t0 = time_us_64();
+                bool ok;
+                if (w->bulk) {
+                        ok = run_bulk_checked(w->chanprog, w->num_devices,
+                                &latencies_us[i]);
+                } else {
+                        ok = run_checked(w->chanprog, w->num_devices);
+                        latencies_us[i] = (uint32_t)(time_us_64() - t0);
+                }
+                if (!ok) {
+                        printf("%s: failed at iteration %u\n", w->name, i);
+                        return false;
+                }
+        }
+        uint64_t elapsed_us = time_us_64() - start_us;
+        stop_bus_perf();
+        if (elapsed_us == 0)
+                elapsed_us = 1;
+
+        qsort(latencies_us, BENCH_ITERATIONS, sizeof(latencies_us[0]),
+                compare_uint32);
+        uint32_t p50 = latencies_us[BENCH_ITERATIONS / 2];
+        uint32_t p99 = latencies_us[(BENCH_ITERATIONS * 99) / 100];
+        uint64_t ops_per_sec = (uint64_t)BENCH_ITERATIONS * 1000000 / elapsed_us;
+        uint64_t bytes_per_sec = (uint64_t)BENCH_ITERATIONS * w->bytes_per_op
+                * 1000000 / elapsed_us;
+        uint64_t ns_per_ccw = elapsed_us * 1000
+                / ((uint64_t)BENCH_ITERATIONS * w->ccws_per_op);
+
+        printf("%-8s %8u %8llu %8lu %8lu %10llu %8llu\n", w->name,
+                BENCH_ITERATIONS, (unsigned long long)ops_per_sec,
+                (unsigned long)p50, (unsigned long)p99,
+                (unsigned long long)bytes_per_sec,
+                (unsigned long long)ns_per_ccw);
+        print_bus_perf();
+        return true;
+}
+
+int main(void) {
+        bi_decl(bi_program_description("picochan channel program benchmark memchan CSS+CU"));
+        // work around timer stall during gdb debug with openocd:
+        // https://github.com/raspberrypi/pico-feedback/issues/428
+        timer_hw->dbgpause = 0;
+
+        stdio_init_all();
+
+        if (!BENCH_POLLED)
+                pch_memchan_init();
+
+        if (BENCH_CROSS_CORE)
+                pch_css_init_cross_core();
+        else
+                pch_css_init();
+
+        pch_css_set_trace(BENCH_ENABLE_TRACE);
+#if BENCH_TRACE_DRAIN
+        pch_trc_drain_start(&bench_trace_drain,
+                pch_css_get_trace_bufferset(),
+                pch_trc_mem_sink_init(&bench_trace_sink,
+                        bench_trace_stream, sizeof(bench_trace_stream)));
+#endif
+        if (BENCH_COMPLETION_RING) {
+                pch_css_set_completion_ring(&bench_completion_ring,
+                        bench_completions, BENCH_COMPLETION_RING_SIZE);
+        }
+        if (!BENCH_CROSS_CORE)
+                setup_css();
+
+        multicore_launch_core1(core1_thread);
+        while (!core1_ready)
+                sleep_ms(1);
+
+        if (!BENCH_CROSS_CORE)
+                start_css_channel();
+
+        pch_sch_modify_enabled_range(FIRST_SID, BENCH_NUM_DEVICES, true);
+        pch_sch_modify_traced_range(FIRST_SID, BENCH_NUM_DEVICES,
+                BENCH_ENABLE_TRACE);
+        for (uint i = 0; i < BENCH_NUM_DEVICES; i++) {
+                pch_sch_modify_priority(FIRST_SID + i,
+                        BENCH_PRIORITY && i != 0);
+                pch_sch_modify_share(FIRST_SID + i, BENCH_SHARE * (i + 1));
+        }
+
+        build_chanprogs();
+        if (BENCH_PREPARED && !prepare_chanprogs())
+                return 1;
+
+        if (BENCH_PREPARED && !check_prepared_resume())
+                return 1;
+
+        printf("iterations=%u read_size=%u chain_len=%u segment_size=%u num_devices=%u batching=%d polled=%d max_segment=%u priority=%d share=%u prepared=%d prefetch=%d exact=%d completion_ring=%d wait_any=%d cross_core=%d\n",
+                BENCH_ITERATIONS, BENCH_READ_SIZE, BENCH_CHAIN_LEN,
+                BENCH_SEGMENT_SIZE, BENCH_NUM_DEVICES, BENCH_TX_BATCHING,
+                BENCH_POLLED, BENCH_MAX_SEGMENT, BENCH_PRIORITY,
+                BENCH_SHARE, BENCH_PREPARED, BENCH_PREFETCH, BENCH_EXACT,
+                BENCH_COMPLETION_RING, BENCH_WAIT_ANY, BENCH_CROSS_CORE);
+        printf("%-8s %8s %8s %8s %8s %10s %8s\n", "workload", "ops",
+                "ops/s", "p50(us)", "p99(us)", "bytes/s", "ns/ccw");
+
+        int rc = 0;
+        for (uint i = 0; i < count_of(workloads); i++) {
+                if (!run_workload(&workloads[i]))
+                        rc = 1;
+        }
+
+        print_sch_stats();
+        if (BENCH_COMPLETION_RING) {
+                printf("completion ring: overflows=%lu\n",
+                        (unsigned long)bench_completion_ring.overflows);
+        }
+        finish_trace_drain();
+
+#if PICO_ON_DEVICE
+        while (1)
+                __wfe();
+#endif
+        return rc;
+}
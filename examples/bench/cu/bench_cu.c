@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2026 Malcolm Beattie
+ * SPDX-License-Identifier: MIT
+ */
+#include <string.h>
+
+#include "picochan/hldev.h"
+#include "picochan/ccw.h"
+
+#include "../bench_api.h"
+
+/*
+ * bench_cu implements a CU for the synthetic "bench" device used by
+ * the bench_memchan benchmark. Each device answers READ from a
+ * static pattern buffer and WRITE into a static sink buffer, both
+ * shared by all devices, so the only work per CCW is that of the
+ * Picochan CSS, channel and CU themselves.
+ */
+
+#ifndef MAX_NUM_BENCH_DEVS
+#define MAX_NUM_BENCH_DEVS 8
+#endif
+
+typedef struct bench_dev {
+        pch_hldev_t             hldev; // must be first field
+        uint16_t                read_size;
+} bench_dev_t;
+
+static_assert(offsetof(bench_dev_t, hldev) == 0,
+        "hldev must be first field in bench_dev_t");
+
+static bench_dev_t bench_devs[MAX_NUM_BENCH_DEVS];
+static uint8_t bench_read_data[BENCH_BUF_SIZE];
+static uint8_t bench_write_sink[BENCH_BUF_SIZE];
+
+static pch_hldev_t *bench_get_hldev(pch_hldev_config_t *hdcfg, int i) {
+        (void)hdcfg;
+        return &bench_devs[i].hldev;
+}
+
+static void bench_hldev_callback(pch_devib_t *devib);
+
+static pch_hldev_config_t bench_hldev_config = {
+        .get_hldev = bench_get_hldev,
+        .start = bench_hldev_callback
+};
+
+// Called when a BENCH_CCW_CMD_SET_READ_SIZE CCW has received all
+// the data available
+static void bench_set_read_size_received(pch_devib_t *devib) {
+        bench_dev_t *bd = (bench_dev_t *)pch_hldev_get(devib);
+        uint16_t read_size;
+        if (bd->hldev.count != sizeof(read_size)) {
+                pch_hldev_end_reject(devib, EINVALIDVALUE);
+                return;
+        }
+
+        memcpy(&read_size, bench_write_sink, sizeof(read_size));
+        if (read_size > BENCH_BUF_SIZE) {
+                pch_hldev_end_reject(devib, EINVALIDVALUE);
+                return;
+        }
+
+        bd->read_size = read_size;
+        pch_hldev_end_ok(devib);
+}
+
+static void bench_read(pch_devib_t *devib) {
+        bench_dev_t *bd = (bench_dev_t *)pch_hldev_get(devib);
+        if (bd->read_size == 0) {
+                pch_hldev_end_ok(devib);
+                return;
+        }
+
+        pch_hldev_send_final(devib, bench_read_data, bd->read_size);
+}
+
+static void bench_read_skip(pch_devib_t *devib) {
+        bench_dev_t *bd = (bench_dev_t *)pch_hldev_get(devib);
+        if (bd->read_size == 0) {
+                pch_hldev_end(devib, PCH_DEVS_STATUS_MODIFIER,
+                        PCH_DEV_SENSE_NONE);
+                return;
+        }
+
+        pch_hldev_send_final_status(devib, bench_read_data,
+                bd->read_size, PCH_DEVS_STATUS_MODIFIER);
+}
+
+static void bench_hldev_callback(pch_devib_t *devib) {
+        uint8_t ccwcmd = devib->payload.p0;
+        switch (ccwcmd) {
+        case PCH_CCW_CMD_READ:
+                bench_read(devib);
+                break;
+
+        case BENCH_CCW_CMD_READ_SKIP:
+                bench_read_skip(devib);
+                break;
+
+        case PCH_CCW_CMD_WRITE:
+                pch_hldev_receive_buffer_final(devib, bench_write_sink,
+                        sizeof(bench_write_sink));
+                break;
+
+        case BENCH_CCW_CMD_SET_READ_SIZE:
+                pch_hldev_receive_then(devib, bench_write_sink,
+                        sizeof(uint16_t), bench_set_read_size_received);
+                break;
+
+        default:
+                pch_hldev_end_reject(devib, EINVALIDCMD);
+                break;
+        }
+}
+
+void bench_cu_init(pch_cu_t *cu, pch_unit_addr_t first_ua, uint16_t num_devices) {
+        assert(num_devices <= MAX_NUM_BENCH_DEVS);
+        memset(bench_devs, 0, sizeof(bench_devs));
+        for (uint i = 0; i < BENCH_BUF_SIZE; i++)
+                bench_read_data[i] = (uint8_t)i;
+
+        pch_hldev_config_init(&bench_hldev_config, cu, first_ua, num_devices);
+}
@@ -60,7 +60,7 @@ static void light_led_for_three_seconds() {
 
 static pch_ccw_t blink_chanprog[] = {
         { PCH_CCW_CMD_WRITE, PCH_CCW_FLAG_CC },
-        { PCH_CCW_CMD_TIC, 0, 0, (uint32_t)&blink_chanprog[0] }
+        { PCH_CCW_CMD_TIC, 0, 0, 0 } // addr set by main()
 };
 
 int main(void) {
@@ -94,6 +94,11 @@ int main(void) {
 
         pch_chp_start(chpid);
 
+        // The TIC address is filled in at run time rather than by a
+        // static initializer so that this example also builds with
+        // the host simulation in tools/pch_host, where pointers are
+        // wider than the 32-bit CCW address field.
+        blink_chanprog[1].addr = (uint32_t)&blink_chanprog[0];
         pch_sch_start(0, blink_chanprog);
 
         while (1)
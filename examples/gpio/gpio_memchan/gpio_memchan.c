@@ -78,16 +78,27 @@ static uint8_t led_data[] = {
 
 static pch_ccw_t led_chanprog[] = {
         { GD_CCW_CMD_SET_OUT_PINS, PCH_CCW_FLAG_CC,
-                sizeof(led_pins), (uint32_t)&led_pins },
+                sizeof(led_pins) },
         { GD_CCW_CMD_SET_CLOCK_PERIOD_US, PCH_CCW_FLAG_CC,
-                sizeof(led_clock_period_us), (uint32_t)&led_clock_period_us },
+                sizeof(led_clock_period_us) },
         // Next is CCW 2 which is where we loop (TIC) back to...
         { PCH_CCW_CMD_WRITE, PCH_CCW_FLAG_CC,
-                sizeof(led_data), (uint32_t)led_data },
+                sizeof(led_data) },
         // ...here
-        { PCH_CCW_CMD_TIC, 0, 0, (uint32_t)&led_chanprog[2] }
+        { PCH_CCW_CMD_TIC, 0, 0 }
 };
 
+// The CCW addresses are filled in at run time rather than by static
+// initializers so that this example also builds with the host
+// simulation in tools/pch_host, where pointers are wider than the
+// 32-bit CCW address field.
+static void set_chanprog_addrs(void) {
+        led_chanprog[0].addr = (uint32_t)&led_pins;
+        led_chanprog[1].addr = (uint32_t)&led_clock_period_us;
+        led_chanprog[2].addr = (uint32_t)led_data;
+        led_chanprog[3].addr = (uint32_t)&led_chanprog[2];
+}
+
 int main(void) {
         bi_decl(bi_program_description("picochan gd_cu test memchan CSS+CU"));
         // work around timer stall during gdb debug with openocd:
@@ -117,6 +128,7 @@ int main(void) {
 
         pch_chp_start(chpid);
 
+        set_chanprog_addrs();
         pch_sch_start(0, led_chanprog);
 
         while (1)
@@ -97,6 +97,8 @@ void dmachan_init_rx_channel(dmachan_rx_channel_t *rx, dmachan_1way_config_t *d1
 
 extern dmachan_rx_channel_ops_t dmachan_mem_rx_channel_ops;
 extern dmachan_tx_channel_ops_t dmachan_mem_tx_channel_ops;
+extern dmachan_rx_channel_ops_t dmachan_mempoll_rx_channel_ops;
+extern dmachan_tx_channel_ops_t dmachan_mempoll_tx_channel_ops;
 extern dmachan_rx_channel_ops_t dmachan_uart_rx_channel_ops;
 extern dmachan_tx_channel_ops_t dmachan_uart_tx_channel_ops;
 extern dmachan_rx_channel_ops_t dmachan_pio_rx_channel_ops;
@@ -45,6 +45,12 @@ void __time_critical_func(pch_channel_handle_dma_irq)(pch_channel_t *ch) {
         trace_dma_irq(ch, ch->tx.link.irq_index, tx_state, rx_state);
 }
 
+bool __time_critical_func(pch_channel_poll)(pch_channel_t *ch) {
+        handle_tx_dma_irq(&ch->tx);
+        handle_rx_irq(&ch->rx);
+        return ch->tx.link.complete || ch->rx.link.complete;
+}
+
 void __time_critical_func(pch_channel_handle_pio_irq)(pch_channel_t *ch, uint irqnum) {
         dmachan_tx_channel_t *tx = &ch->tx;
         if (tx->ops->handle_tx_pio_irq) {
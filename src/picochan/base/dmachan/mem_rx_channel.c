@@ -21,38 +21,81 @@ dmachan_rx_channel_ops_t dmachan_mem_rx_channel_ops = {
         .handle_rx_irq = mem_handle_rx_irq
 };
 
-static void __time_critical_func(mem_start_dst_cmdbuf)(dmachan_rx_channel_t *rx) {
-        valid_params_if(PCH_DMACHAN,
-                rx->u.mem.dst_state == DMACHAN_MEM_DST_IDLE);
+// mem_ring_remove removes the descriptor at the tail of the tx
+// peer's ring and notifies the tx peer if it may be waiting for
+// that: always for a data segment and, for a command, only if the
+// ring was full
+static void __time_critical_func(mem_ring_remove)(dmachan_rx_channel_t *rx, bool notify) {
+        dmachan_tx_channel_t *txpeer = rx->u.mem.tx_peer;
+        if (mem_ring_pop(txpeer->u.mem.ring) || notify) {
+                trace_dmachan(PCH_TRC_RT_DMACHAN_FORCE_IRQ, &rx->link);
+                dmachan_set_link_dma_irq_forced(&txpeer->link, true);
+        }
+}
+
+// mem_try_consume takes the descriptor at the tail of the tx peer's
+// ring if it is what rx is waiting for. A command or a discarded data
+// segment completes rx immediately. A data segment to be received
+// starts the DMA from the tx source to the rx destination and rx
+// completes from the irq that raises.
+static void __time_critical_func(mem_try_consume)(dmachan_rx_channel_t *rx) {
+        dmachan_mem_dst_state_t dst_state = rx->u.mem.dst_state;
+        if (dst_state != DMACHAN_MEM_DST_CMDBUF
+                && dst_state != DMACHAN_MEM_DST_DATA
+                && dst_state != DMACHAN_MEM_DST_DISCARD)
+                return;
 
         dmachan_tx_channel_t *txpeer = rx->u.mem.tx_peer;
-        dmachan_link_t *rxl = &rx->link;
-        uint32_t status = mem_peer_lock();
+        dmachan_mem_desc_t *d = mem_ring_peek(txpeer->u.mem.ring);
+        if (!d)
+                return;
 
-        dmachan_mem_src_state_t txpeer_mem_src_state = txpeer->u.mem.src_state;
-        trace_dmachan_byte(PCH_TRC_RT_DMACHAN_DST_CMDBUF_MEM, rxl,
-                txpeer_mem_src_state);
+        dmachan_link_t *rxl = &rx->link;
+        switch (dst_state) {
+        case DMACHAN_MEM_DST_CMDBUF:
+                if (d->kind != DMACHAN_MEM_DESC_CMD)
+                        return;
 
-        switch (txpeer_mem_src_state) {
-        case DMACHAN_MEM_SRC_IDLE:
-        case DMACHAN_MEM_SRC_DATA:
-                dmachan_set_mem_dst_state(rx, DMACHAN_MEM_DST_CMDBUF);
-                break;
-        case DMACHAN_MEM_SRC_CMDBUF:
-                dmachan_link_t *txl = &txpeer->link;
-                dmachan_link_cmd_copy(rxl, txl);
+                mem_desc_copy_cmd(rxl, d);
                 trace_dmachan_cmd(PCH_TRC_RT_DMACHAN_MEMCHAN_RX_CMD, rxl);
-                rxl->complete = true;
-                dmachan_set_mem_src_state(txpeer, DMACHAN_MEM_SRC_IDLE);
-                dmachan_set_link_dma_irq_forced(txl, true);
+                mem_ring_remove(rx, false);
                 break;
-        default:
-                panic("mem_start_dst_cmdbuf unexpected txpeer->mem_src_state");
-                // NOTREACHED
+
+        case DMACHAN_MEM_DST_DATA:
+                if (d->kind != DMACHAN_MEM_DESC_DATA)
+                        return;
+
+                assert(d->count == rx->u.mem.count);
+                // DATA -> DATA_DMA is the one transition not via IDLE
+                rx->u.mem.dst_state = DMACHAN_MEM_DST_DATA_DMA;
+                dma_channel_configure(rxl->dmaid, &rx->ctrl,
+                        (void*)rx->u.mem.dstaddr, (void*)d->srcaddr,
+                        rx->u.mem.count, true);
+                return;
+
+        default: // DMACHAN_MEM_DST_DISCARD
+                if (d->kind != DMACHAN_MEM_DESC_DATA)
+                        return;
+
+                mem_ring_remove(rx, true);
                 break;
         }
 
-        mem_peer_unlock(status);
+        rxl->complete = true;
+        dmachan_set_mem_dst_state(rx, DMACHAN_MEM_DST_IDLE);
+}
+
+static void __time_critical_func(mem_start_dst_cmdbuf)(dmachan_rx_channel_t *rx) {
+        valid_params_if(PCH_DMACHAN,
+                rx->u.mem.dst_state == DMACHAN_MEM_DST_IDLE);
+
+        uint32_t status = mem_local_lock();
+        trace_dmachan_byte(PCH_TRC_RT_DMACHAN_DST_CMDBUF_MEM, &rx->link,
+                rx->u.mem.tx_peer->u.mem.src_state);
+
+        dmachan_set_mem_dst_state(rx, DMACHAN_MEM_DST_CMDBUF);
+        mem_try_consume(rx);
+        mem_local_unlock(status);
 }
 
 static void __time_critical_func(mem_start_dst_reset)(dmachan_rx_channel_t *rx) {
@@ -66,107 +109,78 @@ static void __time_critical_func(mem_start_dst_data)(dmachan_rx_channel_t *rx, u
         valid_params_if(PCH_DMACHAN,
                 rx->u.mem.dst_state == DMACHAN_MEM_DST_IDLE);
 
-        dmachan_tx_channel_t *txpeer = rx->u.mem.tx_peer;
-        dmachan_link_t *rxl = &rx->link;
-        uint32_t status = mem_peer_lock();
-
-        dmachan_mem_src_state_t txpeer_mem_src_state = txpeer->u.mem.src_state;
+        uint32_t status = mem_local_lock();
         trace_dmachan_segment_memstate(PCH_TRC_RT_DMACHAN_DST_DATA_MEM,
-                &rx->link, dstaddr, count, txpeer_mem_src_state);
-
-        switch (txpeer_mem_src_state) {
-        case DMACHAN_MEM_SRC_IDLE:
-        case DMACHAN_MEM_SRC_CMDBUF:
-                // SRC_CMDBUF can happen if the CU peer has sent its
-                // Data command but not yet reached the tx complete
-                // irq handler in which it'll move to SRC_DATA state.
-                dmachan_set_mem_dst_state(rx, DMACHAN_MEM_DST_DATA);
-                dma_channel_set_write_addr(rxl->dmaid, (void*)dstaddr, false);
-                dma_channel_set_trans_count(rxl->dmaid, count, false);
-                break;
-        case DMACHAN_MEM_SRC_DATA:
-                dmachan_set_mem_dst_state(rx, DMACHAN_MEM_DST_DATA);
-                assert(dma_channel_get_reload_count(rxl->dmaid) == count);
-                dma_channel_transfer_to_buffer_now(rxl->dmaid,
-                        (void*)dstaddr, count);
-                break;
-        default:
-                panic("mem_start_dst_data unexpected txpeer->mem_src_state");
-                // NOTREACHED
-                break;
-        }
-
-        mem_peer_unlock(status);
+                &rx->link, dstaddr, count,
+                rx->u.mem.tx_peer->u.mem.src_state);
+
+        rx->u.mem.dstaddr = dstaddr;
+        rx->u.mem.count = count;
+        dmachan_set_mem_dst_state(rx, DMACHAN_MEM_DST_DATA);
+        mem_try_consume(rx);
+        mem_local_unlock(status);
 }
 
 static void __time_critical_func(mem_start_dst_discard)(dmachan_rx_channel_t *rx, uint32_t count) {
         valid_params_if(PCH_DMACHAN,
                 rx->u.mem.dst_state == DMACHAN_MEM_DST_IDLE);
 
-        (void)count; // ignore count - we bypass doing any DMA transfer
-        dmachan_tx_channel_t *txpeer = rx->u.mem.tx_peer;
-        dmachan_link_t *rxl = &rx->link;
-        uint32_t status = mem_peer_lock();
-
-        dmachan_mem_src_state_t txpeer_mem_src_state = txpeer->u.mem.src_state;
+        // ignore count - we bypass doing any DMA transfer
+        uint32_t status = mem_local_lock();
         trace_dmachan_segment_memstate(PCH_TRC_RT_DMACHAN_DST_DISCARD_MEM,
-                rxl, 0, count, txpeer_mem_src_state);
-
-        switch (txpeer_mem_src_state) {
-        case DMACHAN_MEM_SRC_IDLE:
-                dmachan_set_mem_dst_state(rx, DMACHAN_MEM_DST_DISCARD);
-                break;
-        case DMACHAN_MEM_SRC_DATA:
-                dmachan_link_t *txl = &txpeer->link;
-                rxl->complete = true;
-                dmachan_set_mem_src_state(txpeer, DMACHAN_MEM_SRC_IDLE);
-                dmachan_set_link_dma_irq_forced(txl, true);
-                break;
-        default:
-                panic("mem_start_dst_discard unexpected txpeer->mem_src_state");
-                // NOTREACHED
-                break;
-        }
+                &rx->link, 0, count, rx->u.mem.tx_peer->u.mem.src_state);
 
-        mem_peer_unlock(status);
+        dmachan_set_mem_dst_state(rx, DMACHAN_MEM_DST_DISCARD);
+        mem_try_consume(rx);
+        mem_local_unlock(status);
 }
 
 static void __time_critical_func(mem_prep_dst_data_src_zeroes)(dmachan_rx_channel_t *rx, uint32_t dstaddr, uint32_t count) {
-        // for verification only
+        // completion is noticed from DMACHAN_MEM_DST_SRC_ZEROES
         dmachan_set_mem_dst_state(rx, DMACHAN_MEM_DST_SRC_ZEROES);
 }
 
 static dmachan_irq_state_t __time_critical_func(mem_handle_rx_irq)(dmachan_rx_channel_t *rx) {
         dmachan_link_t *rxl = &rx->link;
-        uint32_t status = mem_peer_lock();
+        uint32_t status = mem_local_lock();
         bool rx_irq_raised = dmachan_link_dma_irq_raised(rxl);
         bool rx_irq_forced = dmachan_get_link_dma_irq_forced(rxl);
-        if (rx_irq_raised) {
-                if (rx_irq_forced)
-                        dmachan_set_link_dma_irq_forced(rxl, false);
-                else {
-                        // propagate to peer tx channel
-                        // (asymmetric: no corresponding tx -> rx trigger)
-                        dmachan_tx_channel_t *txpeer = rx->u.mem.tx_peer;
-                        if (txpeer) {
-                                trace_dmachan(PCH_TRC_RT_DMACHAN_FORCE_IRQ,
-                                        rxl);
-                                dmachan_set_link_dma_irq_forced(&txpeer->link,
-                                        true);
-                        }
-                }
+        if (rx_irq_forced)
+                dmachan_set_link_dma_irq_forced(rxl, false);
 
-                rxl->complete = true;
+        // Acknowledge before looking at the DMA channel so that a
+        // transfer finishing after we look raises the irq again
+        if (rx_irq_raised)
                 dmachan_ack_link_dma_irq(rxl);
-        }
 
-        if (rxl->complete)
+        switch (rx->u.mem.dst_state) {
+        case DMACHAN_MEM_DST_DATA_DMA:
+                if (dma_channel_is_busy(rxl->dmaid))
+                        break;
+
+                mem_ring_remove(rx, true);
+                rxl->complete = true;
+                dmachan_set_mem_dst_state(rx, DMACHAN_MEM_DST_IDLE);
+                break;
+
+        case DMACHAN_MEM_DST_SRC_ZEROES:
+                if (dma_channel_is_busy(rxl->dmaid))
+                        break;
+
+                rxl->complete = true;
                 dmachan_set_mem_dst_state(rx, DMACHAN_MEM_DST_IDLE);
+                break;
+
+        default:
+                // a doorbell from the tx peer
+                mem_try_consume(rx);
+                break;
+        }
 
         if (rxl->resetting)
                 dmachan_handle_rx_resetting(rx);
 
-        mem_peer_unlock(status);
+        mem_local_unlock(status);
         return dmachan_make_irq_state(rx_irq_raised, rx_irq_forced,
                 rxl->complete);
 }
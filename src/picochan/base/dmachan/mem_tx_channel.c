@@ -17,108 +17,96 @@ dmachan_tx_channel_ops_t dmachan_mem_tx_channel_ops = {
         .handle_tx_dma_irq = mem_handle_tx_dma_irq
 };
 
+// mem_ring_doorbell tells the rx peer that there is a new descriptor
+// in the ring
+static inline void mem_ring_doorbell(dmachan_tx_channel_t *tx) {
+        dmachan_set_link_dma_irq_forced(&tx->u.mem.rx_peer->link, true);
+}
+
 static void __time_critical_func(mem_start_src_cmdbuf)(dmachan_tx_channel_t *tx) {
         valid_params_if(PCH_DMACHAN,
                 tx->u.mem.src_state == DMACHAN_MEM_SRC_IDLE);
 
-        dmachan_rx_channel_t *rxpeer = tx->u.mem.rx_peer;
         dmachan_link_t *txl = &tx->link;
-        uint32_t saved_irq = mem_peer_lock();
+        uint32_t status = mem_local_lock();
 
-        dmachan_mem_dst_state_t rxpeer_mem_dst_state = rxpeer->u.mem.dst_state;
         trace_dmachan_byte(PCH_TRC_RT_DMACHAN_SRC_CMDBUF_MEM, txl,
-                rxpeer_mem_dst_state);
-
-        switch (rxpeer_mem_dst_state) {
-        case DMACHAN_MEM_DST_IDLE:
-                dmachan_set_mem_src_state(tx, DMACHAN_MEM_SRC_CMDBUF);
-                break;
-
-        case DMACHAN_MEM_DST_CMDBUF:
-                dmachan_link_t *rxl = &rxpeer->link;
-                dmachan_link_cmd_copy(rxl, txl);
+                tx->u.mem.rx_peer->u.mem.dst_state);
+
+        dmachan_set_mem_src_state(tx, DMACHAN_MEM_SRC_CMDBUF);
+        if (mem_tx_try_post(tx)) {
+                // The command is complete as soon as it is in the
+                // ring so we complete synchronously, as though it had
+                // been copied straight to the rx peer. The caller
+                // must see the completion before it can handle any
+                // response to the command.
                 trace_dmachan_cmd(PCH_TRC_RT_DMACHAN_MEMCHAN_TX_CMD, txl);
+                dmachan_set_mem_src_state(tx, DMACHAN_MEM_SRC_IDLE);
+                tx->u.mem.posted = false;
                 txl->complete = true;
-                dmachan_set_mem_dst_state(rxpeer, DMACHAN_MEM_DST_IDLE);
-                dmachan_set_link_dma_irq_forced(rxl, true);
-                break;
-
-        default:
-                panic("mem_start_src_cmdbuf unexpected rxpeer->mem_dst_state");
-                // NOTREACHED
-                break;
+                mem_ring_doorbell(tx);
         }
 
-        mem_peer_unlock(saved_irq);
+        mem_local_unlock(status);
 }
 
 static void __time_critical_func(mem_write_src_reset)(dmachan_tx_channel_t *tx) {
         trace_dmachan(PCH_TRC_RT_DMACHAN_SRC_RESET_REMOTE, &tx->link);
-        // Bypass DMA and write a single 32-bit word with low byte
-        // DMACHAN_RESET_BYTE to the address in the DMA write address
-        // register which is the address of the hardware transmit FIFO
-        // for the channel
-        dma_channel_hw_t *dmahw = dma_channel_hw_addr(tx->link.dmaid);
-        *(uint32_t*)dmahw->write_addr = DMACHAN_RESET_BYTE;
+        // There is no hardware transmit FIFO to reset for a memchan:
+        // the peer state lives in memory and is reset when the peer
+        // itself is (re)initialised. The DMA write address register
+        // is still 0 at this point (memchan configures .addr = 0) so
+        // a bypass write like the uart/pio variants would be a stray
+        // write to address 0 which only happens to be harmless on
+        // the RP2040 because it lands in ROM.
+        (void)tx;
 }
 
 static void __time_critical_func(mem_start_src_data)(dmachan_tx_channel_t *tx, uint32_t srcaddr, uint32_t count) {
         valid_params_if(PCH_DMACHAN,
                 tx->u.mem.src_state == DMACHAN_MEM_SRC_IDLE);
 
-        dmachan_rx_channel_t *rxpeer = tx->u.mem.rx_peer;
         dmachan_link_t *txl = &tx->link;
-        uint32_t saved_irq = mem_peer_lock();
+        uint32_t status = mem_local_lock();
 
-        dmachan_mem_dst_state_t rxpeer_mem_dst_state = rxpeer->u.mem.dst_state;
         trace_dmachan_segment_memstate(PCH_TRC_RT_DMACHAN_SRC_DATA_MEM,
-                txl, srcaddr, count, rxpeer_mem_dst_state);
-
-        switch (rxpeer_mem_dst_state) {
-        case DMACHAN_MEM_DST_IDLE:
-        case DMACHAN_MEM_DST_CMDBUF:
-                dmachan_set_mem_src_state(tx, DMACHAN_MEM_SRC_DATA);
-                dma_channel_set_read_addr(txl->dmaid,
-                        (void*)srcaddr, false);
-                dma_channel_set_trans_count(txl->dmaid, count, false);
-                break;
-
-        case DMACHAN_MEM_DST_DATA:
-                dmachan_set_mem_src_state(tx, DMACHAN_MEM_SRC_DATA);
-                dma_channel_transfer_from_buffer_now(txl->dmaid,
-                        (void*)srcaddr, count);
-                break;
-
-        case DMACHAN_MEM_DST_DISCARD:
-                txl->complete = true;
-                dmachan_set_mem_dst_state(rxpeer, DMACHAN_MEM_DST_IDLE);
-                dmachan_set_link_dma_irq_forced(&rxpeer->link, true);
-                break;
-
-        default:
-                panic("mem_start_src_data unexpected rxpeer->mem_dst_state");
-                // NOTREACHED
-                break;
-        }
-
-        mem_peer_unlock(saved_irq);
+                txl, srcaddr, count, tx->u.mem.rx_peer->u.mem.dst_state);
+
+        // The rx peer does the DMA itself, from srcaddr straight to
+        // its destination, when it takes the descriptor from the
+        // ring and we complete when it tells us it has removed it.
+        tx->u.mem.srcaddr = srcaddr;
+        tx->u.mem.count = count;
+        dmachan_set_mem_src_state(tx, DMACHAN_MEM_SRC_DATA);
+        if (mem_tx_try_post(tx))
+                mem_ring_doorbell(tx);
+
+        mem_local_unlock(status);
 }
 
 static dmachan_irq_state_t __time_critical_func(mem_handle_tx_dma_irq)(dmachan_tx_channel_t *tx) {
         dmachan_link_t *txl = &tx->link;
-        uint32_t saved_irq = mem_peer_lock();
-        bool tx_irq_raised = dmachan_link_dma_irq_raised(txl);
+        uint32_t status = mem_local_lock();
+
+        // The tx link never has its irq enabled so it is only ever
+        // raised by being forced. We must not acknowledge it: that
+        // would clear the raw DMA completion status that the rx
+        // peer, sharing the same DMA channel, may not yet have seen.
         bool tx_irq_forced = dmachan_get_link_dma_irq_forced(txl);
-        if (tx_irq_raised || tx_irq_forced) {
-                txl->complete = true;
+        if (tx_irq_forced)
                 dmachan_set_link_dma_irq_forced(txl, false);
-                dmachan_ack_link_dma_irq(txl);
-        }
 
-        if (txl->complete)
-                dmachan_set_mem_src_state(tx, DMACHAN_MEM_SRC_IDLE);
+        // A command waiting for room in the ring is both posted and
+        // complete by the time mem_tx_check_complete returns so we
+        // notice a post from the ring head rather than from posted
+        uint32_t head = tx->u.mem.ring->head;
+        if (mem_tx_check_complete(tx))
+                txl->complete = true;
+
+        if (tx->u.mem.ring->head != head)
+                mem_ring_doorbell(tx);
 
-        mem_peer_unlock(saved_irq);
-        return dmachan_make_irq_state(tx_irq_raised, tx_irq_forced,
+        mem_local_unlock(status);
+        return dmachan_make_irq_state(tx_irq_forced, tx_irq_forced,
                 txl->complete);
 }
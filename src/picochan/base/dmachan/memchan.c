@@ -5,24 +5,27 @@
 
 #include "memchan_internal.h"
 
-// mem_peer_spin_lock must be initialised with pch_memchan_init
-spin_lock_t *dmachan_mem_peer_spin_lock;
-
-void dmachan_panic_unless_memchan_initialised() {
-        if (!dmachan_mem_peer_spin_lock)
-                panic("pch_memchan_init not called");
+// pch_memchan_init used to claim the global spin lock that all
+// memchans shared. Each memchan direction now synchronises through
+// its own lock-free ring so there is nothing left to initialise.
+void pch_memchan_init(void) {
 }
 
-// pch_memchan_init must be called to initialise mem_peer_spin_lock
-// before configuring any memchan CU. If it is not initialised then
-// any attempt to configure a memcu from either CSS or CUS side
-// will panic at runtime to avoid any mysterious race conditions.
-void pch_memchan_init(void) {
-        if (dmachan_mem_peer_spin_lock)
-                panic("dmachan_mem_peer_spin_lock already initialised");
+void dmachan_init_mem_tx_state(dmachan_tx_channel_t *tx, dmachan_mem_ring_t *r) {
+        tx->u.mem.src_state = DMACHAN_MEM_SRC_IDLE;
+        tx->u.mem.posted = false;
+        tx->u.mem.pos = 0;
+        tx->u.mem.srcaddr = 0;
+        tx->u.mem.count = 0;
+        r->head = 0;
+        r->tail = 0;
+        tx->u.mem.ring = r;
+}
 
-        int n = spin_lock_claim_unused(true);
-        dmachan_mem_peer_spin_lock = spin_lock_init(n);
+void dmachan_init_mem_rx_state(dmachan_rx_channel_t *rx) {
+        rx->u.mem.dst_state = DMACHAN_MEM_DST_IDLE;
+        rx->u.mem.dstaddr = 0;
+        rx->u.mem.count = 0;
 }
 
 static inline dmachan_1way_config_t dmachan_1way_config_memchan_make(pch_dmaid_t dmaid, pch_irq_index_t dmairqix) {
@@ -59,20 +62,29 @@ static dmachan_config_t import_dma_channels(uint dmairqix, pch_channel_t *chpeer
         return dmachan_config_memchan_make(txdmaid, rxdmaid, dmairqix);
 }
 
-static void do_init_memchan(pch_channel_t *ch, dmachan_config_t *dc) {
+static void do_init_memchan(pch_channel_t *ch, dmachan_config_t *dc, dmachan_mem_ring_t *ring) {
         dmachan_init_tx_channel(&ch->tx, &dc->tx, &dmachan_mem_tx_channel_ops);
+        dmachan_init_mem_tx_state(&ch->tx, ring);
         // Do not enable irq for tx channel link because Pico DMA
-        // does not treat the INTSn bits separately. We enable only
-        // the rx side for irqs and the rx irq handler propagates
-        // notifications to the tx side via the INTFn "forced irq"
-        // register which overrides the INTEn enabled bits.
+        // does not treat the INTSn bits separately. Only the rx side
+        // of each direction drives its DMA channel so we enable only
+        // the rx side for irqs. Each side notifies the other (of a
+        // newly posted descriptor or of one having been removed) via
+        // the INTFn "forced irq" register which overrides the INTEn
+        // enabled bits.
 
         dmachan_rx_channel_t *rx = &ch->rx;
         dmachan_init_rx_channel(rx, &dc->rx, &dmachan_mem_rx_channel_ops);
+        dmachan_init_mem_rx_state(rx);
         dmachan_set_link_dma_irq_enabled(&rx->link, true);
 }
 
 void pch_channel_init_memchan(pch_channel_t *ch, uint8_t id, uint dmairqix, pch_channel_t *chpeer) {
+        pch_channel_init_memchan_ring(ch, id, dmairqix, chpeer,
+                &ch->tx.u.mem.own_ring);
+}
+
+void pch_channel_init_memchan_ring(pch_channel_t *ch, uint8_t id, uint dmairqix, pch_channel_t *chpeer, dmachan_mem_ring_t *ring) {
         assert(!pch_channel_is_started(ch));
         assert(!pch_channel_is_configured(ch));
 
@@ -82,7 +94,7 @@ void pch_channel_init_memchan(pch_channel_t *ch, uint8_t id, uint dmairqix, pch_
         else
                 dc = claim_dma_channels(dmairqix);
 
-        do_init_memchan(ch, &dc);
+        do_init_memchan(ch, &dc, ring);
 
         dmachan_rx_channel_t *rx = &ch->rx;
         dmachan_tx_channel_t *txpeer = &chpeer->tx;
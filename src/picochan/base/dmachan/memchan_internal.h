@@ -9,20 +9,119 @@
 #include "dmachan_internal.h"
 #include "dmachan_trace.h"
 
-// dmachan_mem_peer_spin_lock protects against test/update of
-// tx_channel.mem_src_state and rx_channel.mem_dst_state both
-// from interrupts and cross-core. It must be initialised before
-// use with pch_memchan_init().
-extern spin_lock_t *dmachan_mem_peer_spin_lock;
+// Each memchan tx side posts commands and data segments as
+// descriptors in its own dmachan_mem_ring_t for its rx peer to take.
+// Apart from the ring head (written only by tx) and tail (written
+// only by rx), each side writes only its own channel state so there
+// is no lock between the sides nor between different memchans.
+// mem_local_lock only disables interrupts on the current core
+// because a channel is driven both from its DMA IRQ handler and
+// from other contexts on the same core.
+static inline uint32_t mem_local_lock(void) {
+        return save_and_disable_interrupts();
+}
+
+static inline void mem_local_unlock(uint32_t status) {
+        restore_interrupts(status);
+}
+
+static inline dmachan_mem_desc_t *mem_ring_desc(dmachan_mem_ring_t *r, uint32_t pos) {
+        return &r->desc[pos & (DMACHAN_MEM_RING_SIZE - 1)];
+}
+
+// mem_ring_peek returns the descriptor at the tail of ring r, for
+// use by the rx side, or NULL if the ring is empty. r is NULL until
+// the tx peer has been initialised and been given its ring.
+static inline dmachan_mem_desc_t *mem_ring_peek(dmachan_mem_ring_t *r) {
+        if (!r)
+                return NULL;
 
-static inline uint32_t mem_peer_lock(void) {
-        return spin_lock_blocking(dmachan_mem_peer_spin_lock);
+        uint32_t tail = r->tail;
+        if (r->head == tail)
+                return NULL;
+
+        __mem_fence_acquire();
+        return mem_ring_desc(r, tail);
+}
+
+// mem_ring_pop removes the descriptor at the tail of ring r once
+// the rx side has finished with it and returns true if the ring was
+// full beforehand, in which case the tx side may be waiting for room
+static inline bool mem_ring_pop(dmachan_mem_ring_t *r) {
+        uint32_t tail = r->tail;
+        bool was_full = r->head - tail == DMACHAN_MEM_RING_SIZE;
+        __mem_fence_release();
+        r->tail = tail + 1;
+        return was_full;
 }
 
-static inline void mem_peer_unlock(uint32_t saved_irq) {
-        spin_unlock(dmachan_mem_peer_spin_lock, saved_irq);
+static inline void mem_desc_copy_cmd(dmachan_link_t *rxl, dmachan_mem_desc_t *d) {
+        rxl->cmd.raw = d->cmd.raw;
+#ifdef PCH_CONFIG_DEBUG_MEMCHAN
+        rxl->seqnum = d->seqnum;
+#endif
 }
 
+// mem_tx_try_post posts the command (in the link cmd) or data
+// segment that tx has been started with in its ring, returning
+// false if the ring is full
+static inline bool mem_tx_try_post(dmachan_tx_channel_t *tx) {
+        dmachan_mem_ring_t *r = tx->u.mem.ring;
+        uint32_t head = r->head;
+        if (head - r->tail == DMACHAN_MEM_RING_SIZE)
+                return false;
+
+        // the rx peer has finished with the slot we are about to
+        // reuse by the time we see its tail move past it
+        __mem_fence_acquire();
+        dmachan_mem_desc_t *d = mem_ring_desc(r, head);
+        if (tx->u.mem.src_state == DMACHAN_MEM_SRC_CMDBUF) {
+                d->kind = DMACHAN_MEM_DESC_CMD;
+                d->cmd.raw = tx->link.cmd.raw;
+#ifdef PCH_CONFIG_DEBUG_MEMCHAN
+                d->seqnum = tx->link.seqnum;
+#endif
+        } else {
+                d->kind = DMACHAN_MEM_DESC_DATA;
+                d->srcaddr = tx->u.mem.srcaddr;
+                d->count = tx->u.mem.count;
+        }
+
+        __mem_fence_release();
+        r->head = head + 1;
+        tx->u.mem.posted = true;
+        tx->u.mem.pos = head;
+        return true;
+}
+
+// mem_tx_check_complete posts the current command or data segment
+// if it has been waiting for room in the ring and returns true,
+// moving tx back to idle, if it is complete. A command is complete
+// as soon as it is in the ring, just as if it had been copied
+// straight to the rx peer, but a data segment is complete only once
+// the rx side has removed it from the ring, since only then has the
+// source buffer been read.
+static inline bool mem_tx_check_complete(dmachan_tx_channel_t *tx) {
+        dmachan_mem_src_state_t src_state = tx->u.mem.src_state;
+        if (src_state == DMACHAN_MEM_SRC_IDLE)
+                return false;
+
+        if (!tx->u.mem.posted && !mem_tx_try_post(tx))
+                return false;
+
+        if (src_state == DMACHAN_MEM_SRC_DATA
+                && (int32_t)(tx->u.mem.ring->tail - tx->u.mem.pos) <= 0)
+                return false;
+
+        __mem_fence_acquire();
+        tx->u.mem.posted = false;
+        dmachan_set_mem_src_state(tx, DMACHAN_MEM_SRC_IDLE);
+        return true;
+}
+
+void dmachan_init_mem_tx_state(dmachan_tx_channel_t *tx, dmachan_mem_ring_t *r);
+void dmachan_init_mem_rx_state(dmachan_rx_channel_t *rx);
+
 #ifndef PCH_DMACHAN_MEMCHAN_DEBUG_ENABLED
 #ifdef PCH_CONFIG_DEBUG_MEMCHAN
 #define PCH_DMACHAN_MEMCHAN_DEBUG_ENABLED true
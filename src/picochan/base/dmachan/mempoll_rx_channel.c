@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2025 Malcolm Beattie
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <string.h>
+#include "memchan_internal.h"
+
+static void mempoll_start_dst_cmdbuf(dmachan_rx_channel_t *rx);
+static void mempoll_start_dst_reset(dmachan_rx_channel_t *rx);
+static void mempoll_start_dst_data(dmachan_rx_channel_t *rx, uint32_t dstaddr, uint32_t count);
+static void mempoll_start_dst_discard(dmachan_rx_channel_t *rx, uint32_t count);
+static void mempoll_start_dst_data_src_zeroes(dmachan_rx_channel_t *rx, uint32_t dstaddr, uint32_t count);
+static dmachan_irq_state_t mempoll_handle_rx_poll(dmachan_rx_channel_t *rx);
+
+dmachan_rx_channel_ops_t dmachan_mempoll_rx_channel_ops = {
+        .start_dst_cmdbuf = mempoll_start_dst_cmdbuf,
+        .start_dst_reset = mempoll_start_dst_reset,
+        .start_dst_data = mempoll_start_dst_data,
+        .start_dst_discard = mempoll_start_dst_discard,
+        .start_dst_data_src_zeroes = mempoll_start_dst_data_src_zeroes,
+        .handle_rx_irq = mempoll_handle_rx_poll
+};
+
+// mempoll_try_consume takes the descriptor at the tail of the tx
+// peer's ring if it is what rx is waiting for, copying a command or
+// data segment itself, and completes rx. If the peer has posted
+// nothing yet, or has posted something rx is not (yet) waiting for,
+// it is left for a later poll.
+static void __time_critical_func(mempoll_try_consume)(dmachan_rx_channel_t *rx) {
+        dmachan_mem_dst_state_t dst_state = rx->u.mem.dst_state;
+        if (dst_state == DMACHAN_MEM_DST_IDLE)
+                return;
+
+        dmachan_tx_channel_t *txpeer = rx->u.mem.tx_peer;
+        dmachan_mem_desc_t *d = mem_ring_peek(txpeer->u.mem.ring);
+        if (!d)
+                return;
+
+        dmachan_link_t *rxl = &rx->link;
+        switch (dst_state) {
+        case DMACHAN_MEM_DST_CMDBUF:
+                if (d->kind != DMACHAN_MEM_DESC_CMD)
+                        return;
+
+                mem_desc_copy_cmd(rxl, d);
+                trace_dmachan_cmd(PCH_TRC_RT_DMACHAN_MEMCHAN_RX_CMD, rxl);
+                break;
+
+        case DMACHAN_MEM_DST_DATA:
+                if (d->kind != DMACHAN_MEM_DESC_DATA)
+                        return;
+
+                assert(d->count == rx->u.mem.count);
+                memcpy((void*)rx->u.mem.dstaddr, (void*)d->srcaddr,
+                        rx->u.mem.count);
+                break;
+
+        case DMACHAN_MEM_DST_DISCARD:
+                if (d->kind != DMACHAN_MEM_DESC_DATA)
+                        return;
+
+                break;
+
+        default:
+                panic("mempoll_try_consume unexpected rx->mem_dst_state");
+                // NOTREACHED
+                break;
+        }
+
+        mem_ring_pop(txpeer->u.mem.ring);
+        rxl->complete = true;
+        dmachan_set_mem_dst_state(rx, DMACHAN_MEM_DST_IDLE);
+}
+
+static void __time_critical_func(mempoll_start_dst_cmdbuf)(dmachan_rx_channel_t *rx) {
+        valid_params_if(PCH_DMACHAN,
+                rx->u.mem.dst_state == DMACHAN_MEM_DST_IDLE);
+
+        trace_dmachan_byte(PCH_TRC_RT_DMACHAN_DST_CMDBUF_MEM, &rx->link,
+                rx->u.mem.tx_peer->u.mem.src_state);
+
+        dmachan_set_mem_dst_state(rx, DMACHAN_MEM_DST_CMDBUF);
+        mempoll_try_consume(rx);
+}
+
+static void __time_critical_func(mempoll_start_dst_reset)(dmachan_rx_channel_t *rx) {
+        trace_dmachan_byte(PCH_TRC_RT_DMACHAN_DST_RESET, &rx->link,
+                DMACHAN_RESET_BYPASSED);
+        mempoll_start_dst_cmdbuf(rx);
+}
+
+static void __time_critical_func(mempoll_start_dst_data)(dmachan_rx_channel_t *rx, uint32_t dstaddr, uint32_t count) {
+        valid_params_if(PCH_DMACHAN,
+                rx->u.mem.dst_state == DMACHAN_MEM_DST_IDLE);
+
+        trace_dmachan_segment_memstate(PCH_TRC_RT_DMACHAN_DST_DATA_MEM,
+                &rx->link, dstaddr, count,
+                rx->u.mem.tx_peer->u.mem.src_state);
+
+        rx->u.mem.dstaddr = dstaddr;
+        rx->u.mem.count = count;
+        dmachan_set_mem_dst_state(rx, DMACHAN_MEM_DST_DATA);
+        mempoll_try_consume(rx);
+}
+
+static void __time_critical_func(mempoll_start_dst_discard)(dmachan_rx_channel_t *rx, uint32_t count) {
+        valid_params_if(PCH_DMACHAN,
+                rx->u.mem.dst_state == DMACHAN_MEM_DST_IDLE);
+
+        trace_dmachan_segment_memstate(PCH_TRC_RT_DMACHAN_DST_DISCARD_MEM,
+                &rx->link, 0, count, rx->u.mem.tx_peer->u.mem.src_state);
+
+        dmachan_set_mem_dst_state(rx, DMACHAN_MEM_DST_DISCARD);
+        mempoll_try_consume(rx);
+}
+
+// With no DMA to do it for us, we zero the destination directly and
+// the rx side completes immediately without involving the tx peer
+static void __time_critical_func(mempoll_start_dst_data_src_zeroes)(dmachan_rx_channel_t *rx, uint32_t dstaddr, uint32_t count) {
+        valid_params_if(PCH_DMACHAN,
+                rx->u.mem.dst_state == DMACHAN_MEM_DST_IDLE);
+
+        dmachan_link_t *rxl = &rx->link;
+        dmachan_link_cmd_set_zero(rxl);
+        memset((void*)dstaddr, 0, count);
+        rxl->complete = true;
+}
+
+static dmachan_irq_state_t __time_critical_func(mempoll_handle_rx_poll)(dmachan_rx_channel_t *rx) {
+        dmachan_link_t *rxl = &rx->link;
+        mempoll_try_consume(rx);
+        return dmachan_make_irq_state(false, false, rxl->complete);
+}
@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2025 Malcolm Beattie
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "memchan_internal.h"
+
+static void mempoll_start_src_cmdbuf(dmachan_tx_channel_t *tx);
+static void mempoll_write_src_reset(dmachan_tx_channel_t *tx);
+static void mempoll_start_src_data(dmachan_tx_channel_t *tx, uint32_t srcaddr, uint32_t count);
+static dmachan_irq_state_t mempoll_handle_tx_poll(dmachan_tx_channel_t *tx);
+
+dmachan_tx_channel_ops_t dmachan_mempoll_tx_channel_ops = {
+        .start_src_cmdbuf = mempoll_start_src_cmdbuf,
+        .write_src_reset = mempoll_write_src_reset,
+        .start_src_data = mempoll_start_src_data,
+        .handle_tx_dma_irq = mempoll_handle_tx_poll
+};
+
+static void __time_critical_func(mempoll_start_src_cmdbuf)(dmachan_tx_channel_t *tx) {
+        valid_params_if(PCH_DMACHAN,
+                tx->u.mem.src_state == DMACHAN_MEM_SRC_IDLE);
+
+        dmachan_link_t *txl = &tx->link;
+        trace_dmachan_byte(PCH_TRC_RT_DMACHAN_SRC_CMDBUF_MEM, txl,
+                tx->u.mem.rx_peer->u.mem.dst_state);
+
+        dmachan_set_mem_src_state(tx, DMACHAN_MEM_SRC_CMDBUF);
+        if (mem_tx_try_post(tx)) {
+                // complete synchronously, as for a DMA-driven memchan
+                trace_dmachan_cmd(PCH_TRC_RT_DMACHAN_MEMCHAN_TX_CMD, txl);
+                dmachan_set_mem_src_state(tx, DMACHAN_MEM_SRC_IDLE);
+                tx->u.mem.posted = false;
+                txl->complete = true;
+        }
+}
+
+static void __time_critical_func(mempoll_write_src_reset)(dmachan_tx_channel_t *tx) {
+        trace_dmachan(PCH_TRC_RT_DMACHAN_SRC_RESET_REMOTE, &tx->link);
+        // As for a DMA-driven memchan, there is nothing to reset
+        (void)tx;
+}
+
+static void __time_critical_func(mempoll_start_src_data)(dmachan_tx_channel_t *tx, uint32_t srcaddr, uint32_t count) {
+        valid_params_if(PCH_DMACHAN,
+                tx->u.mem.src_state == DMACHAN_MEM_SRC_IDLE);
+
+        trace_dmachan_segment_memstate(PCH_TRC_RT_DMACHAN_SRC_DATA_MEM,
+                &tx->link, srcaddr, count,
+                tx->u.mem.rx_peer->u.mem.dst_state);
+
+        tx->u.mem.srcaddr = srcaddr;
+        tx->u.mem.count = count;
+        dmachan_set_mem_src_state(tx, DMACHAN_MEM_SRC_DATA);
+        mem_tx_try_post(tx);
+}
+
+static dmachan_irq_state_t __time_critical_func(mempoll_handle_tx_poll)(dmachan_tx_channel_t *tx) {
+        dmachan_link_t *txl = &tx->link;
+        if (mem_tx_check_complete(tx))
+                txl->complete = true;
+
+        return dmachan_make_irq_state(false, false, txl->complete);
+}
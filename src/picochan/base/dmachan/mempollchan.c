@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2025 Malcolm Beattie
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "memchan_internal.h"
+
+// A polled memchan claims no DMA channels and enables no interrupts.
+// Its links get DMACHAN_MEMPOLL_DMAID and an irq_index of -1 so that
+// any attempt to use them as DMA-driven links is caught by the
+// existing parameter assertions.
+static void init_mempoll_link(dmachan_link_t *l) {
+        dmachan_link_cmd_set_zero(l);
+        l->dmaid = DMACHAN_MEMPOLL_DMAID;
+        l->irq_index = -1;
+        l->complete = false;
+        l->resetting = false;
+}
+
+void pch_channel_init_memchan_polled(pch_channel_t *ch, uint8_t id, pch_channel_t *chpeer) {
+        pch_channel_init_memchan_polled_ring(ch, id, chpeer,
+                &ch->tx.u.mem.own_ring);
+}
+
+void pch_channel_init_memchan_polled_ring(pch_channel_t *ch, uint8_t id, pch_channel_t *chpeer, dmachan_mem_ring_t *ring) {
+        assert(!pch_channel_is_started(ch));
+        assert(!pch_channel_is_configured(ch));
+        assert(!pch_channel_is_configured(chpeer)
+                || pch_channel_is_polled(chpeer));
+
+        dmachan_tx_channel_t *tx = &ch->tx;
+        tx->ops = &dmachan_mempoll_tx_channel_ops;
+        init_mempoll_link(&tx->link);
+        dmachan_init_mem_tx_state(tx, ring);
+
+        dmachan_rx_channel_t *rx = &ch->rx;
+        rx->ops = &dmachan_mempoll_rx_channel_ops;
+        init_mempoll_link(&rx->link);
+        dmachan_init_mem_rx_state(rx);
+
+        // As for pch_channel_init_memchan, our tx->u.mem.rx_peer is
+        // set when chpeer is initialised (before or after us) so
+        // must not be touched here.
+        dmachan_tx_channel_t *txpeer = &chpeer->tx;
+        txpeer->u.mem.rx_peer = rx;
+        rx->u.mem.tx_peer = txpeer;
+
+        ch->flags |= PCH_CHANNEL_POLLED;
+        pch_channel_configure_id(ch, id);
+}
@@ -26,6 +26,11 @@ void dmachan_init_rx_channel(dmachan_rx_channel_t *rx, dmachan_1way_config_t *d1
 }
 
 void __time_critical_func(dmachan_start_dst_data_src_zeroes)(dmachan_rx_channel_t *rx, uint32_t dstaddr, uint32_t count) {
+        if (rx->ops->start_dst_data_src_zeroes) {
+                rx->ops->start_dst_data_src_zeroes(rx, dstaddr, count);
+                return;
+        }
+
         if (rx->ops->prep_dst_data_src_zeroes)
                 rx->ops->prep_dst_data_src_zeroes(rx, dstaddr, count);
 
@@ -22,6 +22,7 @@
 #include "pico/platform/compiler.h"
 #include "picochan/dmachan_defs.h"
 #include "picochan/ids.h"
+#include "picochan/placement.h"
 #include "picochan/trc.h"
 
 // General Pico SDK-like DMA-related functions that aren't in the SDK
@@ -176,11 +177,65 @@ void pch_piochan_init(pch_pio_config_t *cfg);
 
 // Memory channel (memchan) configuration
 
-// pch_memchan_init must be called before configuring either side of
-// any memchan CU with pch_cus_memcu_configure or
-// pch_chp_configure_memchan
+// pch_memchan_init is retained for compatibility with existing
+// applications. memchans no longer share a global spin lock so there
+// is nothing to initialise and calling it is optional.
 void pch_memchan_init(void);
 
+// DMACHAN_MEM_RING_SIZE is the number of descriptors in the ring in
+// which the tx side of a memchan posts commands and data segments
+// for its rx peer. It must be a power of 2.
+#ifndef DMACHAN_MEM_RING_SIZE
+#define DMACHAN_MEM_RING_SIZE 4
+#endif
+static_assert((DMACHAN_MEM_RING_SIZE & (DMACHAN_MEM_RING_SIZE - 1)) == 0,
+        "DMACHAN_MEM_RING_SIZE must be a power of 2");
+
+#define DMACHAN_MEM_DESC_CMD    0
+#define DMACHAN_MEM_DESC_DATA   1
+
+// dmachan_mem_desc_t describes either a command (cmd) or a data
+// segment (srcaddr and count) posted by a memchan tx side
+typedef struct dmachan_mem_desc {
+        dmachan_cmd_t           cmd;
+        uint32_t                srcaddr;
+        uint32_t                count;
+        uint8_t                 kind;
+#ifdef PCH_CONFIG_DEBUG_MEMCHAN
+        uint16_t                seqnum;
+#endif
+} dmachan_mem_desc_t;
+
+// dmachan_mem_ring_t is a single-producer, single-consumer ring of
+// descriptors for one direction of a memchan. Only the tx side
+// writes head (after filling in the descriptor it adds) and only the
+// rx side writes tail (after it has finished with the descriptor it
+// removes) so the two sides, and independent memchans, synchronise
+// with nothing more than ordered loads and stores of these counters.
+// head and tail count up freely and are reduced modulo
+// DMACHAN_MEM_RING_SIZE only to index desc.
+typedef struct dmachan_mem_ring {
+        volatile uint32_t       head;
+        volatile uint32_t       tail;
+        dmachan_mem_desc_t      desc[DMACHAN_MEM_RING_SIZE];
+} dmachan_mem_ring_t;
+
+// DMACHAN_MEM_RING_SRAM_BANK is the SRAM bank (MAIN, SCRATCH_X or
+// SCRATCH_Y, see picochan/placement.h) holding the memchan rings.
+// Rings are shared between the two cores so the CSS and the CUs keep
+// them not in their channels but in arrays of their own, one ring for
+// each channel and each CU, which lets them be placed apart from CSS
+// and CU state.
+// Default MAIN, whose striping spreads the accesses of the two cores
+// across banks.
+#ifndef DMACHAN_MEM_RING_SRAM_BANK
+#define DMACHAN_MEM_RING_SRAM_BANK MAIN
+#endif
+
+// DMACHAN_MEMPOLL_DMAID is the dmaid of the links of a polled
+// memchan which uses no DMA channels
+#define DMACHAN_MEMPOLL_DMAID 0xff
+
 // tx and rx channels, starting with forward declarations because
 // for memchans there is a field pointing at the peer channel
 typedef struct __aligned(4) dmachan_tx_channel dmachan_tx_channel_t;
@@ -197,6 +252,14 @@ typedef struct dmachan_tx_channel_ops {
 typedef struct dmachan_mem_tx_channel_data {
         dmachan_rx_channel_t    *rx_peer;
         dmachan_mem_src_state_t src_state;
+        bool                    posted; // current cmd/data is in ring
+        uint32_t                pos;    // ring index it was posted at
+        uint32_t                srcaddr;
+        uint32_t                count;
+        dmachan_mem_ring_t      *ring;
+        // own_ring is the ring used by a memchan initialised
+        // without one being given
+        dmachan_mem_ring_t      own_ring;
 } dmachan_mem_tx_channel_data_t;
 
 typedef struct dmachan_pio_tx_channel_data {
@@ -221,12 +284,18 @@ typedef struct dmachan_rx_channel_ops {
         void (*start_dst_data)(dmachan_rx_channel_t *rx, uint32_t dstaddr, uint32_t count);
         void (*start_dst_discard)(dmachan_rx_channel_t *rx, uint32_t count);
         void (*prep_dst_data_src_zeroes)(dmachan_rx_channel_t *rx, uint32_t dstaddr, uint32_t count);
+        // start_dst_data_src_zeroes, if set, replaces the DMA from a
+        // source of zeroes that dmachan_start_dst_data_src_zeroes
+        // otherwise starts
+        void (*start_dst_data_src_zeroes)(dmachan_rx_channel_t *rx, uint32_t dstaddr, uint32_t count);
         dmachan_irq_state_t (*handle_rx_irq)(dmachan_rx_channel_t *rx);
 } dmachan_rx_channel_ops_t;
 
 typedef struct dmachan_mem_rx_channel_data {
         dmachan_tx_channel_t    *tx_peer;
         dmachan_mem_dst_state_t dst_state;
+        uint32_t                dstaddr;
+        uint32_t                count;
 } dmachan_mem_rx_channel_data_t;
 
 typedef struct dmachan_pio_rx_channel_data {
@@ -261,6 +330,7 @@ typedef struct pch_channel {
 #define PCH_CHANNEL_CONFIGURED  0x01
 #define PCH_CHANNEL_STARTED     0x02
 #define PCH_CHANNEL_TRACED      0x04
+#define PCH_CHANNEL_POLLED      0x08
 
 static inline bool pch_channel_is_configured(pch_channel_t *ch) {
         return ch->flags & PCH_CHANNEL_CONFIGURED;
@@ -274,6 +344,10 @@ static inline bool pch_channel_is_traced(pch_channel_t *ch) {
         return ch->flags & PCH_CHANNEL_TRACED;
 }
 
+static inline bool pch_channel_is_polled(pch_channel_t *ch) {
+        return ch->flags & PCH_CHANNEL_POLLED;
+}
+
 static inline void pch_channel_configure_id(pch_channel_t *ch, uint8_t id) {
         assert(!pch_channel_is_configured(ch));
         ch->id = id;
@@ -308,8 +382,31 @@ static inline void pch_channel_trace(pch_channel_t *ch, pch_trc_bufferset_t *bs)
 
 void pch_channel_init_uartchan(pch_channel_t *ch, uint8_t id, uart_inst_t *uart, pch_uartchan_config_t *cfg);
 void pch_channel_init_piochan(pch_channel_t *ch, uint8_t id, pch_pio_config_t *cfg, pch_piochan_config_t *pc);
+// pch_channel_init_memchan initialises ch as a memchan to chpeer
+// which sends to chpeer through a ring held in ch itself.
 void pch_channel_init_memchan(pch_channel_t *ch, uint8_t id, uint dmairqix, pch_channel_t *chpeer);
 
+// pch_channel_init_memchan_ring is pch_channel_init_memchan but ch
+// sends to chpeer through ring instead, which can then be placed
+// apart from ch (see DMACHAN_MEM_RING_SRAM_BANK). ring must not be
+// used by any other channel and may be reused by ch if ch is
+// initialised again.
+void pch_channel_init_memchan_ring(pch_channel_t *ch, uint8_t id, uint dmairqix, pch_channel_t *chpeer, dmachan_mem_ring_t *ring);
+
+// pch_channel_init_memchan_polled initialises ch as a memchan, like
+// pch_channel_init_memchan, but one that uses no DMA channels and
+// raises no interrupts. Each side instead copies commands and data
+// itself when it finds them posted in its peer's ring during
+// pch_channel_poll. chpeer must be unconfigured or itself a polled
+// memchan. It is intended for when the CSS and CU each have a core
+// to themselves and spin on pch_css_poll and pch_cus_poll.
+void pch_channel_init_memchan_polled(pch_channel_t *ch, uint8_t id, pch_channel_t *chpeer);
+
+// pch_channel_init_memchan_polled_ring is
+// pch_channel_init_memchan_polled but, as for
+// pch_channel_init_memchan_ring, ch sends to chpeer through ring.
+void pch_channel_init_memchan_polled_ring(pch_channel_t *ch, uint8_t id, pch_channel_t *chpeer, dmachan_mem_ring_t *ring);
+
 // tx channel irq and memory source state handling
 static inline void dmachan_set_mem_src_state(dmachan_tx_channel_t *tx, dmachan_mem_src_state_t new_state) {
         valid_params_if(PCH_DMACHAN,
@@ -328,8 +425,6 @@ static inline void dmachan_set_mem_dst_state(dmachan_rx_channel_t *rx, dmachan_m
         rx->u.mem.dst_state = new_state;
 }
 
-void dmachan_panic_unless_memchan_initialised(void);
-
 // Methods for dmachan_rx_channel_t
 
 static inline void dmachan_start_src_cmdbuf(dmachan_tx_channel_t *tx) {
@@ -368,6 +463,12 @@ void dmachan_start_dst_data_src_zeroes(dmachan_rx_channel_t *rx, uint32_t dstadd
 // whenever there is a DMA interrupt that may be relevant to it.
 void pch_channel_handle_dma_irq(pch_channel_t *ch);
 
+// pch_channel_poll() checks a polled channel for tx and rx
+// completions, setting the complete flag of the corresponding link
+// as pch_channel_handle_dma_irq() would for a DMA-driven channel,
+// and returns true if either link is complete.
+bool pch_channel_poll(pch_channel_t *ch);
+
 // pch_channel_handle_pio_irq() must be called for each channel
 // whenever there is a PIO interrupt that may be relevant to it.
 void pch_channel_handle_pio_irq(pch_channel_t *ch, uint irqnum);
@@ -19,7 +19,8 @@ typedef enum __attribute__((packed)) dmachan_mem_dst_state {
         DMACHAN_MEM_DST_CMDBUF,
         DMACHAN_MEM_DST_DATA,
         DMACHAN_MEM_DST_DISCARD,
-        DMACHAN_MEM_DST_SRC_ZEROES
+        DMACHAN_MEM_DST_SRC_ZEROES,
+        DMACHAN_MEM_DST_DATA_DMA
 } dmachan_mem_dst_state_t;
 
 // dmachan_irq_state_t represents the state of a given DMA id
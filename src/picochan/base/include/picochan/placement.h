@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2025 Malcolm Beattie
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _PCH_API_PLACEMENT_H
+#define _PCH_API_PLACEMENT_H
+
+#include "pico/platform/compiler.h"
+
+/*! \file picochan/placement.h
+ *  \ingroup picochan_base
+ *
+ * \brief Placement of picochan state in SRAM banks
+ *
+ * RP2040 and RP2350 SRAM is a set of main banks, striped word by word
+ * so that accesses spread across them, plus two small unstriped
+ * banks, SCRATCH_X and SCRATCH_Y. By default, core 0's stack is at
+ * the top of SCRATCH_Y and core 1's stack (when launched with
+ * multicore_launch_core1) at the top of SCRATCH_X. When both cores
+ * access the same bank in the same cycle, one of them stalls.
+ *
+ * Each of the bank configuration macros (PCH_CSS_SRAM_BANK,
+ * PCH_CU_SRAM_BANK, PCH_CSS_TRACE_SRAM_BANK, PCH_CUS_TRACE_SRAM_BANK
+ * and DMACHAN_MEM_RING_SRAM_BANK) is set to one of the tokens MAIN,
+ * SCRATCH_X or SCRATCH_Y, for example with -DPCH_CSS_SRAM_BANK=SCRATCH_Y.
+ * A good starting point is to keep state used only by one core in
+ * the scratch bank holding that core's stack, which the other core
+ * then never touches, and to leave state that both cores use, such
+ * as memchan rings, in main SRAM. The scratch banks are only 4KB
+ * each so the linker fails if too much is placed in them.
+ */
+
+#define PCH_SRAM_MAIN_PLACEMENT(group)
+#define PCH_SRAM_SCRATCH_X_PLACEMENT(group) __scratch_x(group)
+#define PCH_SRAM_SCRATCH_Y_PLACEMENT(group) __scratch_y(group)
+
+#define __PCH_SRAM_PLACEMENT(bank, group) PCH_SRAM_##bank##_PLACEMENT(group)
+
+/*! \def PCH_SRAM_PLACEMENT
+ *  \ingroup picochan_base
+ *  \hideinitializer
+ *  \brief the attribute placing a variable in SRAM bank (MAIN,
+ *  SCRATCH_X or SCRATCH_Y) in a section named after group
+ *
+ * bank may itself be a macro, such as PCH_CU_SRAM_BANK. For example,
+ * static pch_cu_t PCH_SRAM_PLACEMENT(SCRATCH_X, "mycu") mycu = PCH_CU_INIT(4);
+ */
+#define PCH_SRAM_PLACEMENT(bank, group) __PCH_SRAM_PLACEMENT(bank, group)
+
+#endif
@@ -21,6 +21,11 @@
  * (forming a little-endian encoding of the whole value) but the
  * intended way of accessing the value is with
  * pch_trc_timestamp_to_us().
+ *
+ * When PCH_TRC_TIMESTAMP_32 is enabled, the timestamp instead holds
+ * just the low 32 bits of the number of microseconds since boot and
+ * high is PCH_TRC_TIMESTAMP_32_MARK. The full value is reconstructed
+ * off-platform from the nearest TRC_TIME_SYNC trace record.
  */
 typedef struct pch_trc_timestamp {
         uint16_t low;
@@ -41,15 +46,85 @@ static inline void pch_trc_write_timestamp(pch_trc_timestamp_t *tp, uint64_t us)
         hp[2] = (uint16_t)(us >> 32); // low 16 bits of top 32: t.high
 }
 
+// PCH_TRC_TIMESTAMP_32_MARK in the high field of a timestamp marks
+// it as holding only the low 32 bits of the time. As a 48-bit
+// number of microseconds it would be thousands of years after boot.
+#define PCH_TRC_TIMESTAMP_32_MARK 0xffff
+
+static inline bool pch_trc_timestamp_is_32(pch_trc_timestamp_t t) {
+        return t.high == PCH_TRC_TIMESTAMP_32_MARK;
+}
+
+static inline uint32_t pch_trc_timestamp_to_us32(pch_trc_timestamp_t t) {
+        return (((uint32_t) t.mid) << 16) + t.low;
+}
+
+static inline void pch_trc_write_timestamp32(pch_trc_timestamp_t *tp, uint32_t us) {
+        uint16_t *hp = (uint16_t*)tp;
+        hp[0] = (uint16_t)us;
+        hp[1] = (uint16_t)(us >> 16);
+        hp[2] = PCH_TRC_TIMESTAMP_32_MARK;
+}
+
 // The following macro definition nastiness allows a host-based
 // trace dump program to redefine these macros to build a list
 // of the record type names along with the enum values themselves.
-#define PCH_TRC_RT(rt) PCH_TRC_RT_ ## rt
+#define PCH_TRC_RT(rt, group) PCH_TRC_RT_ ## rt,
 
 typedef enum __attribute__((__packed__)) pch_trc_record_type {
 #include "picochan/trc_record_types.h"
 } pch_trc_record_type_t;
 
+#undef PCH_TRC_RT
+
+/*! \brief Trace groups: each trace record type belongs to one
+ *  \ingroup internal_trc
+ *
+ * The group of each record type is listed along with it in
+ * picochan/trc_record_types.h. Record types from USER_FIRST onwards,
+ * written with pch_css_trace_write_user(), are in group USER.
+ */
+#define PCH_TRC_GROUP_CSS_API           0x01 //!< CSS and subchannel API calls and configuration
+#define PCH_TRC_GROUP_CSS_IRQ           0x02 //!< CSS channel program and packet handling
+#define PCH_TRC_GROUP_CSS_COMPLETION    0x04 //!< CSS I/O completion notifications and callbacks
+#define PCH_TRC_GROUP_CUS               0x08 //!< CU-side configuration and packet handling
+#define PCH_TRC_GROUP_DMACHAN           0x10 //!< dmachan link transfers and IRQs
+#define PCH_TRC_GROUP_HLDEV             0x20 //!< hldev device operations
+#define PCH_TRC_GROUP_TRC               0x40 //!< tracing itself: enablement, padding, time sync
+#define PCH_TRC_GROUP_USER              0x80 //!< application records from USER_FIRST onwards
+#define PCH_TRC_GROUP_ALL               0xff
+
+/*! \brief Which trace groups have trace records compiled in
+ *  \ingroup internal_trc
+ *
+ * A mask of PCH_TRC_GROUP_* values. Code to write trace records of
+ * types in groups not in the mask is not compiled in at all, not
+ * even the test of the run-time trace flags and the gathering of
+ * the record data, so a production build can keep, for example,
+ * just I/O completion records with
+ * PCH_TRC_GROUP_CSS_COMPLETION. Group TRC is always included.
+ * Only relevant when PCH_CONFIG_ENABLE_TRACE is enabled.
+ * Default PCH_TRC_GROUP_ALL.
+ */
+#ifndef PCH_CONFIG_TRACE_GROUPS
+#define PCH_CONFIG_TRACE_GROUPS PCH_TRC_GROUP_ALL
+#endif
+
+/*! \brief the PCH_TRC_GROUP_* group of record type rt
+ *  \ingroup internal_trc
+ *
+ * Folds to a constant when rt is one.
+ */
+static inline uint32_t pch_trc_rt_group(pch_trc_record_type_t rt) {
+        switch (rt) {
+#define PCH_TRC_RT(rt, group) case PCH_TRC_RT_ ## rt: return PCH_TRC_GROUP_ ## group;
+#include "picochan/trc_record_types.h"
+#undef PCH_TRC_RT
+        default:
+                return PCH_TRC_GROUP_USER;
+        }
+}
+
 typedef struct __attribute__((__packed__,__aligned__(2))) pch_trc_header {
         pch_trc_timestamp_t     timestamp;
         uint8_t                 size; // includes header and following data
@@ -88,6 +163,36 @@ typedef struct __attribute__((__packed__,__aligned__(2))) pch_trc_header {
 #define PCH_TRC_NUM_BUFFERS 2
 #endif
 
+#ifndef PCH_TRC_TIMESTAMP_32
+/*! \brief Whether trace record timestamps hold only the low 32 bits
+ * of the microsecond timer
+ *  \ingroup internal_trc
+ *
+ * Reading the low 32 bits of the timer is a single register load
+ * instead of the multiple loads (retried if the high word changes)
+ * needed for the full 64-bit time. A TRC_TIME_SYNC trace record
+ * with the full time is written into each trace buffer and at least
+ * every PCH_TRC_SYNC_INTERVAL_US so that pch_dump_trace can
+ * reconstruct the full time of each record. Only relevant when
+ * PCH_CONFIG_ENABLE_TRACE is enabled.
+ * Default 0.
+ */
+#define PCH_TRC_TIMESTAMP_32 0
+#endif
+
+#ifndef PCH_TRC_SYNC_INTERVAL_US
+/*! \brief The maximum interval in microseconds between TRC_TIME_SYNC
+ * records in a bufferset when PCH_TRC_TIMESTAMP_32 is enabled
+ *  \ingroup internal_trc
+ *
+ * Must be well below 2^31 (about 35 minutes), the furthest a
+ * record can be from a TRC_TIME_SYNC record for its time to be
+ * reconstructed.
+ * Default 1000000 (1 second).
+ */
+#define PCH_TRC_SYNC_INTERVAL_US 1000000
+#endif
+
 /*! \brief pch_trc_buffer_size is initialised to PCH_TRC_BUFFER_SIZE so that
  * its value is visible in memory
  *  \ingroup internal_trc
@@ -114,6 +219,27 @@ extern uint32_t pch_trc_num_buffers;
 #endif
 // end of PCH_CONFIG_ENABLE_TRACE section
 
+/*! \brief the generation of the buffer of a bufferset cursor
+ *  \ingroup internal_trc
+ */
+static inline uint32_t pch_trc_cursor_gen(uint32_t cursor) {
+        return cursor >> 16;
+}
+
+/*! \brief the byte offset in its buffer of a bufferset cursor
+ *  \ingroup internal_trc
+ *
+ * While a buffer is being switched, the offset may briefly exceed
+ * the buffer size.
+ */
+static inline uint32_t pch_trc_cursor_pos(uint32_t cursor) {
+        return cursor & 0xffff;
+}
+
+static inline uint32_t pch_trc_make_cursor(uint32_t gen, uint32_t pos) {
+        return (gen << 16) | pos;
+}
+
 /*! \brief set of buffers and metadata for a subsystem to use tracing
  *  \ingroup internal_trc
  *
@@ -127,22 +253,37 @@ extern uint32_t pch_trc_num_buffers;
  * the ring and, optionally, an interrupt is generated so that the
  * previous buffer can be archived elsewhere before the ring wraps.
  *
+ * Trace records are written from any core and any IRQ level without
+ * a lock: each writer reserves its slot with an atomic fetch-and-add
+ * on the cursor. The single writer whose reservation crosses the
+ * end of the current buffer seals it by writing a TRC_PAD record
+ * where its own record did not fit and any writer finding itself
+ * past the end switches the cursor to the next buffer, so no writer
+ * ever waits for another. A CSS, its CUs and the dmachan links of
+ * channels between them, whichever core they run on, can therefore
+ * all share one bufferset.
+ *
  * When compile-time trace support is not enabled, PCH_TRC_NUM_BUFFERS
  * is defined as 0 so this struct can be instantiated but not used.
  */
 typedef struct pch_trc_bufferset {
-        //! the index in buffers of the current buffer being appended to
-        uint32_t        current_buffer_num;
-
-        //! \brief the byte offset in the current buffer where the
-        //! next trace record will be written.
-        uint32_t        current_buffer_pos;
+        //! \brief the generation of the current buffer being
+        //! appended to (top 16 bits) and the byte offset in it where
+        //! the next trace record will be written (bottom 16 bits).
+        //!
+        //! The index in buffers of the current buffer is its
+        //! generation modulo num_buffers. The cursor is only ever
+        //! changed atomically, by a fetch-and-add of the size of a
+        //! trace record to reserve a slot for it or by a
+        //! compare-and-swap to switch to the next buffer. Use
+        //! pch_trc_cursor_gen() and pch_trc_cursor_pos() to decode it.
+        uint32_t        cursor;
 
         //! \brief the irq_num_t of an IRQ or -1
         //!
         //! When not -1, raised when pch_trc_switch_to_next_buffer is
         //! called either by explicit invocation or when writing a
-        //! trace record skips to the next trace buffer because the
+        //! trace record switches to the next trace buffer because the
         //! current buffer is full.
         int16_t         irqnum;
 
@@ -156,6 +297,12 @@ typedef struct pch_trc_bufferset {
         uint32_t        magic;
         uint32_t        buffer_size;
         uint16_t        num_buffers;
+        //! \brief the generation of the buffer into which the last
+        //! TRC_TIME_SYNC record was written (PCH_TRC_TIMESTAMP_32 only)
+        uint16_t        sync_gen;
+        //! \brief the low 32 bits of the time of the last
+        //! TRC_TIME_SYNC record (PCH_TRC_TIMESTAMP_32 only)
+        uint32_t        sync_us;
         //! \brief the array of trace buffers.
         //!
         //! It is treated as a single ring buffer of trace records.
@@ -167,6 +314,32 @@ typedef struct pch_trc_bufferset {
         void            *buffers[PCH_TRC_NUM_BUFFERS];
 } pch_trc_bufferset_t;
 
+/*! \brief magic number at the start of each frame of a drained trace stream
+ *  \ingroup internal_trc
+ */
+#define PCH_TRC_FRAME_MAGIC 0x70437446
+
+/*! \brief header of each frame of a drained trace stream
+ *  \ingroup internal_trc
+ *
+ * A trace drain (see picochan/trc_drain.h) sends each trace buffer
+ * that has been filled to its sink as a frame consisting of this
+ * header followed by the size bytes of the buffer itself. A host-side
+ * receiver uses the magic number to find the start of a frame in the
+ * stream and the generation and counters to notice what is missing.
+ */
+typedef struct pch_trc_frame {
+        uint32_t        magic;          // PCH_TRC_FRAME_MAGIC
+        uint32_t        bs_magic;       // magic of the drained bufferset
+        uint16_t        gen;            // generation of the buffer
+        uint16_t        size;           // bytes of buffer that follow
+        //! \brief buffers never sent, since the drain started
+        uint32_t        dropped;
+        //! \brief buffers overwritten while being sent, since the
+        //! drain started
+        uint32_t        overrun;
+} pch_trc_frame_t;
+
 void pch_trc_write_raw(pch_trc_bufferset_t *bs, pch_trc_record_type_t rt, void *data, uint8_t data_size);
 
 #endif
@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2025 Malcolm Beattie
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _PCH_API_TRC_DRAIN_H
+#define _PCH_API_TRC_DRAIN_H
+
+#include "hardware/uart.h"
+#include "picochan/ids.h"
+#include "picochan/trc.h"
+
+/*! \file picochan/trc_drain.h
+ *  \defgroup picochan_trc_drain picochan_trc_drain
+ *
+ * \brief Continuous draining of trace buffers to a sink
+ *
+ * A trace drain sends each buffer of a trace bufferset, once it has
+ * been filled and tracing has moved on to the next buffer, to a sink
+ * (a UART, an area of memory or anything else implementing
+ * pch_trc_sink_ops_t) so that trace records are not lost when the
+ * ring of buffers wraps. Each buffer is sent as a frame: a
+ * pch_trc_frame_t header followed by the buffer contents. A buffer
+ * which is overwritten before the drain gets to it is counted as
+ * dropped and one which is overwritten while it is being sent is
+ * counted as overrun. Both counts are carried in each frame header.
+ *
+ * The drain is run from the IRQ handler of a user IRQ which it
+ * claims on the core that calls pch_trc_drain_start() and which is
+ * raised whenever the bufferset switches buffers. Switches made by
+ * trace records written from the other core raise the IRQ on that
+ * core instead so such buffers are only drained at the next switch
+ * made from the drain's own core (or call to pch_trc_drain_flush()).
+ */
+
+typedef struct pch_trc_drain pch_trc_drain_t;
+typedef struct pch_trc_sink pch_trc_sink_t;
+
+/*! \brief Operations implemented by a trace drain sink
+ *  \ingroup picochan_trc_drain
+ */
+typedef struct pch_trc_sink_ops {
+        //! \brief start sending len bytes at data.
+        //!
+        //! Returns false if the sink cannot send the data, in which
+        //! case the buffer being sent is counted as dropped.
+        //! Otherwise, the sink must call pch_trc_drain_sink_done(d)
+        //! once it has finished with the data, either before
+        //! returning or later, such as from a DMA completion IRQ
+        //! handler on the same core.
+        bool (*start)(pch_trc_sink_t *sink, pch_trc_drain_t *d, const void *data, uint32_t len);
+} pch_trc_sink_ops_t;
+
+/*! \brief A trace drain sink
+ *  \ingroup picochan_trc_drain
+ *
+ * Sink implementations embed this as the first member of their own
+ * struct.
+ */
+struct pch_trc_sink {
+        const pch_trc_sink_ops_t *ops;
+};
+
+/*! \brief A trace drain
+ *  \ingroup picochan_trc_drain
+ *
+ * Fields are only changed by the drain's IRQ handler apart from
+ * busy which pch_trc_drain_sink_done() clears.
+ */
+struct pch_trc_drain {
+        pch_trc_bufferset_t     *bs;
+        pch_trc_sink_t          *sink;
+        //! \brief header of the frame currently being sent
+        pch_trc_frame_t         frame;
+        //! \brief number of frames sent
+        uint32_t                frames;
+        //! \brief number of buffers never sent
+        uint32_t                dropped;
+        //! \brief number of buffers overwritten while being sent
+        uint32_t                overrun;
+        //! \brief generation of the next buffer to send
+        uint16_t                next_gen;
+        int16_t                 irqnum;
+        uint8_t                 state;
+        volatile bool           busy;
+};
+
+/*! \brief Starts draining bufferset bs to sink
+ *  \ingroup picochan_trc_drain
+ *
+ * Claims an unused user IRQ on the calling core, installs the drain
+ * IRQ handler for it and sets it as the irqnum of bs. The first
+ * buffer to be drained is the one currently being written.
+ */
+void pch_trc_drain_start(pch_trc_drain_t *d, pch_trc_bufferset_t *bs, pch_trc_sink_t *sink);
+
+/*! \brief Called by a sink when it has finished sending the data
+ * passed to its start operation
+ *  \ingroup picochan_trc_drain
+ */
+void pch_trc_drain_sink_done(pch_trc_drain_t *d);
+
+/*! \brief Seals the current buffer of the drained bufferset so
+ * that it is drained along with any others not yet sent
+ *  \ingroup picochan_trc_drain
+ *
+ * Must be called from the core that started the drain.
+ */
+void pch_trc_drain_flush(pch_trc_drain_t *d);
+
+/*! \brief Returns true if the drain has no sealed buffers left to send
+ *  \ingroup picochan_trc_drain
+ */
+bool pch_trc_drain_is_idle(pch_trc_drain_t *d);
+
+/*! \brief A sink that appends frames to an area of memory
+ *  \ingroup picochan_trc_drain
+ *
+ * Data is copied synchronously. Once the area is full, everything
+ * more is refused. The len bytes at buf can be fetched with gdb or
+ * openocd and shown with pch_dump_trace -s.
+ */
+typedef struct pch_trc_mem_sink {
+        pch_trc_sink_t  sink;
+        unsigned char   *buf;
+        uint32_t        size;
+        uint32_t        len;
+        bool            full;
+} pch_trc_mem_sink_t;
+
+pch_trc_sink_t *pch_trc_mem_sink_init(pch_trc_mem_sink_t *ms, void *buf, uint32_t size);
+
+/*! \brief A sink that sends frames by DMA to a UART
+ *  \ingroup picochan_trc_drain
+ *
+ * The stream can be captured on the host with pch_trace_recv.
+ */
+typedef struct pch_trc_uart_sink {
+        pch_trc_sink_t  sink;
+        uart_inst_t     *uart;
+        pch_trc_drain_t *drain;
+        uint8_t         dmaid;
+        pch_irq_index_t irq_index;
+} pch_trc_uart_sink_t;
+
+/*! \brief Initialises a UART sink
+ *  \ingroup picochan_trc_drain
+ *
+ * Initialises uart at baudrate for 8N1 without flow control, claims
+ * an unused DMA channel and adds a shared IRQ handler for DMA IRQ
+ * irq_index to notice when it completes. Must be called from the
+ * same core as pch_trc_drain_start() for the drain using this sink.
+ */
+pch_trc_sink_t *pch_trc_uart_sink_init(pch_trc_uart_sink_t *us, uart_inst_t *uart, uint baudrate, pch_irq_index_t irq_index);
+
+#endif
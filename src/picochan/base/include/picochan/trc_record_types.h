@@ -3,85 +3,96 @@
  * SPDX-License-Identifier: MIT
  */
 
-PCH_TRC_RT(INVALID),
-PCH_TRC_RT(CSS_SCH_START),
-PCH_TRC_RT(CSS_SCH_RESUME),
-PCH_TRC_RT(CSS_SCH_TEST),
-PCH_TRC_RT(CSS_SCH_MODIFY),
-PCH_TRC_RT(CSS_SCH_STORE),
-PCH_TRC_RT(CSS_SCH_CANCEL),
-PCH_TRC_RT(CSS_SCH_CLEAR),
-PCH_TRC_RT(CSS_SCH_HALT),
-PCH_TRC_RT(CSS_CCW_FETCH),
-PCH_TRC_RT(CSS_CHP_ALLOC),
-PCH_TRC_RT(CSS_CHP_TX_DMA_INIT),
-PCH_TRC_RT(CSS_CHP_RX_DMA_INIT),
-PCH_TRC_RT(CSS_CHP_CONFIGURED),
-PCH_TRC_RT(CSS_CHP_TRACED),
-PCH_TRC_RT(CSS_CHP_STARTED),
-PCH_TRC_RT(CSS_CHP_IRQ_PROGRESS),
-PCH_TRC_RT(CSS_RX_COMMAND_COMPLETE),
-PCH_TRC_RT(CSS_RX_DATA_COMPLETE),
-PCH_TRC_RT(CSS_SEND_TX_PACKET),
-PCH_TRC_RT(CSS_TX_COMPLETE),
-PCH_TRC_RT(CSS_SET_CORE_NUM),
-PCH_TRC_RT(CSS_SET_IRQ_INDEX),
-PCH_TRC_RT(CSS_SET_FUNC_IRQ),
-PCH_TRC_RT(CSS_SET_IO_IRQ),
-PCH_TRC_RT(CSS_SET_IO_CALLBACK),
-PCH_TRC_RT(CSS_INIT_IRQ_HANDLER),
-PCH_TRC_RT(CSS_NOTIFY),
-PCH_TRC_RT(CSS_FUNC_IRQ),
-PCH_TRC_RT(CSS_IO_CALLBACK),
-PCH_TRC_RT(CUS_QUEUE_COMMAND),
-PCH_TRC_RT(CUS_INIT),
-PCH_TRC_RT(CUS_INIT_ASYNC_CONTEXT),
-PCH_TRC_RT(CUS_CLAIM_IRQ_INDEX),
-PCH_TRC_RT(CUS_INIT_IRQ_HANDLER),
-PCH_TRC_RT(CUS_CU_REGISTER),
-PCH_TRC_RT(CUS_CU_SET_IRQ_INDEX),
-PCH_TRC_RT(CUS_CU_TX_DMA_INIT),
-PCH_TRC_RT(CUS_CU_RX_DMA_INIT),
-PCH_TRC_RT(CUS_CU_CONFIGURED),
-PCH_TRC_RT(CUS_CU_TRACED),
-PCH_TRC_RT(CUS_CU_STARTED),
-PCH_TRC_RT(CUS_DEV_TRACED),
-PCH_TRC_RT(CUS_SEND_TX_PACKET),
-PCH_TRC_RT(CUS_TX_COMPLETE),
-PCH_TRC_RT(CUS_REGISTER_CALLBACK),
-PCH_TRC_RT(CUS_CALL_CALLBACK),
-PCH_TRC_RT(CUS_RX_COMMAND_COMPLETE),
-PCH_TRC_RT(CUS_RX_DATA_COMPLETE),
-PCH_TRC_RT(DMACHAN_PIOCHAN_INIT),
-PCH_TRC_RT(DMACHAN_DST_RESET),
-PCH_TRC_RT(DMACHAN_DST_CMDBUF_REMOTE),
-PCH_TRC_RT(DMACHAN_DST_CMDBUF_MEM),
-PCH_TRC_RT(DMACHAN_DST_DATA_REMOTE),
-PCH_TRC_RT(DMACHAN_DST_DATA_MEM),
-PCH_TRC_RT(DMACHAN_DST_DISCARD_REMOTE),
-PCH_TRC_RT(DMACHAN_DST_DISCARD_MEM),
-PCH_TRC_RT(DMACHAN_SRC_CMDBUF_REMOTE),
-PCH_TRC_RT(DMACHAN_SRC_CMDBUF_MEM),
-PCH_TRC_RT(DMACHAN_SRC_RESET_REMOTE),
-PCH_TRC_RT(DMACHAN_SRC_RESET_MEM),
-PCH_TRC_RT(DMACHAN_SRC_DATA_REMOTE),
-PCH_TRC_RT(DMACHAN_SRC_DATA_MEM),
-PCH_TRC_RT(DMACHAN_FORCE_IRQ),
-PCH_TRC_RT(DMACHAN_MEMCHAN_RX_CMD),
-PCH_TRC_RT(DMACHAN_MEMCHAN_TX_CMD),
-PCH_TRC_RT(DMACHAN_DMA_IRQ),
-PCH_TRC_RT(DMACHAN_PIO_IRQ),
-PCH_TRC_RT(HLDEV_CONFIG_INIT),
-PCH_TRC_RT(HLDEV_START),
-PCH_TRC_RT(HLDEV_DEVIB_CALLBACK),
-PCH_TRC_RT(HLDEV_RECEIVING),
-PCH_TRC_RT(HLDEV_RECEIVE),
-PCH_TRC_RT(HLDEV_RECEIVE_THEN),
-PCH_TRC_RT(HLDEV_SENDING),
-PCH_TRC_RT(HLDEV_SEND),
-PCH_TRC_RT(HLDEV_SEND_THEN),
-PCH_TRC_RT(HLDEV_SEND_FINAL),
-PCH_TRC_RT(HLDEV_SEND_FINAL_THEN),
-PCH_TRC_RT(HLDEV_END),
-PCH_TRC_RT(TRC_ENABLE),
-PCH_TRC_RT(USER_FIRST)
+// Each trace record type is listed with the trace group it belongs
+// to (see PCH_CONFIG_TRACE_GROUPS in picochan/trc.h). Whoever
+// includes this file defines PCH_TRC_RT(rt, group) to pick out what
+// it needs, including any separator.
+
+PCH_TRC_RT(INVALID, TRC)
+PCH_TRC_RT(CSS_SCH_START, CSS_API)
+PCH_TRC_RT(CSS_SCH_RESUME, CSS_API)
+PCH_TRC_RT(CSS_SCH_TEST, CSS_API)
+PCH_TRC_RT(CSS_SCH_MODIFY, CSS_API)
+PCH_TRC_RT(CSS_SCH_STORE, CSS_API)
+PCH_TRC_RT(CSS_SCH_CANCEL, CSS_API)
+PCH_TRC_RT(CSS_SCH_CLEAR, CSS_API)
+PCH_TRC_RT(CSS_SCH_HALT, CSS_API)
+PCH_TRC_RT(CSS_CCW_FETCH, CSS_IRQ)
+PCH_TRC_RT(CSS_CHP_ALLOC, CSS_API)
+PCH_TRC_RT(CSS_CHP_TX_DMA_INIT, CSS_API)
+PCH_TRC_RT(CSS_CHP_RX_DMA_INIT, CSS_API)
+PCH_TRC_RT(CSS_CHP_CONFIGURED, CSS_API)
+PCH_TRC_RT(CSS_CHP_TRACED, CSS_API)
+PCH_TRC_RT(CSS_CHP_STARTED, CSS_API)
+PCH_TRC_RT(CSS_CHP_IRQ_PROGRESS, CSS_IRQ)
+PCH_TRC_RT(CSS_RX_COMMAND_COMPLETE, CSS_IRQ)
+PCH_TRC_RT(CSS_RX_DATA_COMPLETE, CSS_IRQ)
+PCH_TRC_RT(CSS_RX_BATCH, CSS_IRQ)
+PCH_TRC_RT(CSS_SEND_TX_PACKET, CSS_IRQ)
+PCH_TRC_RT(CSS_SEND_TX_BATCH, CSS_IRQ)
+PCH_TRC_RT(CSS_TX_COMPLETE, CSS_IRQ)
+PCH_TRC_RT(CSS_SET_CORE_NUM, CSS_API)
+PCH_TRC_RT(CSS_SET_IRQ_INDEX, CSS_API)
+PCH_TRC_RT(CSS_SET_FUNC_IRQ, CSS_API)
+PCH_TRC_RT(CSS_SET_IO_IRQ, CSS_API)
+PCH_TRC_RT(CSS_SET_IO_CALLBACK, CSS_API)
+PCH_TRC_RT(CSS_INIT_IRQ_HANDLER, CSS_API)
+PCH_TRC_RT(CSS_NOTIFY, CSS_COMPLETION)
+PCH_TRC_RT(CSS_FUNC_IRQ, CSS_IRQ)
+PCH_TRC_RT(CSS_IO_CALLBACK, CSS_COMPLETION)
+PCH_TRC_RT(CUS_QUEUE_COMMAND, CUS)
+PCH_TRC_RT(CUS_INIT, CUS)
+PCH_TRC_RT(CUS_INIT_ASYNC_CONTEXT, CUS)
+PCH_TRC_RT(CUS_CLAIM_IRQ_INDEX, CUS)
+PCH_TRC_RT(CUS_INIT_IRQ_HANDLER, CUS)
+PCH_TRC_RT(CUS_CU_REGISTER, CUS)
+PCH_TRC_RT(CUS_CU_SET_IRQ_INDEX, CUS)
+PCH_TRC_RT(CUS_CU_TX_DMA_INIT, CUS)
+PCH_TRC_RT(CUS_CU_RX_DMA_INIT, CUS)
+PCH_TRC_RT(CUS_CU_CONFIGURED, CUS)
+PCH_TRC_RT(CUS_CU_TRACED, CUS)
+PCH_TRC_RT(CUS_CU_STARTED, CUS)
+PCH_TRC_RT(CUS_DEV_TRACED, CUS)
+PCH_TRC_RT(CUS_SEND_TX_PACKET, CUS)
+PCH_TRC_RT(CUS_SEND_TX_BATCH, CUS)
+PCH_TRC_RT(CUS_TX_COMPLETE, CUS)
+PCH_TRC_RT(CUS_REGISTER_CALLBACK, CUS)
+PCH_TRC_RT(CUS_CALL_CALLBACK, CUS)
+PCH_TRC_RT(CUS_RX_COMMAND_COMPLETE, CUS)
+PCH_TRC_RT(CUS_RX_DATA_COMPLETE, CUS)
+PCH_TRC_RT(CUS_RX_BATCH, CUS)
+PCH_TRC_RT(DMACHAN_PIOCHAN_INIT, DMACHAN)
+PCH_TRC_RT(DMACHAN_DST_RESET, DMACHAN)
+PCH_TRC_RT(DMACHAN_DST_CMDBUF_REMOTE, DMACHAN)
+PCH_TRC_RT(DMACHAN_DST_CMDBUF_MEM, DMACHAN)
+PCH_TRC_RT(DMACHAN_DST_DATA_REMOTE, DMACHAN)
+PCH_TRC_RT(DMACHAN_DST_DATA_MEM, DMACHAN)
+PCH_TRC_RT(DMACHAN_DST_DISCARD_REMOTE, DMACHAN)
+PCH_TRC_RT(DMACHAN_DST_DISCARD_MEM, DMACHAN)
+PCH_TRC_RT(DMACHAN_SRC_CMDBUF_REMOTE, DMACHAN)
+PCH_TRC_RT(DMACHAN_SRC_CMDBUF_MEM, DMACHAN)
+PCH_TRC_RT(DMACHAN_SRC_RESET_REMOTE, DMACHAN)
+PCH_TRC_RT(DMACHAN_SRC_RESET_MEM, DMACHAN)
+PCH_TRC_RT(DMACHAN_SRC_DATA_REMOTE, DMACHAN)
+PCH_TRC_RT(DMACHAN_SRC_DATA_MEM, DMACHAN)
+PCH_TRC_RT(DMACHAN_FORCE_IRQ, DMACHAN)
+PCH_TRC_RT(DMACHAN_MEMCHAN_RX_CMD, DMACHAN)
+PCH_TRC_RT(DMACHAN_MEMCHAN_TX_CMD, DMACHAN)
+PCH_TRC_RT(DMACHAN_DMA_IRQ, DMACHAN)
+PCH_TRC_RT(DMACHAN_PIO_IRQ, DMACHAN)
+PCH_TRC_RT(HLDEV_CONFIG_INIT, HLDEV)
+PCH_TRC_RT(HLDEV_START, HLDEV)
+PCH_TRC_RT(HLDEV_DEVIB_CALLBACK, HLDEV)
+PCH_TRC_RT(HLDEV_RECEIVING, HLDEV)
+PCH_TRC_RT(HLDEV_RECEIVE, HLDEV)
+PCH_TRC_RT(HLDEV_RECEIVE_THEN, HLDEV)
+PCH_TRC_RT(HLDEV_SENDING, HLDEV)
+PCH_TRC_RT(HLDEV_SEND, HLDEV)
+PCH_TRC_RT(HLDEV_SEND_THEN, HLDEV)
+PCH_TRC_RT(HLDEV_SEND_FINAL, HLDEV)
+PCH_TRC_RT(HLDEV_SEND_FINAL_THEN, HLDEV)
+PCH_TRC_RT(HLDEV_END, HLDEV)
+PCH_TRC_RT(TRC_ENABLE, TRC)
+PCH_TRC_RT(TRC_PAD, TRC)
+PCH_TRC_RT(TRC_TIME_SYNC, TRC)
+PCH_TRC_RT(USER_FIRST, USER)
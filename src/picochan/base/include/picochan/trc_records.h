@@ -267,4 +267,10 @@ struct pch_trdata_dmachan_cmd {
         pch_dmaid_t     dmaid;
 };
 
+// full 64-bit microseconds since boot, split to keep 4-byte alignment
+struct pch_trdata_time_sync {
+        uint32_t        low;
+        uint32_t        high;
+};
+
 #endif
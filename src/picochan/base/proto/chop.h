@@ -8,8 +8,7 @@
 
 // proto_chop_t represents a channel operation in a packet sent
 // between CSS and CU in either direction.
-// It is 8 bits with the top 4 as flag bits (with only 3 currently
-// in use) and the bottom 4 as the operation command itself.
+// It is 8 bits with the top 4 as flag bits and the bottom 4 as the operation command itself.
 // The meaning of the flag bits depends on the operation command.
 typedef uint8_t proto_chop_t;
 
@@ -19,25 +18,34 @@ typedef enum __attribute__((packed)) proto_chop_cmd {
         PROTO_CHOP_DATA                 = 2,
         PROTO_CHOP_UPDATE_STATUS        = 3,
         PROTO_CHOP_REQUEST_READ         = 4,
-        PROTO_CHOP_HALT                 = 5
+        PROTO_CHOP_HALT                 = 5,
+        PROTO_CHOP_BATCH                = 6,
+        PROTO_CHOP_DATA_INLINE          = 7,
+        PROTO_CHOP_DATA_STATUS          = 8,
+        PROTO_CHOP_COUNT                = 9
 } proto_chop_cmd_t;
 static_assert(sizeof(proto_chop_cmd_t) == 1, "proto_chop_cmd_t must be 1 byte");
 
 typedef uint8_t proto_chop_flags_t;
 
 // PROTO_CHOP_FLAG_SKIP is valid in CSS -> CU Room, Data and Start
-// and in CU -> CSS Data
+// and in CU -> CSS Data and DataStatus
 #define PROTO_CHOP_FLAG_SKIP    0x80
 
-// PROTO_CHOP_FLAG_END is valid in CSS <-> CU Data
+// PROTO_CHOP_FLAG_END is valid in CSS <-> CU Data and DataInline
 #define PROTO_CHOP_FLAG_END     0x40
 
-// PROTO_CHOP_FLAG_STOP is valid in CSS -> CU Data
+// PROTO_CHOP_FLAG_STOP is valid in CSS -> CU Data and DataInline
 #define PROTO_CHOP_FLAG_STOP    0x20
 
-// PROTO_CHOP_FLAG_RESPONSE_REQUIRED is valid in CU -> CSS Data
+// PROTO_CHOP_FLAG_RESPONSE_REQUIRED is valid in CU -> CSS Data and
+// DataInline
 #define PROTO_CHOP_FLAG_RESPONSE_REQUIRED     0x20
 
+// PROTO_CHOP_FLAG_INLINE_TWO is valid in CSS <-> CU DataInline and
+// means that both payload bytes are data rather than just the first
+#define PROTO_CHOP_FLAG_INLINE_TWO      0x10
+
 static inline proto_chop_flags_t proto_chop_flags(proto_chop_t c) {
         return (proto_chop_flags_t)(c & 0xf0);
 }
@@ -62,4 +70,8 @@ static inline bool proto_chop_has_response_required(proto_chop_t c) {
         return proto_chop_flags(c) & PROTO_CHOP_FLAG_RESPONSE_REQUIRED;
 }
 
+static inline bool proto_chop_has_inline_two(proto_chop_t c) {
+        return proto_chop_flags(c) & PROTO_CHOP_FLAG_INLINE_TWO;
+}
+
 #endif
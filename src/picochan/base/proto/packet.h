@@ -36,6 +36,30 @@ typedef struct __attribute__((aligned(4))) proto_packet {
 
 static_assert(sizeof(proto_packet_t) == 4, "proto_packet_t must be 4 bytes");
 
+/*! \brief the maximum number of packets in a Batch
+ *  \ingroup internal_proto
+ *
+ * A Batch packet carries in its count payload a number of command
+ * packets, between 2 and PROTO_BATCH_MAX_PACKETS, which immediately
+ * follow it as data. In the CSS -> CU direction, only the last
+ * packet of a batch may itself be followed by data. In the
+ * CU -> CSS direction, a batch only holds UpdateStatus, RequestRead
+ * and DataInline packets. This is part of the protocol rather than a
+ * configuration option because the receiving side needs to receive
+ * the packets into a fixed-size buffer.
+ */
+#define PROTO_BATCH_MAX_PACKETS 8
+
+/*! \brief the maximum count of data carried inline in a DataInline
+ *  \ingroup internal_proto
+ *
+ * A DataInline packet is a Data packet whose payload holds the data
+ * itself (1 byte, or 2 bytes with PROTO_CHOP_FLAG_INLINE_TWO) instead
+ * of the count of data which follows it. That saves the receiving
+ * side from having to start and complete a separate rx of the data.
+ */
+#define PROTO_DATA_INLINE_MAX 2
+
 static inline proto_payload_t proto_get_payload(proto_packet_t p) {
         return ((proto_payload_t){p.p0, p.p1});
 }
@@ -75,6 +99,48 @@ static inline proto_packet_t proto_make_count_packet(proto_chop_t chop, pch_unit
         });
 }
 
+// proto_make_data_inline_packet makes a DataInline packet carrying
+// count (1 or 2) bytes of data from src, ORring in chopfl
+static inline proto_packet_t proto_make_data_inline_packet(proto_chop_flags_t chopfl, pch_unit_addr_t ua, const uint8_t *src, uint16_t count) {
+        assert(count > 0 && count <= PROTO_DATA_INLINE_MAX);
+        proto_packet_t p = {
+                .chop = PROTO_CHOP_DATA_INLINE | chopfl,
+                .unit_addr = ua,
+                .p0 = src[0]
+        };
+        if (count == 2) {
+                p.chop |= PROTO_CHOP_FLAG_INLINE_TWO;
+                p.p1 = src[1];
+        }
+
+        return p;
+}
+
+// proto_get_data_inline_count returns the count of data bytes that
+// DataInline packet p carries in its payload
+static inline uint16_t proto_get_data_inline_count(proto_packet_t p) {
+        return proto_chop_has_inline_two(p.chop) ? 2 : 1;
+}
+
+// proto_data_inline_as_data_packet returns the Data packet, with the
+// same flags and the count of data, equivalent to DataInline packet p
+static inline proto_packet_t proto_data_inline_as_data_packet(proto_packet_t p) {
+        proto_chop_flags_t chopfl = proto_chop_flags(p.chop)
+                & ~PROTO_CHOP_FLAG_INLINE_TWO;
+        return proto_make_count_packet(PROTO_CHOP_DATA | chopfl,
+                p.unit_addr, proto_get_data_inline_count(p));
+}
+
+// proto_data_status_as_data_packet returns the Data packet, with the
+// Skip flag (if any) and the count of data, equivalent to DataStatus
+// packet p apart from the device status it carries in p0
+static inline proto_packet_t proto_data_status_as_data_packet(proto_packet_t p) {
+        proto_chop_flags_t chopfl = proto_chop_flags(p.chop)
+                & PROTO_CHOP_FLAG_SKIP;
+        return proto_make_count_packet(PROTO_CHOP_DATA | chopfl,
+                p.unit_addr, proto_decode_esize_payload(p));
+}
+
 static inline proto_packet_t proto_make_esize_packet(proto_chop_t chop, pch_unit_addr_t ua, uint8_t p0, pch_bsize_t esize) {
         return ((proto_packet_t){
                 .chop = chop,
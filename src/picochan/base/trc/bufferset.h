@@ -8,11 +8,10 @@
 
 #include "hardware/irq.h"
 #include "assert.h"
-#include "trace_lock.h"
 
 // pch_trc_init_bufferset initialises the bufferset by filling in
-// the num_buffers, buffer_size and magic fields and zeroing out the
-// other fields
+// the num_buffers, buffer_size and magic fields, setting irqnum to
+// -1 and zeroing out the other fields
 void pch_trc_init_bufferset(pch_trc_bufferset_t *bs, uint32_t magic);
 
 // pch_trc_init_buffer initialises buffer index n to buf.
@@ -29,36 +28,41 @@ static inline void pch_trc_init_buffer(pch_trc_bufferset_t *bs, uint n, void *bu
 // PCH_TRC_NUM_BUFFERS*PCH_TRC_BUFFER_SIZE available bytes.
 void pch_trc_init_all_buffers(pch_trc_bufferset_t *bs, void *buf);
 
-// pch_trc_switch_to_next_buffer_unsafe is for internal use.
-// The external API is pch_trc_switch_to_next_buffer which takes
-// the trace_lock and then calls this with a 0 for position.
-// Internally, this is used when allocating a slot for a new trace
-// record (which has already taken trace_lock) and in that situation
-// it is often called with a non-zero pos following the
-// newly-allocated trace record.
-static inline unsigned char *pch_trc_switch_to_next_buffer_unsafe(pch_trc_bufferset_t *bs, uint32_t pos) {
-        bs->current_buffer_num = (bs->current_buffer_num + 1) % PCH_TRC_NUM_BUFFERS;
-        bs->current_buffer_pos = pos;
-        if (bs->irqnum > -1)
-                irq_set_pending((irq_num_t)(bs->irqnum));
+// PCH_TRC_NUM_GENS is the number of buffer generations before the
+// 16-bit generation in a bufferset cursor wraps back to 0. It is a
+// multiple of PCH_TRC_NUM_BUFFERS so that the buffer index (the
+// generation modulo PCH_TRC_NUM_BUFFERS) goes round the ring in
+// order across the wrap.
+#define PCH_TRC_NUM_GENS ((65536 / PCH_TRC_NUM_BUFFERS) * PCH_TRC_NUM_BUFFERS)
 
-        return bs->buffers[bs->current_buffer_num];
+static inline uint32_t pch_trc_next_gen(uint32_t gen) {
+        return (gen + 1) % PCH_TRC_NUM_GENS;
 }
 
-// pch_trc_switch_to_next_buffer switches to the next trace buffer in
-// the bufferset. If bs->irqnum is non-negative, that IRQ is raised.
-// When the IRQ is raised, current_buffer_num has already been
-// incremented (modulo PCH_TRC_NUM_BUFFERS) and a trace record may be
-// in the process of writing to the new buffer. The IRQ handler will
-// typically want to start copying or sending the contents of
-// bs->buffers[bs->current_buffer_num-1] elsewhere and aim for
-// completion before the trace records fill remaining buffers and
-// wrap back around to overwrite that buffer.
-static inline unsigned char *pch_trc_switch_to_next_buffer(pch_trc_bufferset_t *bs) {
-        uint32_t status = trace_lock();
-        unsigned char *rec = pch_trc_switch_to_next_buffer_unsafe(bs, 0);
-        trace_unlock(status);
-        return rec;
+// pch_trc_gen_distance returns how many generations on from gen
+// to_gen is, allowing for the wrap.
+static inline uint32_t pch_trc_gen_distance(uint32_t gen, uint32_t to_gen) {
+        return (to_gen + PCH_TRC_NUM_GENS - gen) % PCH_TRC_NUM_GENS;
 }
 
+// pch_trc_gen_buffer returns the buffer of bs used by generation gen.
+static inline unsigned char *pch_trc_gen_buffer(pch_trc_bufferset_t *bs, uint32_t gen) {
+        unsigned char *buf = bs->buffers[gen % PCH_TRC_NUM_BUFFERS];
+        assert(buf);
+        return buf;
+}
+
+// pch_trc_switch_to_next_buffer seals the current trace buffer in
+// the bufferset and switches to the next one, returning it. If
+// bs->irqnum is non-negative, that IRQ is raised once the buffer has
+// been sealed. When the IRQ is raised, the cursor has already moved
+// on to the next buffer and trace records may be in the process of
+// being written to it (and, for slots reserved just before the
+// switch, to the sealed buffer too). The IRQ handler will typically
+// want to start copying or sending the contents of the buffer before
+// the current one elsewhere and aim for completion before the trace
+// records fill remaining buffers and wrap back around to overwrite
+// that buffer.
+unsigned char *pch_trc_switch_to_next_buffer(pch_trc_bufferset_t *bs);
+
 #endif
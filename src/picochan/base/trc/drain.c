@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) 2025 Malcolm Beattie
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "pico/stdlib.h"
+#include "trace.h"
+#include "picochan/trc_drain.h"
+
+// PCH_TRC_MAX_DRAINS is the number of drains that can be started:
+// one for the CSS bufferset and one for the CU bufferset.
+#define PCH_TRC_MAX_DRAINS 2
+
+static pch_trc_drain_t *drains[PCH_TRC_MAX_DRAINS];
+
+typedef enum drain_state {
+        DRAIN_IDLE = 0,
+        DRAIN_SENDING_FRAME,
+        DRAIN_SENDING_BUFFER
+} drain_state_t;
+
+static inline uint32_t current_gen(pch_trc_drain_t *d) {
+        uint32_t cur = __atomic_load_n(&d->bs->cursor, __ATOMIC_RELAXED);
+        return pch_trc_cursor_gen(cur);
+}
+
+// start_sending asks the sink of d to send len bytes at data,
+// returning false if it refuses.
+static bool start_sending(pch_trc_drain_t *d, const void *data, uint32_t len) {
+        d->busy = true;
+        if (d->sink->ops->start(d->sink, d, data, len))
+                return true;
+
+        d->busy = false;
+        return false;
+}
+
+// next_buffer moves d on to the buffer after the one whose frame it
+// has been sending.
+static void next_buffer(pch_trc_drain_t *d) {
+        d->next_gen = (uint16_t)pch_trc_next_gen(d->next_gen);
+        d->state = DRAIN_IDLE;
+}
+
+// start_frame starts sending the frame header for the oldest sealed
+// buffer not yet sent, first skipping (and counting as dropped) any
+// that have already been overwritten. It returns false if there are
+// no sealed buffers left to send.
+static bool start_frame(pch_trc_drain_t *d) {
+        uint32_t sealed = pch_trc_gen_distance(d->next_gen, current_gen(d));
+        if (sealed == 0)
+                return false;
+
+        if (sealed >= PCH_TRC_NUM_BUFFERS) {
+                uint32_t lost = sealed - (PCH_TRC_NUM_BUFFERS - 1);
+                d->dropped += lost;
+                d->next_gen = (uint16_t)((d->next_gen + lost)
+                        % PCH_TRC_NUM_GENS);
+        }
+
+        d->frame = ((pch_trc_frame_t){
+                .magic = PCH_TRC_FRAME_MAGIC,
+                .bs_magic = d->bs->magic,
+                .gen = d->next_gen,
+                .size = PCH_TRC_BUFFER_SIZE,
+                .dropped = d->dropped,
+                .overrun = d->overrun
+        });
+
+        d->state = DRAIN_SENDING_FRAME;
+        if (!start_sending(d, &d->frame, sizeof(d->frame))) {
+                d->dropped++;
+                next_buffer(d);
+        }
+
+        return true;
+}
+
+// drain_step takes the next step of sending sealed buffers of d to
+// its sink, which must not be busy. It returns false when there is
+// nothing left to do.
+static bool drain_step(pch_trc_drain_t *d) {
+        switch ((drain_state_t)d->state) {
+        case DRAIN_SENDING_FRAME: {
+                unsigned char *buf = pch_trc_gen_buffer(d->bs, d->next_gen);
+                d->state = DRAIN_SENDING_BUFFER;
+                if (!start_sending(d, buf, d->frame.size)) {
+                        // the receiver finds the frame header
+                        // truncated and resynchronises
+                        d->dropped++;
+                        next_buffer(d);
+                }
+                return true;
+        }
+
+        case DRAIN_SENDING_BUFFER:
+                d->frames++;
+                // writers may have wrapped round to the buffer
+                // while the sink was still sending it
+                if (pch_trc_gen_distance(d->next_gen, current_gen(d))
+                        >= PCH_TRC_NUM_BUFFERS)
+                        d->overrun++;
+
+                next_buffer(d);
+                return true;
+
+        case DRAIN_IDLE:
+                break;
+        }
+
+        return start_frame(d);
+}
+
+static void __isr pch_trc_drain_irq_handler(void) {
+        uint irqnum = __get_current_exception() - VTABLE_FIRST_IRQ;
+        irq_clear(irqnum);
+
+        for (int i = 0; i < PCH_TRC_MAX_DRAINS; i++) {
+                pch_trc_drain_t *d = drains[i];
+                if (!d || d->irqnum != (int16_t)irqnum)
+                        continue;
+
+                while (!d->busy && drain_step(d))
+                        ;
+        }
+}
+
+void pch_trc_drain_start(pch_trc_drain_t *d, pch_trc_bufferset_t *bs, pch_trc_sink_t *sink) {
+        valid_params_if(PCH_TRC, bs->irqnum == -1);
+        memset(d, 0, sizeof(*d));
+        d->bs = bs;
+        d->sink = sink;
+        d->next_gen = (uint16_t)current_gen(d);
+
+        int i = 0;
+        while (drains[i]) {
+                if (++i == PCH_TRC_MAX_DRAINS)
+                        panic("too many trace drains");
+        }
+
+        irq_num_t irqnum = (irq_num_t)user_irq_claim_unused(true);
+        d->irqnum = (int16_t)irqnum;
+        drains[i] = d;
+        irq_set_exclusive_handler(irqnum, pch_trc_drain_irq_handler);
+        irq_set_enabled(irqnum, true);
+        bs->irqnum = (int16_t)irqnum;
+}
+
+void __time_critical_func(pch_trc_drain_sink_done)(pch_trc_drain_t *d) {
+        d->busy = false;
+        irq_set_pending((irq_num_t)d->irqnum);
+}
+
+void pch_trc_drain_flush(pch_trc_drain_t *d) {
+        pch_trc_switch_to_next_buffer(d->bs);
+}
+
+bool pch_trc_drain_is_idle(pch_trc_drain_t *d) {
+        return !d->busy && d->state == DRAIN_IDLE
+                && current_gen(d) == d->next_gen;
+}
+
+// Memory sink
+
+static bool mem_sink_start(pch_trc_sink_t *sink, pch_trc_drain_t *d, const void *data, uint32_t len) {
+        pch_trc_mem_sink_t *ms = (pch_trc_mem_sink_t *)sink;
+        if (ms->full || len > ms->size - ms->len) {
+                ms->full = true;
+                return false;
+        }
+
+        memcpy(ms->buf + ms->len, data, len);
+        ms->len += len;
+        pch_trc_drain_sink_done(d);
+        return true;
+}
+
+static const pch_trc_sink_ops_t pch_trc_mem_sink_ops = {
+        .start = mem_sink_start
+};
+
+pch_trc_sink_t *pch_trc_mem_sink_init(pch_trc_mem_sink_t *ms, void *buf, uint32_t size) {
+        memset(ms, 0, sizeof(*ms));
+        ms->sink.ops = &pch_trc_mem_sink_ops;
+        ms->buf = buf;
+        ms->size = size;
+        return &ms->sink;
+}
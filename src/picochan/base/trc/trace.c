@@ -4,16 +4,20 @@
  */
 
 #include "pico/time.h"
+#include "hardware/timer.h"
 #include "assert.h"
 #include "trace.h"
-#include "trace_lock.h"
 
 uint32_t pch_trc_buffer_size = PCH_TRC_BUFFER_SIZE;
 uint32_t pch_trc_num_buffers = PCH_TRC_NUM_BUFFERS;
 
 static inline void pch_trc_write_current_timestamp(pch_trc_timestamp_t *tp) {
+#if PCH_TRC_TIMESTAMP_32
+        pch_trc_write_timestamp32(tp, time_us_32());
+#else
         uint64_t us = to_us_since_boot(get_absolute_time());
         pch_trc_write_timestamp(tp, us);
+#endif
 }
 
 void pch_trc_init_bufferset(pch_trc_bufferset_t *bs, uint32_t magic) {
@@ -21,6 +25,10 @@ void pch_trc_init_bufferset(pch_trc_bufferset_t *bs, uint32_t magic) {
         bs->magic = magic;
         bs->buffer_size = PCH_TRC_BUFFER_SIZE;
         bs->num_buffers = PCH_TRC_NUM_BUFFERS;
+        bs->irqnum = -1;
+        // the generation before the first so that the first trace
+        // record written is preceded by a TRC_TIME_SYNC record
+        bs->sync_gen = (uint16_t)(PCH_TRC_NUM_GENS - 1);
 }
 
 void pch_trc_init_all_buffers(pch_trc_bufferset_t *bs, void *buf) {
@@ -32,41 +40,152 @@ void pch_trc_init_all_buffers(pch_trc_bufferset_t *bs, void *buf) {
         }
 }
 
+static_assert(PCH_TRC_BUFFER_SIZE <= 32768,
+        "PCH_TRC_BUFFER_SIZE must be at most 32768");
+
+static inline uint32_t next_gen(uint32_t gen) {
+        return pch_trc_next_gen(gen);
+}
+
+static inline unsigned char *trace_slot(pch_trc_bufferset_t *bs, uint32_t gen, uint32_t pos) {
+        unsigned char *buf = pch_trc_gen_buffer(bs, gen);
+        return __builtin_assume_aligned(&buf[pos], 4);
+}
+
+// seal_trace_buffer marks where the records in the buffer of
+// generation gen end, at pos, by writing a TRC_PAD record there so
+// that a reader of the buffer knows to ignore the stale data that
+// follows it. If there is no room even for that, the buffer ends
+// there anyway. Only the one writer that owns pos calls this.
+static void seal_trace_buffer(pch_trc_bufferset_t *bs, uint32_t gen, uint32_t pos) {
+        if (pos + sizeof(pch_trc_header_t) > PCH_TRC_BUFFER_SIZE)
+                return;
+
+        pch_trc_header_t *h = (pch_trc_header_t *)trace_slot(bs, gen, pos);
+        pch_trc_write_current_timestamp(&h->timestamp);
+        h->rec_type = PCH_TRC_RT_TRC_PAD;
+        h->size = sizeof(pch_trc_header_t);
+}
+
+// raise_switch_irq raises bs->irqnum, if set, to hand the buffer
+// that has just been both sealed and switched away from over to be
+// drained. It is called by whichever writer sealed the buffer once
+// the switch has happened so that the buffer is never drained before
+// its TRC_PAD record has been written.
+static inline void raise_switch_irq(pch_trc_bufferset_t *bs) {
+        if (bs->irqnum > -1)
+                irq_set_pending((irq_num_t)(bs->irqnum));
+}
+
+// switch_trace_buffer tries to move the cursor of bs on from cur, a
+// position in the buffer of generation gen, to the start of the next
+// buffer with the first pos bytes of that buffer reserved. It fails,
+// returning false, if another writer has already switched buffers.
+static bool switch_trace_buffer(pch_trc_bufferset_t *bs, uint32_t cur, uint32_t gen, uint32_t pos) {
+        uint32_t next = pch_trc_make_cursor(next_gen(gen), pos);
+        while (pch_trc_cursor_gen(cur) == gen) {
+                if (__atomic_compare_exchange_n(&bs->cursor, &cur, next,
+                        false, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                        return true;
+                // cur is now the cursor value that beat us to it
+        }
+
+        return false;
+}
+
 // alloc_trace_slot returns a pointer to where the next trace record
 // can be written. There is room at that location for a header
 // (pch_trc_header_t) followed by data_size bytes of trace data.
-// Before returning, the current_buffer_num and current_buffer_pos
-// are updated ready for the next record (the one after the slot being
-// allocated here) so if no record is written to the returned slot
-// then there will be a gap containing stale data from whatever was
-// in the buffer beforehand. This function takes trace_lock while
-// checking and changing bufferset current_buffer_num and
-// current_buffer_pos fields so is as safe for calling concurrently
-// as trace_lock allows. Currently, trace_lock only disables
-// interrupts so concurrent use on the same core is safe but not on
-// different cores (for which we'd need to use a hardware spinlock).
-static pch_trc_header_t *alloc_trace_slot(pch_trc_bufferset_t *bs, uint8_t data_size) {
+// The slot is reserved by an atomic fetch-and-add of the record size
+// to the bufferset cursor so if no record is written to the returned
+// slot then there will be a gap containing stale data from whatever
+// was in the buffer beforehand. A reservation that does not fit in
+// the current buffer switches to the next buffer and takes its first
+// slot unless some other writer has already switched, in which case
+// it simply tries again. No lock is taken and no writer ever waits
+// for another to finish so it is safe to call concurrently from
+// either core and from any IRQ level.
+static pch_trc_header_t *alloc_trace_slot(pch_trc_bufferset_t *bs, uint8_t data_size, uint32_t *genp) {
         valid_params_if(PCH_TRC,
                 ((uint32_t)data_size) + sizeof(pch_trc_header_t) <= 252);
         uint32_t size = sizeof(pch_trc_header_t) + data_size;
         size = (size + 3) & ~3; // round up to 4-byte alignment
-        unsigned char *rec;
-
-        uint32_t status = trace_lock();
 
-        unsigned char *buf = bs->buffers[bs->current_buffer_num];
-        assert(buf);
-        rec = &buf[bs->current_buffer_pos];
+        while (true) {
+                uint32_t cur = __atomic_fetch_add(&bs->cursor, size,
+                        __ATOMIC_RELAXED);
+                uint32_t gen = pch_trc_cursor_gen(cur);
+                uint32_t pos = pch_trc_cursor_pos(cur);
+                if (pos + size <= PCH_TRC_BUFFER_SIZE) {
+                        *genp = gen;
+                        return (pch_trc_header_t *)trace_slot(bs, gen, pos);
+                }
+
+                // The first reservation past the end of the buffer
+                // is the one that started inside it
+                bool sealer = pos <= PCH_TRC_BUFFER_SIZE;
+                if (sealer)
+                        seal_trace_buffer(bs, gen, pos);
+
+                // Either this writer switches buffers or another
+                // writer already has
+                bool switched = switch_trace_buffer(bs, cur + size,
+                        gen, size);
+                if (sealer)
+                        raise_switch_irq(bs);
+
+                if (switched) {
+                        uint32_t ngen = next_gen(gen);
+                        *genp = ngen;
+                        return (pch_trc_header_t *)trace_slot(bs, ngen, 0);
+                }
+        }
+}
 
-        uint32_t endpos = bs->current_buffer_pos + size;
-        if (endpos <= PCH_TRC_BUFFER_SIZE)
-                bs->current_buffer_pos = endpos;
-        else
-                rec = pch_trc_switch_to_next_buffer_unsafe(bs, size);
+unsigned char *pch_trc_switch_to_next_buffer(pch_trc_bufferset_t *bs) {
+        uint32_t cur = __atomic_load_n(&bs->cursor, __ATOMIC_RELAXED);
+        while (true) {
+                uint32_t gen = pch_trc_cursor_gen(cur);
+                uint32_t pos = pch_trc_cursor_pos(cur);
+                if (switch_trace_buffer(bs, cur, gen, 0)) {
+                        // Nothing can be reserved at pos after the
+                        // switch so it is ours to seal unless a
+                        // reservation past the end is doing so
+                        if (pos <= PCH_TRC_BUFFER_SIZE) {
+                                seal_trace_buffer(bs, gen, pos);
+                                raise_switch_irq(bs);
+                        }
+
+                        return trace_slot(bs, next_gen(gen), 0);
+                }
+
+                cur = __atomic_load_n(&bs->cursor, __ATOMIC_RELAXED);
+        }
+}
 
-        trace_unlock(status);
-        return (pch_trc_header_t*)__builtin_assume_aligned(rec, 4);
+#if PCH_TRC_TIMESTAMP_32
+// sync_trace_time writes a TRC_TIME_SYNC record holding the full
+// 64-bit time if a record with 32-bit timestamp us32 has just been
+// written to the buffer of generation gen and that buffer does not
+// yet have one or the last one was written too long ago. Writers on
+// different cores racing here may both write one, which is harmless.
+// Writing the TRC_TIME_SYNC record itself only recurses (once) if
+// it moves tracing on to the next buffer.
+static void __time_critical_func(sync_trace_time)(pch_trc_bufferset_t *bs, uint32_t gen, uint32_t us32) {
+        if (gen == bs->sync_gen
+                && us32 - bs->sync_us < PCH_TRC_SYNC_INTERVAL_US)
+                return;
+
+        bs->sync_gen = (uint16_t)gen;
+        bs->sync_us = us32;
+        uint64_t us = time_us_64();
+        struct pch_trdata_time_sync td = {
+                .low = (uint32_t)us,
+                .high = (uint32_t)(us >> 32)
+        };
+        pch_trc_write_raw(bs, PCH_TRC_RT_TRC_TIME_SYNC, &td, sizeof(td));
 }
+#endif
 
 // pch_trc_write_uncond allocates a trace record slot, writes a header
 // to it (pch_trc_header_t) with the current timestamp, record type rt
@@ -78,14 +197,21 @@ static pch_trc_header_t *alloc_trace_slot(pch_trc_bufferset_t *bs, uint8_t data_
 // associated trace data bytes will contain whatever stale data was in
 // the buffer beforehand.
 void __time_critical_func(*pch_trc_write_uncond)(pch_trc_bufferset_t *bs, pch_trc_record_type_t rt, uint8_t data_size) {
-        pch_trc_header_t *h = alloc_trace_slot(bs, data_size);
+        uint32_t gen;
+        pch_trc_header_t *h = alloc_trace_slot(bs, data_size, &gen);
         pch_trc_write_current_timestamp(&h->timestamp);
         h->rec_type = rt;
         h->size = (sizeof(pch_trc_header_t) + data_size + 3) & ~3;
+#if PCH_TRC_TIMESTAMP_32
+        sync_trace_time(bs, gen, pch_trc_timestamp_to_us32(h->timestamp));
+#endif
         return h + 1;
 }
 
 void __time_critical_func(pch_trc_write_raw)(pch_trc_bufferset_t *bs, pch_trc_record_type_t rt, void *data, uint8_t data_size) {
+        if (!pch_trc_rt_is_compiled(rt))
+                return;
+
         void *rec = pch_trc_write_uncond(bs, rt, data_size);
         if (rec)
                 memcpy(rec, data, data_size);
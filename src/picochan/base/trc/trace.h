@@ -25,20 +25,37 @@ static_assert(sizeof(pch_trc_header_t) == 8,
 
 void *pch_trc_write_uncond(pch_trc_bufferset_t *bs, pch_trc_record_type_t rt, uint8_t data_size);
 
+// pch_trc_rt_is_compiled returns whether trace records of type rt
+// are compiled in: tracing is enabled at compile time and the group
+// of rt is in PCH_CONFIG_TRACE_GROUPS (or is group TRC). When rt is
+// a constant, so is the result, letting the compiler drop all the
+// code for writing records of excluded types.
+static inline bool pch_trc_rt_is_compiled(pch_trc_record_type_t rt) {
+#if PCH_CONFIG_ENABLE_TRACE
+        return pch_trc_rt_group(rt)
+                & (PCH_CONFIG_TRACE_GROUPS | PCH_TRC_GROUP_TRC);
+#else
+        (void)rt;
+        return false;
+#endif
+}
+
 // pch_trc_write allocates and writes the header of a trace record
 // with the current timestamp and record type rt and returns a pointer
 // to the location where data_size bytes of associated trace should be
 // written. It returns NULL (without writing any header or taking any
 // other action) if no trace record should be written. This will be
 // the case if tracing was disabled globally at compile time
-// (PCH_CONFIG_ENABLE_TRACE was not defined or defined as 0) or if
+// (PCH_CONFIG_ENABLE_TRACE was not defined or defined as 0) or for
+// the group of rt (PCH_CONFIG_TRACE_GROUPS) or if
 // tracing has been disabled (perhaps temporarily) at runtime by
 // setting pch_trc_enable to false or if the cond function argument is
 // false.
 static inline void *pch_trc_write(pch_trc_bufferset_t *bs, bool cond, pch_trc_record_type_t rt, uint8_t data_size) {
 #if PCH_CONFIG_ENABLE_TRACE
-        if (!bs->enable // per-bufferset runtime tracing flag not enabled
-                || !cond) // per-function-call condition flag not enabled
+        if (!pch_trc_rt_is_compiled(rt) // group compiled out
+                || !cond // per-function-call condition flag not enabled
+                || !bs->enable) // per-bufferset runtime tracing flag not enabled
                 return NULL;
 
         return pch_trc_write_uncond(bs, rt, data_size);
@@ -51,7 +68,12 @@ static inline void *pch_trc_write(pch_trc_bufferset_t *bs, bool cond, pch_trc_re
         return NULL;
 }
 
+// PCH_TRC_WRITE writes a trace record of type rt with data as its
+// associated trace data. Neither cond nor data is evaluated if the
+// group of rt is compiled out.
 #define PCH_TRC_WRITE(bs, cond, rt, data) do { \
+                if (!pch_trc_rt_is_compiled(rt)) \
+                        break; \
                 size_t __data_size = sizeof (data); \
                 void *__rec = pch_trc_write((bs), (cond), (rt), __data_size); \
                 if (__rec) \
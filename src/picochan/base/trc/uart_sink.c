@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2025 Malcolm Beattie
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "pico/stdlib.h"
+#include "hardware/dma.h"
+#include "hardware/uart.h"
+#include "trace.h"
+#include "picochan/trc_drain.h"
+
+// PCH_TRC_MAX_UART_SINKS is the number of UART sinks that can be
+// initialised: one for each drain.
+#define PCH_TRC_MAX_UART_SINKS 2
+
+static pch_trc_uart_sink_t *uart_sinks[PCH_TRC_MAX_UART_SINKS];
+
+static bool __time_critical_func(uart_sink_start)(pch_trc_sink_t *sink, pch_trc_drain_t *d, const void *data, uint32_t len) {
+        pch_trc_uart_sink_t *us = (pch_trc_uart_sink_t *)sink;
+        us->drain = d;
+        dma_channel_transfer_from_buffer_now(us->dmaid, data, len);
+        return true;
+}
+
+static const pch_trc_sink_ops_t pch_trc_uart_sink_ops = {
+        .start = uart_sink_start
+};
+
+static void __isr __time_critical_func(pch_trc_uart_sink_dma_irq_handler)(void) {
+        uint irqnum = __get_current_exception() - VTABLE_FIRST_IRQ;
+        pch_irq_index_t irq_index = (pch_irq_index_t)(irqnum - DMA_IRQ_0);
+
+        for (int i = 0; i < PCH_TRC_MAX_UART_SINKS; i++) {
+                pch_trc_uart_sink_t *us = uart_sinks[i];
+                if (!us || us->irq_index != irq_index)
+                        continue;
+
+                if (!dma_irqn_get_channel_status(irq_index, us->dmaid))
+                        continue;
+
+                dma_irqn_acknowledge_channel(irq_index, us->dmaid);
+                if (us->drain)
+                        pch_trc_drain_sink_done(us->drain);
+        }
+}
+
+pch_trc_sink_t *pch_trc_uart_sink_init(pch_trc_uart_sink_t *us, uart_inst_t *uart, uint baudrate, pch_irq_index_t irq_index) {
+        valid_params_if(PCH_TRC,
+                irq_index >= 0 && irq_index < NUM_DMA_IRQS);
+        int i = 0;
+        while (uart_sinks[i]) {
+                if (++i == PCH_TRC_MAX_UART_SINKS)
+                        panic("too many trace UART sinks");
+        }
+
+        memset(us, 0, sizeof(*us));
+        us->sink.ops = &pch_trc_uart_sink_ops;
+        us->uart = uart;
+        us->irq_index = irq_index;
+
+        uart_init(uart, baudrate);
+        uart_set_hw_flow(uart, false, false);
+        uart_set_format(uart, 8, 1, UART_PARITY_NONE);
+        uart_set_fifo_enabled(uart, true);
+        uart_set_translate_crlf(uart, false);
+
+        us->dmaid = (uint8_t)dma_claim_unused_channel(true);
+        dma_channel_config ctrl = dma_channel_get_default_config(us->dmaid);
+        channel_config_set_transfer_data_size(&ctrl, DMA_SIZE_8);
+        channel_config_set_read_increment(&ctrl, true);
+        channel_config_set_write_increment(&ctrl, false);
+        channel_config_set_dreq(&ctrl, uart_get_dreq_num(uart, true));
+        dma_channel_configure(us->dmaid, &ctrl, &uart_get_hw(uart)->dr,
+                NULL, 0, false);
+
+        uart_sinks[i] = us;
+        dma_irqn_set_channel_enabled(irq_index, us->dmaid, true);
+        irq_num_t irqnum = dma_get_irq_num(irq_index);
+        irq_add_shared_handler(irqnum, pch_trc_uart_sink_dma_irq_handler,
+                PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+        irq_set_enabled(irqnum, true);
+        return &us->sink;
+}
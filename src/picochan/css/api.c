@@ -9,12 +9,12 @@
 static inline void raise_func_irq(void) {
         int16_t n = CSS.func_irqnum;
         valid_params_if(PCH_CSS, n > 0);
-        irq_set_pending((irq_num_t)n);
+        css_raise_irq((irq_num_t)n);
 }
 
 // push_func_dlist must be called with schibs_lock held.
 static inline void push_func_dlist(pch_chp_t *chp, pch_schib_t *schib) {
-        push_ua_dlist_unsafe(&chp->ua_func_dlist, chp, schib);
+        push_ua_dlist_unsafe(pch_chp_func_dlist(chp, schib), chp, schib);
 }
 
 static int schib_is_ready_for_start_or_resume(pch_schib_t *schib) {
@@ -30,7 +30,7 @@ static int schib_is_ready_for_start_or_resume(pch_schib_t *schib) {
         return 0;
 }
 
-static int do_sch_start(pch_schib_t *schib, pch_ccw_t *ccw_addr) {
+static int do_sch_start(pch_schib_t *schib, pch_ccw_t *ccw_addr, pch_chanprog_t *cp) {
         uint32_t status = schibs_lock();
 
         int cc = schib_is_ready_for_start_or_resume(schib);
@@ -41,6 +41,7 @@ static int do_sch_start(pch_schib_t *schib, pch_ccw_t *ccw_addr) {
 	pch_chpid_t chpid = schib->pmcw.chpid;
 	pch_chp_t *chp = pch_get_chp(chpid);
 	schib->scsw.ccw_addr = (uint32_t)ccw_addr;
+        CSS.chanprogs[get_sid(schib)] = cp;
 	schib->scsw.ctrl_flags |= PCH_AC_START_PENDING;
         push_func_dlist(chp, schib);
 	raise_func_irq();
@@ -55,12 +56,23 @@ int __time_critical_func(pch_sch_start)(pch_sid_t sid, pch_ccw_t *ccw_addr) {
 		return 3;
 
 	pch_schib_t *schib = get_schib(sid);
-	int cc = do_sch_start(schib, ccw_addr);
+	int cc = do_sch_start(schib, ccw_addr, NULL);
 	trace_schib_word_byte(PCH_TRC_RT_CSS_SCH_START, schib,
                 (uint32_t)ccw_addr, cc);
 	return cc;
 }
 
+int __time_critical_func(pch_sch_start_chanprog)(pch_sid_t sid, pch_chanprog_t *cp) {
+	if (sid >= PCH_NUM_SCHIBS)
+		return 3;
+
+	pch_schib_t *schib = get_schib(sid);
+	int cc = do_sch_start(schib, cp->ccws, cp);
+	trace_schib_word_byte(PCH_TRC_RT_CSS_SCH_START, schib,
+                (uint32_t)cp->ccws, cc);
+	return cc;
+}
+
 static int do_sch_resume(pch_schib_t *schib) {
         uint32_t status = schibs_lock();
 
@@ -116,7 +128,7 @@ static int schib_is_valid_for_cancel(pch_schib_t *schib) {
 static void remove_from_func_dlist(pch_schib_t *schib) {
         pch_chpid_t chpid = schib->pmcw.chpid;
         pch_chp_t *chp = pch_get_chp(chpid);
-        ua_dlist_t *l = &chp->ua_func_dlist;
+        ua_dlist_t *l = pch_chp_func_dlist(chp, schib);
         pch_unit_addr_t ua = schib->pmcw.unit_addr;
         remove_from_ua_dlist_unsafe(l, chp, ua);
 }
@@ -251,6 +263,59 @@ int __time_critical_func(pch_sch_test)(pch_sid_t sid, pch_scsw_t *scsw) {
 	return cc;
 }
 
+// take_pending_from_isc takes the status of up to max subchannels in
+// sids from the list of status pending subchannels of ISC iscnum,
+// storing them in out. The caller must hold schibs_lock.
+static uint take_pending_from_isc(uint8_t iscnum, const pch_sid_set_t *sids, pch_css_completion_t *out, uint max) {
+        schib_dlist_t *isc_dlist = get_isc_dlist(iscnum);
+        pch_sid_t sid = (pch_sid_t)*isc_dlist;
+        pch_sid_t last = get_schib(sid)->mda.prevsid;
+        uint n = 0;
+
+        while (n < max) {
+                pch_schib_t *schib = get_schib(sid);
+                pch_sid_t next = schib->mda.nextsid;
+                bool was_last = sid == last;
+                if (pch_sid_set_contains(sids, sid)) {
+                        out[n].ic = css_make_intcode(schib);
+                        out[n].scsw = schib->scsw;
+                        remove_from_isc_dlist(iscnum, sid);
+                        css_clear_pending_subchannel(schib);
+                        n++;
+                }
+
+                if (was_last)
+                        break;
+
+                sid = next;
+        }
+
+        return n;
+}
+
+uint __time_critical_func(pch_sch_test_any)(const pch_sid_set_t *sids, pch_css_completion_t *out, uint max) {
+        uint n = 0;
+        uint32_t status = schibs_lock();
+
+        // Only the lists of ISCs with status pending subchannels
+        // need looking at, highest priority (lowest ISC) first
+        uint8_t mask = CSS.isc_status_mask;
+        while (mask && n < max) {
+                uint8_t iscnum = (uint8_t)__builtin_ctz(mask);
+                mask &= mask - 1;
+                n += take_pending_from_isc(iscnum, sids, out + n, max - n);
+        }
+
+        schibs_unlock(status);
+
+        for (uint i = 0; i < n; i++) {
+                trace_schib_scsw_cc(PCH_TRC_RT_CSS_SCH_TEST,
+                        get_schib(out[i].ic.sid), &out[i].scsw, 0);
+        }
+
+        return n;
+}
+
 static int do_sch_modify(pch_schib_t *schib, pch_pmcw_t pmcw) {
         int cc;
         uint32_t status = schibs_lock();
@@ -260,6 +325,18 @@ static int do_sch_modify(pch_schib_t *schib, pch_pmcw_t pmcw) {
                 goto out;
         }
 
+        // A function that has been requested but which the CSS has
+        // not yet taken leaves the schib on the function list that
+        // its priority flag selects, so the flag must not change
+        const uint16_t pending_mask = PCH_AC_RESUME_PENDING
+                | PCH_AC_START_PENDING
+                | PCH_AC_HALT_PENDING
+                | PCH_AC_CLEAR_PENDING;
+        if (schib->scsw.ctrl_flags & pending_mask) {
+                cc = 2;
+                goto out;
+        }
+
         if (schib_is_status_pending(schib)) {
                 cc = 1;
                 goto out;
@@ -344,6 +421,44 @@ int __time_critical_func(pch_sch_store_scsw)(pch_sid_t sid, pch_scsw_t *out_scsw
 	return cc;
 }
 
+int __time_critical_func(pch_sch_modify_share)(pch_sid_t sid, uint16_t share) {
+	if (sid >= PCH_NUM_SCHIBS)
+		return 3;
+
+        schib_sched_t *ss = get_schib_sched(get_schib(sid));
+        uint32_t status = schibs_lock();
+        ss->share = share;
+        ss->credit = 0;
+        schibs_unlock(status);
+        return 0;
+}
+
+int __time_critical_func(pch_sch_store_stats)(pch_sid_t sid, pch_sch_stats_t *out_stats) {
+	if (sid >= PCH_NUM_SCHIBS)
+		return 3;
+
+#if PCH_CONFIG_ENABLE_SCH_STATS
+        uint32_t status = schibs_lock();
+        *out_stats = CSS.stats[sid];
+        schibs_unlock(status);
+#else
+        *out_stats = (pch_sch_stats_t){0};
+#endif
+        return 0;
+}
+
+int __time_critical_func(pch_sch_clear_stats)(pch_sid_t sid) {
+	if (sid >= PCH_NUM_SCHIBS)
+		return 3;
+
+#if PCH_CONFIG_ENABLE_SCH_STATS
+        uint32_t status = schibs_lock();
+        CSS.stats[sid] = (pch_sch_stats_t){0};
+        schibs_unlock(status);
+#endif
+        return 0;
+}
+
 pch_intcode_t __time_critical_func(pch_test_pending_interruption)(void) {
 	pch_schib_t *schib = pop_pending_schib();
         return css_make_intcode(schib);
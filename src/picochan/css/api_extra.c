@@ -85,6 +85,22 @@ int __time_critical_func(pch_sch_modify_traced)(pch_sid_t sid, bool traced) {
         return pch_sch_modify(sid, &schib.pmcw);
 }
 
+// pch_sch_modify_priority does a non-atomic store-then-modify of the
+// schib's PMCW to modify the priority bit in its flags.
+int __time_critical_func(pch_sch_modify_priority)(pch_sid_t sid, bool priority) {
+        pch_schib_t schib;
+        int cc = pch_sch_store(sid, &schib);
+        if (cc)
+                return cc;
+
+        if (priority)
+                schib.pmcw.flags |= PCH_PMCW_PRIORITY;
+        else
+                schib.pmcw.flags &= ~PCH_PMCW_PRIORITY;
+
+        return pch_sch_modify(sid, &schib.pmcw);
+}
+
 void __time_critical_func(pch_sch_modify_isc_range)(pch_sid_t sid, uint count, uint8_t isc) {
         while (count--)
                 if (pch_sch_modify_isc(sid++, isc))
@@ -128,6 +144,33 @@ int __time_critical_func(pch_sch_wait_timeout)(pch_sid_t sid, pch_scsw_t *scsw,
         // NOTREACHED
 }
 
+uint __time_critical_func(pch_sch_wait_any)(const pch_sid_set_t *sids, pch_css_completion_t *out, uint max) {
+        valid_params_if(PCH_CSS, max > 0);
+        while (1) {
+                uint n = pch_sch_test_any(sids, out, max);
+                if (n)
+                        return n;
+
+                __wfe();
+        }
+
+        // NOTREACHED
+}
+
+uint __time_critical_func(pch_sch_wait_any_timeout)(const pch_sid_set_t *sids, pch_css_completion_t *out, uint max, absolute_time_t timeout_timestamp) {
+        valid_params_if(PCH_CSS, max > 0);
+        while (1) {
+                uint n = pch_sch_test_any(sids, out, max);
+                if (n)
+                        return n;
+
+                if (best_effort_wfe_or_timeout(timeout_timestamp))
+                        return 0;
+        }
+
+        // NOTREACHED
+}
+
 int __time_critical_func(pch_sch_run_wait)(pch_sid_t sid, pch_ccw_t *ccw_addr, pch_scsw_t *scsw) {
         int cc = pch_sch_start(sid, ccw_addr);
         if (cc)
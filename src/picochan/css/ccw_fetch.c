@@ -5,8 +5,7 @@
 
 #include <stdint.h>
 #include <assert.h>
-#include "schib_internal.h"
-#include "picochan/css.h"
+#include "css_internal.h"
 #include "css_trace.h"
 
 // fetch_ccw fetches an 8-byte CCW from bus address addr, which must
@@ -37,6 +36,44 @@ static inline void update_ccw_fields(pch_schib_t *schib, pch_ccw_t *ccw_addr, pc
 	schib->mda.data_addr = ccw.addr;
 }
 
+// fetch_ccwd returns the pre-decoded CCW of prepared channel program
+// cp that is executed when the CCW at ccw_addr is fetched, which is
+// that of the target of the TIC at ccw_addr if there is one or else
+// that of the CCW itself. If ccw_addr is outside the program, it sets
+// a program check in schib->scsw.schs and returns NULL.
+static inline pch_ccwd_t *fetch_ccwd(pch_schib_t *schib, pch_chanprog_t *cp, pch_ccw_t *ccw_addr) {
+        uint32_t i = (uint32_t)(ccw_addr - cp->ccws);
+        if (i >= cp->len) {
+		schib->scsw.schs |= PCH_SCHS_PROGRAM_CHECK;
+		return NULL;
+        }
+
+        return &cp->ccwds[cp->ccwds[i].target];
+}
+
+// fetch_prepared_ccw is the equivalent of fetch_chain_ccw for a
+// prepared channel program cp. It is also used for the first CCW
+// since pch_chanprog_prepare has already checked that is not a TIC.
+// A CCW prepared with the Suspend flag set is fetched afresh from
+// memory since the application may have cleared the flag while the
+// program was suspended there. Nothing is written back to cp, which
+// other subchannels may be running too.
+static uint8_t fetch_prepared_ccw(pch_schib_t *schib, pch_chanprog_t *cp) {
+        pch_ccwd_t *d = fetch_ccwd(schib, cp,
+                (pch_ccw_t*)schib->scsw.ccw_addr);
+        if (!d)
+                return 0;
+
+        pch_ccw_t *ccw_addr = cp->ccws + d->target;
+        pch_ccw_t ccw = d->ccw;
+        if (ccw.flags & PCH_CCW_FLAG_S)
+                ccw = fetch_ccw(ccw_addr);
+
+	trace_schib_ccw(PCH_TRC_RT_CSS_CCW_FETCH, schib, ccw_addr, ccw);
+        update_ccw_fields(schib, ccw_addr + 1, ccw);
+	return ccw.cmd;
+}
+
 // fetch_first_command_ccw uses fetch_ccw to fetch the CCW pointed to
 // by schib->scsw.ccw_ddr, validates it as a first CCW of a channel
 // program, then stores all fields except ccw.cmd into the schib, sets
@@ -44,7 +81,16 @@ static inline void update_ccw_fields(pch_schib_t *schib, pch_ccw_t *ccw_addr, pc
 // based on whether ccw.cmd is a Write-type command or not and returns
 // that ccw.cmd. If there is an error, an appropriate flag is set in
 // schib->scsw.schs.
+// For a prepared channel program, the CCW comes from its pre-decoded
+// form instead.
 uint8_t __time_critical_func(fetch_first_command_ccw)(pch_schib_t *schib) {
+        pch_chanprog_t *cp = get_schib_chanprog(schib);
+        if (cp) {
+                uint8_t ccwcmd = fetch_prepared_ccw(schib, cp);
+                update_ccw_cmd_write_flag(schib, ccwcmd);
+                return ccwcmd;
+        }
+
 	pch_ccw_t *ccw_addr = (pch_ccw_t*)schib->scsw.ccw_addr;
 	pch_ccw_t ccw = fetch_ccw(ccw_addr);
 	trace_schib_ccw(PCH_TRC_RT_CSS_CCW_FETCH, schib, ccw_addr, ccw);
@@ -70,10 +116,19 @@ uint8_t __time_critical_func(fetch_first_command_ccw)(pch_schib_t *schib) {
 // flag in schib->scsw.ctrl_flags to 1 or 0 based on whether ccw.cmd
 // is a Write-type command or not and returns that ccw.cmd. If there
 // is an error, an appropriate flag is set in schib->scsw.schs.
+// For a prepared channel program, the CCW is fetched from memory
+// too, since the application may have changed it (typically to
+// clear its Suspend flag) while the program was suspended.
 uint8_t __time_critical_func(fetch_resume_ccw)(pch_schib_t *schib) {
 	// fetch CCW from preceding location
 	pch_ccw_t *ccw_addr = (pch_ccw_t*)schib->scsw.ccw_addr;
         ccw_addr--; // -8 bytes
+        pch_chanprog_t *cp = get_schib_chanprog(schib);
+        if (cp && (uint32_t)(ccw_addr - cp->ccws) >= cp->len) {
+		schib->scsw.schs |= PCH_SCHS_PROGRAM_CHECK;
+		return 0;
+        }
+
 	pch_ccw_t ccw = fetch_ccw(ccw_addr);
 	trace_schib_ccw(PCH_TRC_RT_CSS_CCW_FETCH, schib, ccw_addr, ccw);
 	// Don't increment schib->scsw.ccw_addr
@@ -90,11 +145,77 @@ uint8_t __time_critical_func(fetch_resume_ccw)(pch_schib_t *schib) {
 	return ccw.cmd;
 }
 
+// prefetch_chain_ccw is called once a segment of the current CCW of
+// schib has been started. If chp prefetches CCWs and the current CCW
+// chains, it fetches the CCW that fetch_chain_ccw will fetch next,
+// following a valid TIC, and keeps it in the schib's ccw_prefetch_t
+// slot for fetch_chain_ccw to use instead, as long as scsw.ccw_addr
+// has not since changed (a StatusModifier skip). An invalid TIC is not
+// kept so that fetch_chain_ccw finds it again and reports it.
+void __time_critical_func(prefetch_chain_ccw)(pch_chp_t *chp, pch_schib_t *schib) {
+        if (!pch_chp_is_prefetching(chp))
+                return;
+
+        // The segment may already have ended the channel program, in
+        // which case devs no longer holds the stashed CCW flags
+        if (schib_is_status_pending(schib) || schib->scsw.schs != 0)
+                return;
+
+        const uint8_t mask = PCH_CCW_FLAG_CC | PCH_CCW_FLAG_CD;
+        if (!(get_stashed_ccw_flags(schib) & mask))
+                return;
+
+        ccw_prefetch_t *pf = get_schib_prefetch(schib);
+        uint32_t addr = schib->scsw.ccw_addr;
+        if ((pf && pf->addr == addr) || get_schib_chanprog(schib))
+                return;
+
+        pch_ccw_t *ccw_addr = (pch_ccw_t*)addr;
+	pch_ccw_t ccw = fetch_ccw(ccw_addr);
+	trace_schib_ccw(PCH_TRC_RT_CSS_CCW_FETCH, schib, ccw_addr, ccw);
+        ccw_addr++; // +8 bytes
+
+	if (ccw.cmd == PCH_CCW_CMD_TIC) {
+                ccw_addr = pch_ccw_get_addr(ccw);
+		ccw = fetch_ccw(ccw_addr);
+                trace_schib_ccw(PCH_TRC_RT_CSS_CCW_FETCH, schib,
+                        ccw_addr, ccw);
+		ccw_addr++; // +8 bytes
+                if (ccw.cmd == PCH_CCW_CMD_TIC) {
+                        if (pf)
+                                pf->addr = 0;
+			return;
+                }
+	}
+
+        // Take over the slot even if it holds another subchannel's
+        pf = get_prefetch_slot(schib);
+        pf->sid = get_sid(schib);
+        pf->addr = addr;
+        pf->next = (uint32_t)ccw_addr;
+        pf->ccw = ccw;
+}
+
 // fetch_chain_ccw uses fetch_ccw to fetch the CCW pointed to by
 // schib->scsw.ccw_addr, follows valid TICs then stores all fields
 // except ccw.cmd into the schib and returns that ccw.cmd. If there
 // is an error, an appropriate flag is set in schib->scsw.schs.
+// For a prepared channel program, the CCW comes from its pre-decoded
+// form instead and, if prefetch_chain_ccw has already fetched it,
+// from the schib's ccw_prefetch_t slot.
 uint8_t __time_critical_func(fetch_chain_ccw)(pch_schib_t *schib) {
+        pch_chanprog_t *cp = get_schib_chanprog(schib);
+        if (cp)
+                return fetch_prepared_ccw(schib, cp);
+
+        ccw_prefetch_t *pf = get_schib_prefetch(schib);
+        if (pf && pf->addr == schib->scsw.ccw_addr) {
+                // already fetched by prefetch_chain_ccw
+                pf->addr = 0;
+                update_ccw_fields(schib, (pch_ccw_t*)pf->next, pf->ccw);
+                return pf->ccw.cmd;
+        }
+
         pch_ccw_t *ccw_addr = (pch_ccw_t*)schib->scsw.ccw_addr;
 	pch_ccw_t ccw = fetch_ccw(ccw_addr);
 	trace_schib_ccw(PCH_TRC_RT_CSS_CCW_FETCH, schib, ccw_addr, ccw);
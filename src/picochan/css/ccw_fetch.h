@@ -16,4 +16,6 @@ uint8_t fetch_chain_ccw(pch_schib_t *schib);
 
 uint8_t fetch_chain_command_ccw(pch_schib_t *schib);
 
+void prefetch_chain_ccw(pch_chp_t *chp, pch_schib_t *schib);
+
 #endif
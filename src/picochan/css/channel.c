@@ -6,6 +6,10 @@
 #include "css_internal.h"
 #include "css_trace.h"
 
+// css_mem_rings are the rings through which each channel sends to
+// its CU when it is a memchan, indexed by chpid
+static dmachan_mem_ring_t PCH_SRAM_PLACEMENT(DMACHAN_MEM_RING_SRAM_BANK, "picochan_css_mem_rings") css_mem_rings[PCH_NUM_CHANNELS];
+
 pch_channel_t *pch_chp_get_channel(pch_chpid_t chpid) {
         pch_chp_t *chp = pch_get_chp(chpid);
         assert(pch_chp_is_allocated(chp));
@@ -59,8 +63,11 @@ pch_sid_t pch_chp_alloc(pch_chpid_t chpid, uint16_t num_devices) {
 	chp->num_devices = num_devices;
 	chp->rx_data_for_ua = -1;
 	chp->ua_func_dlist = -1;
+	chp->ua_prio_func_dlist = -1;
         chp->ua_response_slist.head = -1;
         chp->ua_response_slist.tail = -1;
+        chp->ua_prio_response_slist.head = -1;
+        chp->ua_prio_response_slist.tail = -1;
         pch_chp_set_allocated(chp, true);
 
 	for (int i = 0; i < num_devices; i++) {
@@ -119,16 +126,12 @@ void pch_chp_configure_piochan(pch_chpid_t chpid, pch_pio_config_t *cfg, pch_pio
 }
 
 void pch_chp_configure_memchan(pch_chpid_t chpid, pch_channel_t *chpeer) {
-        // Check that spin_lock is initialised even when not a Debug
-        // release because silently ignoring it produces such
-        // nasty-to-troubleshoot race conditions
-        dmachan_panic_unless_memchan_initialised();
-
         pch_chp_t *chp = pch_get_chp(chpid);
         assert(pch_chp_is_allocated(chp));
 
         pch_css_configure_dma_irq_if_needed();
-        pch_channel_init_memchan(&chp->channel, chpid, CSS.irq_index, chpeer);
+        pch_channel_init_memchan_ring(&chp->channel, chpid, CSS.irq_index, chpeer,
+                &css_mem_rings[chpid]);
 
         trace_chp_dma(PCH_TRC_RT_CSS_CHP_TX_DMA_INIT, chpid,
                 &chp->channel.tx.link);
@@ -136,6 +139,14 @@ void pch_chp_configure_memchan(pch_chpid_t chpid, pch_channel_t *chpeer) {
                 &chp->channel.rx.link);
 }
 
+void pch_chp_configure_memchan_polled(pch_chpid_t chpid, pch_channel_t *chpeer) {
+        pch_chp_t *chp = pch_get_chp(chpid);
+        assert(pch_chp_is_allocated(chp));
+
+        pch_channel_init_memchan_polled_ring(&chp->channel, chpid, chpeer,
+                &css_mem_rings[chpid]);
+}
+
 uint8_t pch_chp_set_trace_flags(pch_chpid_t chpid, uint8_t trace_flags) {
 	pch_chp_t *chp = pch_get_chp(chpid);
         trace_flags &= PCH_CHP_TRACED_MASK;
@@ -163,6 +174,34 @@ bool pch_chp_set_trace(pch_chpid_t chpid, bool trace) {
         return old_trace_flags != new_trace_flags;
 }
 
+bool pch_chp_set_batching(pch_chpid_t chpid, bool batching) {
+	pch_chp_t *chp = pch_get_chp(chpid);
+        bool old_batching = pch_chp_is_tx_batching(chp);
+        pch_chp_set_tx_batching(chp, batching);
+        return old_batching;
+}
+
+bool pch_chp_set_prefetch(pch_chpid_t chpid, bool prefetch) {
+	pch_chp_t *chp = pch_get_chp(chpid);
+        bool old_prefetch = pch_chp_is_prefetching(chp);
+        pch_chp_set_prefetching(chp, prefetch);
+        return old_prefetch;
+}
+
+bool pch_chp_set_exact_counts(pch_chpid_t chpid, bool exact) {
+	pch_chp_t *chp = pch_get_chp(chpid);
+        bool old_exact = pch_chp_is_exact_counting(chp);
+        pch_chp_set_exact_counting(chp, exact);
+        return old_exact;
+}
+
+uint16_t pch_chp_set_max_segment(pch_chpid_t chpid, uint16_t max_segment) {
+	pch_chp_t *chp = pch_get_chp(chpid);
+        uint16_t old_max_segment = chp->max_segment;
+        chp->max_segment = max_segment;
+        return old_max_segment;
+}
+
 void pch_chp_start(pch_chpid_t chpid) {
 	pch_chp_t *chp = pch_get_chp(chpid);
         assert(pch_channel_is_configured(&chp->channel));
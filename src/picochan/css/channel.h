@@ -33,6 +33,19 @@ typedef struct ua_slist {
         int16_t tail;
 } ua_slist_t;
 
+// pch_chp_tx_batch_t gathers command packets for a channel so that
+// they can be sent to the CU as a single Batch packet followed by
+// the gathered packets as data. Only the final packet may have data
+// following it and, if so, its pending transfer is held in data
+// until the gathered packets themselves have been sent.
+typedef struct pch_chp_tx_batch {
+        proto_packet_t          packets[PROTO_BATCH_MAX_PACKETS];
+        pch_txsm_t              data;
+        uint8_t                 count;
+        // final_data: data followed the final packet in the batch
+        bool                    final_data;
+} pch_chp_tx_batch_t;
+
 /*! \brief pch_chp_t is the CSS-side representation of a channel path
  * to a control unit.
  * \ingroup internal_css
@@ -54,12 +67,27 @@ typedef struct __aligned(4) pch_chp {
         // rx_data_end_ds: if non-zero then, when rx data complete,
         // treat as an immediate implicit device status for update_status
         uint8_t                 rx_data_end_ds;
+        // rx_batch_count: rx dma is active receiving packets of a
+        // Batch into rx_batch
+        uint8_t                 rx_batch_count;
         uint8_t                 flags;
         uint8_t                 trace_flags;
+        // max_segment: if non-zero, the most data that any single
+        // Data (or write-immediate Start) sent to one device may
+        // carry so that packets for other devices can be
+        // interleaved between the segments of a long transfer
+        uint16_t                max_segment;
         // ua_func_dlist: links via schib.prevua and .nextua
         ua_dlist_t              ua_func_dlist;
+        // ua_prio_func_dlist: as ua_func_dlist for priority schibs
+        ua_dlist_t              ua_prio_func_dlist;
         // ua_response_slist: link via schib.nextua
         ua_slist_t              ua_response_slist;
+        // ua_prio_response_slist: as ua_response_slist for
+        // priority schibs
+        ua_slist_t              ua_prio_response_slist;
+        pch_chp_tx_batch_t      tx_batch;
+        proto_packet_t          rx_batch[PROTO_BATCH_MAX_PACKETS];
 } pch_chp_t;
 
 // values for pch_chp_t flags
@@ -67,8 +95,18 @@ typedef struct __aligned(4) pch_chp {
 #define PCH_CHP_RX_RESPONSE_REQUIRED    0x01
 #define PCH_CHP_CLAIMED                 0x02
 #define PCH_CHP_ALLOCATED               0x04
+// tx_batching: gather packets waiting for tx into Batch packets
+#define PCH_CHP_TX_BATCHING             0x08
+// tx_batch_open: packets being sent are gathered into tx_batch
+#define PCH_CHP_TX_BATCH_OPEN           0x10
 // tx_active: tx dma is active
 #define PCH_CHP_TX_ACTIVE               0x20
+// prefetch: fetch the next CCW of a chain while the current
+// segment is being transferred
+#define PCH_CHP_PREFETCH                0x40
+// exact_counts: send a Count packet ahead of a Start whose count
+// the bsize encoding in the Start payload would round down
+#define PCH_CHP_EXACT_COUNTS            0x80
 
 static inline bool pch_chp_is_rx_response_required(pch_chp_t *chp) {
         return chp->flags & PCH_CHP_RX_RESPONSE_REQUIRED;
@@ -86,6 +124,22 @@ static inline bool pch_chp_is_tx_active(pch_chp_t *chp) {
         return chp->flags & PCH_CHP_TX_ACTIVE;
 }
 
+static inline bool pch_chp_is_prefetching(pch_chp_t *chp) {
+        return chp->flags & PCH_CHP_PREFETCH;
+}
+
+static inline bool pch_chp_is_exact_counting(pch_chp_t *chp) {
+        return chp->flags & PCH_CHP_EXACT_COUNTS;
+}
+
+static inline bool pch_chp_is_tx_batching(pch_chp_t *chp) {
+        return chp->flags & PCH_CHP_TX_BATCHING;
+}
+
+static inline bool pch_chp_is_tx_batch_open(pch_chp_t *chp) {
+        return chp->flags & PCH_CHP_TX_BATCH_OPEN;
+}
+
 static inline void pch_chp_set_rx_response_required(pch_chp_t *chp, bool b) {
         if (b)
                 chp->flags |= PCH_CHP_RX_RESPONSE_REQUIRED;
@@ -114,6 +168,44 @@ static inline void pch_chp_set_tx_active(pch_chp_t *chp, bool b) {
                 chp->flags &= ~PCH_CHP_TX_ACTIVE;
 }
 
+static inline void pch_chp_set_prefetching(pch_chp_t *chp, bool b) {
+        if (b)
+                chp->flags |= PCH_CHP_PREFETCH;
+        else
+                chp->flags &= ~PCH_CHP_PREFETCH;
+}
+
+static inline void pch_chp_set_exact_counting(pch_chp_t *chp, bool b) {
+        if (b)
+                chp->flags |= PCH_CHP_EXACT_COUNTS;
+        else
+                chp->flags &= ~PCH_CHP_EXACT_COUNTS;
+}
+
+static inline void pch_chp_set_tx_batching(pch_chp_t *chp, bool b) {
+        if (b)
+                chp->flags |= PCH_CHP_TX_BATCHING;
+        else
+                chp->flags &= ~PCH_CHP_TX_BATCHING;
+}
+
+static inline void pch_chp_set_tx_batch_open(pch_chp_t *chp, bool b) {
+        if (b)
+                chp->flags |= PCH_CHP_TX_BATCH_OPEN;
+        else
+                chp->flags &= ~PCH_CHP_TX_BATCH_OPEN;
+}
+
+// pch_chp_cap_segment returns count capped at the max_segment of
+// chp, if it has one
+static inline uint16_t pch_chp_cap_segment(pch_chp_t *chp, uint16_t count) {
+        uint16_t max_segment = chp->max_segment;
+        if (max_segment && count > max_segment)
+                return max_segment;
+
+        return count;
+}
+
 static inline bool pch_chp_is_traced_general(pch_chp_t *chp) {
         return chp->trace_flags & PCH_CHP_TRACED_GENERAL;
 }
@@ -201,14 +293,66 @@ static inline bool push_ua_slist(ua_slist_t *l, pch_chp_t *chp, pch_sid_t sid) {
         return was_empty;
 }
 
-// popping from and pushing to the channel ua_response_slist of schibs
+// pch_chp_func_dlist returns the function list of chp that schib
+// waits on: ua_prio_func_dlist for a priority schib, otherwise
+// ua_func_dlist
+static inline ua_dlist_t *pch_chp_func_dlist(pch_chp_t *chp, pch_schib_t *schib) {
+        if (schib_is_priority(schib))
+                return &chp->ua_prio_func_dlist;
+
+        return &chp->ua_func_dlist;
+}
+
+// pch_chp_response_slist returns the response list of chp that
+// schib waits on: ua_prio_response_slist for a priority schib,
+// otherwise ua_response_slist
+static inline ua_slist_t *pch_chp_response_slist(pch_chp_t *chp, pch_schib_t *schib) {
+        if (schib_is_priority(schib))
+                return &chp->ua_prio_response_slist;
+
+        return &chp->ua_response_slist;
+}
+
+ua_dlist_t *select_ua_func_dlist_unsafe(pch_chp_t *chp);
+
+// select_ua_response_slist returns the response list of chp from
+// which the next schib should be popped, the priority one first,
+// or NULL if both are empty
+static inline ua_slist_t *select_ua_response_slist(pch_chp_t *chp) {
+        if (chp->ua_prio_response_slist.head != -1)
+                return &chp->ua_prio_response_slist;
+
+        if (chp->ua_response_slist.head != -1)
+                return &chp->ua_response_slist;
+
+        return NULL;
+}
+
+// popping from and pushing to the channel response lists of schibs
 // with response packets pending to be sent to their CUs
 static inline pch_schib_t *pop_ua_response_slist(pch_chp_t *chp) {
-        return pop_ua_slist(&chp->ua_response_slist, chp);
+        uint32_t status = schibs_lock();
+        pch_schib_t *schib = NULL;
+        ua_slist_t *l = select_ua_response_slist(chp);
+        if (l)
+                schib = pop_ua_slist_unsafe(l, chp);
+        schibs_unlock(status);
+        return schib;
 }
 
-static inline void push_ua_response_slist(pch_chp_t *chp, pch_sid_t sid) {
-        push_ua_slist(&chp->ua_response_slist, chp, sid);
+void push_ua_response_slist(pch_chp_t *chp, pch_sid_t sid);
+
+// pop_ua_func_dlist pops the schib from the function lists of chp
+// whose function the CSS should process next or returns NULL if
+// there is none
+static inline pch_schib_t *pop_ua_func_dlist(pch_chp_t *chp) {
+        uint32_t status = schibs_lock();
+        pch_schib_t *schib = NULL;
+        ua_dlist_t *l = select_ua_func_dlist_unsafe(chp);
+        if (l)
+                schib = pop_ua_dlist_unsafe(l, chp);
+        schibs_unlock(status);
+        return schib;
 }
 
 //
@@ -231,5 +375,14 @@ static inline proto_packet_t get_tx_packet(pch_chp_t *chp) {
 }
 
 void send_tx_packet(pch_chp_t *chp, pch_schib_t *schib, proto_packet_t p);
+void start_tx_cmdbuf(pch_chp_t *chp);
+
+//
+// gathering packets into a Batch
+//
+
+bool css_tx_batch_has_ua(pch_chp_t *chp, pch_unit_addr_t ua);
+void css_tx_batch_add(pch_chp_t *chp, pch_schib_t *schib, proto_packet_t p);
+void css_tx_batch_flush(pch_chp_t *chp);
 
 #endif
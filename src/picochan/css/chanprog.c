@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2025 Malcolm Beattie
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "css_internal.h"
+
+// chanprog_index returns the index within ccws (of len CCWs) of the
+// CCW at addr or -1 if addr is not exactly that of one of them.
+static int chanprog_index(pch_ccw_t *ccws, uint16_t len, uint32_t addr) {
+        uint32_t offset = addr - (uint32_t)ccws;
+        if (offset % sizeof(pch_ccw_t) != 0)
+                return -1;
+
+        uint32_t i = offset / sizeof(pch_ccw_t);
+        if (i >= len)
+                return -1;
+
+        return (int)i;
+}
+
+int pch_chanprog_prepare(pch_chanprog_t *cp, pch_ccw_t *ccws, uint16_t len, pch_ccwd_t *ccwds) {
+        valid_params_if(PCH_CSS, ((uint32_t)ccws & 0x3) == 0);
+
+        if (len == 0 || ccws[0].cmd == PCH_CCW_CMD_TIC)
+                return 0;
+
+        // Resolve each TIC to its target so the CSS need not follow it
+        for (uint16_t i = 0; i < len; i++) {
+                pch_ccw_t ccw = ccws[i];
+                int target = (int)i;
+                if (ccw.cmd == PCH_CCW_CMD_TIC) {
+                        target = chanprog_index(ccws, len, ccw.addr);
+                        if (target < 0)
+                                return (int)i;
+
+                        if (ccws[target].cmd == PCH_CCW_CMD_TIC)
+                                return (int)i;
+                }
+
+                ccwds[i] = (pch_ccwd_t){
+                        .ccw = ccw,
+                        .target = (uint16_t)target
+                };
+        }
+
+        // Check chaining now that each TIC's target is known
+        for (uint16_t i = 0; i < len; i++) {
+                pch_ccw_flags_t flags = ccwds[i].ccw.flags;
+                if (ccwds[i].target != i
+                        || !(flags & (PCH_CCW_FLAG_CC|PCH_CCW_FLAG_CD)))
+                        continue;
+
+                uint16_t next = (uint16_t)(i + 1);
+                if (next >= len)
+                        return (int)i;
+
+                pch_ccwd_t *nd = &ccwds[ccwds[next].target];
+                if ((flags & PCH_CCW_FLAG_CD)
+                        && (nd->ccw.flags & PCH_CCW_FLAG_S))
+                        return (int)next;
+        }
+
+        cp->ccws = ccws;
+        cp->ccwds = ccwds;
+        cp->len = len;
+        return -1;
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2025 Malcolm Beattie
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "css_internal.h"
+
+// The completion ring has a single producer, pch_css_io_irq_handler
+// (see callback_pending_schibs in notify.c), which only advances
+// head, and a single consumer, the functions here, which only
+// advance tail. The handler runs on the CSS core. With a cross-core
+// CSS (see pch_css_init_cross_core) the reaper may run on the other
+// core and so race the handler, not just be interrupted by it. Each
+// side therefore checks stalled, or the ring being full, again after
+// a barrier that follows its own update, so that at least one of
+// them sees the other's update.
+
+void pch_css_set_completion_ring(pch_css_completion_ring_t *ring, pch_css_completion_t *entries, uint32_t capacity) {
+        if (ring) {
+                valid_params_if(PCH_CSS, entries != NULL);
+                valid_params_if(PCH_CSS,
+                        capacity && !(capacity & (capacity - 1)));
+                ring->entries = entries;
+                ring->capacity = capacity;
+                ring->head = 0;
+                ring->tail = 0;
+                ring->overflows = 0;
+                ring->stalled = false;
+        }
+
+        CSS.completion_ring = ring;
+}
+
+uint __time_critical_func(pch_css_reap_completions)(pch_css_completion_t *out, uint max) {
+        pch_css_completion_ring_t *ring = CSS.completion_ring;
+        valid_params_if(PCH_CSS, ring != NULL);
+
+        uint32_t tail = ring->tail;
+        uint32_t avail = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE)
+                - tail;
+        uint n = avail < max ? avail : max;
+        uint32_t mask = ring->capacity - 1;
+        for (uint i = 0; i < n; i++)
+                out[i] = ring->entries[(tail + i) & mask];
+
+        __atomic_store_n(&ring->tail, tail + n, __ATOMIC_RELEASE);
+        // The handler must either see the new tail or have set
+        // stalled before we look at it
+        __dmb();
+
+        if (n && ring->stalled) {
+                ring->stalled = false;
+                raise_io_irq();
+        }
+
+        return n;
+}
+
+uint __time_critical_func(pch_css_wait_completions)(pch_css_completion_t *out, uint max) {
+        while (1) {
+                uint n = pch_css_reap_completions(out, max);
+                if (n)
+                        return n;
+
+                __wfe();
+        }
+
+        // NOTREACHED
+}
+
+uint __time_critical_func(pch_css_wait_completions_timeout)(pch_css_completion_t *out, uint max, absolute_time_t timeout_timestamp) {
+        while (1) {
+                uint n = pch_css_reap_completions(out, max);
+                if (n)
+                        return n;
+
+                if (best_effort_wfe_or_timeout(timeout_timestamp))
+                        return 0;
+        }
+
+        // NOTREACHED
+}
@@ -9,9 +9,11 @@
 //! CSS is a channel subsystem. It is intended to be a singleton and
 //! is just a convenience for gathering together the global variables
 //! associated with the CSS.
-struct css __not_in_flash("picochan_css") CSS;
+struct css PCH_SRAM_PLACEMENT(PCH_CSS_SRAM_BANK, "picochan_css") CSS;
 
-unsigned char pch_css_trace_buffer_space[PCH_TRC_NUM_BUFFERS * PCH_TRC_BUFFER_SIZE] __aligned(4);
+css_schibs_lock_t css_schibs_lock = {.owner = -1};
+
+unsigned char PCH_SRAM_PLACEMENT(PCH_CSS_TRACE_SRAM_BANK, "picochan_css_trace") pch_css_trace_buffer_space[PCH_TRC_NUM_BUFFERS * PCH_TRC_BUFFER_SIZE] __aligned(4);
 
 void pch_css_init(void) {
         memset(&CSS, 0, sizeof CSS);
@@ -36,6 +38,14 @@ void pch_css_init(void) {
         }
 }
 
+void pch_css_init_cross_core(void) {
+        pch_css_init();
+        if (!css_schibs_lock.spin_lock) {
+                uint lock_num = (uint)spin_lock_claim_unused(true);
+                css_schibs_lock.spin_lock = spin_lock_init(lock_num);
+        }
+}
+
 // Helpers for setting CSS IRQ handlers
 
 static void css_try_set_core_num() {
@@ -219,6 +229,15 @@ void pch_css_auto_configure_func_irq(void) {
         pch_css_configure_func_irq_unused_shared_default(true);
 }
 
+// Configuring doorbell IRQ handler for a cross-core CSS
+
+static void configure_doorbell_irq(void) {
+        multicore_fifo_drain();
+        multicore_fifo_clear_irq();
+        irq_num_t irqnum = SIO_FIFO_IRQ_NUM(get_core_num());
+        configure_irq_handler(irqnum, pch_css_doorbell_irq_handler, -1);
+}
+
 // Configuring I/O IRQ handler
 
 int16_t pch_css_get_io_irq(void) {
@@ -303,24 +322,29 @@ void pch_css_start(io_callback_t io_callback, uint8_t isc_mask) {
         if (CSS.func_irqnum == -1)
                 pch_css_auto_configure_func_irq();
 
-        if (io_callback) {
+        if (io_callback)
                 pch_css_set_io_callback(io_callback);
-                if (CSS.io_irqnum == -1)
-                        pch_css_auto_configure_io_irq();
-        }
+
+        if ((io_callback || CSS.completion_ring) && CSS.io_irqnum == -1)
+                pch_css_auto_configure_io_irq();
+
+        if (css_schibs_lock.spin_lock)
+                configure_doorbell_irq();
 }
 
 bool pch_css_set_trace(bool trace) {
         return pch_trc_set_enable(&CSS.trace_bs, trace);
 }
 
-void __time_critical_func(send_tx_packet)(pch_chp_t *chp, pch_schib_t *schib, proto_packet_t p) {
+pch_trc_bufferset_t *pch_css_get_trace_bufferset(void) {
+        return &CSS.trace_bs;
+}
+
+// start_tx_cmdbuf starts sending the command packet that has been
+// set in the channel's tx cmdbuf.
+void __time_critical_func(start_tx_cmdbuf)(pch_chp_t *chp) {
         dmachan_tx_channel_t *tx = &chp->channel.tx;
         dmachan_link_t *txl = &tx->link;
-        uint32_t cmd = proto_packet_as_word(p);
-        dmachan_link_cmd_set(txl, dmachan_make_cmd_from_word(cmd));
-        trace_schib_packet(PCH_TRC_RT_CSS_SEND_TX_PACKET, schib, p,
-                dmachan_link_seqnum(txl));
         pch_chp_set_tx_active(chp, true);
         dmachan_start_src_cmdbuf(tx);
         if (txl->complete) {
@@ -333,6 +357,20 @@ void __time_critical_func(send_tx_packet)(pch_chp_t *chp, pch_schib_t *schib, pr
         }
 }
 
+void __time_critical_func(send_tx_packet)(pch_chp_t *chp, pch_schib_t *schib, proto_packet_t p) {
+        if (pch_chp_is_tx_batch_open(chp)) {
+                css_tx_batch_add(chp, schib, p);
+                return;
+        }
+
+        dmachan_link_t *txl = &chp->channel.tx.link;
+        uint32_t cmd = proto_packet_as_word(p);
+        dmachan_link_cmd_set(txl, dmachan_make_cmd_from_word(cmd));
+        trace_schib_packet(PCH_TRC_RT_CSS_SEND_TX_PACKET, schib, p,
+                dmachan_link_seqnum(txl));
+        start_tx_cmdbuf(chp);
+}
+
 void __time_critical_func(pch_css_trace_write_user)(pch_trc_record_type_t rt, void *data, uint8_t data_size) {
         assert(rt >= PCH_TRC_RT_USER_FIRST);
         pch_trc_write_raw(&CSS.trace_bs, rt, data, data_size);
@@ -6,15 +6,11 @@
 #ifndef _PCH_CSS_CSS_INTERNAL_H
 #define _PCH_CSS_CSS_INTERNAL_H
 
-// PICO_CONFIG: PARAM_ASSERTIONS_ENABLED_PCH_CSS, Enable/disable assertions in the pch_css module, type=bool, default=0, group=pch_css
-#ifndef PARAM_ASSERTIONS_ENABLED_PCH_CSS
-#define PARAM_ASSERTIONS_ENABLED_PCH_CSS 0
-#endif
-
 #include <stdint.h>
 #include <assert.h>
 #include "hardware/sync.h"
 #include "hardware/irq.h"
+#include "pico/multicore.h"
 #include "picochan/css.h"
 #include "schibs_lock.h"
 #include "schib_internal.h"
@@ -35,6 +31,33 @@
  * \brief internal CSS implementations
  */
 
+/*! \brief schib_sched_t is the scheduling state of a subchannel
+ * \ingroup internal_css
+ *
+ * It is kept apart from the schib itself, whose size and layout are
+ * fixed, in CSS.scheds indexed by sid.
+ */
+typedef struct schib_sched {
+        int32_t         credit; //!< bytes of budget left, may go negative
+        uint16_t        share;  //!< budget given each turn, 0 for none
+} schib_sched_t;
+
+/*! \brief ccw_prefetch_t is a CCW fetched ahead of being needed
+ * \ingroup internal_css
+ *
+ * When the channel of a subchannel prefetches CCWs, the CCW that
+ * fetch_chain_ccw will next need is fetched while the current
+ * segment is transferred and kept, apart from the schib, in
+ * CSS.prefetches slot sid % PCH_NUM_CCW_PREFETCHES, tagged with
+ * the sid that it was fetched for.
+ */
+typedef struct ccw_prefetch {
+        uint32_t        addr;   //!< scsw.ccw_addr fetched for, 0 if none
+        uint32_t        next;   //!< scsw.ccw_addr after ccw (and any TIC)
+        pch_ccw_t       ccw;
+        pch_sid_t       sid;
+} ccw_prefetch_t;
+
 /*! \brief struct css is a channel subsystem (CSS)
  *
  * It is intended to be a singleton and is just a convenience for
@@ -43,6 +66,7 @@
 struct css {
         schib_dlist_t   isc_dlists[PCH_NUM_ISCS]; // indexed by ISC
         io_callback_t   io_callback;
+        pch_css_completion_ring_t *completion_ring; //!< NULL or filled instead of io_callback
         bool            dma_irq_configured;
         bool            pio_irq_configured[NUM_IRQ_INDEXES];
         int16_t         io_irqnum;   //!< -1 or Irq raised for schib notify
@@ -54,7 +78,18 @@ struct css {
         pch_sid_t       next_sid; //!< starting SID for next pch_chp_claim
         pch_trc_bufferset_t trace_bs;
         pch_chp_t       chps[PCH_NUM_CHANNELS];
+        // Per-subchannel state, split by how often it is touched so
+        // that large PCH_NUM_SCHIBS only costs what is needed: the
+        // schibs on every packet, scheds and chanprogs while a
+        // channel program runs and stats hardly at all. Prefetched
+        // CCWs are only held for PCH_NUM_CCW_PREFETCHES at a time.
         pch_schib_t     schibs[PCH_NUM_SCHIBS];
+        schib_sched_t   scheds[PCH_NUM_SCHIBS]; // indexed by sid
+        pch_chanprog_t  *chanprogs[PCH_NUM_SCHIBS]; // indexed by sid
+#if PCH_CONFIG_ENABLE_SCH_STATS
+        pch_sch_stats_t stats[PCH_NUM_SCHIBS]; // indexed by sid
+#endif
+        ccw_prefetch_t  prefetches[PCH_NUM_CCW_PREFETCHES];
 };
 
 extern struct css CSS;
@@ -73,6 +108,28 @@ static inline pch_chpid_t pch_get_chpid(pch_chp_t *chp) {
         return (pch_chpid_t)n;
 }
 
+void css_ring_doorbell(void);
+
+// css_raise_irq sets CSS IRQ irqnum pending on the core running the
+// CSS. That is the calling core unless the CSS is cross-core (see
+// pch_css_init_cross_core) and the caller is on the other core, in
+// which case it rings the doorbell of the CSS core instead.
+static inline void css_raise_irq(irq_num_t irqnum) {
+        if (css_schibs_lock.spin_lock
+                && get_core_num() != (uint)CSS.core_num) {
+                css_ring_doorbell();
+                return;
+        }
+
+        irq_set_pending(irqnum);
+}
+
+static inline void raise_io_irq(void) {
+        int16_t io_irqnum_opt = CSS.io_irqnum;
+        if (io_irqnum_opt > 0)
+                css_raise_irq((irq_num_t)io_irqnum_opt);
+}
+
 static inline schib_dlist_t *get_isc_dlist(uint8_t iscnum) {
         valid_params_if(PCH_CSS, iscnum < PCH_NUM_ISCS);
         return &CSS.isc_dlists[iscnum];
@@ -94,6 +151,78 @@ static inline pch_sid_t get_sid(pch_schib_t *schib) {
         return schib - CSS.schibs;
 }
 
+static inline schib_sched_t *get_schib_sched(pch_schib_t *schib) {
+        return &CSS.scheds[get_sid(schib)];
+}
+
+// get_schib_chanprog returns the prepared channel program that was
+// most recently started for schib or NULL if that was unprepared.
+static inline pch_chanprog_t *get_schib_chanprog(pch_schib_t *schib) {
+        return CSS.chanprogs[get_sid(schib)];
+}
+
+// get_prefetch_slot returns the ccw_prefetch_t slot that holds any
+// CCW prefetched for schib, which may instead hold one for another
+// subchannel.
+static inline ccw_prefetch_t *get_prefetch_slot(pch_schib_t *schib) {
+        return &CSS.prefetches[get_sid(schib) % PCH_NUM_CCW_PREFETCHES];
+}
+
+// get_schib_prefetch returns the CCW prefetched for schib or NULL if
+// there is none.
+static inline ccw_prefetch_t *get_schib_prefetch(pch_schib_t *schib) {
+        ccw_prefetch_t *pf = get_prefetch_slot(schib);
+        if (pf->addr == 0 || pf->sid != get_sid(schib))
+                return NULL;
+
+        return pf;
+}
+
+static inline void clear_schib_prefetch(pch_schib_t *schib) {
+        ccw_prefetch_t *pf = get_schib_prefetch(schib);
+        if (pf)
+                pf->addr = 0;
+}
+
+static inline void count_schib_start(pch_schib_t *schib) {
+#if PCH_CONFIG_ENABLE_SCH_STATS
+        CSS.stats[get_sid(schib)].starts++;
+#else
+        (void)schib;
+#endif
+}
+
+static inline void count_schib_split(pch_schib_t *schib) {
+#if PCH_CONFIG_ENABLE_SCH_STATS
+        CSS.stats[get_sid(schib)].splits++;
+#else
+        (void)schib;
+#endif
+}
+
+// css_charge_schib accounts for count data bytes sent or received
+// for schib against its share of the channel
+static inline void css_charge_schib(pch_schib_t *schib, uint16_t count) {
+#if PCH_CONFIG_ENABLE_SCH_STATS
+        CSS.stats[get_sid(schib)].bytes += count;
+#endif
+        schib_sched_t *ss = get_schib_sched(schib);
+        if (ss->share)
+                ss->credit -= (int32_t)count;
+}
+
+// css_take_turn is called for a schib taken from a function list to
+// be processed. As in deficit round robin when a flow's queue
+// empties, the schib keeps any debt from bytes charged beyond its
+// budget but not budget left unused, so that it does not carry
+// budget into its next channel program which it was given only
+// while waiting for others to take their turn.
+static inline void css_take_turn(pch_schib_t *schib) {
+        schib_sched_t *ss = get_schib_sched(schib);
+        if (ss->credit > 0)
+                ss->credit = 0;
+}
+
 static inline bool css_is_started(void) {
         return CSS.irq_index >= 0;
 }
@@ -6,6 +6,11 @@
 #ifndef _PCH_API_CSS_H
 #define _PCH_API_CSS_H
 
+// PICO_CONFIG: PARAM_ASSERTIONS_ENABLED_PCH_CSS, Enable/disable assertions in the pch_css module, type=bool, default=0, group=pch_css
+#ifndef PARAM_ASSERTIONS_ENABLED_PCH_CSS
+#define PARAM_ASSERTIONS_ENABLED_PCH_CSS 0
+#endif
+
 #include "hardware/irq.h"
 #include "hardware/dma.h"
 #include "hardware/sync.h"
@@ -72,6 +77,68 @@ static_assert(PCH_NUM_CHANNELS >= 1 && PCH_NUM_CHANNELS <= 256,
 static_assert(PCH_NUM_ISCS >= 1 && PCH_NUM_ISCS <= 8,
         "PCH_NUM_ISCS must be between 1 and 8");
 
+/*!
+ * \def PCH_NUM_CCW_PREFETCHES
+ * \ingroup picochan_css
+ * \hideinitializer
+ * \brief The number of CCWs that channels can hold prefetched
+ *
+ * Must be a compile-time constant between 1 and PCH_NUM_SCHIBS.
+ * Default PCH_NUM_SCHIBS or 32 if that is smaller.
+ * A CCW prefetched for subchannel sid (see \ref pch_chp_set_prefetch)
+ * is held in slot sid % PCH_NUM_CCW_PREFETCHES so, with fewer slots
+ * than subchannels, a subchannel can lose its prefetched CCW to
+ * another and then just fetches it again when it is needed.
+ */
+#ifndef PCH_NUM_CCW_PREFETCHES
+#define PCH_NUM_CCW_PREFETCHES (PCH_NUM_SCHIBS < 32 ? PCH_NUM_SCHIBS : 32)
+#endif
+static_assert(PCH_NUM_CCW_PREFETCHES >= 1
+        && PCH_NUM_CCW_PREFETCHES <= PCH_NUM_SCHIBS,
+        "PCH_NUM_CCW_PREFETCHES must be between 1 and PCH_NUM_SCHIBS");
+
+/*!
+ * \def PCH_CONFIG_ENABLE_SCH_STATS
+ * \ingroup picochan_css
+ * \hideinitializer
+ * \brief Whether the CSS keeps statistics for each subchannel
+ *
+ * Set to 0 to save the 12 bytes per subchannel of the
+ * pch_sch_stats_t counters, in which case pch_sch_store_stats()
+ * stores zeroes. Default 1.
+ */
+#ifndef PCH_CONFIG_ENABLE_SCH_STATS
+#define PCH_CONFIG_ENABLE_SCH_STATS 1
+#endif
+
+/*!
+ * \def PCH_CSS_SRAM_BANK
+ * \ingroup picochan_css
+ * \hideinitializer
+ * \brief The SRAM bank holding the CSS state
+ *
+ * One of MAIN, SCRATCH_X or SCRATCH_Y (see picochan/placement.h).
+ * Default MAIN. The CSS state includes the schibs, the CSS side of
+ * each channel and the per-subchannel side tables but not the
+ * memchan rings (see DMACHAN_MEM_RING_SRAM_BANK).
+ */
+#ifndef PCH_CSS_SRAM_BANK
+#define PCH_CSS_SRAM_BANK MAIN
+#endif
+
+/*!
+ * \def PCH_CSS_TRACE_SRAM_BANK
+ * \ingroup picochan_css
+ * \hideinitializer
+ * \brief The SRAM bank holding the CSS trace buffers
+ *
+ * One of MAIN, SCRATCH_X or SCRATCH_Y (see picochan/placement.h).
+ * Default MAIN.
+ */
+#ifndef PCH_CSS_TRACE_SRAM_BANK
+#define PCH_CSS_TRACE_SRAM_BANK MAIN
+#endif
+
 #define PCH_CSS_BUFFERSET_MAGIC 0x70437353
 
 /*! \brief A callback function to be invoked when a subchannel becomes status pending
@@ -80,6 +147,50 @@ static_assert(PCH_NUM_ISCS >= 1 && PCH_NUM_ISCS <= 8,
 
 typedef void(*io_callback_t)(pch_intcode_t, pch_scsw_t);
 
+/*! \brief Scheduling statistics for a subchannel
+ * \ingroup picochan_css
+ *
+ * Counters kept by the CSS for each subchannel, retrieved with
+ * pch_sch_store_stats(). Comparing bytes across the subchannels of
+ * a channel shows the share of the channel each has achieved.
+ */
+typedef struct pch_sch_stats {
+        uint32_t        bytes;  //!< data bytes sent or received
+        uint32_t        starts; //!< channel programs started
+        //! Starts whose count was rounded down by its bsize encoding
+        uint32_t        splits;
+} pch_sch_stats_t;
+
+/*! \brief A pre-decoded CCW of a prepared channel program
+ * \ingroup picochan_css
+ *
+ * There is one pch_ccwd_t for each CCW of the channel program from
+ * which it was prepared by pch_chanprog_prepare(). ccw is the CCW at
+ * that position and target is the position of the CCW that the CSS
+ * executes when it fetches the CCW there, which is that of the
+ * target of a TIC if that is what is there and otherwise its own.
+ * A TIC therefore holds no copy of its target, so each CCW the CSS
+ * executes has just the one pre-decoded form.
+ */
+typedef struct pch_ccwd {
+        pch_ccw_t       ccw;
+        uint16_t        target;
+        uint16_t        reserved;
+} pch_ccwd_t;
+
+/*! \brief A prepared channel program
+ * \ingroup picochan_css
+ *
+ * A channel program of len CCWs at ccws which has been validated
+ * and pre-decoded into ccwds by pch_chanprog_prepare() so that it
+ * can be started repeatedly with pch_sch_start_chanprog().
+ */
+typedef struct pch_chanprog {
+        pch_ccw_t       *ccws;
+        pch_ccwd_t      *ccwds;
+        uint16_t        len;
+} pch_chanprog_t;
+
 /*! \brief Get the addr field of a CCW as a pointer.
  * \ingroup picochan_css
  *
@@ -100,6 +211,29 @@ static inline void *pch_ccw_get_addr(pch_ccw_t ccw) {
  */
 void pch_css_init(void);
 
+/*! \brief Initialise CSS so that its API can be called from either core.
+ *  \ingroup picochan_css
+ *
+ * Like pch_css_init() but, instead of the API functions needing to
+ * be called on the same core as the CSS IRQ handlers run on (the
+ * core that calls pch_css_start() and configures the channels), they
+ * may be called from either core. For example, the CSS can run on
+ * core 1 while the application calls pch_sch_start() and waits for
+ * completions on core 0 without bursts of CSS interrupts ever
+ * preempting it.
+ *
+ * The CSS claims a hardware spinlock which it holds, as well as
+ * disabling interrupts, while updating subchannel state shared with
+ * the API. An API call from the other core signals the CSS core by
+ * pushing a doorbell word into the SIO inter-core FIFO, whose IRQ
+ * pch_css_start() configures with handler pch_css_doorbell_irq_handler
+ * on the CSS core, so the application must not otherwise use that
+ * FIFO (such as with multicore_lockout) in the direction of the CSS
+ * core. CSS configuration functions must still be called on the
+ * CSS core.
+ */
+void pch_css_init_cross_core(void);
+
 // Accessor functions for basic CSS settings
 int8_t pch_css_get_core_num(void);
 int8_t pch_css_get_irq_index(void);
@@ -189,11 +323,16 @@ io_callback_t pch_css_set_io_callback(io_callback_t io_callback);
  * If the function IRQ is not set, it is configured by claiming an
  * unused user IRQ, setting the handler to pch_css_func_irq_handler
  * and enabling the IRQ. If io_callback is non-NULL then it is set as
- * the CSS io_callback function after, if the I/O IRQ is not set,
- * configuring it by claiming an unused IRQ, settting the handler to
+ * the CSS io_callback function. If io_callback is non-NULL or a
+ * completion ring has been set (see
+ * \ref pch_css_set_completion_ring) and the I/O IRQ is not set, it is
+ * configured by claiming an unused IRQ, settting the handler to
  * pch_css_io_irq_handler and enabling the IRQ. Any IRQ handlers set
  * from this function are added using irq_add_shared_handler() with an
  * order_priority of PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY.
+ * If the CSS was initialised with pch_css_init_cross_core(), the
+ * SIO FIFO IRQ of the current core is configured with exclusive
+ * handler pch_css_doorbell_irq_handler.
  */
 void pch_css_start(io_callback_t io_callback, uint8_t isc_mask);
 
@@ -206,6 +345,14 @@ void pch_css_start(io_callback_t io_callback, uint8_t isc_mask);
  */
 bool pch_css_set_trace(bool trace);
 
+/*! \brief Returns the CSS trace bufferset
+ * \ingroup picochan_css
+ *
+ * For use with pch_trc_drain_start() to drain CSS trace records
+ * continuously to a sink.
+ */
+pch_trc_bufferset_t *pch_css_get_trace_bufferset(void);
+
 /*! \brief Sets what CSS trace events are enabled for channel chpid.
  * Flags may be a combination of PCH_CHP_TRACED_GENERAL,
  * PCH_CHP_TRACED_LINK, PCH_CHP_TRACED_IRQ.
@@ -232,6 +379,7 @@ bool pch_chp_set_trace(pch_chpid_t chpid, bool trace);
 
 void __isr pch_css_func_irq_handler(void);
 void __isr pch_css_io_irq_handler(void);
+void __isr pch_css_doorbell_irq_handler(void);
 
 /*! \brief Sets the IRQ number that the CSS raises when a subchannel becomes status pending
  * \ingroup picochan_css
@@ -346,6 +494,103 @@ void pch_chp_configure_piochan(pch_chpid_t chpid, pch_pio_config_t *cfg, pch_pio
  */
 void pch_chp_configure_memchan(pch_chpid_t chpid, pch_channel_t *chpeer);
 
+/*! \brief Configure a polled memchan channel
+ * \ingroup picochan_css
+ *
+ * Like pch_chp_configure_memchan() but the channel uses no DMA
+ * channels and raises no interrupts. Instead, the CSS core must call
+ * pch_css_poll() repeatedly (typically spinning on it, or on
+ * pch_sch_test() and pch_css_poll(), when it has a core to itself)
+ * and the peer CU must have been configured with
+ * pch_cus_memcu_configure_polled() and likewise be polled with
+ * pch_cus_poll().
+ */
+void pch_chp_configure_memchan_polled(pch_chpid_t chpid, pch_channel_t *chpeer);
+
+/*! \brief Polls each started polled channel for completions
+ * \ingroup picochan_css
+ *
+ * For each started channel configured with
+ * pch_chp_configure_memchan_polled(), checks for tx and rx
+ * completions and handles them exactly as the CSS DMA interrupt
+ * handler would do for a DMA-driven channel. Returns true if any
+ * channel had a completion to handle.
+ */
+bool pch_css_poll(void);
+
+/*! \brief Sets whether channel chpid batches packets sent to its CU
+ * \ingroup picochan_css
+ *
+ * Without batching, the CSS sends each command packet to the CU as
+ * a separate transfer and waits for its tx completion before sending
+ * the next. With batching, when several subchannels on the channel
+ * are waiting to send a packet (typically because many devices are
+ * busy), the CSS gathers up to PROTO_BATCH_MAX_PACKETS of them into
+ * a single Batch transfer which the CU unpacks from one rx
+ * completion. The CU must be running a version of picochan that
+ * understands Batch packets. Returns the previous setting.
+ */
+bool pch_chp_set_batching(pch_chpid_t chpid, bool batching);
+
+/*! \brief Sets the maximum data segment size for channel chpid
+ * \ingroup picochan_css
+ *
+ * A channel carries the data of only one Data (or write-immediate
+ * Start) at a time so, while a device is transferring a large
+ * segment, every other device on the same channel waits. If
+ * max_segment is non-zero, the CSS caps at max_segment bytes the
+ * data it sends in response to each RequestRead and the immediate
+ * data it sends with a Start. A device then receives the data of a
+ * large Write-type CCW segment in several smaller pieces, asking
+ * for the rest after each (as the hldev API does automatically)
+ * and, because the CSS answers devices in the order they asked,
+ * other devices' packets are interleaved between those pieces. This
+ * gives fairer latency to devices doing small I/Os that share a
+ * channel with a device doing bulk writes at the cost of a
+ * RequestRead round trip for each piece. The room advertised for a
+ * Read-type CCW is not capped because the device, not the CSS,
+ * chooses how much data it sends in one go. A device must not
+ * assume that the data it is sent covers all it asked for. Zero,
+ * the default, means no cap. Returns the previous setting.
+ */
+uint16_t pch_chp_set_max_segment(pch_chpid_t chpid, uint16_t max_segment);
+
+/*! \brief Sets whether channel chpid prefetches chained CCWs
+ * \ingroup picochan_css
+ *
+ * Without prefetch, the CSS fetches (and validates) the next CCW of
+ * a command or data chain only once the current CCW segment is
+ * complete, in between handling that completion and starting the
+ * next segment. With prefetch, as soon as the CSS has started a
+ * segment of a CCW with Chain Command or Chain Data set, it fetches
+ * the CCW that follows, following any TIC, so that chaining to it
+ * later is just a copy. A channel program must not then modify a
+ * CCW, for example after a PCI interruption, once the CCW before
+ * it has started. CCWs modified while a channel program is
+ * suspended are seen on Resume. Not needed for prepared channel
+ * programs, which are pre-decoded anyway. Off by default. Returns
+ * the previous setting.
+ */
+bool pch_chp_set_prefetch(pch_chpid_t chpid, bool prefetch);
+
+/*! \brief Sets whether channel chpid sends exact counts with Starts
+ * \ingroup picochan_css
+ *
+ * A Start packet carries its count (the immediate data for a
+ * Write-type CCW or the room advertised for a Read-type CCW) as an
+ * 8-bit bsize encoding which rounds down counts above 63 that it
+ * cannot represent exactly. Without exact counts, the segment is
+ * then split: the remainder needs a further RequestRead or Room
+ * round trip. With exact counts, the CSS sends such a Start in a
+ * Batch immediately preceded by a Count packet carrying the exact
+ * 16-bit count, which the CU uses in place of the rounded one. The
+ * CU must be running a version of picochan that understands Count
+ * packets. The splits counted in pch_sch_stats_t show how many
+ * segments are being split by rounding. Off by default. Returns
+ * the previous setting.
+ */
+bool pch_chp_set_exact_counts(pch_chpid_t chpid, bool exact);
+
 // Channel initialisation low-level helpers
 
 /*! \brief Get the underlying channel from a channel path from CSS to CU
@@ -373,6 +618,42 @@ pch_channel_t *pch_chp_get_channel(pch_chpid_t chpid);
  */
 int pch_sch_start(pch_sid_t sid, pch_ccw_t *ccw_addr);
 
+/*! \brief Prepare a channel program to be started repeatedly
+ * \ingroup picochan_css
+ *
+ * Validates the channel program of len CCWs at ccws and pre-decodes
+ * it into the len entries of ccwds, filling in cp to refer to both.
+ * The program must be self-contained: every TIC must point to a CCW
+ * within it (and not to another TIC) and no CCW that chains may be
+ * the last. A CCW following a CCW with Chain Data set may not have
+ * the Suspend flag set. Neither ccws nor ccwds may be changed while
+ * cp is in use except that, while the channel program is suspended,
+ * the CCW at which it is suspended may be changed (typically to clear
+ * its Suspend flag) just as for pch_sch_start(). The CSS fetches a
+ * CCW that had the Suspend flag set when prepared afresh from ccws
+ * each time it executes it, however it is reached, and never writes
+ * to ccwds, so cp may be used by several subchannels at once.
+ *
+ * Returns -1 if the program is valid or else the index within ccws
+ * of the first invalid CCW found, in which case cp must not be used.
+ */
+int pch_chanprog_prepare(pch_chanprog_t *cp, pch_ccw_t *ccws, uint16_t len, pch_ccwd_t *ccwds);
+
+/*! \brief Start a prepared channel program for a subchannel
+ * \ingroup picochan_css
+ *
+ * Like pch_sch_start() with ccw_addr cp->ccws but, for as long as the
+ * channel program runs, the CSS fetches each CCW from its
+ * pre-decoded form in cp->ccwds with no TICs to follow and no
+ * validity checks to repeat. The exception is a CCW prepared with
+ * the Suspend flag set, which is fetched from cp->ccws so that a
+ * cleared Suspend flag is seen. The SCSW CCW Address
+ * still points into cp->ccws exactly as it would for pch_sch_start().
+ * A StatusModifier skip past the end of the program causes a
+ * program check.
+ */
+int pch_sch_start_chanprog(pch_sid_t sid, pch_chanprog_t *cp);
+
 /*! \brief Resume a channel program for a subchannel
  * \ingroup picochan_css
  *
@@ -408,7 +689,18 @@ int pch_sch_test(pch_sid_t sid, pch_scsw_t *scsw);
  * * flags bits in mask PCH_PMCW_SCH_MODIFY_MASK
  *
  * The bits in PCH_PMCW_SCH_MODIFY_MASK are PCH_PMCW_ENABLED,
- * PCH_PMCW_TRACED and the ISC bits, PCH_PMCW_ISC_BITS.
+ * PCH_PMCW_TRACED, PCH_PMCW_PRIORITY and the ISC bits,
+ * PCH_PMCW_ISC_BITS.
+ *
+ * When PCH_PMCW_PRIORITY is set, the CSS starts channel programs
+ * for the subchannel, and sends the responses that its device is
+ * waiting for, ahead of those of any non-priority subchannel on
+ * the same channel.
+ *
+ * \returns 0 on success, 1 if the subchannel is status pending, 2 if
+ * a function is in progress or pending (such as after pch_sch_start
+ * but before the CSS has started the channel program) or 3 if sid is
+ * not a valid subchannel
  */
 int pch_sch_modify(pch_sid_t sid, pch_pmcw_t *pmcw);
 
@@ -494,6 +786,43 @@ int pch_sch_store_pmcw(pch_sid_t sid, pch_pmcw_t *out_pmcw);
  */
 int pch_sch_store_scsw(pch_sid_t sid, pch_scsw_t *out_scsw);
 
+/*! \brief Sets the byte-budget share of subchannel sid
+ * \ingroup picochan_css
+ *
+ * The CSS starts channel programs for the non-priority subchannels
+ * of a channel in a deficit round robin: each subchannel with a
+ * non-zero share is charged for the data bytes it sends or
+ * receives and, once it has used up its budget, is passed over in
+ * favour of the others until its turn comes round again, when it
+ * is given another share bytes of budget. A subchannel keeps any
+ * debt into its next channel program but not budget it has left
+ * unused. Over time, subchannels that keep Starts waiting for their
+ * channel therefore get bandwidth in proportion to their shares.
+ * Since a subchannel has only one channel program at a time, that
+ * needs the channel, not the CU, to be the bottleneck.
+ * A share of zero, the default, means
+ * that the subchannel is never passed over. Setting the share also
+ * resets the budget of the subchannel.
+ * \returns 0 or 3 if sid is not a valid subchannel
+ */
+int pch_sch_modify_share(pch_sid_t sid, uint16_t share);
+
+/*! \brief Stores the scheduling statistics of subchannel sid to out_stats
+ * \ingroup picochan_css
+ *
+ * If PCH_CONFIG_ENABLE_SCH_STATS is 0, the statistics are not kept
+ * and zeroes are stored.
+ * \returns 0 or 3 if sid is not a valid subchannel
+ */
+int pch_sch_store_stats(pch_sid_t sid, pch_sch_stats_t *out_stats);
+
+/*! \brief Resets the scheduling statistics of subchannel sid to zero
+ * \ingroup picochan_css
+ *
+ * \returns 0 or 3 if sid is not a valid subchannel
+ */
+int pch_sch_clear_stats(pch_sid_t sid);
+
 // Convenience API functions that wrap the architectural API
 
 /*! \brief Modifies the intparm field of the PMCW part of the schib for subchannel sid
@@ -536,6 +865,14 @@ int pch_sch_modify_enabled(pch_sid_t sid, bool enabled);
  */
 int pch_sch_modify_traced(pch_sid_t sid, bool traced);
 
+/*! \brief Modifies priority flag of the schib for subchannel sid
+ * \ingroup picochan_css
+ *
+ * This is a convenience/optimised subset of pch_sch_modify that
+ * only modifies the priority flag of the subchannel.
+ */
+int pch_sch_modify_priority(pch_sid_t sid, bool priority);
+
 /*! \brief Calls pch_sch_modify_isc() on count subchannels starting
  * from sid, panicking if any call fails
  * \ingroup picochan_css
@@ -603,6 +940,156 @@ int pch_sch_run_wait(pch_sid_t sid, pch_ccw_t *ccw_addr, pch_scsw_t *scsw);
  */
 int pch_sch_run_wait_timeout(pch_sid_t sid, pch_ccw_t *ccw_addr, pch_scsw_t *scsw, absolute_time_t timeout_timestamp);
 
+/*! \brief A completion taken from a subchannel by the CSS I/O
+ * interrupt handler: its interruption code and SCSW
+ * \ingroup picochan_css
+ */
+typedef struct pch_css_completion {
+        pch_intcode_t   ic;
+        pch_scsw_t      scsw;
+} pch_css_completion_t;
+
+/*! \brief A fixed-capacity ring of completions
+ * \ingroup picochan_css
+ *
+ * Set up with \ref pch_css_set_completion_ring. head is only
+ * advanced by pch_css_io_irq_handler and tail only by the reaping
+ * functions. overflows counts the times the handler found the ring
+ * full while subchannels were still status pending. Those
+ * subchannels are not lost: they stay status pending until the ring
+ * is next reaped.
+ */
+typedef struct pch_css_completion_ring {
+        pch_css_completion_t    *entries;
+        uint32_t                capacity; //!< power of 2
+        uint32_t                head;
+        uint32_t                tail;
+        uint32_t                overflows;
+        bool                    stalled; //!< handler left status pending
+} pch_css_completion_ring_t;
+
+/*! \brief Sets a ring of completions which pch_css_io_irq_handler
+ * fills instead of calling the io_callback
+ * \ingroup picochan_css
+ *
+ * ring is initialised to use the capacity entries at entries, where
+ * capacity must be a power of 2. Each subchannel with unmasked ISC
+ * that becomes status pending has its SCSW taken and cleared, as
+ * with pch_sch_test, and is added to the ring for the application
+ * to reap with pch_css_reap_completions or
+ * pch_css_wait_completions. A NULL ring goes back to calling the
+ * io_callback (if any).
+ *
+ * This must be called before pch_css_start, which then configures
+ * the I/O IRQ even if its io_callback is NULL. The ring must only be
+ * reaped from one core at a time and, unless the CSS was initialised
+ * with pch_css_init_cross_core(), only from the core that the CSS
+ * runs on.
+ */
+void pch_css_set_completion_ring(pch_css_completion_ring_t *ring, pch_css_completion_t *entries, uint32_t capacity);
+
+/*! \brief Moves up to max completions from the completion ring to
+ * out without waiting
+ * \ingroup picochan_css
+ *
+ * If the I/O interrupt handler had found the ring full, it is
+ * raised again after space has been made so that subchannels still
+ * status pending are added to the ring.
+ * \returns The number of completions moved, which may be 0
+ */
+uint pch_css_reap_completions(pch_css_completion_t *out, uint max);
+
+/*! \brief Moves between 1 and max completions from the completion
+ * ring to out, waiting with __wfe() while the ring is empty
+ * \ingroup picochan_css
+ *
+ * \returns The number of completions moved
+ */
+uint pch_css_wait_completions(pch_css_completion_t *out, uint max);
+
+/*! \brief Moves up to max completions from the completion ring to
+ * out, waiting while the ring is empty until the timeout expires
+ * (i.e. absolute time timeout_timestamp is reached)
+ * \ingroup picochan_css
+ *
+ * \returns The number of completions moved, 0 only on timeout
+ */
+uint pch_css_wait_completions_timeout(pch_css_completion_t *out, uint max, absolute_time_t timeout_timestamp);
+
+/*! \brief A set of subchannels, one bit per SID, for
+ * pch_sch_test_any and pch_sch_wait_any
+ * \ingroup picochan_css
+ */
+typedef struct pch_sid_set {
+        uint32_t        bits[(PCH_NUM_SCHIBS + 31) / 32];
+} pch_sid_set_t;
+
+static inline void pch_sid_set_clear(pch_sid_set_t *set) {
+        for (uint i = 0; i < count_of(set->bits); i++)
+                set->bits[i] = 0;
+}
+
+static inline void pch_sid_set_add(pch_sid_set_t *set, pch_sid_t sid) {
+        set->bits[sid / 32] |= 1u << (sid % 32);
+}
+
+static inline void pch_sid_set_remove(pch_sid_set_t *set, pch_sid_t sid) {
+        set->bits[sid / 32] &= ~(1u << (sid % 32));
+}
+
+static inline bool pch_sid_set_contains(const pch_sid_set_t *set, pch_sid_t sid) {
+        return set->bits[sid / 32] & (1u << (sid % 32));
+}
+
+/*! \brief Adds count subchannels starting from sid to set
+ * \ingroup picochan_css
+ */
+static inline void pch_sid_set_add_range(pch_sid_set_t *set, pch_sid_t sid, uint count) {
+        while (count--)
+                pch_sid_set_add(set, sid++);
+}
+
+/*! \brief Tests any of the subchannels in sids for I/O interruption
+ * conditions, taking the status of up to max of them
+ * \ingroup picochan_css
+ *
+ * This behaves like calling pch_sch_test on each subchannel in sids
+ * that is status pending but only looks at subchannels on the lists
+ * of status pending subchannels of each ISC with a pending
+ * interruption rather than at every subchannel in sids. For each
+ * subchannel whose status is taken, its interruption code and SCSW
+ * are stored in the next entry of out.
+ * As with pch_sch_wait, this function must only be called while
+ * the ISCs of the subchannels are masked.
+ * \returns The number of entries stored in out, which may be 0
+ */
+uint pch_sch_test_any(const pch_sid_set_t *sids, pch_css_completion_t *out, uint max);
+
+/*! \brief Wait for an I/O interruption condition for any of the
+ * subchannels in sids
+ * \ingroup picochan_css
+ *
+ * This is a convenience function which loops calling
+ * pch_sch_test_any, calling __wfe() in between, until the status of
+ * at least one subchannel has been taken. max must be at least 1
+ * since otherwise no status could ever be taken.
+ * \returns The number of entries stored in out, between 1 and max
+ */
+uint pch_sch_wait_any(const pch_sid_set_t *sids, pch_css_completion_t *out, uint max);
+
+/*! \brief Wait for an I/O interruption condition for any of the
+ * subchannels in sids with a timeout
+ * \ingroup picochan_css
+ *
+ * This is a convenience function which behaves the same as
+ * pch_sch_wait_any except that it also returns if the timeout
+ * expires (i.e. absolute time timeout_timestamp is reached) without
+ * any of the subchannels having become status pending. As with
+ * pch_sch_wait_any, max must be at least 1.
+ * \returns The number of entries stored in out, 0 only on timeout
+ */
+uint pch_sch_wait_any_timeout(const pch_sid_set_t *sids, pch_css_completion_t *out, uint max, absolute_time_t timeout_timestamp);
+
 void pch_css_trace_write_user(pch_trc_record_type_t rt, void *data, uint8_t data_size);
 
 #endif
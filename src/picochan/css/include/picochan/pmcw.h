@@ -29,6 +29,9 @@
  * thus run channel programs
  * * A "trace" flag to indicate whether events for this subchannel
  * can cause trace records to be written
+ * * A "priority" flag to have the CSS start work for this subchannel
+ * (and send its responses) ahead of that for non-priority
+ * subchannels on the same channel
  *
  * Although for a mainframe channel subsystem, the addressing
  * information in the PMCW contains 8 x 8-bit channel path id numbers
@@ -43,7 +46,7 @@
 PMCW    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
         |               Interruption Parameter (Intparm)                |
         +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-        |                     |T|E| ISC |      CHPID    | UnitAddr      |
+        |                   |P|T|E| ISC |      CHPID    | UnitAddr      |
         +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
 \endverbatim
  */
@@ -56,7 +59,7 @@ typedef struct pch_pmcw {
 
 // PCH_PMCW_SCH_MODIFY_MASK are the bits of the PMCW flags
 // which can be set with the Modify Subchannel function
-#define PCH_PMCW_SCH_MODIFY_MASK 0x001f
+#define PCH_PMCW_SCH_MODIFY_MASK 0x003f
 
 // ISC: Interrupt Service Class - the low 3 bits of the PMCW.
 // We define PCH_PMCW_ISC_LSB as the shift count to get the ISC bits
@@ -65,6 +68,7 @@ typedef struct pch_pmcw {
 #define PCH_PMCW_ISC_LSB        0
 #define PCH_PMCW_ENABLED        0x08
 #define PCH_PMCW_TRACED         0x10
+#define PCH_PMCW_PRIORITY       0x20
 
 static inline uint8_t pch_pmcw_isc(pch_pmcw_t *pmcw) {
         return (pmcw->flags & PCH_PMCW_ISC_BITS) >> PCH_PMCW_ISC_LSB;
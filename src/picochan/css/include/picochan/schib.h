@@ -44,7 +44,7 @@ static_assert(sizeof(pch_schib_mda_t) == 12,
 PMCW    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
         |                            Intparm                            |
         +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-        |                     |T|E| ISC |      CUAddr   | UnitAddr      |
+        |                   |P|T|E| ISC |      CUAddr   | UnitAddr      |
 SCSW    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
         |               | CC|P|I|U|Z| |N|W|  FC |     AC      |   SC    |
         +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
@@ -78,6 +78,10 @@ static inline bool schib_is_traced(pch_schib_t *schib) {
         return schib->pmcw.flags & PCH_PMCW_TRACED;
 }
 
+static inline bool schib_is_priority(pch_schib_t *schib) {
+        return schib->pmcw.flags & PCH_PMCW_PRIORITY;
+}
+
 static inline bool schib_has_function_in_progress(pch_schib_t *schib) {
         const uint16_t mask = PCH_FC_START|PCH_FC_HALT|PCH_FC_CLEAR;
         return schib->scsw.ctrl_flags & mask;
@@ -9,8 +9,20 @@
 void process_schib_func(pch_schib_t *schib);
 void process_schib_response(pch_chp_t *chp, pch_schib_t *schib);
 
-static inline pch_schib_t *pop_ua_func_dlist(pch_chp_t *chp) {
-        return pop_ua_dlist(&chp->ua_func_dlist, chp);
+// handle_schib_func and handle_schib_response process one schib
+// under css_handler_lock() so that, with a cross-core CSS, an API
+// function on the other core waits for no more than the processing
+// of that one schib.
+static void handle_schib_func(pch_schib_t *schib) {
+        uint32_t status = css_handler_lock();
+        process_schib_func(schib);
+        css_handler_unlock(status);
+}
+
+static void handle_schib_response(pch_chp_t *chp, pch_schib_t *schib) {
+        uint32_t status = css_handler_lock();
+        process_schib_response(chp, schib);
+        css_handler_unlock(status);
 }
 
 // process_a_schib_waiting_for_tx return value is progress,
@@ -22,19 +34,95 @@ static bool process_a_schib_waiting_for_tx(pch_chp_t *chp) {
 
         pch_schib_t *schib = pop_ua_response_slist(chp);
         if (schib) {
-                process_schib_response(chp, schib);
+                handle_schib_response(chp, schib);
                 return true;
         }
 
         schib = pop_ua_func_dlist(chp);
         if (schib) {
-                process_schib_func(schib);
+                handle_schib_func(schib);
                 return true;
         }
 
         return false;
 }
 
+// process_a_schib_for_tx_batch is like process_a_schib_waiting_for_tx
+// (but only considering the function list unless responses is true)
+// while the tx batch is open. It leaves a schib waiting if the batch
+// already has a packet for the same unit address so that the CU never
+// sees two packets for one device in the same batch (other than a
+// Count and the Start it precedes). With exact counts, it stops
+// gathering while fewer than two packets would fit in the batch.
+static bool process_a_schib_for_tx_batch(pch_chp_t *chp, bool responses) {
+        if (!pch_chp_is_tx_batch_open(chp))
+                return false; // batch flushed because full or final
+
+        if (pch_chp_is_exact_counting(chp)
+                && chp->tx_batch.count > PROTO_BATCH_MAX_PACKETS - 2)
+                return false; // no room for a Count and its Start
+
+        pch_schib_t *schib = NULL;
+        ua_slist_t *rl = NULL;
+        ua_dlist_t *fl = NULL;
+        uint32_t status = schibs_lock();
+        int16_t ua = -1;
+        if (responses)
+                rl = select_ua_response_slist(chp);
+
+        if (rl)
+                ua = rl->head;
+        else if ((fl = select_ua_func_dlist_unsafe(chp)) != NULL)
+                ua = peek_ua_dlist(fl);
+
+        if (ua != -1 && !css_tx_batch_has_ua(chp, (pch_unit_addr_t)ua)) {
+                if (rl)
+                        schib = pop_ua_slist_unsafe(rl, chp);
+                else
+                        schib = pop_ua_dlist_unsafe(fl, chp);
+        }
+        schibs_unlock(status);
+
+        if (!schib)
+                return false;
+
+        if (rl)
+                handle_schib_response(chp, schib);
+        else
+                handle_schib_func(schib);
+
+        return true;
+}
+
+// process_schibs_waiting_for_tx processes schibs waiting for tx.
+// Without tx batching enabled for chp, that is just the first one.
+// With tx batching, it gathers the packets that processing sends
+// into a batch and flushes it as a single tx.
+static bool process_schibs_waiting_for_tx(pch_chp_t *chp, bool responses) {
+        if (pch_chp_is_tx_active(chp))
+                return false; // tx busy
+
+        if (!pch_chp_is_tx_batching(chp)) {
+                if (responses)
+                        return process_a_schib_waiting_for_tx(chp);
+
+                pch_schib_t *schib = pop_ua_func_dlist(chp);
+                if (!schib)
+                        return false;
+
+                handle_schib_func(schib);
+                return true;
+        }
+
+        bool progress = false;
+        pch_chp_set_tx_batch_open(chp, true);
+        while (process_a_schib_for_tx_batch(chp, responses))
+                progress = true;
+
+        css_tx_batch_flush(chp);
+        return progress;
+}
+
 static void handle_irq_completions(pch_chp_t *chp) {
         pch_channel_t *ch = &chp->channel;
 
@@ -45,21 +133,31 @@ static void handle_irq_completions(pch_chp_t *chp) {
         trace_chp_irq_progress(PCH_TRC_RT_CSS_CHP_IRQ_PROGRESS,
                 chp, rxl->complete, txl->complete, progress);
         while (rxl->complete || txl->complete || progress) {
-                if (rxl->complete) {
-                        rxl->complete = false;
-                        css_handle_rx_complete(chp);
+                // Handle tx completion first: when both are complete,
+                // the rx may be the CU's response to what we sent
+                // (a memchan only completes a tx of data once the CU
+                // has taken it) and handling the response before the
+                // completion of, say, the Start that caused it would
+                // leave the subchannel marked active again.
+                if (txl->complete) {
+                        txl->complete = false;
+                        uint32_t status = css_handler_lock();
+                        css_handle_tx_complete(chp);
+                        css_handler_unlock(status);
                 }
 
                 trace_chp_irq_progress(PCH_TRC_RT_CSS_CHP_IRQ_PROGRESS,
                         chp, rxl->complete, txl->complete, progress);
-                if (txl->complete) {
-                        txl->complete = false;
-                        css_handle_tx_complete(chp);
+                if (rxl->complete) {
+                        rxl->complete = false;
+                        uint32_t status = css_handler_lock();
+                        css_handle_rx_complete(chp);
+                        css_handler_unlock(status);
                 }
 
                 trace_chp_irq_progress(PCH_TRC_RT_CSS_CHP_IRQ_PROGRESS,
                         chp, rxl->complete, txl->complete, progress);
-                progress = process_a_schib_waiting_for_tx(chp);
+                progress = process_schibs_waiting_for_tx(chp, true);
                 trace_chp_irq_progress(PCH_TRC_RT_CSS_CHP_IRQ_PROGRESS,
                         chp, rxl->complete, txl->complete, progress);
         }
@@ -68,18 +166,15 @@ static void handle_irq_completions(pch_chp_t *chp) {
 void __time_critical_func(handle_func_irq_chp)(pch_chp_t *chp) {
         PCH_CSS_TRACE_COND(PCH_TRC_RT_CSS_FUNC_IRQ,
                 pch_chp_is_traced_irq(chp), ((struct pch_trdata_func_irq){
-                .ua_opt = peek_ua_dlist(&chp->ua_func_dlist),
+                .ua_opt = chp->ua_prio_func_dlist != -1
+                        ? peek_ua_dlist(&chp->ua_prio_func_dlist)
+                        : peek_ua_dlist(&chp->ua_func_dlist),
                 .chpid = pch_get_chpid(chp),
                 .tx_active = (int8_t)pch_chp_is_tx_active(chp)
                 }));
 
-	while (!pch_chp_is_tx_active(chp)) {
-                pch_schib_t *schib = pop_ua_func_dlist(chp);
-		if (!schib)
-			break;
-
-		process_schib_func(schib);
-	}
+        while (process_schibs_waiting_for_tx(chp, false))
+                ;
 }
 
 void __isr __time_critical_func(pch_css_func_irq_handler)(void) {
@@ -101,6 +196,28 @@ void __isr __time_critical_func(pch_css_func_irq_handler)(void) {
 	}
 }
 
+// css_ring_doorbell signals the CSS core from the other core of a
+// cross-core CSS. A full FIFO already holds a doorbell that the CSS
+// core has yet to take so there is no need to wait for room.
+void __time_critical_func(css_ring_doorbell)(void) {
+        if (multicore_fifo_wready())
+                multicore_fifo_push_blocking(0);
+}
+
+// pch_css_doorbell_irq_handler takes the doorbells rung by
+// css_ring_doorbell and, since they do not say why, raises both the
+// function IRQ and any I/O IRQ which each find whatever work there
+// is to do.
+void __isr __time_critical_func(pch_css_doorbell_irq_handler)(void) {
+        while (multicore_fifo_rvalid())
+                (void)multicore_fifo_pop_blocking();
+
+        multicore_fifo_clear_irq();
+        irq_set_pending((irq_num_t)CSS.func_irqnum);
+        if (CSS.io_irqnum > 0)
+                irq_set_pending((irq_num_t)CSS.io_irqnum);
+}
+
 void __isr __time_critical_func(pch_css_dma_irq_handler)() {
         uint irqnum = __get_current_exception() - VTABLE_FIRST_IRQ;
 	// TODO deal with getting the Irq information and acking
@@ -114,11 +231,37 @@ void __isr __time_critical_func(pch_css_dma_irq_handler)() {
                 if (!pch_channel_is_started(&chp->channel))
 			continue;
 
+                if (pch_channel_is_polled(&chp->channel))
+                        continue;
+
                 pch_channel_handle_dma_irq(&chp->channel);
                 handle_irq_completions(chp);
 	}
 }
 
+bool __time_critical_func(pch_css_poll)(void) {
+        bool progress = false;
+
+        for (int i = 0; i < PCH_NUM_CHANNELS; i++) {
+		pch_chp_t *chp = &CSS.chps[i];
+                pch_channel_t *ch = &chp->channel;
+                if (!pch_channel_is_started(ch) || !pch_channel_is_polled(ch))
+			continue;
+
+                // Completions are otherwise handled from the DMA irq
+                // handler so keep the function irq handler out while
+                // we handle them
+                uint32_t status = save_and_disable_interrupts();
+                if (pch_channel_poll(ch)) {
+                        handle_irq_completions(chp);
+                        progress = true;
+                }
+                restore_interrupts(status);
+	}
+
+        return progress;
+}
+
 void __isr __time_critical_func(pch_css_pio_irq_handler)() {
         uint irqnum = __get_current_exception() - VTABLE_FIRST_IRQ;
         for (int i = 0; i < PCH_NUM_CHANNELS; i++) {
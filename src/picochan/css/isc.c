@@ -5,12 +5,6 @@
 
 #include "css_internal.h"
 
-static inline void raise_io_irq(void) {
-        int16_t io_irqnum_opt = CSS.io_irqnum;
-        if (io_irqnum_opt > 0)
-                irq_set_pending((irq_num_t)io_irqnum_opt);
-}
-
 static inline void set_isc_status_bit(uint8_t iscnum) {
 	CSS.isc_status_mask |= (uint8_t)(1 << iscnum);
 }
@@ -7,13 +7,22 @@
 #include "css_trace.h"
 
 void __time_critical_func(css_notify)(pch_schib_t *schib, uint8_t devs) {
-        if (schib_is_status_pending(schib))
+        uint32_t status = schibs_lock();
+        if (schib_is_status_pending(schib)) {
+                schibs_unlock(status);
                 return; // already pending; nothing to do
+        }
 
         schib->scsw.devs = devs;
         schib->scsw.ctrl_flags |= PCH_SC_PENDING;
         trace_schib_byte(PCH_TRC_RT_CSS_NOTIFY, schib, devs);
         push_to_isc_dlist(schib);
+        schibs_unlock(status);
+
+        // With a cross-core CSS, pch_sch_wait may be waiting on the
+        // other core, which an IRQ here does not wake
+        if (css_schibs_lock.spin_lock)
+                __sev();
 }
 
 pch_schib_t __time_critical_func(*pop_pending_schib)() {
@@ -31,12 +40,26 @@ pch_schib_t __time_critical_func(*pop_pending_schib)() {
         return schib;
 }
 
-static void callback_one_pending_schib(pch_schib_t *schib) {
-        pch_scsw_t scsw = schib->scsw;
-        pch_intcode_t ic = css_make_intcode(schib);
-        css_clear_pending_subchannel(schib);
+static inline bool completion_ring_full(pch_css_completion_ring_t *ring) {
+        return ring->head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE)
+                == ring->capacity;
+}
+
+static void queue_completion(pch_css_completion_ring_t *ring, pch_intcode_t ic, pch_scsw_t scsw) {
+        uint32_t head = ring->head;
+        pch_css_completion_t *c = &ring->entries[head & (ring->capacity - 1)];
+        c->ic = ic;
+        c->scsw = scsw;
+        __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
 
-        if (CSS.io_callback) {
+static void callback_one_pending_schib(pch_schib_t *schib, pch_intcode_t ic, pch_scsw_t scsw) {
+        pch_css_completion_ring_t *ring = CSS.completion_ring;
+        if (ring) {
+                trace_schib_callback(PCH_TRC_RT_CSS_IO_CALLBACK,
+                        schib, &ic);
+                queue_completion(ring, ic, scsw);
+        } else if (CSS.io_callback) {
                 trace_schib_callback(PCH_TRC_RT_CSS_IO_CALLBACK,
                         schib, &ic);
                 CSS.io_callback(ic, scsw);
@@ -44,13 +67,49 @@ static void callback_one_pending_schib(pch_schib_t *schib) {
 }
 
 static void callback_pending_schibs(void) {
+        pch_css_completion_ring_t *ring = CSS.completion_ring;
         while (1) {
+                if (ring && completion_ring_full(ring)) {
+                        // Leave the rest status pending until
+                        // pch_css_reap_completions makes space
+                        if (CSS.isc_enable_mask & CSS.isc_status_mask) {
+                                ring->stalled = true;
+                                // A reaper on the other core may have
+                                // made space after we looked but
+                                // before it saw stalled
+                                __dmb();
+                                if (!completion_ring_full(ring)) {
+                                        ring->stalled = false;
+                                        continue;
+                                }
+
+                                ring->overflows++;
+                        }
+                        break;
+                }
+
+                // Take the status under schibs_lock so that a
+                // pch_sch_test on the other core of a cross-core CSS
+                // cannot take it too
+                uint32_t status = schibs_lock();
                 pch_schib_t *schib = pop_pending_schib();
+                pch_intcode_t ic;
+                pch_scsw_t scsw;
+                if (schib) {
+                        scsw = schib->scsw;
+                        ic = css_make_intcode(schib);
+                        css_clear_pending_subchannel(schib);
+                }
+                schibs_unlock(status);
+
                 if (!schib)
                         break;
 
-                callback_one_pending_schib(schib);
+                callback_one_pending_schib(schib, ic, scsw);
         }
+
+        if (ring)
+                __sev(); // for a reaper waiting on another core
 }
 
 void __isr __time_critical_func(pch_css_io_irq_handler)(void) {
@@ -3,6 +3,7 @@
  * SPDX-License-Identifier: MIT
  */
 
+#include <string.h>
 #include "css_internal.h"
 #include "ccw_fetch.h"
 #include "css_trace.h"
@@ -114,17 +115,26 @@ typedef struct addr_count {
         bool            discard;
 } addr_count_t;
 
-// begin_data_write is called from css_handle_rx_data_command to
+// data_end_ds returns the device status implied by the End flag of
+// a Data or DataInline packet p or zero if it has none
+static inline uint8_t data_end_ds(proto_packet_t p) {
+        if (!proto_chop_has_end(p.chop))
+                return 0;
+
+        return PCH_DEVS_CHANNEL_END | PCH_DEVS_DEVICE_END;
+}
+
+// begin_data_write is called from do_handle_rx_data_command to
 // prepare the schib for the incoming data that's about to arrive as
 // the peer device sends us data for us to receive into the current
 // CCW segment of an active CCW Read-type command. As soon as we
-// return with (addr, count), css_handle_rx_data_command is going to
+// return with (addr, count), do_handle_rx_data_command is going to
 // point the channel's rx dma engine at that destination and start it.
 // TODO If count > rescount for an incoming Data command, we could
 // redirect all the about-to-be-received data to discard it, set
 // ChainingCheck in Schs and then tell the device about its error
 // with a Stop command. For now, we just assert.
-static addr_count_t __time_critical_func(begin_data_write)(pch_chp_t *chp, pch_schib_t *schib, proto_packet_t p) {
+static addr_count_t __time_critical_func(begin_data_write)(pch_chp_t *chp, pch_schib_t *schib, proto_packet_t p, uint8_t end_ds) {
 	assert(chp->rx_data_for_ua == -1);
 	chp->rx_data_for_ua = (int16_t)(schib->pmcw.unit_addr);
 
@@ -158,17 +168,13 @@ static addr_count_t __time_critical_func(begin_data_write)(pch_chp_t *chp, pch_s
         if ((proto_chop_has_response_required(p.chop)) && !halting)
                 pch_chp_set_rx_response_required(chp, true);
 
-        // Propagate PROTO_CHOP_FLAG_END to the chp rx_data_end_ds
-        // as ChannelEnd|DeviceEnd so that, once we get the rx
-        // completion of the data itself, we can see that we need to
-        // do an immediate update_status.
-        // TODO: consider having a variant of the chop DATA command
-        // that sends an esize-counted length of data and a full
-        // device status in the other byte of the payload
-        if (proto_chop_has_end(p.chop)) {
-                uint8_t devs = PCH_DEVS_CHANNEL_END | PCH_DEVS_DEVICE_END;
-                chp->rx_data_end_ds = devs;
-        }
+        // Propagate any device status end_ds (ChannelEnd|DeviceEnd
+        // for PROTO_CHOP_FLAG_END or the device status carried by a
+        // DataStatus) to the chp rx_data_end_ds so that, once we get
+        // the rx completion of the data itself, we can see that we
+        // need to do an immediate update_status.
+        if (end_ds)
+                chp->rx_data_end_ds = end_ds;
 
         addr_count_t ac = {
                 .count = count,
@@ -176,6 +182,7 @@ static addr_count_t __time_critical_func(begin_data_write)(pch_chp_t *chp, pch_s
         };
 
         if (!halting) {
+                css_charge_schib(schib, count);
                 ac.addr = schib->mda.data_addr;
                 rescount -= (int)count;
                 if (rescount == 0) {
@@ -228,7 +235,7 @@ static void __time_critical_func(css_handle_rx_data_complete)(pch_chp_t *chp, pc
 	}
 }
 
-// css_handle_rx_data_command handles a received _data command.
+// do_handle_rx_data_command handles a received _data command.
 // If PROTO_CHOP_FLAG_SKIP is set then the device wants us to write
 // zero bytes and will not be sending any real data itself.
 // If PROTO_CHOP_FLAG_SKIP is not set then the device is going to send
@@ -239,13 +246,14 @@ static void __time_critical_func(css_handle_rx_data_complete)(pch_chp_t *chp, pc
 // seen the Discard flag in our room announcement and used the
 // PROTO_CHOP_FLAG_SKIP flag in its command instead which would have
 // avoided it needing to send us all this data just for us to discard.
-static void __time_critical_func(css_handle_rx_data_command)(pch_chp_t *chp, pch_schib_t *schib, proto_packet_t p) {
+// end_ds is any device status to handle once the data is complete.
+static void __time_critical_func(do_handle_rx_data_command)(pch_chp_t *chp, pch_schib_t *schib, proto_packet_t p, uint8_t end_ds) {
 	// if PROTO_CHOP_FLAG_SKIP is set in the incoming op, we write
 	// (or ignore/discard) zeroes and no data is about to be sent
 	// to us
 	bool zeroes = proto_chop_has_skip(p.chop);
 
-	addr_count_t ac = begin_data_write(chp, schib, p); // may have chained
+	addr_count_t ac = begin_data_write(chp, schib, p, end_ds); // may have chained
 	if (ac.discard) {
 		// Skp flag set in CCW or schs error or halting:
 		// discard data instead of writing it
@@ -271,6 +279,39 @@ static void __time_critical_func(css_handle_rx_data_command)(pch_chp_t *chp, pch
                                 ac.addr, (uint32_t)ac.count);
 		}
 	}
+
+        prefetch_chain_ccw(chp, schib);
+}
+
+static void __time_critical_func(css_handle_rx_data_command)(pch_chp_t *chp, pch_schib_t *schib, proto_packet_t p) {
+        do_handle_rx_data_command(chp, schib, p, data_end_ds(p));
+}
+
+// css_handle_rx_data_status_command handles a received DataStatus
+// command. It is handled just like a Data command for the
+// (bsize-encoded) count that it carries except that, instead of the
+// plain ChannelEnd|DeviceEnd implied by an End flag, it is the full
+// device status it carries that is handled once the data is complete.
+static void __time_critical_func(css_handle_rx_data_status_command)(pch_chp_t *chp, pch_schib_t *schib, proto_packet_t p) {
+        uint8_t devs = proto_parse_devstatus_payload_devs(proto_get_payload(p));
+        assert(devs & PCH_DEVS_CHANNEL_END);
+        proto_packet_t dp = proto_data_status_as_data_packet(p);
+        do_handle_rx_data_command(chp, schib, dp, devs);
+}
+
+// css_handle_rx_data_inline_command handles a received DataInline
+// command. It is handled just like a Data command of the same count
+// except that the data is already here in the payload so we write it
+// (or discard it) ourselves and handle rx-data-complete right now
+// instead of having the channel receive it.
+static void __time_critical_func(css_handle_rx_data_inline_command)(pch_chp_t *chp, pch_schib_t *schib, proto_packet_t p) {
+        proto_packet_t dp = proto_data_inline_as_data_packet(p);
+        addr_count_t ac = begin_data_write(chp, schib, dp, data_end_ds(p)); // may have chained
+        if (!ac.discard)
+                memcpy((void*)ac.addr, &p.p0, ac.count);
+
+        prefetch_chain_ccw(chp, schib);
+        css_handle_rx_data_complete(chp, schib);
 }
 
 // handle_request_read handles a RequestRead that a peer device has
@@ -308,31 +349,24 @@ static inline proto_packet_t get_rx_packet(dmachan_link_t *l) {
         return *(proto_packet_t *)&l->cmd;
 }
 
-static void __time_critical_func(css_handle_rx_command_complete)(pch_chp_t *chp) {
-	// DMA has received a command packet from chp into RxBuf
-        dmachan_rx_channel_t *rx = &chp->channel.rx;
-        dmachan_link_t *rxl = &rx->link;
-        proto_packet_t p = get_rx_packet(rxl);
-
+// css_handle_rx_packet handles a command packet p from chp, either
+// just received into RxBuf or unpacked from a Batch.
+static void __time_critical_func(css_handle_rx_packet)(pch_chp_t *chp, proto_packet_t p, uint16_t seqnum) {
         pch_unit_addr_t ua = p.unit_addr;
         pch_schib_t *schib = get_schib_by_chp(chp, ua);
-        uint16_t seqnum = dmachan_link_seqnum(rxl);
 	trace_schib_packet(PCH_TRC_RT_CSS_RX_COMMAND_COMPLETE,
                 schib, p, seqnum);
-#ifdef PCH_CONFIG_DEBUG_MEMCHAN
-        uint16_t next_seqnum = rx->seen_seqnum + 1;
-        if (seqnum != next_seqnum)
-                panic("expected seqnum %d, got %d", next_seqnum, seqnum);
-        rx->seen_seqnum = seqnum;
-#endif
-
-        // Poison RxBuf to help troubleshooting
-        rxl->cmd.raw = 0xefefefef;
 
 	switch (proto_chop_cmd(p.chop)) {
 	case PROTO_CHOP_DATA:
 		css_handle_rx_data_command(chp, schib, p);
                 break;
+	case PROTO_CHOP_DATA_INLINE:
+		css_handle_rx_data_inline_command(chp, schib, p);
+                break;
+	case PROTO_CHOP_DATA_STATUS:
+		css_handle_rx_data_status_command(chp, schib, p);
+                break;
 	case PROTO_CHOP_UPDATE_STATUS:
 		handle_update_status(chp, schib, p);
                 break;
@@ -345,6 +379,60 @@ static void __time_critical_func(css_handle_rx_command_complete)(pch_chp_t *chp)
 	}
 }
 
+// css_handle_rx_chop_batch handles a Batch packet by starting rx of
+// the packets that follow it into chp->rx_batch.
+static void __time_critical_func(css_handle_rx_chop_batch)(pch_chp_t *chp, proto_packet_t p) {
+        uint16_t n = proto_get_count(p);
+        if (n < 2 || n > PROTO_BATCH_MAX_PACKETS)
+                panic("invalid Batch count from CU");
+
+        PCH_CSS_TRACE_COND(PCH_TRC_RT_CSS_RX_BATCH,
+                pch_chp_is_traced_general(chp),
+                ((struct pch_trdata_id_byte){
+                        .id = pch_get_chpid(chp),
+                        .byte = (uint8_t)n
+                }));
+
+        chp->rx_batch_count = (uint8_t)n;
+        dmachan_start_dst_data(&chp->channel.rx, (uint32_t)chp->rx_batch,
+                n * sizeof(proto_packet_t));
+}
+
+// css_handle_rx_batch_complete handles each packet received from a
+// Batch in turn. The CU only batches UpdateStatus, RequestRead and
+// DataInline packets so none of them is followed by data.
+static void __time_critical_func(css_handle_rx_batch_complete)(pch_chp_t *chp) {
+        uint n = chp->rx_batch_count;
+        chp->rx_batch_count = 0;
+
+        for (uint i = 0; i < n; i++) {
+                css_handle_rx_packet(chp, chp->rx_batch[i], 0);
+                assert(chp->rx_data_for_ua == -1);
+        }
+}
+
+static void __time_critical_func(css_handle_rx_command_complete)(pch_chp_t *chp) {
+	// DMA has received a command packet from chp into RxBuf
+        dmachan_rx_channel_t *rx = &chp->channel.rx;
+        dmachan_link_t *rxl = &rx->link;
+        proto_packet_t p = get_rx_packet(rxl);
+        uint16_t seqnum = dmachan_link_seqnum(rxl);
+#ifdef PCH_CONFIG_DEBUG_MEMCHAN
+        uint16_t next_seqnum = rx->seen_seqnum + 1;
+        if (seqnum != next_seqnum)
+                panic("expected seqnum %d, got %d", next_seqnum, seqnum);
+        rx->seen_seqnum = seqnum;
+#endif
+
+        // Poison RxBuf to help troubleshooting
+        rxl->cmd.raw = 0xefefefef;
+
+        if (proto_chop_cmd(p.chop) == PROTO_CHOP_BATCH)
+                css_handle_rx_chop_batch(chp, p);
+        else
+                css_handle_rx_packet(chp, p, seqnum);
+}
+
 void __time_critical_func(css_handle_rx_complete)(pch_chp_t *chp) {
 	int16_t rx_data_for_ua = chp->rx_data_for_ua;
 	if (rx_data_for_ua != -1) {
@@ -353,12 +441,15 @@ void __time_critical_func(css_handle_rx_complete)(pch_chp_t *chp) {
 		// Completion is for data that's just been received into
 		// memory belonging to CCW address of this schib
 		css_handle_rx_data_complete(chp, schib);
-	} else {
+	} else if (chp->rx_batch_count) {
+                // Completion is for the packets following a Batch
+                css_handle_rx_batch_complete(chp);
+        } else {
 		// Completion is for a command that has arrived in RxBuf.
 		css_handle_rx_command_complete(chp);
 	}
 
         rx_data_for_ua = chp->rx_data_for_ua;
-	if (rx_data_for_ua == -1)
+	if (rx_data_for_ua == -1 && !chp->rx_batch_count)
 		dmachan_start_dst_cmdbuf(&chp->channel.rx);
 }
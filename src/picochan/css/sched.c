@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2025 Malcolm Beattie
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "css_internal.h"
+
+// schib_may_go returns whether a schib may be taken from the
+// function list now: it may if it has no share or has budget left.
+static inline bool schib_may_go(schib_sched_t *ss) {
+        return ss->share == 0 || ss->credit > 0;
+}
+
+// give_shares gives every schib on the list starting at first its
+// share rounds times over, as though they had all been passed over
+// that many more times round the list.
+static void give_shares(pch_chp_t *chp, pch_unit_addr_t first, int32_t rounds) {
+        pch_unit_addr_t ua = first;
+        do {
+                pch_schib_t *schib = get_schib_by_chp(chp, ua);
+                schib_sched_t *ss = get_schib_sched(schib);
+                ss->credit += rounds * (int32_t)ss->share;
+                ua = schib->mda.nextua;
+        } while (ua != first);
+}
+
+// select_ua_func_dlist_unsafe returns the function list of chp from
+// which the next schib should be popped or NULL if both are empty.
+// Priority schibs always come first. Otherwise, ua_func_dlist is
+// served by deficit round robin. The head of the list is moved round
+// (which, for a circular list, moves those passed over to the tail)
+// to the first schib that may go. Each schib that is passed over is
+// given its share then and only then, so it gets its share once for
+// each time round the list and the schib chosen is not given any,
+// even if the caller then leaves it on the list. If a whole time
+// round the list finds no schib that may go, the rounds that would
+// still pass before one can are given in one go rather than by
+// going round the list again and again. Must be called with
+// schibs_lock held.
+ua_dlist_t __time_critical_func(*select_ua_func_dlist_unsafe)(pch_chp_t *chp) {
+        if (chp->ua_prio_func_dlist != -1)
+                return &chp->ua_prio_func_dlist;
+
+        ua_dlist_t *l = &chp->ua_func_dlist;
+        if (*l == -1)
+                return NULL;
+
+        pch_unit_addr_t first = (pch_unit_addr_t)*l;
+        while (true) {
+                int32_t rounds = INT32_MAX;
+                pch_unit_addr_t ua = first;
+                do {
+                        pch_schib_t *schib = get_schib_by_chp(chp, ua);
+                        schib_sched_t *ss = get_schib_sched(schib);
+                        if (schib_may_go(ss)) {
+                                *l = (ua_dlist_t)ua;
+                                return l;
+                        }
+
+                        int32_t share = (int32_t)ss->share;
+                        ss->credit += share;
+                        // number of further times round the list
+                        // before this schib may go
+                        int32_t r = 0;
+                        if (ss->credit <= 0)
+                                r = (share - ss->credit) / share;
+                        if (r < rounds)
+                                rounds = r;
+
+                        ua = schib->mda.nextua;
+                } while (ua != first);
+
+                if (rounds > 0)
+                        give_shares(chp, first, rounds);
+        }
+}
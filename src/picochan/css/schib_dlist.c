@@ -24,6 +24,9 @@ pch_schib_t __time_critical_func(*remove_from_schib_dlist_unsafe)(schib_dlist_t
 			*l = (schib_dlist_t)next;
 	}
 
+        // mark removed schib as no longer in a list
+        schib->mda.nextsid = sid;
+        schib->mda.prevsid = sid;
 	return schib;
 }
 
@@ -13,6 +13,26 @@ static void suspend(pch_schib_t *schib) {
 	css_notify(schib, 0);
 }
 
+// send_count_packet sends a Count packet carrying the exact count
+// for the Start that send_start_packet is about to send for schib.
+// The CU only applies a Count to a Start that follows it in the same
+// Batch so, unless the tx batch of chp is already open (in which case
+// process_schibs_waiting_for_tx has left room for both), it opens
+// the batch and returns true so that the caller flushes it once the
+// Start has been added.
+static bool send_count_packet(pch_chp_t *chp, pch_schib_t *schib, uint16_t count) {
+        bool opened = !pch_chp_is_tx_batch_open(chp);
+        if (opened)
+                pch_chp_set_tx_batch_open(chp, true);
+
+        assert(chp->tx_batch.count <= PROTO_BATCH_MAX_PACKETS - 2);
+	pch_unit_addr_t ua = schib->pmcw.unit_addr;
+        proto_packet_t p = proto_make_count_packet(PROTO_CHOP_COUNT,
+                ua, count);
+        send_tx_packet(chp, schib, p);
+        return opened;
+}
+
 // send_start_packet builds and sends a Start packet to the CU.
 // If the CCW is a Write-type command, there is data in the
 // current CCW segment and the device has previously advertised
@@ -23,26 +43,48 @@ static void suspend(pch_schib_t *schib) {
 // the segment size and the bsize-encoding of those.
 // For a Read-type CCW, the count we encode into the payload is
 // the current CCW segment size which advertises how much data
-// the device can send us with Data+data.
+// the device can send us with Data+data. Only the immediate data
+// of a Write is capped at the channel's max segment size: the room
+// advertised for a Read is not, since a capped room would cost the
+// device a round trip for every max_segment bytes it sends. If the
+// bsize encoding rounds the count down, the segment is split (and
+// counted in the schib's stats) unless the channel sends exact
+// counts, in which case a Count packet carrying the count precedes
+// the Start.
 static void send_start_packet(pch_chp_t *chp, pch_schib_t *schib, uint8_t ccwcmd) {
         uint16_t count = schib->scsw.count;
 
         bool write = (schib->scsw.ctrl_flags & PCH_SCSW_CCW_WRITE) != 0;
 	if (write) {
+                count = pch_chp_cap_segment(chp, count);
                 uint16_t advcount = schib->mda.devcount;
 		if (count > advcount)
 			count = advcount;
 	}
 
 	pch_unit_addr_t ua = schib->pmcw.unit_addr;
-        pch_bsize_t esize = pch_bsize_encode(count);
+        pch_bsizex_t esizex = pch_bsize_encodex(count);
+        bool opened = false;
+        if (!esizex.exact) {
+                if (pch_chp_is_exact_counting(chp)) {
+                        opened = send_count_packet(chp, schib, count);
+                } else {
+                        count_schib_split(schib);
+                        count = pch_bsize_decode(esizex.bsize);
+                }
+        }
+
         proto_packet_t p = proto_make_esize_packet(PROTO_CHOP_START,
-                ua, ccwcmd, esize);
+                ua, ccwcmd, esizex.bsize);
 	if (write && count > 0) {
-		count = pch_bsize_decode(esize);
 		send_command_with_data(chp, schib, p, count);
+                if (opened)
+                        css_tx_batch_flush(chp);
 	} else {
 		send_tx_packet(chp, schib, p);
+                if (opened)
+                        css_tx_batch_flush(chp);
+                prefetch_chain_ccw(chp, schib);
 	}
 }
 
@@ -59,6 +101,8 @@ static void process_schib_start(pch_schib_t *schib) {
         schib->scsw.ctrl_flags &= ~PCH_SC_MASK;
         schib->scsw.ctrl_flags &= ~PCH_AC_START_PENDING;
         schib->scsw.ctrl_flags |= PCH_FC_START;
+        count_schib_start(schib);
+        clear_schib_prefetch(schib);
 
 	pch_chpid_t chpid = schib->pmcw.chpid;
         pch_chp_t *chp = pch_get_chp(chpid);
@@ -80,6 +124,7 @@ static void process_schib_resume(pch_schib_t *schib) {
         schib->scsw.ctrl_flags &= ~PCH_SC_MASK;
         schib->scsw.ctrl_flags &= ~PCH_AC_RESUME_PENDING;
         schib->scsw.ctrl_flags |= PCH_FC_START; // XXX set this or not?
+        clear_schib_prefetch(schib); // CCWs may have changed
 
 	pch_chpid_t chpid = schib->pmcw.chpid;
         pch_chp_t *chp = pch_get_chp(chpid);
@@ -114,6 +159,7 @@ static void process_schib_halt(pch_schib_t *schib) {
 // point we'll probably need to implement Resume, Halt and Clear too
 // (and maybe Stop for some errors will come via this path too).
 void __time_critical_func(process_schib_func)(pch_schib_t *schib) {
+        css_take_turn(schib);
         schib->scsw.schs = 0;
         uint16_t ctrl_flags = schib->scsw.ctrl_flags;
         if (ctrl_flags & PCH_AC_START_PENDING) {
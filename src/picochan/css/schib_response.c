@@ -16,7 +16,9 @@
 // packet using p, ORring in flags Skip, End and Stop to the Chop
 // field as needed. If the Skip op flag is not set then it also
 // arranges for the TxPending state machine to transmit the actual
-// data immediately after the command itself is transmitted.
+// data immediately after the command itself is transmitted, except
+// that a Data command for no more than PROTO_DATA_INLINE_MAX bytes
+// is sent instead as a DataInline carrying the data in its payload.
 void __time_critical_func(send_command_with_data)(pch_chp_t *chp, pch_schib_t *schib, proto_packet_t p, uint16_t count) {
         assert(!pch_chp_is_tx_active(chp));
 
@@ -31,6 +33,7 @@ void __time_critical_func(send_command_with_data)(pch_chp_t *chp, pch_schib_t *s
         assert(count != 0);
 	uint16_t rescount = schib->scsw.count;
         assert(count <= rescount);
+        css_charge_schib(schib, count);
 
 	rescount -= count;
 	if (rescount > 0) {
@@ -48,15 +51,28 @@ void __time_critical_func(send_command_with_data)(pch_chp_t *chp, pch_schib_t *s
 			p.chop |= PROTO_CHOP_FLAG_END;
 	}
 
-	if (!zeroes)
-                pch_txsm_set_pending(&chp->tx_pending, addr, count);
+	if (!zeroes) {
+                if (proto_chop_cmd(p.chop) == PROTO_CHOP_DATA
+                        && count <= PROTO_DATA_INLINE_MAX) {
+                        p = proto_make_data_inline_packet(
+                                proto_chop_flags(p.chop), p.unit_addr,
+                                (const uint8_t *)addr, count);
+                } else {
+                        pch_txsm_set_pending(&chp->tx_pending, addr, count);
+                }
+        }
 
 	send_tx_packet(chp, schib, p);
+        prefetch_chain_ccw(chp, schib);
 }
 
 void __time_critical_func(send_data_response)(pch_chp_t *chp, pch_schib_t *schib) {
         proto_chop_flags_t chopfl = 0;
-        uint16_t count = schib->mda.devcount;
+        // Cap the data at the channel's max segment size before
+        // anything else: the device will ask again for the rest and
+        // it is that later request which finds whether there is
+        // enough data left in the segment
+        uint16_t count = pch_chp_cap_segment(chp, schib->mda.devcount);
 
         uint16_t rescount = schib->scsw.count;
         // if the requested count exceeds the current segment size
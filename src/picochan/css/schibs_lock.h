@@ -16,23 +16,74 @@
 // request, add itself to the ua_func_dlist headed by the channel
 // responsible for the subchannel (linked via mda.prevua/nextua) and
 // ping the CSS with raise_func_irq.
-// At the moment, we assume the user API invocations and the CSS
-// itself run on the same core and so the ping is raising a
-// (non-hardware-connected) IRQ and lock/unlock is a simple
-// disable/restore of (all) interrupts. If we want to separate out
-// the user invocations onto a different core from the CSS itself
-// (and there's no inherent problem with that since the CSS runs
-// entirely asynchronously and can cope with that) then we can
-// change the ping to be a doorbell interrupt to the other core
-// and change the lock/unlock to be a (hardware) spinlock plus the
-// disable/restore of interrupts.
+// By default, the user API invocations and the CSS itself run on
+// the same core and so the ping is raising a (non-hardware-connected)
+// IRQ and lock/unlock is a simple disable/restore of (all)
+// interrupts. A CSS initialised with pch_css_init_cross_core()
+// instead lets the user API run on either core: lock/unlock is the
+// disable/restore of interrupts plus css_schibs_lock, a
+// hardware spinlock, and the ping from the core that is not running
+// the CSS is a doorbell rung through the SIO FIFO to the CSS core
+// (see css_raise_irq).
+
+// css_schibs_lock_t is the hardware spinlock of a cross-core CSS.
+// The API functions and the CSS nest schibs_lock() (a list helper
+// that takes it may be called with it already held) so it records
+// which core holds it and how deeply.
+typedef struct css_schibs_lock {
+        spin_lock_t     *spin_lock;     // NULL unless CSS is cross-core
+        volatile int8_t owner;          // core holding spin_lock or -1
+        uint8_t         depth;
+} css_schibs_lock_t;
+
+extern css_schibs_lock_t css_schibs_lock;
 
 static inline uint32_t schibs_lock(void) {
-        return save_and_disable_interrupts();
+        uint32_t status = save_and_disable_interrupts();
+        spin_lock_t *lock = css_schibs_lock.spin_lock;
+        if (lock) {
+                int8_t core_num = (int8_t)get_core_num();
+                if (css_schibs_lock.owner != core_num) {
+                        spin_lock_unsafe_blocking(lock);
+                        css_schibs_lock.owner = core_num;
+                }
+                css_schibs_lock.depth++;
+        }
+
+        return status;
 }
 
 static inline void schibs_unlock(uint32_t status) {
+        spin_lock_t *lock = css_schibs_lock.spin_lock;
+        if (lock && --css_schibs_lock.depth == 0) {
+                css_schibs_lock.owner = -1;
+                spin_unlock_unsafe(lock);
+        }
+
         restore_interrupts(status);
 }
 
+// css_handler_lock() and css_handler_unlock() bracket each piece of
+// the CSS's own processing of schibs from its IRQ handlers (and
+// pch_css_poll): the handling of one tx or rx completion of a
+// channel or the processing of one schib taken from its lists. That
+// updates schib->scsw, and in particular ctrl_flags, with
+// read-modify-writes. The API functions only update a schib from
+// the CSS core with interrupts disabled so, without a cross-core
+// CSS, there is nothing to do. With one, this holds schibs_lock for
+// that piece so that an API function on the other core cannot
+// update the schib in between, but is released between pieces so
+// that it need not wait for the whole handler.
+static inline uint32_t css_handler_lock(void) {
+        if (!css_schibs_lock.spin_lock)
+                return 0;
+
+        return schibs_lock();
+}
+
+static inline void css_handler_unlock(uint32_t status) {
+        if (css_schibs_lock.spin_lock)
+                schibs_unlock(status);
+}
+
 #endif
@@ -37,10 +37,9 @@ static void css_handle_tx_data_after_data_complete(pch_schib_t *schib) {
 	}
 }
 
-static void css_handle_tx_data_complete(pch_chp_t *chp) {
+static void css_handle_tx_data_complete(pch_chp_t *chp, proto_packet_t p) {
 	// We've just completed sending data (not a command) to the CU
-	// for a device. Reread the packet to find out where we sent it.
-        proto_packet_t p = get_tx_packet(chp);
+	// for a device following command packet p.
 	pch_unit_addr_t ua = p.unit_addr;
 	pch_schib_t *schib = get_schib_by_chp(chp, ua);
 
@@ -62,18 +61,37 @@ static void css_handle_tx_data_complete(pch_chp_t *chp) {
 	}
 }
 
-static void css_handle_tx_command_complete(pch_chp_t *chp) {
-	// We've just sent a command (without any following data)
-	// from TxBuf to a device on chp. Reread the packet to find out
-	// where we sent it and whether we need to do anything.
-        proto_packet_t p = get_tx_packet(chp);
+static void css_handle_tx_command_complete(pch_chp_t *chp, proto_packet_t p) {
+	// We've just sent command packet p (without any following data)
+	// to a device on chp. Find out whether we need to do anything.
         pch_unit_addr_t ua = p.unit_addr;
         pch_schib_t *schib = get_schib_by_chp(chp, ua);
 
 	if (p.chop == PROTO_CHOP_START)  {
 		// Start command sent with no immediate data
 		css_handle_tx_start_complete(schib);
-	}
+	} else if (proto_chop_cmd(p.chop) == PROTO_CHOP_DATA_INLINE) {
+                // Data sent inline in the command itself
+		css_handle_tx_data_after_data_complete(schib);
+        }
+}
+
+// css_handle_tx_batch_complete handles the completion of sending a
+// Batch by handling the completion of each packet in it in turn.
+static void css_handle_tx_batch_complete(pch_chp_t *chp) {
+        pch_chp_tx_batch_t *b = &chp->tx_batch;
+        uint n = b->count;
+        bool final_data = b->final_data;
+        b->count = 0;
+        b->final_data = false;
+
+        for (uint i = 0; i < n; i++) {
+                proto_packet_t p = b->packets[i];
+                if (final_data && i == n - 1)
+                        css_handle_tx_data_complete(chp, p);
+                else
+                        css_handle_tx_command_complete(chp, p);
+        }
 }
 
 // css_handle_tx_complete handles a tx completion for
@@ -94,10 +112,109 @@ void __time_critical_func(css_handle_tx_complete)(pch_chp_t *chp) {
 	if (tr == PCH_TXSM_ACTED)
 		return; // tx dma not free - still sending pending data
 
+        pch_txsm_t *batch_data = &chp->tx_batch.data;
+        if (tr == PCH_TXSM_FINISHED && pch_txsm_busy(batch_data)) {
+                // Batch packets have been sent - now send the data
+                // that follows the final packet
+                *txpend = *batch_data;
+                pch_txsm_reset(batch_data);
+                tr = pch_txsm_run(txpend, &chp->channel.tx);
+                assert(tr == PCH_TXSM_ACTED);
+                return;
+        }
+
 	pch_chp_set_tx_active(chp, false); // tx dma is now free again
 
+        if (chp->tx_batch.count) {
+                css_handle_tx_batch_complete(chp);
+                return;
+        }
+
+        proto_packet_t p = get_tx_packet(chp);
 	if (tr == PCH_TXSM_FINISHED)
-		css_handle_tx_data_complete(chp);
+		css_handle_tx_data_complete(chp, p);
 	else
-		css_handle_tx_command_complete(chp);
+		css_handle_tx_command_complete(chp, p);
+}
+
+bool __time_critical_func(css_tx_batch_has_ua)(pch_chp_t *chp, pch_unit_addr_t ua) {
+        pch_chp_tx_batch_t *b = &chp->tx_batch;
+        for (uint i = 0; i < b->count; i++) {
+                if (b->packets[i].unit_addr == ua)
+                        return true;
+        }
+
+        return false;
+}
+
+// css_tx_batch_add is called by send_tx_packet while the tx batch of
+// chp is open. A packet with no data following it (including a
+// DataInline) is added to the batch. A packet followed by data (or
+// a Data packet with the Skip flag, since the CU then receives into
+// the segment from its own source of zeroes) can only be the final
+// packet of a batch so it closes the batch and flushes it. A full
+// batch is flushed too.
+void __time_critical_func(css_tx_batch_add)(pch_chp_t *chp, pch_schib_t *schib, proto_packet_t p) {
+        pch_chp_tx_batch_t *b = &chp->tx_batch;
+        assert(!pch_chp_is_tx_active(chp));
+        assert(b->count < PROTO_BATCH_MAX_PACKETS);
+
+        pch_txsm_t *txpend = &chp->tx_pending;
+        bool final = pch_txsm_busy(txpend)
+                || proto_chop_cmd(p.chop) == PROTO_CHOP_DATA;
+        if (final && b->count == 0) {
+                // nothing gathered so send it the usual way
+                pch_chp_set_tx_batch_open(chp, false);
+                send_tx_packet(chp, schib, p);
+                return;
+        }
+
+        trace_schib_packet(PCH_TRC_RT_CSS_SEND_TX_PACKET, schib, p, 0);
+        b->packets[b->count++] = p;
+        if (pch_txsm_busy(txpend)) {
+                b->data = *txpend;
+                pch_txsm_reset(txpend);
+                b->final_data = true;
+        }
+
+        if (final || b->count == PROTO_BATCH_MAX_PACKETS)
+                css_tx_batch_flush(chp);
+}
+
+// css_tx_batch_flush closes the tx batch of chp and sends what has
+// been gathered in it. A single packet is sent on its own and two
+// or more are sent as a Batch packet followed by the packets. It
+// does nothing if the batch has already been closed because it was
+// flushed by css_tx_batch_add when full or final.
+void __time_critical_func(css_tx_batch_flush)(pch_chp_t *chp) {
+        if (!pch_chp_is_tx_batch_open(chp))
+                return;
+
+        pch_chp_tx_batch_t *b = &chp->tx_batch;
+        pch_chp_set_tx_batch_open(chp, false);
+        uint8_t n = b->count;
+        if (n == 0)
+                return;
+
+        proto_packet_t p;
+        if (n == 1) {
+                assert(!b->final_data);
+                p = b->packets[0];
+                b->count = 0;
+        } else {
+                p = proto_make_count_packet(PROTO_CHOP_BATCH, 0, n);
+                pch_txsm_set_pending(&chp->tx_pending,
+                        (uint32_t)b->packets, n * sizeof(proto_packet_t));
+                PCH_CSS_TRACE_COND(PCH_TRC_RT_CSS_SEND_TX_BATCH,
+                        pch_chp_is_traced_general(chp),
+                        ((struct pch_trdata_id_byte){
+                                .id = pch_get_chpid(chp),
+                                .byte = n
+                        }));
+        }
+
+        dmachan_link_t *txl = &chp->channel.tx.link;
+        uint32_t cmd = proto_packet_as_word(p);
+        dmachan_link_cmd_set(txl, dmachan_make_cmd_from_word(cmd));
+        start_tx_cmdbuf(chp);
 }
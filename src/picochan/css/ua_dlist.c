@@ -24,6 +24,10 @@ pch_schib_t __time_critical_func(*remove_from_ua_dlist_unsafe)(ua_dlist_t *l, pc
 			*l = (ua_dlist_t)next;
 	}
 
+        // mark removed schib as no longer in a list so that a later
+        // push_ua_slist_unsafe does not follow its stale nextua
+        schib->mda.nextua = ua;
+        schib->mda.prevua = ua;
 	return schib;
 }
 
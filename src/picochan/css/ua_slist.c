@@ -44,3 +44,8 @@ bool __time_critical_func(push_ua_slist_unsafe)(ua_slist_t *l, pch_chp_t *chp, p
 	l->tail = (int16_t)ua;
 	return was_empty;
 }
+
+void __time_critical_func(push_ua_response_slist)(pch_chp_t *chp, pch_sid_t sid) {
+        ua_slist_t *l = pch_chp_response_slist(chp, get_schib(sid));
+        push_ua_slist(l, chp, sid);
+}
@@ -14,7 +14,11 @@ pch_trc_bufferset_t pch_cus_trace_bs;
 static struct async_context_threadsafe_background pch_cus_default_async_context;
 async_context_t *pch_cus_async_context;
 
-unsigned char pch_cus_trace_buffer_space[PCH_TRC_NUM_BUFFERS * PCH_TRC_BUFFER_SIZE] __aligned(4);
+// cus_mem_rings are the rings through which each CU sends to its
+// channel when it is a memchan, indexed by CU address
+static dmachan_mem_ring_t PCH_SRAM_PLACEMENT(DMACHAN_MEM_RING_SRAM_BANK, "picochan_cus_mem_rings") cus_mem_rings[PCH_NUM_CUS];
+
+unsigned char PCH_SRAM_PLACEMENT(PCH_CUS_TRACE_SRAM_BANK, "picochan_cus_trace") pch_cus_trace_buffer_space[PCH_TRC_NUM_BUFFERS * PCH_TRC_BUFFER_SIZE] __aligned(4);
 
 bool pch_cus_init_done;
 
@@ -40,6 +44,7 @@ void pch_cu_init(pch_cu_t *cu, uint16_t num_devibs) {
         pch_devib_list_init(&cu->tx_list);
         pch_devib_list_init(&cu->cb_list);
         cu->rx_active = -1;
+        cu->rx_start_count = -1;
         cu->num_devibs = num_devibs;
         cu->irq_index = -1;
 }
@@ -148,18 +153,14 @@ void pch_cus_piocu_configure(pch_cuaddr_t cua, pch_pio_config_t *cfg, pch_piocha
 }
 
 void pch_cus_memcu_configure(pch_cuaddr_t cua, pch_channel_t *chpeer) {
-        // Check that spin_lock is initialised even when not a Debug
-        // release because silently ignoring it produces such
-        // nasty-to-troubleshoot race conditions
-        dmachan_panic_unless_memchan_initialised();
-
         pch_cu_t *cu = pch_get_cu(cua);
         assert(!pch_channel_is_started(&cu->channel));
 
         pch_cu_configure_async_context_if_unset(cu);
         pch_cu_configure_dma_irq_if_unset(cu);
 
-        pch_channel_init_memchan(&cu->channel, cua, cu->irq_index, chpeer);
+        pch_channel_init_memchan_ring(&cu->channel, cua, cu->irq_index, chpeer,
+                &cus_mem_rings[cua]);
 
         trace_cu_dma(PCH_TRC_RT_CUS_CU_TX_DMA_INIT, cua,
                 &cu->channel.tx.link);
@@ -167,6 +168,15 @@ void pch_cus_memcu_configure(pch_cuaddr_t cua, pch_channel_t *chpeer) {
                 &cu->channel.rx.link);
 }
 
+void pch_cus_memcu_configure_polled(pch_cuaddr_t cua, pch_channel_t *chpeer) {
+        pch_cu_t *cu = pch_get_cu(cua);
+        assert(!pch_channel_is_started(&cu->channel));
+
+        pch_cu_configure_async_context_if_unset(cu);
+        pch_channel_init_memchan_polled_ring(&cu->channel, cua, chpeer,
+                &cus_mem_rings[cua]);
+}
+
 void pch_cu_start(pch_cuaddr_t cua) {
         pch_cu_t *cu = pch_get_cu(cua);
         assert(pch_channel_is_configured(&cu->channel));
@@ -205,6 +215,10 @@ bool pch_cus_is_traced(void) {
         return pch_cus_trace_bs.enable;
 }
 
+pch_trc_bufferset_t *pch_cus_get_trace_bufferset(void) {
+        return &pch_cus_trace_bs;
+}
+
 uint8_t pch_cu_set_trace_flags(pch_cuaddr_t cua, uint8_t trace_flags) {
         pch_cu_t *cu = pch_get_cu(cua);
         trace_flags &= PCH_CU_TRACED_MASK;
@@ -232,6 +246,17 @@ bool pch_cus_trace_cu(pch_cuaddr_t cua, bool trace) {
         return old_trace_flags != new_trace_flags;
 }
 
+bool pch_cu_set_batching(pch_cuaddr_t cua, bool batching) {
+        pch_cu_t *cu = pch_get_cu(cua);
+        bool old_batching = pch_cu_is_tx_batching(cu);
+        if (batching)
+                cu->flags |= PCH_CU_TX_BATCHING;
+        else
+                cu->flags &= ~PCH_CU_TX_BATCHING;
+
+        return old_batching;
+}
+
 bool pch_cus_trace_dev(pch_devib_t *devib, bool trace) {
         pch_cu_t *cu = pch_dev_get_cu(devib);
         pch_unit_addr_t ua = pch_dev_get_ua(devib);
@@ -128,6 +128,45 @@ int __time_critical_func(pch_dev_send)(pch_devib_t *devib, void *srcaddr, uint16
         return pch_dev_send_then(devib, srcaddr, n, flags, -1);
 }
 
+int __no_inline_not_in_flash_func(pch_dev_send_final_status_then)(pch_devib_t *devib, void *srcaddr, uint16_t n, uint8_t devs, int cbindex_opt) {
+        if (!pch_devib_is_started(devib))
+                return -ENOTSTARTED;
+
+        if (pch_devib_is_cmd_write(devib))
+                return -ECMDNOTREAD;
+
+        if (n == 0)
+                return -EDATALENZERO;
+
+        if (!(devs & PCH_DEVS_CHANNEL_END))
+                return -EINVALIDSTATUS;
+
+        int err = pch_dev_set_callback(devib, cbindex_opt);
+        if (err < 0)
+                return err;
+
+        // Cap write count at CSS-advertised size
+        if (n > devib->size)
+                n = devib->size;
+
+        // The count travels bsize-encoded alongside devs so it
+        // must be exact since there is no later chance to send
+        // the remainder
+        if (!pch_bsize_encodex(n).exact)
+                return -EDATALENINEXACT;
+
+	if (devs & PCH_DEVS_DEVICE_END)
+                devib->flags &= ~PCH_DEVIB_FLAG_STOPPING;
+
+        pch_devib_prepare_write_data_status(devib, srcaddr, n, devs, false);
+        pch_devib_send_or_queue_command(devib);
+        return n;
+}
+
+int __time_critical_func(pch_dev_send_final_status)(pch_devib_t *devib, void *srcaddr, uint16_t n, uint8_t devs) {
+        return pch_dev_send_final_status_then(devib, srcaddr, n, devs, -1);
+}
+
 int __no_inline_not_in_flash_func(pch_dev_receive_then)(pch_devib_t *devib, void *dstaddr, uint16_t size, int cbindex_opt) {
         if (!pch_devib_is_started(devib))
                 return -ENOTSTARTED;
@@ -23,6 +23,7 @@
 #include "picochan/dev_api.h"
 #include "picochan/dmachan.h"
 #include "txsm/txsm.h"
+#include "proto/packet.h"
 
 static_assert(__builtin_constant_p(PCH_MAX_DEVIBS_PER_CU),
         "PCH_MAX_DEVIBS_PER_CU must be a compile-time constant");
@@ -62,6 +63,45 @@ static_assert(__builtin_constant_p(PCH_CU_ALIGN),
 static_assert(PCH_NUM_CUS >= 1 && PCH_NUM_CUS <= 256,
         "PCH_NUM_CUS must be between 1 and 256");
 
+/*!
+ * \def PCH_CU_SRAM_BANK
+ * \ingroup picochan_cu
+ * \hideinitializer
+ * \brief The SRAM bank for CUs declared with PCH_CU_PLACEMENT
+ *
+ * One of MAIN, SCRATCH_X or SCRATCH_Y (see picochan/placement.h).
+ * Default MAIN. The application allocates each pch_cu_t so this
+ * only has effect where it is declared with PCH_CU_PLACEMENT. A CU
+ * declared with PCH_SRAM_PLACEMENT() instead can be given a bank
+ * of its own.
+ */
+#ifndef PCH_CU_SRAM_BANK
+#define PCH_CU_SRAM_BANK MAIN
+#endif
+
+/*! \def PCH_CU_PLACEMENT
+ *  \ingroup picochan_cu
+ *  \hideinitializer
+ *  \brief the attribute placing a pch_cu_t in PCH_CU_SRAM_BANK
+ *
+ * For example,
+ * static pch_cu_t PCH_CU_PLACEMENT mycu = PCH_CU_INIT(4);
+ */
+#define PCH_CU_PLACEMENT PCH_SRAM_PLACEMENT(PCH_CU_SRAM_BANK, "picochan_cu")
+
+/*!
+ * \def PCH_CUS_TRACE_SRAM_BANK
+ * \ingroup picochan_cu
+ * \hideinitializer
+ * \brief The SRAM bank holding the CU-side trace buffers
+ *
+ * One of MAIN, SCRATCH_X or SCRATCH_Y (see picochan/placement.h).
+ * Default MAIN.
+ */
+#ifndef PCH_CUS_TRACE_SRAM_BANK
+#define PCH_CUS_TRACE_SRAM_BANK MAIN
+#endif
+
 #define PCH_CUS_BUFFERSET_MAGIC 0x70437553
 
 /*! \brief pch_cu_t is a Control Unit (CU)
@@ -103,16 +143,28 @@ typedef struct __aligned(PCH_CU_ALIGN) pch_cu {
         pch_txsm_t              tx_pending;
 	//! active ua for rx data to dev or -1 if none
 	int16_t                 rx_active;
+        //! exact count from a Count packet for the Start following it
+        //! in the Batch being handled or -1 if none
+        int32_t                 rx_start_count;
+        //! number of packets being received into rx_batch or 0
+        uint8_t                 rx_batch_count;
+        //! number of packets being sent from tx_batch or 0
+        uint8_t                 tx_batch_count;
         uint16_t                num_devibs; //!< [0, 256]
 	//! completions raise irqs with irq_index, -1 before configuration
 	pch_irq_index_t         irq_index;
         pch_cuaddr_t            cuaddr;
         uint8_t                 flags;
+        //! packets received following a Batch packet from the CSS
+        proto_packet_t          rx_batch[PROTO_BATCH_MAX_PACKETS];
+        //! packets being sent following a Batch packet to the CSS
+        proto_packet_t          tx_batch[PROTO_BATCH_MAX_PACKETS];
         //! Flexible Array Member (FAM) of size num_devibs
 	pch_devib_t             devibs[];
 } pch_cu_t;
 
 // values of pch_cu_t flags
+#define PCH_CU_TX_BATCHING      0x08
 #define PCH_CU_TRACED_IRQ       0x04
 #define PCH_CU_TRACED_LINK      0x02
 #define PCH_CU_TRACED_GENERAL   0x01
@@ -136,6 +188,10 @@ static inline bool pch_cu_is_traced_irq(pch_cu_t *cu) {
         return cu->flags & PCH_CU_TRACED_IRQ;
 }
 
+static inline bool pch_cu_is_tx_batching(pch_cu_t *cu) {
+        return cu->flags & PCH_CU_TX_BATCHING;
+}
+
 static inline pch_irq_index_t pch_cu_get_irq_index(pch_cu_t *cu) {
         return cu->irq_index;
 }
@@ -157,6 +213,7 @@ void pch_cu_set_irq_index(pch_cu_t *cu, pch_irq_index_t irq_index);
                 .tx_list = { -1, -1 }, \
                 .cb_list = { -1, -1 }, \
                 .rx_active = -1, \
+                .rx_start_count = -1, \
                 .num_devibs = (num_devices), \
                 .irq_index = -1, \
                 .devibs = { [(num_devices)-1] = {0} } \
@@ -239,6 +296,14 @@ bool pch_cus_set_trace(bool trace);
 
 bool pch_cus_is_traced(void);
 
+/*! \brief Returns the CU subsystem trace bufferset
+ * \ingroup picochan_cu
+ *
+ * For use with pch_trc_drain_start() to drain CU trace records
+ * continuously to a sink.
+ */
+pch_trc_bufferset_t *pch_cus_get_trace_bufferset(void);
+
 async_context_t *pch_cus_configure_default_async_context(async_context_threadsafe_background_config_t *config);
 void pch_cu_configure_async_context_if_unset(pch_cu_t *cu);
 
@@ -345,6 +410,29 @@ void pch_cus_piocu_configure(pch_cuaddr_t cua, pch_pio_config_t *cfg, pch_piocha
  */
 void pch_cus_memcu_configure(pch_cuaddr_t cua, pch_channel_t *chpeer);
 
+/*! \brief Configure a polled memchan control unit
+ * \ingroup picochan_cu
+ *
+ * Like pch_cus_memcu_configure() but the channel uses no DMA
+ * channels and raises no interrupts so no DMA IRQ index is
+ * configured for the CU. Instead, the CU core must call
+ * pch_cus_poll() repeatedly (typically spinning on it when it has a
+ * core to itself) and the peer CSS channel must have been configured
+ * with pch_chp_configure_memchan_polled().
+ */
+void pch_cus_memcu_configure_polled(pch_cuaddr_t cua, pch_channel_t *chpeer);
+
+/*! \brief Polls each started polled CU for completions
+ * \ingroup picochan_cu
+ *
+ * For each started CU configured with
+ * pch_cus_memcu_configure_polled(), checks for tx and rx
+ * completions and, if there are any, runs the CU worker directly
+ * (holding the CU's async_context lock) rather than scheduling it.
+ * Returns true if any CU had a completion to handle.
+ */
+bool pch_cus_poll(void);
+
 /*! \brief Starts the channel from CU cua to the CSS
  * \ingroup picochan_cu
  *
@@ -379,6 +467,21 @@ bool pch_cus_trace_cu(pch_cuaddr_t cua, bool trace);
  */
 uint8_t pch_cu_set_trace_flags(pch_cuaddr_t cua, uint8_t trace_flags);
 
+/*! \brief Sets whether CU cua batches packets sent to the CSS
+ * \ingroup picochan_cu
+ *
+ * Without batching, the CU sends each command packet to the CSS as
+ * a separate transfer and waits for its tx completion before sending
+ * the next. With batching, when several devices on the CU have an
+ * UpdateStatus or RequestRead waiting to be sent (for example, when
+ * many devices end their channel programs together), the CU gathers
+ * up to PROTO_BATCH_MAX_PACKETS of them into a single Batch transfer
+ * which the CSS unpacks from one rx completion. The CSS must be
+ * running a version of picochan that understands Batch packets.
+ * Returns the previous setting.
+ */
+bool pch_cu_set_batching(pch_cuaddr_t cua, bool batching);
+
 /*! \brief Sets whether tracing is enabled for device
  * \ingroup picochan_cu
  *
@@ -48,6 +48,7 @@ enum {
         EDATALENZERO            = 11,
         EBUFFERTOOSHORT         = 12,
         ECUBUSY                 = 13,
+        EDATALENINEXACT         = 14,
         //
         ECANCEL                 = 256
 };
@@ -100,11 +101,14 @@ int pch_dev_set_callback(pch_devib_t *devib, int cbindex_opt);
  * For (2), provided (1) holds, the devib->size field will have been
  * filled in at Start time with a size that is no more than (and will
  * typically be very close to) the size specified by the CCW segment
- * itself. However, the size field is not affected by using this or
- * related functions to send data to the CSS (and the field should
- * not be updated in such a way by the device). Use the
+ * itself. Each Data or DataStatus command that the CU sends, from
+ * this or related functions, deducts its count from the size field
+ * so that it always holds what remains of the advertised window:
+ * the most the device can send next without waiting for the CSS.
+ * The device itself should not update the field. Use the
  * PROTO_CHOP_FLAG_RESPONSE_REQUIRED flag (see below) if up-to-date
- * and/or exact size information is needed.
+ * and/or exact size information is needed, since the CSS may have
+ * more room than the window that remains.
  * \param cu - the control unit
  * \param ua - the unit address of the device in control unit `cu`
  * \param flags - may contain the following flags:
@@ -151,6 +155,36 @@ int pch_dev_send_then(pch_devib_t *devib, void *srcaddr, uint16_t n, proto_chop_
  */
 int pch_dev_send_zeroes_then(pch_devib_t *devib, uint16_t n, proto_chop_flags_t flags, int cbindex_opt);
 
+/*! \brief Send data to the CSS together with the device status ending the CCW
+ *  \ingroup picochan_cu
+ *
+ * This sends data to the CSS just like pch_dev_send_then() but in a
+ * single DataStatus command that also carries the device status,
+ * devs, that would otherwise need to be sent with a separate
+ * pch_dev_update_status_then() once the data has been sent. Unlike
+ * pch_dev_send_final_then(), which implies a status of exactly
+ * ChannelEnd|DeviceEnd, devs can include flags such as
+ * StatusModifier or UnitException so that a conditional channel
+ * program can end a Read-type CCW with one packet fewer.
+ *
+ * devs must include ChannelEnd (otherwise -EINVALIDSTATUS is
+ * returned). The count of data is carried bsize-encoded alongside
+ * devs so, after being capped at `devib->size`, `n` must be one of
+ * the counts that bsize can encode exactly (any count up to 63, an
+ * even count up to 190, a multiple of 8 up to 696 or a multiple of
+ * 64 up to 4736). Otherwise -EDATALENINEXACT is returned and the
+ * device should use pch_dev_send_then() followed by
+ * pch_dev_update_status_then() instead.
+ * \param devib - the devib of the device
+ * \param srcaddr - the address of the data to send
+ * \param n - the number of data bytes to send
+ * \param devs - the device status, including ChannelEnd
+ * \param cbindex_opt - before sending, update the callback index
+ * in the devib (unless -1 is passed)
+ * \return the number of bytes being sent or a negative error
+ */
+int pch_dev_send_final_status_then(pch_devib_t *devib, void *srcaddr, uint16_t n, uint8_t devs, int cbindex_opt);
+
 /*! \brief Receive data from the CSS
  *  \ingroup picochan_cu
  *
@@ -219,6 +253,7 @@ int pch_dev_update_status_advert_then(pch_devib_t *devib, uint8_t devs, void *ds
 int pch_dev_send(pch_devib_t *devib, void *srcaddr, uint16_t n, proto_chop_flags_t flags);
 int pch_dev_send_final(pch_devib_t *devib, void *srcaddr, uint16_t n);
 int pch_dev_send_final_then(pch_devib_t *devib, void *srcaddr, uint16_t n, int cbindex_opt);
+int pch_dev_send_final_status(pch_devib_t *devib, void *srcaddr, uint16_t n, uint8_t devs);
 int pch_dev_send_respond(pch_devib_t *devib, void *srcaddr, uint16_t n);
 int pch_dev_send_respond_then(pch_devib_t *devib, void *srcaddr, uint16_t n, int cbindex_opt);
 int pch_dev_send_norespond(pch_devib_t *devib, void *srcaddr, uint16_t n);
@@ -341,6 +341,36 @@ static inline void pch_devib_prepare_write_zeroes(pch_devib_t *devib, uint16_t n
         devib->op = PROTO_CHOP_DATA | PROTO_CHOP_FLAG_SKIP | flags;
 }
 
+/*! \brief Low-level API to prepare a DataStatus channel operation command for a device
+ *  \ingroup picochan_cu
+ *
+ * Sets the channel operation command to be PROTO_CHOP_DATA_STATUS
+ * (along with PROTO_CHOP_FLAG_SKIP if zeroes is true, for which
+ * srcaddr is ignored) and sets the payload to hold the device status
+ * devs and the bsize encoding of the count n of bytes to be written.
+ * The CSS writes the data as it would for a Data command and then
+ * handles devs as it would for a following UpdateStatus.
+ *
+ * For a Debug build, asserts if the device has not received a
+ * Start operation, if devs does not include ChannelEnd or if n is
+ * not exactly encodable as a bsize.
+ * 
+ * Typically, device driver authors should use the higher-level
+ * pch_dev_ API rather than this low-level API.
+ */
+static inline void pch_devib_prepare_write_data_status(pch_devib_t *devib, void *srcaddr, uint16_t n, uint8_t devs, bool zeroes) {
+        assert(devib->flags & PCH_DEVIB_FLAG_STARTED);
+        assert(devs & PCH_DEVS_CHANNEL_END);
+        pch_bsizex_t esizex = pch_bsize_encodex(n);
+        assert(esizex.exact);
+        devib->payload = proto_make_devstatus_payload(devs, esizex.bsize);
+        devib->op = PROTO_CHOP_DATA_STATUS;
+        if (zeroes)
+                devib->op |= PROTO_CHOP_FLAG_SKIP;
+        else
+                devib->addr = (uint32_t)srcaddr;
+}
+
 /*! \brief Low-level API to prepare a RequestRead channel operation command for a device
  *  \ingroup picochan_cu
  *
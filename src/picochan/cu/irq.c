@@ -195,6 +195,31 @@ void __isr __time_critical_func(pch_cus_handle_dma_irq)() {
         }
 }
 
+bool __time_critical_func(pch_cus_poll)(void) {
+        bool progress = false;
+
+        for (int i = 0; i < PCH_NUM_CUS; i++) {
+                pch_cu_t *cu = pch_cus[i];
+                if (cu == NULL)
+                        continue;
+
+                pch_channel_t *ch = &cu->channel;
+                if (!pch_channel_is_started(ch) || !pch_channel_is_polled(ch))
+                        continue;
+
+                if (!pch_channel_poll(ch))
+                        continue;
+
+                async_context_t *context = cu->async_context;
+                async_context_acquire_lock_blocking(context);
+                pch_cus_async_worker_callback(context, &cu->worker);
+                async_context_release_lock(context);
+                progress = true;
+        }
+
+        return progress;
+}
+
 void __isr __time_critical_func(pch_cus_handle_pio_irq)() {
         uint irqnum = __get_current_exception() - VTABLE_FIRST_IRQ;
         for (int i = 0; i < PCH_NUM_CUS; i++) {
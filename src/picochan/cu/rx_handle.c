@@ -3,6 +3,7 @@
  * SPDX-License-Identifier: MIT
  */
 
+#include <string.h>
 #include "cu_internal.h"
 #include "picochan/ccw.h"
 #include "cus_trace.h"
@@ -24,11 +25,23 @@ static void __not_in_flash_func(cus_handle_rx_chop_data)(pch_devib_t *devib, pro
 	cu->rx_active = (int16_t)ua;
 }
 
+// cus_handle_rx_chop_data_inline handles a DataInline by writing
+// the data carried in its payload straight to the devib buffer. It
+// then makes the devib op and payload that of the equivalent Data
+// command, as though that data had been received after it, so that
+// the device sees no difference.
+static void __not_in_flash_func(cus_handle_rx_chop_data_inline)(pch_devib_t *devib, proto_packet_t p) {
+	assert(devib->flags & PCH_DEVIB_FLAG_STARTED);
+        proto_packet_t dp = proto_data_inline_as_data_packet(p);
+        uint16_t count = proto_get_count(dp);
+        memcpy((void*)devib->addr, &p.p0, count);
+        devib->op = dp.chop;
+        devib->payload = proto_get_payload(dp);
+}
+
 static void __not_in_flash_func(cus_handle_rx_chop_room)(pch_devib_t *devib, proto_packet_t p) {
-        pch_cu_t *cu = pch_dev_get_cu(devib);
         assert(devib->flags & PCH_DEVIB_FLAG_STARTED);
         devib->size = proto_get_count(p);
-        dmachan_start_dst_cmdbuf(&cu->channel.rx);
 }
 
 static void __not_in_flash_func(cus_handle_rx_chop_halt)(pch_devib_t *devib, proto_packet_t p) {
@@ -39,11 +52,8 @@ static void __not_in_flash_func(cus_handle_rx_chop_halt)(pch_devib_t *devib, pro
 }
 
 static void __not_in_flash_func(cus_handle_rx_chop_start_read)(pch_devib_t *devib, uint8_t ccwcmd, uint16_t count) {
-        pch_cu_t *cu = pch_dev_get_cu(devib);
         devib->flags &= ~PCH_DEVIB_FLAG_CMD_WRITE;
         devib->size = count; // advertised window we can write to
-
-        dmachan_start_dst_cmdbuf(&cu->channel.rx);
 }
 
 static void __not_in_flash_func(cus_handle_rx_chop_start_write)(pch_devib_t *devib, uint8_t ccwcmd, uint16_t count) {
@@ -51,10 +61,8 @@ static void __not_in_flash_func(cus_handle_rx_chop_start_write)(pch_devib_t *dev
         pch_cu_t *cu = pch_dev_get_cu(devib);
         devib->flags |= PCH_DEVIB_FLAG_CMD_WRITE;
 
-        if (count == 0) {
-                dmachan_start_dst_cmdbuf(&cu->channel.rx);
+        if (count == 0)
                 return;
-        }
 
         assert(count <= devib->size);
         assert(cu->rx_active == -1);
@@ -74,6 +82,13 @@ static void __not_in_flash_func(cus_handle_rx_chop_start)(pch_devib_t *devib, pr
         devib->flags |= PCH_DEVIB_FLAG_START_PENDING;
         uint8_t ccwcmd = p.p0;
         uint16_t count = proto_decode_esize_payload(p);
+        pch_cu_t *cu = pch_dev_get_cu(devib);
+        if (cu->rx_start_count >= 0) {
+                // exact count from the Count packet preceding us
+                assert(cu->rx_start_count >= count);
+                count = (uint16_t)cu->rx_start_count;
+                cu->rx_start_count = -1;
+        }
 
 	if (pch_is_ccw_cmd_write(ccwcmd))
                 cus_handle_rx_chop_start_write(devib, ccwcmd, count);
@@ -85,15 +100,17 @@ static inline proto_packet_t get_rx_packet(dmachan_link_t *l) {
         return *(proto_packet_t *)&l->cmd;
 }
 
-static pch_devib_t *__not_in_flash_func(cus_handle_rx_command_complete)(pch_cu_t *cu) {
-	// DMA has received a command packet from CSS into RxBuf
-        dmachan_link_t *rxl = &cu->channel.rx.link;
-        proto_packet_t p = get_rx_packet(rxl);
+// cus_handle_rx_packet handles a command packet p from the CSS,
+// either just received into RxBuf or unpacked from a Batch. If the
+// packet is followed by data, it starts rx of that data and sets
+// cu->rx_active but otherwise it leaves it to the caller to start
+// rx of the next command.
+static pch_devib_t *__not_in_flash_func(cus_handle_rx_packet)(pch_cu_t *cu, proto_packet_t p, uint16_t seqnum) {
         pch_unit_addr_t ua = p.unit_addr;
 	assert(ua < cu->num_devibs);
         pch_devib_t *devib = pch_get_devib(cu, ua);
 	trace_dev_packet(PCH_TRC_RT_CUS_RX_COMMAND_COMPLETE, devib, p,
-                dmachan_link_seqnum(rxl));
+                seqnum);
         devib->op = p.chop;
         devib->payload = proto_get_payload(p);
 	switch (proto_chop_cmd(p.chop)) {
@@ -105,6 +122,10 @@ static pch_devib_t *__not_in_flash_func(cus_handle_rx_command_complete)(pch_cu_t
 		cus_handle_rx_chop_data(devib, p);
                 break;
 
+	case PROTO_CHOP_DATA_INLINE:
+		cus_handle_rx_chop_data_inline(devib, p);
+                break;
+
 	case PROTO_CHOP_ROOM:
 		cus_handle_rx_chop_room(devib, p);
                 break;
@@ -121,6 +142,81 @@ static pch_devib_t *__not_in_flash_func(cus_handle_rx_command_complete)(pch_cu_t
         return devib;
 }
 
+// cus_handle_rx_chop_batch handles a Batch packet by starting rx of
+// the packets that follow it into cu->rx_batch.
+static void __not_in_flash_func(cus_handle_rx_chop_batch)(pch_cu_t *cu, proto_packet_t p) {
+        uint16_t n = proto_get_count(p);
+        if (n < 2 || n > PROTO_BATCH_MAX_PACKETS)
+                panic("invalid Batch count from CSS");
+
+        PCH_CUS_TRACE_COND(PCH_TRC_RT_CUS_RX_BATCH,
+                pch_cu_is_traced_general(cu),
+                ((struct pch_trdata_id_byte){
+                        .id = cu->cuaddr,
+                        .byte = (uint8_t)n
+                }));
+
+        assert(cu->rx_active == -1);
+        cu->rx_batch_count = (uint8_t)n;
+        dmachan_start_dst_data(&cu->channel.rx, (uint32_t)cu->rx_batch,
+                n * sizeof(proto_packet_t));
+}
+
+static void __not_in_flash_func(cus_schedule_rx_callback)(pch_devib_t *devib) {
+        if (pch_devib_is_tx_busy(devib)) {
+                // defer callback until tx completion
+                pch_devib_set_callback_pending(devib, true);
+        } else {
+                pch_devib_schedule_callback(devib);
+        }
+}
+
+// cus_handle_rx_chop_count handles a Count packet, which the CSS
+// only sends in a Batch immediately before a Start for the same
+// device, by noting the exact count that the Start uses in place of
+// the bsize-encoded one in its payload.
+static void __not_in_flash_func(cus_handle_rx_chop_count)(pch_cu_t *cu, proto_packet_t p, proto_packet_t next) {
+        if (proto_chop_cmd(next.chop) != PROTO_CHOP_START
+                || next.unit_addr != p.unit_addr)
+                panic("Count from CSS not followed by its Start");
+
+        pch_devib_t *devib = pch_get_devib(cu, p.unit_addr);
+	trace_dev_packet(PCH_TRC_RT_CUS_RX_COMMAND_COMPLETE, devib, p, 0);
+        assert(cu->rx_start_count == -1);
+        cu->rx_start_count = (int32_t)proto_get_count(p);
+}
+
+// cus_handle_rx_batch_complete handles each packet received from a
+// Batch in turn. The CSS only sends a packet followed by data as the
+// final one in a Batch and never sends two packets for the same
+// device in one Batch other than a Count and the Start it precedes.
+static void __not_in_flash_func(cus_handle_rx_batch_complete)(pch_cu_t *cu) {
+        uint n = cu->rx_batch_count;
+        cu->rx_batch_count = 0;
+
+        for (uint i = 0; i < n; i++) {
+                proto_packet_t p = cu->rx_batch[i];
+                if (proto_chop_cmd(p.chop) == PROTO_CHOP_COUNT) {
+                        if (i == n - 1)
+                                panic("Count from CSS not followed by its Start");
+
+                        cus_handle_rx_chop_count(cu, p, cu->rx_batch[i + 1]);
+                        continue;
+                }
+
+                pch_devib_t *devib = cus_handle_rx_packet(cu, p, 0);
+                if (cu->rx_active >= 0) {
+                        // receiving data following the final packet
+                        assert(i == n - 1);
+                        return;
+                }
+
+                cus_schedule_rx_callback(devib);
+        }
+
+        dmachan_start_dst_cmdbuf(&cu->channel.rx);
+}
+
 static void __not_in_flash_func(cus_handle_rx_data_complete)(pch_cu_t *cu, pch_devib_t *devib) {
 	cu->rx_active = -1;
         dmachan_start_dst_cmdbuf(&cu->channel.rx);
@@ -133,17 +229,24 @@ void __time_critical_func(pch_cus_handle_rx_complete)(pch_cu_t *cu) {
 	if (rx_active >= 0) {
                 devib = pch_get_devib(cu, (pch_unit_addr_t)rx_active);
 		cus_handle_rx_data_complete(cu, devib);
-	} else {
-		devib = cus_handle_rx_command_complete(cu);
-	}
+	} else if (cu->rx_batch_count) {
+                cus_handle_rx_batch_complete(cu);
+                return;
+        } else {
+                // DMA has received a command packet from CSS into RxBuf
+                dmachan_link_t *rxl = &cu->channel.rx.link;
+                proto_packet_t p = get_rx_packet(rxl);
+                if (proto_chop_cmd(p.chop) == PROTO_CHOP_BATCH) {
+                        cus_handle_rx_chop_batch(cu, p);
+                        return;
+                }
+
+                devib = cus_handle_rx_packet(cu, p, dmachan_link_seqnum(rxl));
+                if (cu->rx_active >= 0)
+                        return; // receiving data following Data or Start
 
-        if (cu->rx_active >= 0)
-                return; // receiving data following Data or Start
+                dmachan_start_dst_cmdbuf(&cu->channel.rx);
+	}
 
-        if (pch_devib_is_tx_busy(devib)) {
-                // defer callback until tx completion
-                pch_devib_set_callback_pending(devib, true);
-        } else {
-                pch_devib_schedule_callback(devib);
-        }
+        cus_schedule_rx_callback(devib);
 }
@@ -28,8 +28,15 @@ static void make_update_status(pch_devib_t *devib) {
 	}
 }
 
-static void make_data_command(pch_devib_t *devib) {
+// make_data_command returns the packet for the prepared Data command
+// in devib. If it is for no more than PROTO_DATA_INLINE_MAX bytes of
+// real data, the packet is a DataInline carrying the data itself.
+// Otherwise, unless the Skip flag is set, it arranges for the
+// TxPending state machine to send the data after the packet. The
+// count is deducted from devib->size.
+static proto_packet_t make_data_command(pch_devib_t *devib) {
         pch_cu_t *cu = pch_dev_get_cu(devib);
+        pch_unit_addr_t ua = pch_dev_get_ua(devib);
         uint16_t count = proto_parse_count_payload(devib->payload);
 
         assert(!(devib->flags & PCH_DEVIB_FLAG_CMD_WRITE));
@@ -43,6 +50,10 @@ static void make_data_command(pch_devib_t *devib) {
                 && !proto_chop_has_end(op);
         pch_devib_set_callback_pending(devib, callback_pending);
 
+        // What remains of the CSS-advertised room is what the device
+        // can send next without waiting for a Room update
+        devib->size -= count;
+
         // If the End flag is set then the data we're sending has an
         // implicit following UpdateStatus with a plain
         // ChannelEnd|DeviceEnd so unset the Started flag as though
@@ -50,8 +61,50 @@ static void make_data_command(pch_devib_t *devib) {
 	if (proto_chop_has_end(op))
                 devib->flags &= ~PCH_DEVIB_FLAG_STARTED;
 
+	if (!proto_chop_has_skip(op)) {
+                if (count <= PROTO_DATA_INLINE_MAX) {
+                        return proto_make_data_inline_packet(
+                                proto_chop_flags(op), ua,
+                                (const uint8_t *)devib->addr, count);
+                }
+
+                pch_txsm_set_pending(&cu->tx_pending, devib->addr, count);
+        }
+
+        return proto_make_packet(op, ua, devib->payload);
+}
+
+// make_data_status verifies the prepared DataStatus in devib and
+// returns its packet. The device status it carries ends the CCW (or
+// the whole channel program if it includes DeviceEnd) just as a
+// following UpdateStatus would so it is handled as one here. Unless
+// the Skip flag is set, it arranges for the TxPending state machine
+// to send the data after the packet. As for a Data command, the
+// count is deducted from devib->size.
+static proto_packet_t make_data_status(pch_devib_t *devib) {
+        pch_cu_t *cu = pch_dev_get_cu(devib);
+        pch_unit_addr_t ua = pch_dev_get_ua(devib);
+        proto_payload_t p = devib->payload;
+        uint8_t devs = proto_parse_devstatus_payload_devs(p);
+        uint16_t count = pch_bsize_decode(
+                proto_parse_devstatus_payload_esize(p));
+
+        assert(!(devib->flags & PCH_DEVIB_FLAG_CMD_WRITE));
+        assert(devib->flags & PCH_DEVIB_FLAG_STARTED);
+        assert(devs & PCH_DEVS_CHANNEL_END);
+        assert(count > 0 && count <= devib->size);
+        assert(!pch_txsm_busy(&cu->tx_pending));
+
+        pch_devib_set_callback_pending(devib, false);
+        devib->size -= count;
+	if (devs & PCH_DEVS_DEVICE_END)
+                devib->flags &= ~PCH_DEVIB_FLAG_STARTED;
+
+	proto_chop_t op = devib->op;
 	if (!proto_chop_has_skip(op))
                 pch_txsm_set_pending(&cu->tx_pending, devib->addr, count);
+
+        return proto_make_packet(op, ua, p);
 }
 
 static void make_request_read(pch_devib_t *devib) {
@@ -68,8 +121,10 @@ static proto_packet_t pch_cus_make_packet(pch_devib_t *devib) {
                 break;
 
 	case PROTO_CHOP_DATA:
-		make_data_command(devib);
-                break;
+		return make_data_command(devib);
+
+	case PROTO_CHOP_DATA_STATUS:
+		return make_data_status(devib);
 
 	case PROTO_CHOP_REQUEST_READ:
 		make_request_read(devib);
@@ -84,6 +139,20 @@ static proto_packet_t pch_cus_make_packet(pch_devib_t *devib) {
         return proto_make_packet(op, ua, devib->payload);
 }
 
+// cus_handle_tx_devib_complete pops the devib at the head of
+// tx_list whose packet (and any following data) has now been sent
+// and schedules its callback if one is pending.
+static void cus_handle_tx_devib_complete(pch_cu_t *cu) {
+        pch_devib_t *devib = pch_cu_pop_devib(cu, &cu->tx_list);
+        assert(devib);
+        pch_devib_set_tx_busy(devib, false);
+        if (pch_devib_is_callback_pending(devib)) {
+                pch_devib_set_callback_pending(devib, false);
+                pch_cu_push_devib(cu, &cu->cb_list, devib);
+                pch_cu_schedule_worker(cu);
+        }
+}
+
 void __time_critical_func(pch_cus_handle_tx_complete)(pch_cu_t *cu) {
 	pch_txsm_t *txpend = &cu->tx_pending;
         pch_devib_t *devib = pch_cu_head_devib(cu, &cu->tx_list);
@@ -101,16 +170,100 @@ void __time_critical_func(pch_cus_handle_tx_complete)(pch_cu_t *cu) {
         if (res == PCH_TXSM_ACTED)
                 return;
 
-        pch_cu_pop_devib(cu, &cu->tx_list);
-        pch_devib_set_tx_busy(devib, false);
-        if (callback_pending) {
-                pch_devib_set_callback_pending(devib, false);
-                pch_cu_push_devib(cu, &cu->cb_list, devib);
-                pch_cu_schedule_worker(cu);
+        // A Batch completes the devibs of all the packets it holds,
+        // which are the ones at the head of tx_list
+        uint n = cu->tx_batch_count;
+        cu->tx_batch_count = 0;
+        if (n == 0)
+                n = 1;
+
+        for (uint i = 0; i < n; i++)
+                cus_handle_tx_devib_complete(cu);
+}
+
+// cus_can_batch_devib returns whether the packet that devib is
+// waiting to send can go in a Batch. Only UpdateStatus, RequestRead
+// and a Data that will be sent as a DataInline can because no data
+// follows them in either direction.
+static inline bool cus_can_batch_devib(pch_devib_t *devib) {
+        proto_chop_t op = devib->op;
+        switch (proto_chop_cmd(op)) {
+        case PROTO_CHOP_UPDATE_STATUS:
+        case PROTO_CHOP_REQUEST_READ:
+                return true;
+
+        case PROTO_CHOP_DATA:
+                return !proto_chop_has_skip(op)
+                        && proto_parse_count_payload(devib->payload)
+                                <= PROTO_DATA_INLINE_MAX;
+
+        default:
+                return false;
         }
 }
 
+// cus_send_tx_batch gathers the packets of devibs from the head of
+// tx_list, for as long as they can be batched and up to
+// PROTO_BATCH_MAX_PACKETS of them, and sends them as a Batch. If
+// fewer than two packets can be gathered, it returns false without
+// sending anything.
+static bool __not_in_flash_func(cus_send_tx_batch)(pch_cu_t *cu) {
+        pch_unit_addr_t uas[PROTO_BATCH_MAX_PACKETS];
+        uint n = 0;
+
+        uint32_t status = devibs_lock();
+        int16_t head = cu->tx_list.head;
+        if (head != -1) {
+                pch_unit_addr_t ua = (pch_unit_addr_t)head;
+                while (n < PROTO_BATCH_MAX_PACKETS) {
+                        pch_devib_t *devib = pch_get_devib(cu, ua);
+                        if (!cus_can_batch_devib(devib))
+                                break;
+
+                        uas[n++] = ua;
+                        if (devib->next == ua)
+                                break; // end of list
+
+                        ua = devib->next;
+                }
+        }
+        devibs_unlock(status);
+
+        if (n < 2)
+                return false;
+
+        for (uint i = 0; i < n; i++) {
+                pch_devib_t *devib = pch_get_devib(cu, uas[i]);
+                pch_devib_set_tx_busy(devib, true);
+                proto_packet_t p = pch_cus_make_packet(devib);
+                trace_dev_packet(PCH_TRC_RT_CUS_SEND_TX_PACKET, devib, p, 0);
+                cu->tx_batch[i] = p;
+        }
+
+        assert(!pch_txsm_busy(&cu->tx_pending));
+        cu->tx_batch_count = (uint8_t)n;
+        pch_txsm_set_pending(&cu->tx_pending, (uint32_t)cu->tx_batch,
+                n * sizeof(proto_packet_t));
+        PCH_CUS_TRACE_COND(PCH_TRC_RT_CUS_SEND_TX_BATCH,
+                pch_cu_is_traced_general(cu),
+                ((struct pch_trdata_id_byte){
+                        .id = cu->cuaddr,
+                        .byte = (uint8_t)n
+                }));
+
+        proto_packet_t p = proto_make_count_packet(PROTO_CHOP_BATCH, 0,
+                (uint16_t)n);
+        dmachan_link_t *txl = &cu->channel.tx.link;
+        dmachan_link_cmd_set(txl,
+                dmachan_make_cmd_from_word(proto_packet_as_word(p)));
+        dmachan_start_src_cmdbuf(&cu->channel.tx);
+        return true;
+}
+
 void __no_inline_not_in_flash_func(pch_cu_send_pending_tx_command)(pch_cu_t *cu, pch_devib_t *devib) {
+        if (pch_cu_is_tx_batching(cu) && cus_send_tx_batch(cu))
+                return;
+
         pch_devib_set_tx_busy(devib, true);
         proto_packet_t p = pch_cus_make_packet(devib);
         uint32_t cmd = proto_packet_as_word(p);
@@ -14,6 +14,7 @@ void pch_hldev_reset(pch_hldev_config_t *hdcfg, pch_hldev_t *hd) {
         hd->state = PCH_HLDEV_IDLE;
         hd->flags = 0;
         hd->ccwcmd = 0;
+        hd->end_devs = 0;
 }
 
 void pch_hldev_end_ok(pch_devib_t *devib) {
@@ -110,25 +111,39 @@ void pch_hldev_receive_buffer_final(pch_devib_t *devib, void *dstaddr, uint16_t
 // most to the end of the current segment, this function repeatedly
 // calls pch_dev_send() to send as much of the requested buffer as
 // possible. The first call to pch_dev_send() is from pch_hldev_send()
-// so by the time we are called, devib->size contains the exact
-// remaining size of the segment. If we send the last chunk of data
-// this time then for SENDING state, we return to STARTED state or
-// else for SENDING_FINAL, we include the PROTO_CHOP_FLAG_END flag
-// with the pch_dev_send() so that the CSS treats it as an implicit
-// "normal" end (DEVICE_END|CHANNEL_END with no sense) and we can go
-// straight to IDLE state.
+// so by the time we are called, the CSS has answered our
+// ResponseRequired with a Room update and devib->size contains the
+// exact room in its next segment. Zero room means there are no more
+// data-chained segments, so we stop as though all data were sent.
+// If we send the last chunk of data this time then for SENDING
+// state, we return to STARTED state or else for SENDING_FINAL, we
+// include the PROTO_CHOP_FLAG_END flag with the pch_dev_send() so
+// that the CSS treats it as an implicit "normal" end
+// (DEVICE_END|CHANNEL_END with no sense) and we can go straight to
+// IDLE state. Any chunk that does not finish the data is sent with
+// PROTO_CHOP_FLAG_RESPONSE_REQUIRED to get the next Room update.
 static void do_send(pch_hldev_t *hd, pch_devib_t *devib) {
         assert(!pch_devib_is_cmd_write(devib));
+        bool final = pch_hldev_is_sending_final(hd);
+        if (devib->size == 0) {
+                hd->state = PCH_HLDEV_STARTED;
+                if (final)
+                        pch_hldev_end_ok(devib);
+                else
+                        hd->callback(devib);
+                return;
+        }
+
         void *srcaddr = hd->addr;
         uint16_t n = hd->size - hd->count;
         assert(n > 0);
 
-        bool final = pch_hldev_is_sending_final(hd);
-        bool end = false;
+        proto_chop_flags_t flags = 0;
         if (n > devib->size) {
                 n = devib->size;
+                flags = PROTO_CHOP_FLAG_RESPONSE_REQUIRED;
         } else if (final) {
-                end = true;
+                flags = PROTO_CHOP_FLAG_END;
                 hd->state = PCH_HLDEV_ENDING;
         } else {
                 hd->state = PCH_HLDEV_STARTED;
@@ -137,10 +152,7 @@ static void do_send(pch_hldev_t *hd, pch_devib_t *devib) {
         trace_hldev_counts(PCH_TRC_RT_HLDEV_SENDING, devib, n,
                 devib->size);
 
-        proto_chop_flags_t flags = 0;
-        if (end) {
-                flags = PROTO_CHOP_FLAG_END;
-        } else {
+        if (!(flags & PROTO_CHOP_FLAG_END)) {
                 hd->addr += n;
                 hd->count += n;
         }
@@ -158,30 +170,26 @@ static void start_send(pch_devib_t *devib, void *srcaddr, uint16_t size, pch_dev
                 hd->callback = callback;
 
         proto_chop_flags_t flags = 0;
-        if (final)
-                flags = PROTO_CHOP_FLAG_END;
-
         hd->size = size;
         if (size <= devib->size) {
                 // enough announced room in segment to send it all
                 // here without needing to go into SENDING state
                 if (final) {
+                        flags = PROTO_CHOP_FLAG_END;
                         pch_hldev_config_t *hdcfg = pch_hldev_get_config(devib);
                         pch_hldev_reset(hdcfg, hd); // back to IDLE
                 } else {
-                        devib->size -= size; // XXX check this is OK
                         hd->count = size;
                 }
         } else {
-                if (final) {
-                        hd->state = PCH_HLDEV_SENDING_FINAL;
-                } else {
-                        flags |= PROTO_CHOP_FLAG_RESPONSE_REQUIRED;
-                        size = devib->size;
-                        hd->count = size;
-                        hd->addr = srcaddr + size;
-                        hd->state = PCH_HLDEV_SENDING;
-                }
+                // send as much as fits in the current segment and
+                // have the CSS tell us the room in the next one
+                flags = PROTO_CHOP_FLAG_RESPONSE_REQUIRED;
+                size = devib->size;
+                hd->count = size;
+                hd->addr = srcaddr + size;
+                hd->state = final ?
+                        PCH_HLDEV_SENDING_FINAL : PCH_HLDEV_SENDING;
         }
 
         if (callback) {
@@ -196,6 +204,7 @@ static void start_send(pch_devib_t *devib, void *srcaddr, uint16_t size, pch_dev
 
         int rc = pch_dev_send(devib, srcaddr, size, flags);
         assert(rc >= 0);
+        (void)rc;
 }
 
 void pch_hldev_send_then(pch_devib_t *devib, void *srcaddr, uint16_t size, pch_devib_callback_t callback) {
@@ -206,6 +215,35 @@ void pch_hldev_send_final(pch_devib_t *devib, void *srcaddr, uint16_t size) {
         start_send(devib, srcaddr, size, NULL, true);
 }
 
+static void end_with_end_devs(pch_devib_t *devib) {
+        pch_hldev_t *hd = pch_hldev_get(devib);
+        pch_hldev_end(devib, hd->end_devs, PCH_DEV_SENSE_NONE);
+}
+
+void pch_hldev_send_final_status(pch_devib_t *devib, void *srcaddr, uint16_t size, uint8_t extra_devs) {
+        pch_hldev_t *hd = pch_hldev_get(devib);
+        assert(pch_hldev_is_started(hd));
+        assert(!pch_devib_is_cmd_write(devib));
+        assert(size);
+
+        if (size > devib->size || !pch_bsize_encodex(size).exact) {
+                // can't carry the status with the data so send it
+                // separately once all the data has been sent
+                hd->end_devs = extra_devs;
+                start_send(devib, srcaddr, size, end_with_end_devs, false);
+                return;
+        }
+
+        pch_hldev_config_t *hdcfg = pch_hldev_get_config(devib);
+        pch_hldev_reset(hdcfg, hd); // back to IDLE
+        trace_hldev_data(PCH_TRC_RT_HLDEV_SEND_FINAL, devib, srcaddr, size);
+        uint8_t devs = PCH_DEVS_CHANNEL_END | PCH_DEVS_DEVICE_END
+                | extra_devs;
+        int rc = pch_dev_send_final_status(devib, srcaddr, size, devs);
+        assert(rc >= 0);
+        (void)rc;
+}
+
 void pch_hldev_send(pch_devib_t *devib, void *srcaddr, uint16_t size) {
         pch_hldev_send_then(devib, srcaddr, size, NULL);
 }
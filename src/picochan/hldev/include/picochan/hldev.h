@@ -124,6 +124,7 @@ typedef struct pch_hldev {
         uint8_t                 state;
         uint8_t                 flags;
         uint8_t                 ccwcmd;
+        uint8_t                 end_devs; // extra_devs for send_final_status
 } pch_hldev_t;
 
 // values for pch_hldev_t flags
@@ -276,6 +277,21 @@ void pch_hldev_send_then(pch_devib_t *devib, void *srcaddr, uint16_t size, pch_d
  */
 void pch_hldev_send_final(pch_devib_t *devib, void *srcaddr, uint16_t size);
 
+/*! \brief Calls pch_hldev_send() then pch_hldev_end() with
+ *  extra_devs and no sense, in a single channel operation if possible.
+ *  \ingroup picochan_hldev
+ *
+ *  If all size bytes fit in the current CCW segment and size is a
+ *  count that bsize can encode exactly then the data and the device
+ *  status ChannelEnd|DeviceEnd|extra_devs are sent together in a
+ *  single DataStatus channel operation with pch_dev_send_final_status().
+ *  This lets a device end a Read-type CCW with, for example,
+ *  StatusModifier as cheaply as pch_hldev_send_final() ends one with
+ *  normal status. Otherwise, the data is sent as for pch_hldev_send()
+ *  and followed by a separate UpdateStatus.
+ */
+void pch_hldev_send_final_status(pch_devib_t *devib, void *srcaddr, uint16_t size, uint8_t extra_devs);
+
 /*! \brief Reads data from srcaddr and sends it the current
  *  (Read-type) CCW.
  *  \ingroup picochan_hldev
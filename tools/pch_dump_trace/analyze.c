@@ -0,0 +1,488 @@
+/*
+ * Copyright (c) 2025 Malcolm Beattie
+ * SPDX-License-Identifier: MIT
+ */
+
+// Latency and throughput analysis for pch_dump_trace -a.
+//
+// The records of a trace are paired up to measure:
+//
+//   - per subchannel, the time from CSS_SCH_START (with cc 0) until
+//     its status is taken by CSS_IO_CALLBACK or CSS_SCH_TEST with
+//     cc 0 and, for all subchannels together, the part of that from
+//     the CSS_NOTIFY making status pending (the I/O IRQ and callback
+//     or polling latency).
+//   - per device, the CU callback queueing delay from
+//     CUS_RX_COMMAND_COMPLETE until the CUS_CALL_CALLBACK for it.
+//   - per channel path and CU, the fraction of the time covered by
+//     the trace that tx was busy: from sending a packet (or batch)
+//     until the tx complete. CSS_SEND_TX_PACKET records have a SID,
+//     not a CHPID, so SIDs are mapped to CHPIDs by CSS_CHP_ALLOC
+//     records if the trace has them. Otherwise, a send is counted
+//     against the CHPID of the next tx complete.
+//   - per bufferset, the number of data bytes sent and received by
+//     the dmachan data segment records and the rate for the time
+//     covered by that bufferset's records.
+//
+// Latencies are shown as percentile tables in microseconds with a
+// log2 histogram of the start-to-status latency of all subchannels.
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "picochan/trc_records.h"
+#include "format.h"
+#include "analyze.h"
+
+#define PCH_TRC_NUM_BUFFERS 1
+#include "picochan/trc.h"
+
+#define NUM_SIDS        0x10000
+#define NUM_DEVS        0x10000
+#define NUM_CHANS       0x100
+#define NUM_SIDES       3
+#define HIST_BUCKETS    32
+
+enum { SIDE_CSS, SIDE_CUS, SIDE_OTHER };
+
+typedef struct samples {
+        uint32_t        *v;
+        size_t          n;
+        size_t          cap;
+} samples_t;
+
+typedef struct pending {
+        uint64_t        start;
+        uint64_t        notify;
+        bool            open;
+        bool            notified;
+} pending_t;
+
+typedef struct tx_busy {
+        uint64_t        start;
+        uint64_t        busy;
+        uint32_t        count;
+        bool            active;
+} tx_busy_t;
+
+typedef struct side_stats {
+        uint64_t        first_tus;
+        uint64_t        last_tus;
+        uint64_t        records;
+        uint64_t        bytes_sent;
+        uint64_t        bytes_received;
+        tx_busy_t       tx[NUM_CHANS];
+        bool            seen;
+} side_stats_t;
+
+static side_stats_t sides[NUM_SIDES];
+static samples_t *chanprog_samples[NUM_SIDS];
+static samples_t all_chanprog_samples;
+static samples_t all_pending_samples;
+static samples_t *dispatch_samples[NUM_DEVS];
+static samples_t all_dispatch_samples;
+static pending_t chanprogs[NUM_SIDS];
+static pending_t dispatches[NUM_DEVS];
+static int16_t sid_chpid[NUM_SIDS];     // -1 if not known
+static bool have_sid_chpid;
+static uint64_t unknown_tx_start;
+static bool unknown_tx_active;
+
+static const char *side_names[NUM_SIDES] = {
+        "CSS", "CU side", "other"
+};
+
+static int bs_side(uint32_t bs_magic) {
+        switch (bs_magic) {
+        case CSS_BUFFERSET_MAGIC:
+                return SIDE_CSS;
+        case CUS_BUFFERSET_MAGIC:
+                return SIDE_CUS;
+        }
+
+        return SIDE_OTHER;
+}
+
+static void add_sample(samples_t *s, uint64_t us) {
+        if (s->n == s->cap) {
+                s->cap = s->cap ? 2 * s->cap : 64;
+                s->v = realloc(s->v, s->cap * sizeof(*s->v));
+                if (!s->v) {
+                        fprintf(stderr, "malloc failed for samples\n");
+                        exit(1);
+                }
+        }
+
+        s->v[s->n++] = us > UINT32_MAX ? UINT32_MAX : (uint32_t)us;
+}
+
+static void add_indexed_sample(samples_t **table, int i, uint64_t us) {
+        if (!table[i]) {
+                table[i] = calloc(1, sizeof(samples_t));
+                if (!table[i]) {
+                        fprintf(stderr, "malloc failed for samples\n");
+                        exit(1);
+                }
+        }
+
+        add_sample(table[i], us);
+}
+
+static int dev_index(pch_cuaddr_t cuaddr, pch_unit_addr_t ua) {
+        return (cuaddr << 8) | ua;
+}
+
+static void end_chanprog(pch_sid_t sid, uint64_t tus) {
+        pending_t *p = &chanprogs[sid];
+        if (!p->open)
+                return;
+
+        add_indexed_sample(chanprog_samples, sid, tus - p->start);
+        add_sample(&all_chanprog_samples, tus - p->start);
+        if (p->notified)
+                add_sample(&all_pending_samples, tus - p->notify);
+        p->open = false;
+}
+
+static void start_tx(side_stats_t *ss, int chan, uint64_t tus) {
+        tx_busy_t *tx = &ss->tx[chan];
+        if (tx->active)
+                return;
+
+        tx->start = tus;
+        tx->active = true;
+}
+
+static void start_sid_tx(side_stats_t *ss, pch_sid_t sid, uint64_t tus) {
+        if (have_sid_chpid && sid_chpid[sid] >= 0) {
+                start_tx(ss, sid_chpid[sid], tus);
+                return;
+        }
+
+        if (!unknown_tx_active) {
+                unknown_tx_start = tus;
+                unknown_tx_active = true;
+        }
+}
+
+static void end_tx(side_stats_t *ss, int chan, uint64_t tus) {
+        tx_busy_t *tx = &ss->tx[chan];
+        if (!tx->active && ss == &sides[SIDE_CSS] && unknown_tx_active) {
+                tx->start = unknown_tx_start;
+                tx->active = true;
+        }
+        unknown_tx_active = false;
+
+        if (!tx->active)
+                return;
+
+        tx->busy += tus - tx->start;
+        tx->count++;
+        tx->active = false;
+}
+
+static void map_sids(struct pch_trdata_chp_alloc *td) {
+        if (!have_sid_chpid) {
+                memset(sid_chpid, 0xff, sizeof(sid_chpid));
+                have_sid_chpid = true;
+        }
+
+        for (uint i = 0; i < td->num_devices; i++)
+                sid_chpid[(pch_sid_t)(td->first_sid + i)] = td->chpid;
+}
+
+void analyze_record(uint32_t bs_magic, uint rt, uint64_t tus, unsigned char *data, int data_size) {
+        void *vd = data;
+        side_stats_t *ss = &sides[bs_side(bs_magic)];
+
+        if (rt == PCH_TRC_RT_TRC_TIME_SYNC)
+                return;
+
+        if (!ss->seen || tus < ss->first_tus)
+                ss->first_tus = tus;
+        if (tus > ss->last_tus)
+                ss->last_tus = tus;
+        ss->seen = true;
+        ss->records++;
+
+        switch (rt) {
+        case PCH_TRC_RT_CSS_CHP_ALLOC:
+                map_sids(vd);
+                break;
+
+        case PCH_TRC_RT_CSS_SCH_START: {
+                struct pch_trdata_word_sid_byte *td = vd;
+                if (td->byte != 0)
+                        break;
+
+                pending_t *p = &chanprogs[td->sid];
+                p->start = tus;
+                p->open = true;
+                p->notified = false;
+                break;
+        }
+
+        case PCH_TRC_RT_CSS_NOTIFY: {
+                struct pch_trdata_sid_byte *td = vd;
+                pending_t *p = &chanprogs[td->sid];
+                if (p->open && !p->notified) {
+                        p->notify = tus;
+                        p->notified = true;
+                }
+                break;
+        }
+
+        case PCH_TRC_RT_CSS_IO_CALLBACK: {
+                struct pch_trdata_intcode_scsw *td = vd;
+                if (td->intcode.cc)
+                        end_chanprog(td->intcode.sid, tus);
+                break;
+        }
+
+        case PCH_TRC_RT_CSS_SCH_TEST: {
+                struct pch_trdata_scsw_sid_cc *td = vd;
+                if (td->cc == 0)
+                        end_chanprog(td->sid, tus);
+                break;
+        }
+
+        case PCH_TRC_RT_CSS_SEND_TX_PACKET: {
+                struct pch_trdata_packet_sid *td = vd;
+                start_sid_tx(ss, td->sid, tus);
+                break;
+        }
+
+        case PCH_TRC_RT_CSS_SEND_TX_BATCH:
+        case PCH_TRC_RT_CUS_SEND_TX_BATCH: {
+                struct pch_trdata_id_byte *td = vd;
+                start_tx(ss, td->id, tus);
+                break;
+        }
+
+        case PCH_TRC_RT_CSS_TX_COMPLETE: {
+                struct pch_trdata_id_byte *td = vd;
+                end_tx(ss, td->id, tus);
+                break;
+        }
+
+        case PCH_TRC_RT_CUS_SEND_TX_PACKET: {
+                struct pch_trdata_packet_dev *td = vd;
+                start_tx(ss, td->cuaddr, tus);
+                break;
+        }
+
+        case PCH_TRC_RT_CUS_TX_COMPLETE: {
+                struct pch_trdata_cus_tx_complete *td = vd;
+                end_tx(ss, td->cuaddr, tus);
+                break;
+        }
+
+        case PCH_TRC_RT_CUS_RX_COMMAND_COMPLETE: {
+                struct pch_trdata_packet_dev *td = vd;
+                pending_t *p = &dispatches[dev_index(td->cuaddr, td->ua)];
+                p->start = tus;
+                p->open = true;
+                break;
+        }
+
+        case PCH_TRC_RT_CUS_CALL_CALLBACK: {
+                struct pch_trdata_cus_call_callback *td = vd;
+                int n = dev_index(td->cuaddr, td->ua);
+                pending_t *p = &dispatches[n];
+                if (!p->open)
+                        break;
+
+                add_indexed_sample(dispatch_samples, n, tus - p->start);
+                add_sample(&all_dispatch_samples, tus - p->start);
+                p->open = false;
+                break;
+        }
+
+        case PCH_TRC_RT_DMACHAN_SRC_DATA_REMOTE:
+        case PCH_TRC_RT_DMACHAN_SRC_DATA_MEM: {
+                struct pch_trdata_dmachan_segment *td = vd;
+                ss->bytes_sent += td->count;
+                break;
+        }
+
+        case PCH_TRC_RT_DMACHAN_DST_DATA_REMOTE:
+        case PCH_TRC_RT_DMACHAN_DST_DATA_MEM: {
+                struct pch_trdata_dmachan_segment *td = vd;
+                ss->bytes_received += td->count;
+                break;
+        }
+        }
+}
+
+static int compare_u32(const void *a, const void *b) {
+        uint32_t x = *(const uint32_t *)a;
+        uint32_t y = *(const uint32_t *)b;
+        return (x > y) - (x < y);
+}
+
+// percentile returns the sample at or below which pct percent of
+// the (sorted) samples lie.
+static uint32_t percentile(samples_t *s, int pct) {
+        size_t i = (s->n * (size_t)pct + 99) / 100;
+        return s->v[i ? i - 1 : 0];
+}
+
+static void print_percentile_header(FILE *f, const char *what) {
+        fprintf(f, "%-12s %9s %9s %9s %9s %9s %9s %9s\n", what,
+                "count", "min", "p50", "p90", "p99", "max", "mean");
+}
+
+static void print_percentile_row(FILE *f, const char *label, samples_t *s) {
+        if (!s || !s->n)
+                return;
+
+        qsort(s->v, s->n, sizeof(*s->v), compare_u32);
+        uint64_t sum = 0;
+        for (size_t i = 0; i < s->n; i++)
+                sum += s->v[i];
+
+        fprintf(f, "%-12s %9zu %9u %9u %9u %9u %9u %9.1f\n", label,
+                s->n, s->v[0], percentile(s, 50), percentile(s, 90),
+                percentile(s, 99), s->v[s->n - 1],
+                (double)sum / (double)s->n);
+}
+
+// print_histogram prints a log2 histogram of s: bucket 0 counts
+// samples of 0us and bucket b counts those from 2^(b-1) to 2^b - 1.
+static void print_histogram(FILE *f, samples_t *s) {
+        size_t buckets[HIST_BUCKETS] = {0};
+        size_t most = 0;
+        int top = 0;
+
+        for (size_t i = 0; i < s->n; i++) {
+                int b = s->v[i] ? 32 - __builtin_clz(s->v[i]) : 0;
+                if (b >= HIST_BUCKETS)
+                        b = HIST_BUCKETS - 1;
+                if (++buckets[b] > most)
+                        most = buckets[b];
+                if (b > top)
+                        top = b;
+        }
+
+        for (int b = 0; b <= top; b++) {
+                uint32_t lo = b ? 1u << (b - 1) : 0;
+                uint32_t hi = b ? (1u << b) - 1 : 0;
+                int bar = (int)((buckets[b] * 50 + most - 1) / most);
+                fprintf(f, "%10u-%-10u %9zu %.*s\n", lo, hi, buckets[b],
+                        bar, "##################################################");
+        }
+}
+
+static double side_secs(side_stats_t *ss) {
+        return (double)(ss->last_tus - ss->first_tus) / 1e6;
+}
+
+static void print_sides(FILE *f) {
+        for (int i = 0; i < NUM_SIDES; i++) {
+                side_stats_t *ss = &sides[i];
+                if (!ss->seen)
+                        continue;
+
+                fprintf(f, "%s: %llu records over %.6fs\n", side_names[i],
+                        (unsigned long long)ss->records, side_secs(ss));
+        }
+}
+
+static void print_chanprogs(FILE *f) {
+        if (!all_chanprog_samples.n)
+                return;
+
+        fprintf(f, "\nStart subchannel to status taken (us)\n");
+        print_percentile_header(f, "subchannel");
+        char label[16];
+        for (int sid = 0; sid < NUM_SIDS; sid++) {
+                snprintf(label, sizeof(label), "SID:%04x", sid);
+                print_percentile_row(f, label, chanprog_samples[sid]);
+        }
+        print_percentile_row(f, "all", &all_chanprog_samples);
+
+        fprintf(f, "\nCSS notify to status taken (us)\n");
+        print_percentile_header(f, "");
+        print_percentile_row(f, "all", &all_pending_samples);
+
+        fprintf(f, "\nStart subchannel to status taken histogram (us)\n");
+        print_histogram(f, &all_chanprog_samples);
+}
+
+static void print_dispatches(FILE *f) {
+        if (!all_dispatch_samples.n)
+                return;
+
+        fprintf(f, "\nCU callback queueing: rx command complete to callback (us)\n");
+        print_percentile_header(f, "device");
+        char label[16];
+        for (int n = 0; n < NUM_DEVS; n++) {
+                snprintf(label, sizeof(label), "CU=%d UA=%d", n >> 8, n & 0xff);
+                print_percentile_row(f, label, dispatch_samples[n]);
+        }
+        print_percentile_row(f, "all", &all_dispatch_samples);
+}
+
+static void print_tx_busy(FILE *f) {
+        bool header = false;
+        for (int i = 0; i < NUM_SIDES; i++) {
+                side_stats_t *ss = &sides[i];
+                double secs = side_secs(ss);
+                for (int chan = 0; chan < NUM_CHANS; chan++) {
+                        tx_busy_t *tx = &ss->tx[chan];
+                        if (!tx->count)
+                                continue;
+
+                        if (!header) {
+                                fprintf(f, "\nTx busy\n");
+                                fprintf(f, "%-12s %9s %12s %7s\n",
+                                        "channel", "sends", "busy(s)",
+                                        "busy%");
+                                header = true;
+                        }
+
+                        char label[16];
+                        snprintf(label, sizeof(label), "%s=%d",
+                                i == SIDE_CUS ? "CU" : "CHPID", chan);
+                        double busy = (double)tx->busy / 1e6;
+                        fprintf(f, "%-12s %9u %12.6f %6.2f%%\n", label,
+                                tx->count, busy,
+                                secs > 0 ? 100 * busy / secs : 0);
+                }
+        }
+}
+
+static void print_bytes_moved(FILE *f) {
+        bool header = false;
+        for (int i = 0; i < NUM_SIDES; i++) {
+                side_stats_t *ss = &sides[i];
+                if (!ss->bytes_sent && !ss->bytes_received)
+                        continue;
+
+                if (!header) {
+                        fprintf(f, "\nData moved\n");
+                        fprintf(f, "%-12s %12s %12s %12s %12s\n", "",
+                                "sent", "sent/s", "received",
+                                "received/s");
+                        header = true;
+                }
+
+                double secs = side_secs(ss);
+                fprintf(f, "%-12s %12llu %12.0f %12llu %12.0f\n",
+                        side_names[i],
+                        (unsigned long long)ss->bytes_sent,
+                        secs > 0 ? ss->bytes_sent / secs : 0,
+                        (unsigned long long)ss->bytes_received,
+                        secs > 0 ? ss->bytes_received / secs : 0);
+        }
+}
+
+void analyze_report(FILE *f) {
+        print_sides(f);
+        print_chanprogs(f);
+        print_dispatches(f);
+        print_tx_busy(f);
+        print_bytes_moved(f);
+}
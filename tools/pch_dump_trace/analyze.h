@@ -0,0 +1,14 @@
+/*
+ * Copyright (c) 2025 Malcolm Beattie
+ * SPDX-License-Identifier: MIT
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/types.h>
+
+// Latency and throughput analysis for pch_dump_trace -a: records
+// are fed to analyze_record() and analyze_report() prints tables of
+// what they show (see analyze.c).
+
+void analyze_record(uint32_t bs_magic, uint rt, uint64_t tus, unsigned char *data, int data_size);
+void analyze_report(FILE *f);
@@ -0,0 +1,468 @@
+/*
+ * Copyright (c) 2025 Malcolm Beattie
+ * SPDX-License-Identifier: MIT
+ */
+
+// Chrome trace event JSON output for pch_dump_trace -j.
+//
+// Each bufferset is shown as a process: the CSS, the CU side or, for
+// any other bufferset magic number, one process for all of them.
+// Within a process, each trace record is an instant event on a track
+// (a "thread") for the subchannel, channel path, control unit or
+// device it is about, or on an "other" track if it is about none of
+// them. Records are paired up into spans on the same tracks:
+//
+//   - a "channel program" span on the track of a subchannel runs
+//     from CSS_SCH_START (with cc 0) until its status is taken by a
+//     CSS_IO_CALLBACK or a CSS_SCH_TEST with cc 0. Within it, an
+//     "active" span runs until the CSS_NOTIFY that makes its status
+//     pending and a "status pending" span covers the rest, which is
+//     the latency of the I/O IRQ and callback (or of polling).
+//   - a "dispatch" span on the track of a device runs from
+//     CUS_RX_COMMAND_COMPLETE until the CUS_CALL_CALLBACK for it.
+//   - an "hldev" span on the track of a device runs from HLDEV_START
+//     until HLDEV_END.
+//
+// Spans still open at the end of the trace are shown up to the last
+// record with an "unfinished" argument.
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "picochan/trc_records.h"
+#include "format.h"
+#include "chrome_trace.h"
+
+#define PCH_TRC_NUM_BUFFERS 1
+#include "picochan/trc.h"
+
+enum {
+        PID_CSS = 1,
+        PID_CUS,
+        PID_OTHER,
+        NUM_PIDS
+};
+
+// Thread ids of tracks within a process: one for records about
+// nothing more specific, one for each channel path (CSS) or control
+// unit (CU side) and one for each subchannel (CSS) or device (CU
+// side, by CU address and unit address).
+#define TID_OTHER       0
+#define TID_CHAN(id)    (1 + (id))
+#define TID_DEV(n)      (0x101 + (n))
+#define NUM_TIDS        0x10101
+
+typedef struct span {
+        uint64_t        start;
+        uint64_t        mid;
+        uint32_t        arg;
+        int             pid;
+        bool            open;
+        bool            has_mid;
+} span_t;
+
+static FILE *out;
+static bool first_event;
+static uint64_t last_tus;
+static bool track_named[NUM_PIDS][NUM_TIDS];
+static span_t chanprogs[0x10000];       // by SID
+static span_t dispatches[0x10000];      // by CU address and UA
+static span_t hldevs[0x10000];          // by CU address and UA
+
+static int bs_pid(uint32_t bs_magic) {
+        switch (bs_magic) {
+        case CSS_BUFFERSET_MAGIC:
+                return PID_CSS;
+        case CUS_BUFFERSET_MAGIC:
+                return PID_CUS;
+        }
+
+        return PID_OTHER;
+}
+
+static const char *pid_name(int pid) {
+        switch (pid) {
+        case PID_CSS:
+                return "CSS";
+        case PID_CUS:
+                return "CU side";
+        }
+
+        return "other";
+}
+
+static void begin_event(void) {
+        if (!first_event)
+                fputs(",\n", out);
+        first_event = false;
+}
+
+static void name_track(int pid, int tid) {
+        if (track_named[pid][tid])
+                return;
+
+        track_named[pid][tid] = true;
+        begin_event();
+        fprintf(out, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"",
+                pid, tid);
+        if (tid == TID_OTHER)
+                fputs("other", out);
+        else if (tid < TID_DEV(0))
+                fprintf(out, "%s=%d", pid == PID_CSS ? "CHPID" : "CU",
+                        tid - TID_CHAN(0));
+        else if (pid == PID_CSS)
+                fprintf(out, "SID:%04x", tid - TID_DEV(0));
+        else
+                fprintf(out, "CU=%d UA=%d", (tid - TID_DEV(0)) >> 8,
+                        (tid - TID_DEV(0)) & 0xff);
+        fputs("\"}}", out);
+
+        // sort devices by number after the channel tracks
+        begin_event();
+        fprintf(out, "{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"sort_index\":%d}}",
+                pid, tid, tid);
+}
+
+// Arguments of an event are written into a buffer first so that the
+// record can be decoded before knowing its track.
+static char args[256];
+static size_t args_len;
+
+static void add_arg(const char *fmt, ...) {
+        if (args_len >= sizeof(args))
+                return;
+
+        if (args_len)
+                args[args_len++] = ',';
+
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vsnprintf(args + args_len, sizeof(args) - args_len, fmt, ap);
+        va_end(ap);
+        if (n > 0)
+                args_len += (size_t)n;
+}
+
+static void add_hex_arg(const char *name, unsigned char *data, int data_size) {
+        char hex[3 * 32 + 1];
+        size_t len = 0;
+        for (int i = 0; i < data_size && i < 32; i++)
+                len += (size_t)snprintf(hex + len, sizeof(hex) - len,
+                        i ? " %02x" : "%02x", data[i]);
+        hex[len] = '\0';
+        add_arg("\"%s\":\"%s\"", name, hex);
+}
+
+static void write_instant(int pid, int tid, const char *name, uint64_t tus) {
+        name_track(pid, tid);
+        begin_event();
+        fprintf(out, "{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%llu,\"pid\":%d,\"tid\":%d,\"args\":{%.*s}}",
+                name, (unsigned long long)tus, pid, tid,
+                (int)args_len, args);
+}
+
+static void write_span(int pid, int tid, const char *name, uint64_t start, uint64_t end, const char *spanargs) {
+        name_track(pid, tid);
+        begin_event();
+        fprintf(out, "{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%llu,\"dur\":%llu,\"pid\":%d,\"tid\":%d,\"args\":{%s}}",
+                name, (unsigned long long)start,
+                (unsigned long long)(end - start), pid, tid, spanargs);
+}
+
+static void open_span(span_t *s, int pid, uint64_t tus, uint32_t arg) {
+        s->start = tus;
+        s->pid = pid;
+        s->arg = arg;
+        s->open = true;
+        s->has_mid = false;
+}
+
+static void end_chanprog(int pid, int tid, span_t *s, uint64_t tus, bool unfinished) {
+        char spanargs[64];
+        snprintf(spanargs, sizeof(spanargs), "\"ccw_addr\":\"%08x\"%s",
+                s->arg, unfinished ? ",\"unfinished\":true" : "");
+        write_span(pid, tid, "channel program", s->start, tus, spanargs);
+        if (s->has_mid) {
+                write_span(pid, tid, "active", s->start, s->mid, "");
+                write_span(pid, tid, "status pending", s->mid, tus, "");
+        } else {
+                write_span(pid, tid, "active", s->start, tus, "");
+        }
+
+        s->open = false;
+}
+
+static void end_span(int pid, int tid, const char *name, span_t *s, uint64_t tus, bool unfinished) {
+        write_span(pid, tid, name, s->start, tus,
+                unfinished ? "\"unfinished\":true" : "");
+        s->open = false;
+}
+
+static int dev_index(pch_cuaddr_t cuaddr, pch_unit_addr_t ua) {
+        return (cuaddr << 8) | ua;
+}
+
+// decode_record adds arguments for the record data, updates any
+// spans that the record starts or ends and returns the track (tid)
+// for the record.
+static int decode_record(int pid, uint rt, uint64_t tus, void *vd) {
+        switch (rt) {
+        case PCH_TRC_RT_CSS_SCH_START: {
+                struct pch_trdata_word_sid_byte *td = vd;
+                int tid = TID_DEV(td->sid);
+                add_arg("\"ccw_addr\":\"%08x\",\"cc\":%d",
+                        td->word, td->byte);
+                if (td->byte != 0)
+                        return tid;
+
+                span_t *s = &chanprogs[td->sid];
+                if (s->open)
+                        end_chanprog(pid, tid, s, tus, true);
+                open_span(s, pid, tus, td->word);
+                return tid;
+        }
+
+        case PCH_TRC_RT_CSS_SCH_RESUME:
+        case PCH_TRC_RT_CSS_SCH_CANCEL:
+        case PCH_TRC_RT_CSS_SCH_HALT:
+        case PCH_TRC_RT_CSS_SCH_STORE:
+        case PCH_TRC_RT_CSS_SCH_MODIFY: {
+                struct pch_trdata_sid_byte *td = vd;
+                add_arg("\"cc\":%d", td->byte);
+                return TID_DEV(td->sid);
+        }
+
+        case PCH_TRC_RT_CSS_SCH_TEST: {
+                struct pch_trdata_scsw_sid_cc *td = vd;
+                int tid = TID_DEV(td->sid);
+                add_arg("\"cc\":%d", td->cc);
+                if (td->cc != 0)
+                        return tid;
+
+                add_arg("\"devs\":\"%02x\",\"schs\":\"%02x\",\"count\":%d",
+                        td->scsw.devs, td->scsw.schs, td->scsw.count);
+                span_t *s = &chanprogs[td->sid];
+                if (s->open)
+                        end_chanprog(pid, tid, s, tus, false);
+                return tid;
+        }
+
+        case PCH_TRC_RT_CSS_CCW_FETCH: {
+                struct pch_trdata_ccw_addr_sid *td = vd;
+                add_arg("\"addr\":\"%08x\",\"cmd\":\"%02x\",\"flags\":\"%02x\",\"count\":%d",
+                        td->addr, td->ccw.cmd, td->ccw.flags,
+                        td->ccw.count);
+                return TID_DEV(td->sid);
+        }
+
+        case PCH_TRC_RT_CSS_SEND_TX_PACKET:
+        case PCH_TRC_RT_CSS_RX_COMMAND_COMPLETE: {
+                struct pch_trdata_packet_sid *td = vd;
+                add_arg("\"packet\":\"%08x\",\"seqnum\":%u",
+                        td->packet, td->seqnum);
+                return TID_DEV(td->sid);
+        }
+
+        case PCH_TRC_RT_CSS_RX_DATA_COMPLETE:
+                add_arg("\"devs\":\"%02x\"",
+                        ((struct pch_trdata_sid_byte *)vd)->byte);
+                return TID_DEV(((struct pch_trdata_sid_byte *)vd)->sid);
+
+        case PCH_TRC_RT_CSS_NOTIFY: {
+                struct pch_trdata_sid_byte *td = vd;
+                add_arg("\"devs\":\"%02x\"", td->byte);
+                span_t *s = &chanprogs[td->sid];
+                if (s->open && !s->has_mid) {
+                        s->mid = tus;
+                        s->has_mid = true;
+                }
+                return TID_DEV(td->sid);
+        }
+
+        case PCH_TRC_RT_CSS_IO_CALLBACK: {
+                struct pch_trdata_intcode_scsw *td = vd;
+                if (!td->intcode.cc)
+                        return TID_OTHER;
+
+                int tid = TID_DEV(td->intcode.sid);
+                add_arg("\"intparm\":\"%08x\",\"devs\":\"%02x\",\"schs\":\"%02x\",\"count\":%d",
+                        td->intcode.intparm, td->scsw.devs,
+                        td->scsw.schs, td->scsw.count);
+                span_t *s = &chanprogs[td->intcode.sid];
+                if (s->open)
+                        end_chanprog(pid, tid, s, tus, false);
+                return tid;
+        }
+
+        case PCH_TRC_RT_CSS_FUNC_IRQ: {
+                struct pch_trdata_func_irq *td = vd;
+                add_arg("\"ua\":%d,\"tx_active\":%d",
+                        td->ua_opt, td->tx_active);
+                return TID_CHAN(td->chpid);
+        }
+
+        case PCH_TRC_RT_CSS_CHP_IRQ_PROGRESS:
+        case PCH_TRC_RT_CSS_SEND_TX_BATCH:
+        case PCH_TRC_RT_CSS_TX_COMPLETE:
+        case PCH_TRC_RT_CSS_RX_BATCH:
+        case PCH_TRC_RT_CUS_SEND_TX_BATCH:
+        case PCH_TRC_RT_CUS_RX_BATCH: {
+                struct pch_trdata_id_byte *td = vd;
+                add_arg("\"byte\":%d", td->byte);
+                return TID_CHAN(td->id);
+        }
+
+        case PCH_TRC_RT_DMACHAN_DMA_IRQ: {
+                struct pch_trdata_id_irq *td = vd;
+                add_arg("\"irq_index\":%d,\"tx_state\":\"%02x\",\"rx_state\":\"%02x\"",
+                        td->irq_index, td->tx_state, td->rx_state);
+                return TID_CHAN(td->id);
+        }
+
+        case PCH_TRC_RT_CUS_RX_COMMAND_COMPLETE: {
+                struct pch_trdata_packet_dev *td = vd;
+                int n = dev_index(td->cuaddr, td->ua);
+                add_arg("\"packet\":\"%08x\",\"seqnum\":%u",
+                        td->packet, td->seqnum);
+                span_t *s = &dispatches[n];
+                if (s->open)
+                        end_span(pid, TID_DEV(n), "dispatch", s, tus, true);
+                open_span(s, pid, tus, 0);
+                return TID_DEV(n);
+        }
+
+        case PCH_TRC_RT_CUS_SEND_TX_PACKET: {
+                struct pch_trdata_packet_dev *td = vd;
+                add_arg("\"packet\":\"%08x\",\"seqnum\":%u",
+                        td->packet, td->seqnum);
+                return TID_DEV(dev_index(td->cuaddr, td->ua));
+        }
+
+        case PCH_TRC_RT_CUS_CALL_CALLBACK: {
+                struct pch_trdata_cus_call_callback *td = vd;
+                int n = dev_index(td->cuaddr, td->ua);
+                add_arg("\"cbindex\":%d", td->cbindex);
+                span_t *s = &dispatches[n];
+                if (s->open)
+                        end_span(pid, TID_DEV(n), "dispatch", s, tus, false);
+                return TID_DEV(n);
+        }
+
+        case PCH_TRC_RT_CUS_QUEUE_COMMAND:
+        case PCH_TRC_RT_HLDEV_DEVIB_CALLBACK: {
+                struct pch_trdata_dev_byte *td = vd;
+                add_arg("\"byte\":%d", td->byte);
+                return TID_DEV(dev_index(td->cuaddr, td->ua));
+        }
+
+        case PCH_TRC_RT_CUS_RX_DATA_COMPLETE: {
+                struct pch_trdata_dev *td = vd;
+                return TID_DEV(dev_index(td->cuaddr, td->ua));
+        }
+
+        case PCH_TRC_RT_CUS_TX_COMPLETE: {
+                struct pch_trdata_cus_tx_complete *td = vd;
+                add_arg("\"tx_head\":%d,\"txpstate\":%d,\"cbpending\":%d",
+                        td->tx_head, td->txpstate, td->cbpending);
+                return TID_CHAN(td->cuaddr);
+        }
+
+        case PCH_TRC_RT_HLDEV_START: {
+                struct pch_trdata_hldev_start *td = vd;
+                int n = dev_index(td->cuaddr, td->ua);
+                add_arg("\"ccwcmd\":\"%02x\",\"esize\":%d",
+                        td->ccwcmd, td->esize);
+                span_t *s = &hldevs[n];
+                if (s->open)
+                        end_span(pid, TID_DEV(n), "hldev", s, tus, true);
+                open_span(s, pid, tus, 0);
+                return TID_DEV(n);
+        }
+
+        case PCH_TRC_RT_HLDEV_RECEIVING:
+        case PCH_TRC_RT_HLDEV_SENDING: {
+                struct pch_trdata_counts_dev *td = vd;
+                add_arg("\"count1\":%u,\"count2\":%u",
+                        td->count1, td->count2);
+                return TID_DEV(dev_index(td->cuaddr, td->ua));
+        }
+
+        case PCH_TRC_RT_HLDEV_RECEIVE:
+        case PCH_TRC_RT_HLDEV_SEND:
+        case PCH_TRC_RT_HLDEV_SEND_FINAL: {
+                struct pch_trdata_hldev_data *td = vd;
+                add_arg("\"addr\":\"%08x\",\"count\":%u",
+                        td->addr, td->count);
+                return TID_DEV(dev_index(td->cuaddr, td->ua));
+        }
+
+        case PCH_TRC_RT_HLDEV_RECEIVE_THEN:
+        case PCH_TRC_RT_HLDEV_SEND_THEN:
+        case PCH_TRC_RT_HLDEV_SEND_FINAL_THEN: {
+                struct pch_trdata_hldev_data_then *td = vd;
+                add_arg("\"addr\":\"%08x\",\"count\":%u",
+                        td->addr, td->count);
+                return TID_DEV(dev_index(td->cuaddr, td->ua));
+        }
+
+        case PCH_TRC_RT_HLDEV_END: {
+                struct pch_trdata_hldev_end *td = vd;
+                int n = dev_index(td->cuaddr, td->ua);
+                add_arg("\"devstat\":\"%02x\"", td->devstat);
+                span_t *s = &hldevs[n];
+                if (s->open)
+                        end_span(pid, TID_DEV(n), "hldev", s, tus, false);
+                return TID_DEV(n);
+        }
+        }
+
+        return -1;
+}
+
+void chrome_trace_begin(FILE *f) {
+        out = f;
+        first_event = true;
+        fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n", out);
+        for (int pid = PID_CSS; pid < NUM_PIDS; pid++) {
+                begin_event();
+                fprintf(out, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":0,\"args\":{\"name\":\"%s\"}}",
+                        pid, pid_name(pid));
+        }
+}
+
+void chrome_trace_record(uint32_t bs_magic, uint rt, const char *rtname, uint64_t tus, unsigned char *data, int data_size) {
+        if (rt == PCH_TRC_RT_TRC_TIME_SYNC)
+                return;
+
+        int pid = bs_pid(bs_magic);
+        if (tus > last_tus)
+                last_tus = tus;
+
+        args_len = 0;
+        int tid = decode_record(pid, rt, tus, data);
+        if (tid < 0) {
+                tid = TID_OTHER;
+                add_hex_arg("data", data, data_size);
+        }
+
+        write_instant(pid, tid, rtname, tus);
+}
+
+void chrome_trace_end(void) {
+        for (int n = 0; n < 0x10000; n++) {
+                if (chanprogs[n].open)
+                        end_chanprog(chanprogs[n].pid, TID_DEV(n), &chanprogs[n],
+                                last_tus, true);
+                if (dispatches[n].open)
+                        end_span(dispatches[n].pid, TID_DEV(n), "dispatch",
+                                &dispatches[n], last_tus, true);
+                if (hldevs[n].open)
+                        end_span(hldevs[n].pid, TID_DEV(n), "hldev",
+                                &hldevs[n], last_tus, true);
+        }
+
+        fputs("\n]}\n", out);
+}
@@ -0,0 +1,17 @@
+/*
+ * Copyright (c) 2025 Malcolm Beattie
+ * SPDX-License-Identifier: MIT
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/types.h>
+
+// Chrome trace event JSON output, as loaded by Perfetto
+// (ui.perfetto.dev) or chrome://tracing. Each trace record becomes an
+// instant event on a track for its subchannel, channel, control unit
+// or device and channel programs are shown as spans (see
+// chrome_trace.c).
+
+void chrome_trace_begin(FILE *f);
+void chrome_trace_record(uint32_t bs_magic, uint rt, const char *rtname, uint64_t tus, unsigned char *data, int data_size);
+void chrome_trace_end(void);
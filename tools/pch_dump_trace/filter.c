@@ -0,0 +1,304 @@
+/*
+ * Copyright (c) 2025 Malcolm Beattie
+ * SPDX-License-Identifier: MIT
+ */
+
+// Record filters for pch_dump_trace:
+//
+//   -t [from]:[to]     seconds since boot, either end optional
+//   -T type[,type...]  record type names (without PCH_TRC_RT_), a
+//                      prefix ending in '*' such as CSS_* or numbers
+//   -S sid[,sid...]    subchannels, in hex as shown by SID:nnnn
+//   -C cu[:ua][,...]   control units or single devices, in decimal
+//
+// When both -S and -C are given, a record about any of the
+// subchannels or devices is shown. Which subchannel or device a
+// record is about comes from its trace record data, as decoded by
+// record_sid() and record_cu().
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "picochan/trc_records.h"
+#include "filter.h"
+
+#define PCH_TRC_NUM_BUFFERS 1
+#include "picochan/trc.h"
+
+trace_filter_t filter;
+
+void filter_init(void) {
+        memset(&filter, 0, sizeof(filter));
+        filter.to_us = UINT64_MAX;
+}
+
+static bool parse_secs(const char *s, const char *end, uint64_t *us) {
+        if (s == end)
+                return true; // open-ended: leave as it is
+
+        char *e;
+        double secs = strtod(s, &e);
+        if (e != end || secs < 0)
+                return false;
+
+        *us = (uint64_t)(secs * 1e6 + 0.5);
+        return true;
+}
+
+bool parse_time_filter(const char *arg) {
+        const char *colon = strchr(arg, ':');
+        if (!colon)
+                return false;
+
+        return parse_secs(arg, colon, &filter.from_us)
+                && parse_secs(colon + 1, colon + strlen(colon), &filter.to_us);
+}
+
+bool parse_type_filter(const char *arg, const char **rtnames, uint num_rtnames) {
+        char *copy = strdup(arg);
+        bool ok = true;
+
+        for (char *tok = strtok(copy, ","); tok && ok; tok = strtok(NULL, ",")) {
+                char *e;
+                unsigned long n = strtoul(tok, &e, 0);
+                if (*tok && !*e) {
+                        ok = n < FILTER_NUM_RT;
+                        if (ok)
+                                set_filter_bit(filter.types, n);
+                        continue;
+                }
+
+                size_t len = strlen(tok);
+                bool prefix = len && tok[len - 1] == '*';
+                if (prefix)
+                        len--;
+
+                bool found = false;
+                for (uint rt = 0; rt < num_rtnames; rt++) {
+                        if (prefix ? strncmp(rtnames[rt], tok, len)
+                                : strcmp(rtnames[rt], tok))
+                                continue;
+
+                        set_filter_bit(filter.types, rt);
+                        found = true;
+                }
+                ok = found;
+        }
+
+        free(copy);
+        filter.have_types = true;
+        return ok;
+}
+
+bool parse_sid_filter(const char *arg) {
+        char *copy = strdup(arg);
+        bool ok = true;
+
+        for (char *tok = strtok(copy, ","); tok && ok; tok = strtok(NULL, ",")) {
+                char *e;
+                unsigned long sid = strtoul(tok, &e, 16);
+                ok = !*e && sid < 0x10000;
+                if (ok) {
+                        set_filter_bit(filter.sids, sid);
+                        filter.sid_mask |= 1ull << (sid % 64);
+                }
+        }
+
+        free(copy);
+        filter.have_ids = true;
+        return ok;
+}
+
+bool parse_cu_filter(const char *arg) {
+        char *copy = strdup(arg);
+        bool ok = true;
+
+        for (char *tok = strtok(copy, ","); tok && ok; tok = strtok(NULL, ",")) {
+                char *e;
+                unsigned long cu = strtoul(tok, &e, 10);
+                ok = e != tok && cu < 0x100;
+                if (!ok)
+                        break;
+
+                filter.cu_mask |= 1ull << (cu % 64);
+                if (!*e) {
+                        set_filter_bit(filter.cus, cu);
+                        continue;
+                }
+
+                const char *uastr = e + 1;
+                unsigned long ua = strtoul(uastr, &e, 10);
+                ok = *uastr && !*e && ua < 0x100;
+                if (ok)
+                        set_filter_bit(filter.devs, (cu << 8) | ua);
+        }
+
+        free(copy);
+        filter.have_ids = true;
+        return ok;
+}
+
+// record_sid sets *sid to the subchannel that a record of type rt
+// with data vd is about, if there is one.
+bool record_sid(uint rt, void *vd, pch_sid_t *sid) {
+        switch (rt) {
+        case PCH_TRC_RT_CSS_SCH_START:
+                *sid = ((struct pch_trdata_word_sid_byte *)vd)->sid;
+                return true;
+
+        case PCH_TRC_RT_CSS_SCH_RESUME:
+        case PCH_TRC_RT_CSS_SCH_CANCEL:
+        case PCH_TRC_RT_CSS_SCH_HALT:
+        case PCH_TRC_RT_CSS_SCH_STORE:
+        case PCH_TRC_RT_CSS_SCH_MODIFY:
+        case PCH_TRC_RT_CSS_RX_DATA_COMPLETE:
+        case PCH_TRC_RT_CSS_NOTIFY:
+                *sid = ((struct pch_trdata_sid_byte *)vd)->sid;
+                return true;
+
+        case PCH_TRC_RT_CSS_SCH_TEST:
+                *sid = ((struct pch_trdata_scsw_sid_cc *)vd)->sid;
+                return true;
+
+        case PCH_TRC_RT_CSS_CCW_FETCH:
+                *sid = ((struct pch_trdata_ccw_addr_sid *)vd)->sid;
+                return true;
+
+        case PCH_TRC_RT_CSS_SEND_TX_PACKET:
+        case PCH_TRC_RT_CSS_RX_COMMAND_COMPLETE:
+                *sid = ((struct pch_trdata_packet_sid *)vd)->sid;
+                return true;
+
+        case PCH_TRC_RT_CSS_IO_CALLBACK: {
+                struct pch_trdata_intcode_scsw *td = vd;
+                *sid = td->intcode.sid;
+                return td->intcode.cc != 0;
+        }
+        }
+
+        return false;
+}
+
+// record_cu sets *cuaddr to the CU that a record of type rt with data
+// vd is about, if there is one, and *ua to the unit address of the
+// device or -1 if it is about the CU as a whole.
+bool record_cu(uint rt, void *vd, pch_cuaddr_t *cuaddr, int *ua) {
+        switch (rt) {
+        case PCH_TRC_RT_CUS_RX_COMMAND_COMPLETE:
+        case PCH_TRC_RT_CUS_SEND_TX_PACKET: {
+                struct pch_trdata_packet_dev *td = vd;
+                *cuaddr = td->cuaddr;
+                *ua = td->ua;
+                return true;
+        }
+
+        case PCH_TRC_RT_CUS_CALL_CALLBACK: {
+                struct pch_trdata_cus_call_callback *td = vd;
+                *cuaddr = td->cuaddr;
+                *ua = td->ua;
+                return true;
+        }
+
+        case PCH_TRC_RT_CUS_QUEUE_COMMAND:
+        case PCH_TRC_RT_HLDEV_DEVIB_CALLBACK: {
+                struct pch_trdata_dev_byte *td = vd;
+                *cuaddr = td->cuaddr;
+                *ua = td->ua;
+                return true;
+        }
+
+        case PCH_TRC_RT_CUS_RX_DATA_COMPLETE: {
+                struct pch_trdata_dev *td = vd;
+                *cuaddr = td->cuaddr;
+                *ua = td->ua;
+                return true;
+        }
+
+        case PCH_TRC_RT_HLDEV_START: {
+                struct pch_trdata_hldev_start *td = vd;
+                *cuaddr = td->cuaddr;
+                *ua = td->ua;
+                return true;
+        }
+
+        case PCH_TRC_RT_HLDEV_RECEIVING:
+        case PCH_TRC_RT_HLDEV_SENDING: {
+                struct pch_trdata_counts_dev *td = vd;
+                *cuaddr = td->cuaddr;
+                *ua = td->ua;
+                return true;
+        }
+
+        case PCH_TRC_RT_HLDEV_RECEIVE:
+        case PCH_TRC_RT_HLDEV_SEND:
+        case PCH_TRC_RT_HLDEV_SEND_FINAL: {
+                struct pch_trdata_hldev_data *td = vd;
+                *cuaddr = td->cuaddr;
+                *ua = td->ua;
+                return true;
+        }
+
+        case PCH_TRC_RT_HLDEV_RECEIVE_THEN:
+        case PCH_TRC_RT_HLDEV_SEND_THEN:
+        case PCH_TRC_RT_HLDEV_SEND_FINAL_THEN: {
+                struct pch_trdata_hldev_data_then *td = vd;
+                *cuaddr = td->cuaddr;
+                *ua = td->ua;
+                return true;
+        }
+
+        case PCH_TRC_RT_HLDEV_END: {
+                struct pch_trdata_hldev_end *td = vd;
+                *cuaddr = td->cuaddr;
+                *ua = td->ua;
+                return true;
+        }
+
+        case PCH_TRC_RT_CUS_TX_COMPLETE:
+                *cuaddr = ((struct pch_trdata_cus_tx_complete *)vd)->cuaddr;
+                *ua = -1;
+                return true;
+
+        case PCH_TRC_RT_CUS_SEND_TX_BATCH:
+        case PCH_TRC_RT_CUS_RX_BATCH:
+                *cuaddr = ((struct pch_trdata_id_byte *)vd)->id;
+                *ua = -1;
+                return true;
+        }
+
+        return false;
+}
+
+static bool filter_ids(uint rt, void *vd) {
+        pch_sid_t sid;
+        if (record_sid(rt, vd, &sid))
+                return filter_bit(filter.sids, sid);
+
+        pch_cuaddr_t cuaddr;
+        int ua;
+        if (record_cu(rt, vd, &cuaddr, &ua)) {
+                if (filter_bit(filter.cus, cuaddr))
+                        return true;
+
+                return ua >= 0 && filter_bit(filter.devs, (cuaddr << 8) | ua);
+        }
+
+        return false;
+}
+
+// filter_record returns true if a record of type rt at time tus with
+// data vd is to be shown.
+bool filter_record(uint rt, uint64_t tus, void *vd) {
+        if (tus < filter.from_us || tus > filter.to_us)
+                return false;
+
+        if (filter.have_types && !filter_bit(filter.types, rt))
+                return false;
+
+        if (filter.have_ids && !filter_ids(rt, vd))
+                return false;
+
+        return true;
+}
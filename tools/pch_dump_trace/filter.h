@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2025 Malcolm Beattie
+ * SPDX-License-Identifier: MIT
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/types.h>
+#include "picochan/ids.h"
+
+// Filters selecting which trace records pch_dump_trace shows (see
+// filter.c). A record is shown if it is in the time range, is of
+// one of the record types (if any are given) and is about one of the
+// subchannels or devices (if any are given).
+
+#define FILTER_NUM_RT   256
+
+typedef struct trace_filter {
+        uint64_t        from_us;
+        uint64_t        to_us;
+        bool            have_types;
+        bool            have_ids;
+        uint8_t         types[FILTER_NUM_RT / 8];
+        uint8_t         sids[0x10000 / 8];
+        uint8_t         cus[0x100 / 8];         // every UA of the CU
+        uint8_t         devs[0x10000 / 8];      // by CU address and UA
+        // summaries for matching trace_index_entry_t
+        uint64_t        sid_mask;
+        uint64_t        cu_mask;
+} trace_filter_t;
+
+extern trace_filter_t filter;
+
+void filter_init(void);
+bool parse_time_filter(const char *arg);
+bool parse_type_filter(const char *arg, const char **rtnames, uint num_rtnames);
+bool parse_sid_filter(const char *arg);
+bool parse_cu_filter(const char *arg);
+
+bool record_sid(uint rt, void *vd, pch_sid_t *sid);
+bool record_cu(uint rt, void *vd, pch_cuaddr_t *cuaddr, int *ua);
+
+bool filter_record(uint rt, uint64_t tus, void *vd);
+
+static inline bool filter_bit(const uint8_t *bits, uint n) {
+        return bits[n / 8] & (1u << (n % 8));
+}
+
+static inline void set_filter_bit(uint8_t *bits, uint n) {
+        bits[n / 8] |= (uint8_t)(1u << (n % 8));
+}
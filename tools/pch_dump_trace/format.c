@@ -120,6 +120,9 @@ void print_mem_dst_state(dmachan_mem_dst_state_t dststate) {
         case DMACHAN_MEM_DST_SRC_ZEROES:
                 printf("src_zeroes");
                 break;
+        case DMACHAN_MEM_DST_DATA_DMA:
+                printf("data_dma");
+                break;
         default:
                 printf("unknown:%02x", dststate);
                 break;
@@ -216,6 +219,36 @@ void print_packet(uint32_t raw, uint16_t seqnum, bool from_css) {
                 printf(" ua=%d count=%u", p.unit_addr,
                         proto_get_count(p));
                 break;
+        case PROTO_CHOP_DATA_INLINE:
+                printf("DataInline");
+                if (flags & PROTO_CHOP_FLAG_END)
+                        printf("|End");
+                flags &= ~(PROTO_CHOP_FLAG_END|PROTO_CHOP_FLAG_INLINE_TWO);
+                if (from_css) {
+                        if (flags & PROTO_CHOP_FLAG_STOP)
+                                printf("|Stop");
+                        flags &= ~PROTO_CHOP_FLAG_STOP;
+                } else {
+                        if (flags & PROTO_CHOP_FLAG_RESPONSE_REQUIRED)
+                                printf("|ResponseRequired");
+                        flags &= ~PROTO_CHOP_FLAG_RESPONSE_REQUIRED;
+                }
+                if (flags)
+                        printf("|UnknownFlags:%02x", flags);
+                printf(" ua=%d data:%02x", p.unit_addr, p.p0);
+                if (proto_chop_has_inline_two(p.chop))
+                        printf("%02x", p.p1);
+                break;
+        case PROTO_CHOP_DATA_STATUS:
+                printf("DataStatus");
+                if (flags & PROTO_CHOP_FLAG_SKIP)
+                        printf("|Skip");
+                flags &= ~PROTO_CHOP_FLAG_SKIP;
+                if (flags)
+                        printf("|UnknownFlags:%02x", flags);
+                printf(" ua=%d devs:%02x count=", p.unit_addr, p.p0);
+                print_bsize(p.p1);
+                break;
         case PROTO_CHOP_UPDATE_STATUS:
                 printf("UpdateStatus ua=%d devs:%02x advertise=",
                         p.unit_addr, p.p0);
@@ -228,6 +261,13 @@ void print_packet(uint32_t raw, uint16_t seqnum, bool from_css) {
         case PROTO_CHOP_HALT:
                 printf("Halt ua=%d", p.unit_addr);
                 break;
+        case PROTO_CHOP_BATCH:
+                printf("Batch count=%u", proto_get_count(p));
+                break;
+        case PROTO_CHOP_COUNT:
+                printf("Count ua=%d count=%u", p.unit_addr,
+                        proto_get_count(p));
+                break;
         default:
                 printf("Unknown(chop_cmd=%d flags:%02x ua=%d p0:%02x p1:%02x)",
                         cmd, flags, p.unit_addr, p.p0, p.p1);
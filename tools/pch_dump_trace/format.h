@@ -12,6 +12,11 @@
 #include "picochan/trc_records.h"
 #include "packet.h"
 
+// Bufferset magic numbers as PCH_CSS_BUFFERSET_MAGIC and
+// PCH_CUS_BUFFERSET_MAGIC, whose headers need the Pico SDK.
+#define CSS_BUFFERSET_MAGIC 0x70437353
+#define CUS_BUFFERSET_MAGIC 0x70437553
+
 void print_sid(pch_sid_t sid);
 void print_cc(uint8_t cc);
 void print_cua_ua(pch_cuaddr_t cua, pch_unit_addr_t ua);
@@ -12,25 +12,28 @@
 // fields and timestamps to do it properly.
 
 // Compile with:
-//   cc -I .. -Wall -o pch_dump_trace pch_dump_trace.c
+//   make PICOCHAN_PATH=path/to/src/picochan
 
 #include <stddef.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 #include "picochan/trc_records.h"
 #include "picochan/txsm_state.h"
 #include "format.h"
+#include "chrome_trace.h"
+#include "analyze.h"
+#include "filter.h"
 
-#define MAX_NUM_BUFFERS 64
-
-#define PCH_TRC_NUM_BUFFERS MAX_NUM_BUFFERS
+#define PCH_TRC_NUM_BUFFERS 1
 
 #include "picochan/trc.h"
+#include "trace_index.h"
 
 #undef PCH_TRC_RT
-#define PCH_TRC_RT(rt) # rt
+#define PCH_TRC_RT(rt, group) # rt,
 const char *rtnames[] = {
 #include "picochan/trc_record_types.h"
 };
@@ -41,6 +44,19 @@ const char *rtnames[] = {
 
 bool raw = false;
 
+typedef enum output_mode {
+        OUTPUT_TEXT,
+        OUTPUT_JSON,    // -j
+        OUTPUT_ANALYZE  // -a
+} output_mode_t;
+
+output_mode_t output_mode = OUTPUT_TEXT;
+
+// msgout is where messages about the bufferset or stream go: stdout
+// along with the records or, for -j and -a, stderr to keep them
+// apart from the JSON or the analysis.
+FILE *msgout;
+
 static const char *pick_side(uint rt, uint cssrt) {
         return (rt == cssrt) ? "CSS" : "CU-side";
 }
@@ -274,6 +290,12 @@ static void print_css_send_tx_packet(uint rt, void *vd) {
         print_packet(td->packet, td->seqnum, true);
 }
 
+static void print_css_send_tx_batch(uint rt, void *vd) {
+        struct pch_trdata_id_byte *td = vd;
+        printf("CHPID=%d sends Batch of the previous %d packets",
+                td->id, td->byte);
+}
+
 static void print_css_tx_complete(uint rt, void *vd) {
         struct pch_trdata_id_byte *td = vd;
         printf("CHPID=%d handling tx complete while txsm is ",
@@ -328,6 +350,11 @@ static void print_css_rx_data_complete(uint rt, void *vd) {
         printf(" with device status:%02x", td->byte);
 }
 
+static void print_css_rx_batch(uint rt, void *vd) {
+        struct pch_trdata_id_byte *td = vd;
+        printf("CHPID=%d receiving Batch of %d packets", td->id, td->byte);
+}
+
 static void print_css_notify(uint rt, void *vd) {
         struct pch_trdata_sid_byte *td = vd;
         printf("CSS Notify for ");
@@ -354,6 +381,12 @@ static void print_cus_send_tx_packet(uint rt, void *vd) {
         print_packet(td->packet, td->seqnum, true);
 }
 
+static void print_cus_send_tx_batch(uint rt, void *vd) {
+        struct pch_trdata_id_byte *td = vd;
+        printf("CU=%d sends Batch of the previous %d packets",
+                td->id, td->byte);
+}
+
 static void print_cus_tx_complete(uint rt, void *vd) {
         struct pch_trdata_cus_tx_complete *td = vd;
         const char *cb = td->cbpending ? "is" : "not";
@@ -375,6 +408,11 @@ static void print_cus_rx_data_complete(uint rt, void *vd) {
         printf(" rx data complete");
 }
 
+static void print_cus_rx_batch(uint rt, void *vd) {
+        struct pch_trdata_id_byte *td = vd;
+        printf("CU=%d receiving Batch of %d packets", td->id, td->byte);
+}
+
 // Values for pch_trdata_dmachan_byte for PCH_TRC_RT_DMACHAN_DST_RESET
 #define DMACHAN_RESET_PROGRESSING       0
 #define DMACHAN_RESET_COMPLETE          1
@@ -517,6 +555,12 @@ static void print_enable(uint rt, void *vd) {
         printf("trace %s", td[0] ? "enabled" : "disabled");
 }
 
+static void print_time_sync(uint rt, void *vd) {
+        struct pch_trdata_time_sync *td = vd;
+        uint64_t us = ((uint64_t)td->high << 32) | td->low;
+        printf("time sync %llu us since boot", (unsigned long long)us);
+}
+
 static void print_hldev_config_init(uint rt, void *vd) {
         struct pch_trdata_hldev_config_init *td = vd;
         printf("CU=%d UA_range=%d", td->cuaddr, td->first_ua);
@@ -654,6 +698,7 @@ trace_record_print_func_t trace_record_printer_table[NUM_RECORD_TYPES] = {
 	[PCH_TRC_RT_CUS_CU_RX_DMA_INIT] = print_cus_cu_rx_dma_init,
 	[PCH_TRC_RT_CSS_CHP_IRQ_PROGRESS] = print_css_chp_irq_progress,
 	[PCH_TRC_RT_CSS_SEND_TX_PACKET] = print_css_send_tx_packet,
+	[PCH_TRC_RT_CSS_SEND_TX_BATCH] = print_css_send_tx_batch,
 	[PCH_TRC_RT_CSS_TX_COMPLETE] = print_css_tx_complete,
 	[PCH_TRC_RT_CSS_SET_CORE_NUM] = print_css_core_num,
 	[PCH_TRC_RT_CSS_SET_IRQ_INDEX] = print_css_set_irq_index,
@@ -664,14 +709,17 @@ trace_record_print_func_t trace_record_printer_table[NUM_RECORD_TYPES] = {
 	[PCH_TRC_RT_CSS_IO_CALLBACK] = print_css_io_callback,
 	[PCH_TRC_RT_CSS_RX_COMMAND_COMPLETE] = print_css_rx_command_complete,
 	[PCH_TRC_RT_CSS_RX_DATA_COMPLETE] = print_css_rx_data_complete,
+	[PCH_TRC_RT_CSS_RX_BATCH] = print_css_rx_batch,
 	[PCH_TRC_RT_CSS_NOTIFY] = print_css_notify,
 	[PCH_TRC_RT_CUS_INIT_IRQ_HANDLER] = print_init_irq_handler,
 	[PCH_TRC_RT_CUS_REGISTER_CALLBACK] = print_cus_register_callback,
 	[PCH_TRC_RT_CUS_CALL_CALLBACK] = print_cus_call_callback,
 	[PCH_TRC_RT_CUS_SEND_TX_PACKET] = print_cus_send_tx_packet,
+	[PCH_TRC_RT_CUS_SEND_TX_BATCH] = print_cus_send_tx_batch,
 	[PCH_TRC_RT_CUS_TX_COMPLETE] = print_cus_tx_complete,
 	[PCH_TRC_RT_CUS_RX_COMMAND_COMPLETE] = print_cus_rx_command_complete,
 	[PCH_TRC_RT_CUS_RX_DATA_COMPLETE] = print_cus_rx_data_complete,
+	[PCH_TRC_RT_CUS_RX_BATCH] = print_cus_rx_batch,
 	[PCH_TRC_RT_DMACHAN_DST_RESET] = print_dmachan_dst_reset,
         [PCH_TRC_RT_DMACHAN_PIOCHAN_INIT] = print_dmachan_piochan_init,
 	[PCH_TRC_RT_DMACHAN_DST_CMDBUF_REMOTE] = print_dmachan_dst_cmdbuf_remote,
@@ -691,6 +739,7 @@ trace_record_print_func_t trace_record_printer_table[NUM_RECORD_TYPES] = {
 	[PCH_TRC_RT_DMACHAN_DMA_IRQ] = print_dma_irq,
 	[PCH_TRC_RT_DMACHAN_PIO_IRQ] = print_pio_irq,
 	[PCH_TRC_RT_TRC_ENABLE] = print_enable,
+	[PCH_TRC_RT_TRC_TIME_SYNC] = print_time_sync,
 	[PCH_TRC_RT_HLDEV_CONFIG_INIT] = print_hldev_config_init,
 	[PCH_TRC_RT_HLDEV_START] = print_hldev_start,
 	[PCH_TRC_RT_HLDEV_DEVIB_CALLBACK] = print_hldev_devib_callback,
@@ -723,151 +772,267 @@ void print_trace_record_data(uint rt, unsigned char *data, int data_size) {
                 hexdump_trace_record_data(rt, data, data_size);
 }
 
-// dump_tracebs is a crude function to dump a single trace record.
-// It returns the length of the header-plus-record-data or, if an
-// invalid record is found, a negative value.
-int dump_trace_record(unsigned char *p) {
+// dump_trace_record is a crude function to dump a single trace
+// record at offset pos of buffer bufnum of the bufferset with magic
+// number bs_magic, either as text or, for -j, as a Chrome trace event
+// or, for -a, to be analysed. Records not matching the filters are
+// skipped. It returns the length of the header-plus-record-data or,
+// if an invalid record is found, a negative value.
+int dump_trace_record(unsigned char *p, uint32_t avail, int bufnum, uint32_t pos, uint32_t bs_magic) {
         pch_trc_header_t *h = (pch_trc_header_t *)p;
         uint size = h->size;
         if (size < sizeof(pch_trc_header_t))
                 return -1;
 
-        if (size >= 32)
-                return -2; // sanity check for currently used records
+        if (size > avail)
+                return -2; // runs off the end of the buffer
+
+        if (h->rec_type == PCH_TRC_RT_TRC_TIME_SYNC)
+                set_time_sync(p);
 
-        uint64_t tus = pch_trc_timestamp_to_us(h->timestamp);
+        uint64_t tus = timestamp_to_us(h->timestamp);
         if (tus == 0)
                 return -3;
 
         uint64_t tsecs = tus / 1000000;
         int uuuuuu = tus % 1000000;
         int ss = tsecs % 60;
-        int tmins = tsecs / 60;
-        int thours = tmins / 60;
-        if (thours > 24)
-                return -4; // sanity check 24 hour limit for now
-
+        uint64_t tmins = tsecs / 60;
+        uint64_t thours = tmins / 60;
         int mm = tmins % 60;
         int data_size = h->size - sizeof(pch_trc_header_t);
-        if (data_size < 0)
-                return -5;
-        if (data_size > 32)
-                return -6; // sanity check 32-byte record data limit
 
         uint rt = h->rec_type;
-
-        printf("%d:%02d:%02d.%06d ", thours, mm, ss, uuuuuu);
         p += sizeof(pch_trc_header_t);
-        print_trace_record_data(rt, p, data_size);
+        if (!filter_record(rt, tus, p))
+                return (int)size;
+
+        const char *rtname = "USER";
+        switch (output_mode) {
+        case OUTPUT_TEXT:
+                printf("[%d:%05u] ", bufnum, pos);
+                printf("%llu:%02d:%02d.%06d ", (unsigned long long)thours,
+                        mm, ss, uuuuuu);
+                print_trace_record_data(rt, p, data_size);
+                putchar('\n');
+                break;
+
+        case OUTPUT_JSON:
+                if (rt < NUM_RECORD_TYPES)
+                        rtname = rtnames[rt];
+
+                chrome_trace_record(bs_magic, rt, rtname, tus, p, data_size);
+                break;
+
+        case OUTPUT_ANALYZE:
+                analyze_record(bs_magic, rt, tus, p, data_size);
+                break;
+        }
 
         return (int)size;
 }
 
-void dump_tracebs_buffer(int bufnum, void *buf, uint32_t buflen) {
-        if (!buf)
-                return;
-
+void dump_tracebs_buffer(int bufnum, unsigned char *buf, uint32_t buflen, uint32_t bs_magic) {
         if (buflen < sizeof(pch_trc_header_t))
                 return;
 
+        find_time_sync(buf, buflen);
         uint32_t pos = 0;
         while (pos <= buflen - sizeof(pch_trc_header_t)) {
-                unsigned char *p = (unsigned char *)buf + pos;
-                printf("[%d:%05d] ", bufnum, pos);
-                int n = dump_trace_record(p);
+                unsigned char *p = buf + pos;
+                pch_trc_header_t *h = (pch_trc_header_t *)p;
+                if (h->rec_type == PCH_TRC_RT_TRC_PAD)
+                        break; // buffer sealed: no more records
+
+                int n = dump_trace_record(p, buflen - pos, bufnum, pos,
+                        bs_magic);
                 if (n < 0) {
-                        printf("[err=%d]\n", n);
+                        fprintf(msgout, "[%d:%05u] [err=%d]\n",
+                                bufnum, pos, n);
                         break;
                 }
                 pos += n;
-                putchar('\n');
         }
 }
 
-// dump_tracebs is a crude function to dump a trace bufferset.
-void dump_tracebs(pch_trc_bufferset_t *bs) {
-        int current_buffer_num = bs->current_buffer_num;
-        int n = (current_buffer_num + 1) % bs->num_buffers;
-        while (n != current_buffer_num) {
-                dump_tracebs_buffer(n, bs->buffers[n], bs->buffer_size);
-                n = (n + 1) % bs->num_buffers;
-        }
+// dump_tracebs dumps the buffers of a bufferset input, oldest first,
+// skipping those that the index shows cannot match the filters.
+void dump_tracebs(trace_input_t *in) {
+        for (uint32_t i = 0; i < in->num_entries; i++) {
+                trace_index_entry_t *e = &in->entries[i];
+                if (!index_entry_matches(e))
+                        continue;
 
-        dump_tracebs_buffer(n, bs->buffers[n],
-                bs->current_buffer_pos);
+                restore_time_sync(e);
+                dump_tracebs_buffer(e->bufnum, entry_buffer(in, e),
+                        e->len, in->bs.magic);
+        }
 }
 
-pch_trc_bufferset_t bs;
+// report_missing_frames reports buffers of the same bufferset that
+// are missing between frames prev and frame.
+static void report_missing_frames(pch_trc_frame_t *prev, pch_trc_frame_t *frame) {
+        // generations wrap to 0 before 65536 unless the number of
+        // buffers is a power of 2
+        uint16_t expect = (uint16_t)(prev->gen + 1);
+        if (frame->dropped != prev->dropped)
+                fprintf(msgout, "[%u buffers dropped before gen %u]\n",
+                        frame->dropped - prev->dropped, frame->gen);
+        else if (frame->gen != expect && frame->gen != 0)
+                fprintf(msgout, "[buffers lost in transit before gen %u]\n",
+                        frame->gen);
+        if (frame->overrun != prev->overrun)
+                fprintf(msgout, "[buffer gen %u was overwritten while being sent]\n",
+                        prev->gen);
+}
+
+// dump_trace_stream dumps the frames of a trace stream, as sent
+// by a trace drain (see picochan/trc_drain.h), skipping those that
+// the index shows cannot match the filters. Bytes that are not part
+// of a frame are skipped until the start of the next frame is found.
+// Buffers missing from the stream (because they were dropped on the
+// Pico or lost in transit) and buffers that were overwritten while
+// being sent (overrun) are reported.
+void dump_trace_stream(trace_input_t *in) {
+        for (uint32_t i = 0; i < in->num_entries; i++) {
+                trace_index_entry_t *e = &in->entries[i];
+                if (!index_entry_matches(e))
+                        continue;
+
+                pch_trc_frame_t *frame = (pch_trc_frame_t *)
+                        (entry_buffer(in, e) - sizeof(pch_trc_frame_t));
+                if (e->skipped)
+                        fprintf(msgout, "[skipped %u bytes]\n", e->skipped);
+
+                if (e->flags & TRACE_INDEX_TRUNCATED) {
+                        fprintf(msgout, "[truncated frame gen %u]\n",
+                                frame->gen);
+                        break;
+                }
 
-int main(int argc, char **argv) {
-        if (argc > 1) {
-                if (!strcmp(argv[1], "-r")) {
-                        raw = true;
-                        argc--;
-                        argv++;
+                if (i > 0) {
+                        pch_trc_frame_t *prev = (pch_trc_frame_t *)
+                                (entry_buffer(in, e - 1)
+                                - sizeof(pch_trc_frame_t));
+                        if (prev->bs_magic == frame->bs_magic)
+                                report_missing_frames(prev, frame);
                 }
-        }
 
-        if (argc != 3) {
-                fprintf(stderr, "Usage: dump_trace [-r] bufferset_file buffers_file\n");
-                exit(1);
+                fprintf(msgout, "frame bufferset 0x%08x gen %u size %u dropped %u overrun %u\n",
+                        frame->bs_magic, frame->gen, frame->size,
+                        frame->dropped, frame->overrun);
+                restore_time_sync(e);
+                dump_tracebs_buffer(frame->gen, entry_buffer(in, e),
+                        e->len, frame->bs_magic);
         }
 
-        FILE *bsf = fopen(argv[1], "rb");
-        size_t hdrsize = offsetof(pch_trc_bufferset_t, buffers);
-        size_t nread = fread(&bs, 1, hdrsize, bsf);
-        if (nread != hdrsize) {
-                fprintf(stderr, "only read %zu instead of %zu bytes from bufferset file %s\n",
-                        nread, sizeof(bs), argv[1]);
-                exit(1);
-        }
+        if (in->trailing_skipped)
+                fprintf(msgout, "[skipped %u bytes]\n", in->trailing_skipped);
+}
 
-        printf("read bufferset file %s:\n", argv[1]);
-        printf("  magic = 0x%08x\n", bs.magic);
-        printf("  num_buffers = %d\n", bs.num_buffers);
-        printf("  buffer_size = %d\n", bs.buffer_size);
-        printf("  current_buffer_num = %d\n", bs.current_buffer_num);
-        printf("  current_buffer_pos = %d\n", bs.current_buffer_pos);
-
-        // Sanity checks
-        if (bs.buffer_size == 0) {
-                fprintf(stderr, "buffer_size is zero\n");
-                exit(1);
-        }
-        if (bs.num_buffers == 0) {
-                fprintf(stderr, "num_buffers is zero\n");
-                exit(1);
-        }
-        if (bs.buffer_size > 1024*1024) {
-                fprintf(stderr, "buffer size is unreasonably big\n");
-                exit(1);
-        }
-        if (bs.num_buffers > MAX_NUM_BUFFERS) {
-                fprintf(stderr, "number of buffers is unreasonably big\n");
-                exit(1);
+static void begin_output(void) {
+        if (output_mode == OUTPUT_JSON)
+                chrome_trace_begin(stdout);
+}
+
+static void end_output(void) {
+        switch (output_mode) {
+        case OUTPUT_TEXT:
+                break;
+
+        case OUTPUT_JSON:
+                chrome_trace_end();
+                break;
+
+        case OUTPUT_ANALYZE:
+                analyze_report(stdout);
+                break;
         }
+}
 
-        FILE *bf = fopen(argv[2], "rb");
-        if (!bf) {
-                perror(argv[2]);
-                exit(1);
+static void usage(void) {
+        fprintf(stderr, "Usage: pch_dump_trace [-r|-j|-a] [filters] bufferset_file buffers_file ...\n");
+        fprintf(stderr, "       pch_dump_trace [-r|-j|-a] [filters] -s stream_file ...\n");
+        fprintf(stderr, "filters: -t [from]:[to]  -T type[,type...]  -S sid[,sid...]  -C cu[:ua][,...]\n");
+        exit(1);
+}
+
+static void bad_filter(int opt, const char *arg) {
+        fprintf(stderr, "invalid filter -%c %s\n", opt, arg);
+        exit(1);
+}
+
+int main(int argc, char **argv) {
+        bool stream = false;
+        int opt;
+
+        filter_init();
+        while ((opt = getopt(argc, argv, "rjast:T:S:C:")) != -1) {
+                switch (opt) {
+                case 'r':
+                        raw = true;
+                        break;
+                case 'j':
+                        output_mode = OUTPUT_JSON;
+                        break;
+                case 'a':
+                        output_mode = OUTPUT_ANALYZE;
+                        break;
+                case 's':
+                        stream = true;
+                        break;
+                case 't':
+                        if (!parse_time_filter(optarg))
+                                bad_filter(opt, optarg);
+                        break;
+                case 'T':
+                        if (!parse_type_filter(optarg, rtnames,
+                                NUM_RECORD_TYPES))
+                                bad_filter(opt, optarg);
+                        break;
+                case 'S':
+                        if (!parse_sid_filter(optarg))
+                                bad_filter(opt, optarg);
+                        break;
+                case 'C':
+                        if (!parse_cu_filter(optarg))
+                                bad_filter(opt, optarg);
+                        break;
+                default:
+                        usage();
+                }
         }
-        for (int n = 0; n < bs.num_buffers; n++) {
-                unsigned char *buf = malloc(bs.buffer_size);
-                if (!buf) {
-                        fprintf(stderr, "malloc failed for buffer %d", n);
-                        exit(1);
+
+        int nfiles = argc - optind;
+        if (nfiles == 0 || (!stream && nfiles % 2))
+                usage();
+
+        msgout = output_mode == OUTPUT_TEXT ? stdout : stderr;
+        begin_output();
+        trace_input_t in;
+        if (stream) {
+                for (int i = optind; i < argc; i++) {
+                        open_stream_input(&in, argv[i]);
+                        dump_trace_stream(&in);
+                        close_input(&in);
                 }
-                size_t nread = fread(buf, 1, bs.buffer_size, bf);
-                if (nread != bs.buffer_size) {
-                        fprintf(stderr, "only read %zu instead of %u bytes for buffer %d from file %s\n",
-                                nread, bs.buffer_size, n, argv[2]);
-                        exit(1);
+        } else {
+                for (int i = optind; i < argc; i += 2) {
+                        open_bufferset_input(&in, argv[i], argv[i + 1]);
+                        fprintf(msgout, "read bufferset file %s:\n", argv[i]);
+                        fprintf(msgout, "  magic = 0x%08x\n", in.bs.magic);
+                        fprintf(msgout, "  num_buffers = %d\n", in.bs.num_buffers);
+                        fprintf(msgout, "  buffer_size = %d\n", in.bs.buffer_size);
+                        fprintf(msgout, "  cursor = gen %u pos %u\n",
+                                pch_trc_cursor_gen(in.bs.cursor),
+                                pch_trc_cursor_pos(in.bs.cursor));
+                        fprintf(msgout, "mapped %u buffers from file %s\n",
+                                in.bs.num_buffers, argv[i + 1]);
+                        dump_tracebs(&in);
+                        close_input(&in);
                 }
-                bs.buffers[n] = buf;
-                printf("read buffer %d from file %s\n", n, argv[2]);
         }
 
-        dump_tracebs(&bs);
+        end_output();
         exit(0);
 }
@@ -0,0 +1,525 @@
+/*
+ * Copyright (c) 2025 Malcolm Beattie
+ * SPDX-License-Identifier: MIT
+ */
+
+// Trace input files for pch_dump_trace are memory-mapped rather than
+// read so that captures of gigabytes of continuously drained trace
+// can be handled. Each input is described by an index with an entry
+// per trace buffer (a buffer of a bufferset or a frame of a stream)
+// giving where it is, the range of times of its records, which
+// record types, SIDs and CUs it has records for and the time sync in
+// effect at its start. Buffers that cannot match the filters given
+// (see filter.c) are skipped without looking at their records.
+//
+// Building the index means parsing every record so, for a regular
+// file, it is saved alongside the input in a file with the suffix
+// ".pdx" and used by later runs for as long as the size and
+// modification time of the input (and, for a bufferset, the
+// bufferset itself) are unchanged. If it cannot be saved, it is
+// built afresh each time.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "picochan/trc_records.h"
+#include "filter.h"
+#include "trace_index.h"
+
+#define TRACE_INDEX_MAGIC       0x78644970
+#define TRACE_INDEX_VERSION     1
+#define TRACE_INDEX_SUFFIX      ".pdx"
+
+#define BS_HEADER_SIZE offsetof(pch_trc_bufferset_t, buffers)
+
+typedef struct trace_index_header {
+        uint32_t        magic;
+        uint32_t        version;
+        uint32_t        entry_size;
+        uint32_t        num_entries;
+        uint64_t        src_size;
+        int64_t         src_mtime_sec;
+        int64_t         src_mtime_nsec;
+        uint32_t        trailing_skipped;
+        uint32_t        bs_size;
+        unsigned char   bs[32];
+} trace_index_header_t;
+
+_Static_assert(BS_HEADER_SIZE <= 32, "bufferset header fits in index");
+
+// Records written with PCH_TRC_TIMESTAMP_32 have only the low 32
+// bits of their time. The full time is reconstructed from that of
+// the nearest TRC_TIME_SYNC record: the most recent one or, for
+// records at the start of a buffer before its first one, that one.
+bool have_time_sync = false;
+uint64_t time_sync_us;
+
+void set_time_sync(unsigned char *p) {
+        struct pch_trdata_time_sync *td =
+                (struct pch_trdata_time_sync *)(p + sizeof(pch_trc_header_t));
+        time_sync_us = ((uint64_t)td->high << 32) | td->low;
+        have_time_sync = true;
+}
+
+uint64_t timestamp_to_us(pch_trc_timestamp_t t) {
+        if (!pch_trc_timestamp_is_32(t))
+                return pch_trc_timestamp_to_us(t);
+
+        uint32_t us32 = pch_trc_timestamp_to_us32(t);
+        if (!have_time_sync)
+                return us32;
+
+        int32_t delta = (int32_t)(us32 - (uint32_t)time_sync_us);
+        return time_sync_us + delta;
+}
+
+// find_time_sync sets the time sync from the first TRC_TIME_SYNC
+// record in buf, if there is one.
+void find_time_sync(unsigned char *buf, uint32_t buflen) {
+        uint32_t pos = 0;
+        while (pos + sizeof(pch_trc_header_t) <= buflen) {
+                pch_trc_header_t *h = (pch_trc_header_t *)(buf + pos);
+                if (h->rec_type == PCH_TRC_RT_TRC_PAD
+                        || h->size < sizeof(pch_trc_header_t))
+                        return;
+
+                if (h->rec_type == PCH_TRC_RT_TRC_TIME_SYNC
+                        && pos + h->size <= buflen) {
+                        set_time_sync(buf + pos);
+                        return;
+                }
+
+                pos += h->size;
+        }
+}
+
+void restore_time_sync(trace_index_entry_t *e) {
+        have_time_sync = !!(e->flags & TRACE_INDEX_SYNC_VALID);
+        time_sync_us = e->sync_us;
+}
+
+static bool filter_is_active(void) {
+        return filter.from_us != 0 || filter.to_us != UINT64_MAX
+                || filter.have_types || filter.have_ids;
+}
+
+// index_entry_matches returns false if none of the records of the
+// buffer described by e can match the filters.
+bool index_entry_matches(trace_index_entry_t *e) {
+        if (e->flags & TRACE_INDEX_TRUNCATED)
+                return true; // to report it
+
+        if (!filter_is_active())
+                return true;
+
+        if (!(e->flags & TRACE_INDEX_HAS_RECORDS))
+                return false;
+
+        if (e->last_us < filter.from_us || e->first_us > filter.to_us)
+                return false;
+
+        if (filter.have_types) {
+                bool any = false;
+                for (int i = 0; i < 8; i++) {
+                        uint32_t types = filter.types[4 * i]
+                                | (uint32_t)filter.types[4 * i + 1] << 8
+                                | (uint32_t)filter.types[4 * i + 2] << 16
+                                | (uint32_t)filter.types[4 * i + 3] << 24;
+                        if (e->rt_mask[i] & types)
+                                any = true;
+                }
+                if (!any)
+                        return false;
+        }
+
+        if (filter.have_ids && !(e->sid_mask & filter.sid_mask)
+                && !(e->cu_mask & filter.cu_mask))
+                return false;
+
+        return true;
+}
+
+static void *xmalloc(size_t size) {
+        void *p = malloc(size ? size : 1);
+        if (!p) {
+                fprintf(stderr, "malloc failed for %zu bytes\n", size);
+                exit(1);
+        }
+
+        return p;
+}
+
+static trace_index_entry_t *add_entry(trace_input_t *in, uint32_t *cap) {
+        if (in->num_entries == *cap) {
+                *cap = *cap ? 2 * *cap : 256;
+                in->entries = realloc(in->entries,
+                        *cap * sizeof(trace_index_entry_t));
+                if (!in->entries) {
+                        fprintf(stderr, "malloc failed for trace index\n");
+                        exit(1);
+                }
+        }
+
+        trace_index_entry_t *e = &in->entries[in->num_entries++];
+        memset(e, 0, sizeof(*e));
+        return e;
+}
+
+// index_buffer fills in the summary of the records in the buffer
+// described by e, following the time sync from one buffer to the
+// next as dumping the buffers in order does.
+static void index_buffer(trace_input_t *in, trace_index_entry_t *e) {
+        unsigned char *buf = entry_buffer(in, e);
+        uint32_t len = e->len;
+
+        if (have_time_sync) {
+                e->flags |= TRACE_INDEX_SYNC_VALID;
+                e->sync_us = time_sync_us;
+        }
+
+        find_time_sync(buf, len);
+        uint32_t pos = 0;
+        while (pos + sizeof(pch_trc_header_t) <= len) {
+                unsigned char *p = buf + pos;
+                pch_trc_header_t *h = (pch_trc_header_t *)p;
+                if (h->rec_type == PCH_TRC_RT_TRC_PAD
+                        || h->size < sizeof(pch_trc_header_t)
+                        || pos + h->size > len)
+                        break;
+
+                if (h->rec_type == PCH_TRC_RT_TRC_TIME_SYNC)
+                        set_time_sync(p);
+
+                uint64_t tus = timestamp_to_us(h->timestamp);
+                if (!(e->flags & TRACE_INDEX_HAS_RECORDS)
+                        || tus < e->first_us)
+                        e->first_us = tus;
+                if (tus > e->last_us)
+                        e->last_us = tus;
+                e->flags |= TRACE_INDEX_HAS_RECORDS;
+
+                uint rt = h->rec_type;
+                e->rt_mask[rt / 32] |= 1u << (rt % 32);
+
+                void *vd = p + sizeof(pch_trc_header_t);
+                pch_sid_t sid;
+                pch_cuaddr_t cuaddr;
+                int ua;
+                if (record_sid(rt, vd, &sid))
+                        e->sid_mask |= 1ull << (sid % 64);
+                else if (record_cu(rt, vd, &cuaddr, &ua))
+                        e->cu_mask |= 1ull << (cuaddr % 64);
+
+                pos += h->size;
+        }
+}
+
+static void build_stream_index(trace_input_t *in) {
+        uint32_t cap = 0;
+        uint32_t skipped = 0;
+        size_t pos = 0;
+
+        have_time_sync = false;
+        while (pos + sizeof(uint32_t) <= in->size) {
+                pch_trc_frame_t *f = (pch_trc_frame_t *)(in->data + pos);
+                if (f->magic != PCH_TRC_FRAME_MAGIC) {
+                        // slide along a byte at a time until the
+                        // magic matches
+                        pos++;
+                        skipped++;
+                        continue;
+                }
+
+                if (pos + sizeof(pch_trc_frame_t) > in->size)
+                        break;
+
+                trace_index_entry_t *e = add_entry(in, &cap);
+                e->offset = pos + sizeof(pch_trc_frame_t);
+                e->bufnum = f->gen;
+                e->skipped = skipped;
+                skipped = 0;
+                if (e->offset + f->size > in->size) {
+                        e->flags |= TRACE_INDEX_TRUNCATED;
+                        pos = in->size;
+                        break;
+                }
+
+                e->len = f->size;
+                index_buffer(in, e);
+                pos = e->offset + f->size;
+        }
+
+        in->trailing_skipped = skipped;
+}
+
+static void build_bufferset_index(trace_input_t *in) {
+        pch_trc_bufferset_t *bs = &in->bs;
+        uint32_t cap = 0;
+        int current_buffer_num = pch_trc_cursor_gen(bs->cursor)
+                % bs->num_buffers;
+
+        have_time_sync = false;
+        int n = (current_buffer_num + 1) % bs->num_buffers;
+        while (1) {
+                trace_index_entry_t *e = add_entry(in, &cap);
+                e->offset = (uint64_t)n * bs->buffer_size;
+                e->bufnum = (uint16_t)n;
+                e->len = bs->buffer_size;
+                if (n == current_buffer_num) {
+                        // the cursor position may be past the end of
+                        // the buffer while it is being switched
+                        uint32_t pos = pch_trc_cursor_pos(bs->cursor);
+                        if (pos < e->len)
+                                e->len = pos;
+                }
+
+                index_buffer(in, e);
+                if (n == current_buffer_num)
+                        break;
+
+                n = (n + 1) % bs->num_buffers;
+        }
+}
+
+static char *index_path(const char *name) {
+        char *path = xmalloc(strlen(name) + sizeof(TRACE_INDEX_SUFFIX));
+        strcpy(path, name);
+        strcat(path, TRACE_INDEX_SUFFIX);
+        return path;
+}
+
+static void make_index_header(trace_input_t *in, struct stat *st, trace_index_header_t *ih) {
+        memset(ih, 0, sizeof(*ih));
+        ih->magic = TRACE_INDEX_MAGIC;
+        ih->version = TRACE_INDEX_VERSION;
+        ih->entry_size = sizeof(trace_index_entry_t);
+        ih->num_entries = in->num_entries;
+        ih->src_size = (uint64_t)st->st_size;
+        ih->src_mtime_sec = st->st_mtim.tv_sec;
+        ih->src_mtime_nsec = st->st_mtim.tv_nsec;
+        ih->trailing_skipped = in->trailing_skipped;
+        if (!in->stream) {
+                ih->bs_size = BS_HEADER_SIZE;
+                memcpy(ih->bs, &in->bs, BS_HEADER_SIZE);
+        }
+}
+
+// load_index reads the saved index for in if it is still valid for
+// the input with status st.
+static bool load_index(trace_input_t *in, struct stat *st) {
+        char *path = index_path(in->name);
+        FILE *f = fopen(path, "rb");
+        free(path);
+        if (!f)
+                return false;
+
+        trace_index_header_t ih, expect;
+        in->num_entries = 0;
+        make_index_header(in, st, &expect);
+        if (fread(&ih, sizeof(ih), 1, f) != 1)
+                goto invalid;
+
+        expect.num_entries = ih.num_entries;
+        expect.trailing_skipped = ih.trailing_skipped;
+        if (memcmp(&ih, &expect, sizeof(ih)))
+                goto invalid;
+
+        in->entries = xmalloc((size_t)ih.num_entries
+                * sizeof(trace_index_entry_t));
+        if (fread(in->entries, sizeof(trace_index_entry_t),
+                ih.num_entries, f) != ih.num_entries) {
+                free(in->entries);
+                in->entries = NULL;
+                goto invalid;
+        }
+
+        fclose(f);
+        in->num_entries = ih.num_entries;
+        in->trailing_skipped = ih.trailing_skipped;
+        return true;
+
+invalid:
+        fclose(f);
+        return false;
+}
+
+static void save_index(trace_input_t *in, struct stat *st) {
+        char *path = index_path(in->name);
+        FILE *f = fopen(path, "wb");
+        if (!f) {
+                fprintf(stderr, "cannot save index %s: %s\n", path,
+                        strerror(errno));
+                free(path);
+                return;
+        }
+
+        trace_index_header_t ih;
+        make_index_header(in, st, &ih);
+        bool ok = fwrite(&ih, sizeof(ih), 1, f) == 1
+                && fwrite(in->entries, sizeof(trace_index_entry_t),
+                        in->num_entries, f) == in->num_entries;
+        if (fclose(f) != 0)
+                ok = false;
+        if (!ok) {
+                fprintf(stderr, "cannot save index %s\n", path);
+                unlink(path);
+        }
+
+        free(path);
+}
+
+// read_all reads all of fd, which cannot be mapped, into memory.
+static void read_all(trace_input_t *in, int fd) {
+        size_t cap = 1 << 20;
+        in->data = xmalloc(cap);
+        in->size = 0;
+        while (1) {
+                if (in->size == cap) {
+                        cap *= 2;
+                        in->data = realloc(in->data, cap);
+                        if (!in->data) {
+                                fprintf(stderr, "malloc failed for %s\n",
+                                        in->name);
+                                exit(1);
+                        }
+                }
+
+                ssize_t n = read(fd, in->data + in->size, cap - in->size);
+                if (n < 0) {
+                        if (errno == EINTR)
+                                continue;
+                        perror(in->name);
+                        exit(1);
+                }
+                if (n == 0)
+                        break;
+
+                in->size += (size_t)n;
+        }
+}
+
+// map_input maps the input file name or, if it is stdin or is not
+// a regular file, reads it into memory. It returns true if the input
+// was mapped, with its status in st.
+static bool map_input(trace_input_t *in, const char *name, struct stat *st) {
+        in->name = name;
+        int fd = 0;
+        if (strcmp(name, "-")) {
+                fd = open(name, O_RDONLY);
+                if (fd < 0) {
+                        perror(name);
+                        exit(1);
+                }
+        }
+
+        if (fstat(fd, st) < 0) {
+                perror(name);
+                exit(1);
+        }
+
+        if (fd == 0 || !S_ISREG(st->st_mode)) {
+                read_all(in, fd);
+                if (fd != 0)
+                        close(fd);
+                return false;
+        }
+
+        in->size = (size_t)st->st_size;
+        if (in->size) {
+                in->data = mmap(NULL, in->size, PROT_READ, MAP_PRIVATE,
+                        fd, 0);
+                if (in->data == MAP_FAILED) {
+                        perror(name);
+                        exit(1);
+                }
+                in->mapped = true;
+                madvise(in->data, in->size, MADV_SEQUENTIAL);
+        }
+
+        close(fd);
+        return true;
+}
+
+// index_input loads the saved index of in or builds it, saving it
+// if the input is a mapped file with status st.
+static void index_input(trace_input_t *in, bool mapped, struct stat *st) {
+        if (mapped && load_index(in, st))
+                return;
+
+        if (in->stream)
+                build_stream_index(in);
+        else
+                build_bufferset_index(in);
+
+        if (mapped)
+                save_index(in, st);
+}
+
+void open_stream_input(trace_input_t *in, const char *name) {
+        memset(in, 0, sizeof(*in));
+        in->stream = true;
+        struct stat st;
+        bool mapped = map_input(in, name, &st);
+        index_input(in, mapped, &st);
+}
+
+void open_bufferset_input(trace_input_t *in, const char *bsname, const char *bufsname) {
+        memset(in, 0, sizeof(*in));
+        FILE *bsf = fopen(bsname, "rb");
+        if (!bsf) {
+                perror(bsname);
+                exit(1);
+        }
+
+        size_t nread = fread(&in->bs, 1, BS_HEADER_SIZE, bsf);
+        fclose(bsf);
+        if (nread != BS_HEADER_SIZE) {
+                fprintf(stderr, "only read %zu instead of %zu bytes from bufferset file %s\n",
+                        nread, BS_HEADER_SIZE, bsname);
+                exit(1);
+        }
+
+        // Sanity checks
+        pch_trc_bufferset_t *bs = &in->bs;
+        if (bs->buffer_size == 0) {
+                fprintf(stderr, "buffer_size is zero\n");
+                exit(1);
+        }
+        if (bs->num_buffers == 0) {
+                fprintf(stderr, "num_buffers is zero\n");
+                exit(1);
+        }
+        if (bs->buffer_size > 1024*1024) {
+                fprintf(stderr, "buffer size is unreasonably big\n");
+                exit(1);
+        }
+
+        struct stat st;
+        bool mapped = map_input(in, bufsname, &st);
+        uint64_t need = (uint64_t)bs->num_buffers * bs->buffer_size;
+        if (in->size < need) {
+                fprintf(stderr, "only %zu instead of %llu bytes for %u buffers in file %s\n",
+                        in->size, (unsigned long long)need,
+                        bs->num_buffers, bufsname);
+                exit(1);
+        }
+
+        index_input(in, mapped, &st);
+}
+
+void close_input(trace_input_t *in) {
+        if (in->mapped)
+                munmap(in->data, in->size);
+        else
+                free(in->data);
+
+        free(in->entries);
+        memset(in, 0, sizeof(*in));
+}
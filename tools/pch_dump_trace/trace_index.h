@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2025 Malcolm Beattie
+ * SPDX-License-Identifier: MIT
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/types.h>
+
+#ifndef PCH_TRC_NUM_BUFFERS
+#define PCH_TRC_NUM_BUFFERS 1
+#endif
+#include "picochan/trc.h"
+
+// Memory-mapped trace input files and their indexes (see
+// trace_index.c).
+
+// trace_index_entry_t describes one trace buffer of an input: a
+// buffer of a bufferset or the buffer of a frame of a stream.
+typedef struct trace_index_entry {
+        // offset of the buffer in the input
+        uint64_t        offset;
+        // time of the earliest and latest records
+        uint64_t        first_us;
+        uint64_t        last_us;
+        // time sync in effect at the start of the buffer
+        uint64_t        sync_us;
+        // bit (sid % 64) set for each SID with records
+        uint64_t        sid_mask;
+        // bit (cuaddr % 64) set for each CU with records
+        uint64_t        cu_mask;
+        // bit rt set for each record type present
+        uint32_t        rt_mask[8];
+        uint32_t        len;
+        // bytes skipped before the frame (streams)
+        uint32_t        skipped;
+        // buffer number or frame generation
+        uint16_t        bufnum;
+        uint8_t         flags;
+} trace_index_entry_t;
+
+#define TRACE_INDEX_SYNC_VALID  0x01
+#define TRACE_INDEX_HAS_RECORDS 0x02
+#define TRACE_INDEX_TRUNCATED   0x04    // frame missing part of its buffer
+
+typedef struct trace_input {
+        const char              *name;
+        unsigned char           *data;
+        size_t                  size;
+        bool                    mapped;
+        bool                    stream;
+        // the bufferset, up to its buffer pointers (not for streams)
+        pch_trc_bufferset_t     bs;
+        trace_index_entry_t     *entries;
+        uint32_t                num_entries;
+        // bytes skipped after the last frame (streams)
+        uint32_t                trailing_skipped;
+} trace_input_t;
+
+// Full time reconstruction for PCH_TRC_TIMESTAMP_32 records.
+extern bool have_time_sync;
+extern uint64_t time_sync_us;
+void set_time_sync(unsigned char *p);
+uint64_t timestamp_to_us(pch_trc_timestamp_t t);
+void find_time_sync(unsigned char *buf, uint32_t buflen);
+
+void open_stream_input(trace_input_t *in, const char *name);
+void open_bufferset_input(trace_input_t *in, const char *bsname, const char *bufsname);
+void close_input(trace_input_t *in);
+
+void restore_time_sync(trace_index_entry_t *e);
+bool index_entry_matches(trace_index_entry_t *e);
+
+static inline unsigned char *entry_buffer(trace_input_t *in, trace_index_entry_t *e) {
+        return in->data + e->offset;
+}
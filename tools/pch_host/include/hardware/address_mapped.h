@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2026 Malcolm Beattie
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _PCH_HOST_HARDWARE_ADDRESS_MAPPED_H
+#define _PCH_HOST_HARDWARE_ADDRESS_MAPPED_H
+
+#include "pico.h"
+
+typedef volatile uint32_t io_rw_32;
+typedef const volatile uint32_t io_ro_32;
+typedef volatile uint32_t io_wo_32;
+
+// sim_hw_written must be called after any write to a simulated
+// hardware register that can change interrupt state (for example,
+// the DMA INTFn "forced" registers) so that the simulation can
+// re-evaluate its IRQ lines.
+void sim_hw_written(io_rw_32 *addr);
+
+// sim_addr32 converts a pointer into the 32-bit address stored in a
+// simulated DMA register. The host build is non-PIE so that static
+// data and the brk heap live below 4GiB but it panics for anything
+// (such as a main-thread stack buffer) that does not fit.
+uint32_t sim_addr32(const volatile void *p);
+
+static inline void *sim_ptr32(uint32_t addr) {
+        return (void *)(uintptr_t)addr;
+}
+
+static inline void hw_set_bits(io_rw_32 *addr, uint32_t mask) {
+        __atomic_fetch_or(addr, mask, __ATOMIC_SEQ_CST);
+        sim_hw_written(addr);
+}
+
+static inline void hw_clear_bits(io_rw_32 *addr, uint32_t mask) {
+        __atomic_fetch_and(addr, ~mask, __ATOMIC_SEQ_CST);
+        sim_hw_written(addr);
+}
+
+static inline void hw_xor_bits(io_rw_32 *addr, uint32_t mask) {
+        __atomic_fetch_xor(addr, mask, __ATOMIC_SEQ_CST);
+        sim_hw_written(addr);
+}
+
+static inline void hw_write_masked(io_rw_32 *addr, uint32_t values, uint32_t write_mask) {
+        hw_xor_bits(addr, (*addr ^ values) & write_mask);
+}
+
+#endif
@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) 2026 Malcolm Beattie
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _PCH_HOST_HARDWARE_DMA_H
+#define _PCH_HOST_HARDWARE_DMA_H
+
+#include "pico.h"
+#include "hardware/address_mapped.h"
+#include "hardware/structs/dma.h"
+#include "hardware/structs/dma_debug.h"
+#include "hardware/irq.h"
+
+// Simulated DMA engine. Only unpaced (DREQ "permanent") transfers
+// are supported: a triggered channel copies its whole transfer
+// synchronously in the triggering thread then raises its interrupt
+// through the same INTR/INTEn/INTFn/INTSn logic as the hardware.
+
+void sim_dma_trigger(uint channel);
+void sim_dma_irq_update(void);
+
+#ifndef PARAM_ASSERTIONS_ENABLED_HARDWARE_DMA
+#define PARAM_ASSERTIONS_ENABLED_HARDWARE_DMA 0
+#endif
+
+static inline void check_dma_channel_param(__unused uint channel) {
+        invalid_params_if(HARDWARE_DMA, channel >= NUM_DMA_CHANNELS);
+}
+
+enum dma_channel_transfer_size {
+        DMA_SIZE_8 = 0,
+        DMA_SIZE_16 = 1,
+        DMA_SIZE_32 = 2
+};
+
+typedef struct {
+        uint32_t ctrl;
+} dma_channel_config;
+
+typedef dma_channel_config dma_channel_config_t;
+
+static inline dma_channel_hw_t *dma_channel_hw_addr(uint channel) {
+        check_dma_channel_param(channel);
+        return &dma_hw->ch[channel];
+}
+
+void dma_channel_claim(uint channel);
+void dma_claim_mask(uint32_t channel_mask);
+void dma_channel_unclaim(uint channel);
+int dma_claim_unused_channel(bool required);
+bool dma_channel_is_claimed(uint channel);
+
+static inline void channel_config_set_read_increment(dma_channel_config *c, bool incr) {
+        c->ctrl = incr ? (c->ctrl | DMA_CH0_CTRL_TRIG_INCR_READ_BITS) : (c->ctrl & ~DMA_CH0_CTRL_TRIG_INCR_READ_BITS);
+}
+
+static inline void channel_config_set_write_increment(dma_channel_config *c, bool incr) {
+        c->ctrl = incr ? (c->ctrl | DMA_CH0_CTRL_TRIG_INCR_WRITE_BITS) : (c->ctrl & ~DMA_CH0_CTRL_TRIG_INCR_WRITE_BITS);
+}
+
+static inline void channel_config_set_dreq(dma_channel_config *c, uint dreq) {
+        c->ctrl = (c->ctrl & ~DMA_CH0_CTRL_TRIG_TREQ_SEL_BITS) | (dreq << DMA_CH0_CTRL_TRIG_TREQ_SEL_LSB);
+}
+
+static inline void channel_config_set_chain_to(dma_channel_config *c, uint chain_to) {
+        c->ctrl = (c->ctrl & ~DMA_CH0_CTRL_TRIG_CHAIN_TO_BITS) | (chain_to << DMA_CH0_CTRL_TRIG_CHAIN_TO_LSB);
+}
+
+static inline void channel_config_set_transfer_data_size(dma_channel_config *c, enum dma_channel_transfer_size size) {
+        c->ctrl = (c->ctrl & ~DMA_CH0_CTRL_TRIG_DATA_SIZE_BITS) | (((uint)size) << DMA_CH0_CTRL_TRIG_DATA_SIZE_LSB);
+}
+
+static inline void channel_config_set_irq_quiet(dma_channel_config *c, bool irq_quiet) {
+        c->ctrl = irq_quiet ? (c->ctrl | DMA_CH0_CTRL_TRIG_IRQ_QUIET_BITS) : (c->ctrl & ~DMA_CH0_CTRL_TRIG_IRQ_QUIET_BITS);
+}
+
+static inline void channel_config_set_high_priority(dma_channel_config *c, bool high_priority) {
+        c->ctrl = high_priority ? (c->ctrl | DMA_CH0_CTRL_TRIG_HIGH_PRIORITY_BITS) : (c->ctrl & ~DMA_CH0_CTRL_TRIG_HIGH_PRIORITY_BITS);
+}
+
+static inline void channel_config_set_enable(dma_channel_config *c, bool enable) {
+        c->ctrl = enable ? (c->ctrl | DMA_CH0_CTRL_TRIG_EN_BITS) : (c->ctrl & ~DMA_CH0_CTRL_TRIG_EN_BITS);
+}
+
+static inline void channel_config_set_bswap(dma_channel_config *c, bool bswap) {
+        c->ctrl = bswap ? (c->ctrl | DMA_CH0_CTRL_TRIG_BSWAP_BITS) : (c->ctrl & ~DMA_CH0_CTRL_TRIG_BSWAP_BITS);
+}
+
+static inline dma_channel_config dma_channel_get_default_config(uint channel) {
+        dma_channel_config c = {0};
+        channel_config_set_read_increment(&c, true);
+        channel_config_set_write_increment(&c, false);
+        channel_config_set_dreq(&c, DMA_CH0_CTRL_TRIG_TREQ_SEL_VALUE_PERMANENT);
+        channel_config_set_chain_to(&c, channel);
+        channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+        channel_config_set_enable(&c, true);
+        return c;
+}
+
+static inline dma_channel_config dma_get_channel_config(uint channel) {
+        dma_channel_config c;
+        c.ctrl = dma_channel_hw_addr(channel)->ctrl_trig;
+        return c;
+}
+
+static inline uint32_t channel_config_get_ctrl_value(const dma_channel_config *config) {
+        return config->ctrl;
+}
+
+static inline void dma_channel_set_config(uint channel, const dma_channel_config *config, bool trigger) {
+        dma_channel_hw_addr(channel)->ctrl_trig = config->ctrl;
+        if (trigger)
+                sim_dma_trigger(channel);
+}
+
+static inline void dma_channel_set_read_addr(uint channel, const volatile void *read_addr, bool trigger) {
+        dma_channel_hw_addr(channel)->read_addr = sim_addr32(read_addr);
+        if (trigger)
+                sim_dma_trigger(channel);
+}
+
+static inline void dma_channel_set_write_addr(uint channel, volatile void *write_addr, bool trigger) {
+        dma_channel_hw_addr(channel)->write_addr = sim_addr32(write_addr);
+        if (trigger)
+                sim_dma_trigger(channel);
+}
+
+static inline void dma_channel_set_trans_count(uint channel, uint32_t trans_count, bool trigger) {
+        dma_channel_hw_addr(channel)->transfer_count = trans_count;
+        *(io_rw_32 *)&dma_debug_hw->ch[channel].dbg_tcr = trans_count;
+        if (trigger)
+                sim_dma_trigger(channel);
+}
+
+static inline void dma_channel_configure(uint channel, const dma_channel_config *config, volatile void *write_addr, const volatile void *read_addr, uint transfer_count, bool trigger) {
+        dma_channel_set_read_addr(channel, read_addr, false);
+        dma_channel_set_write_addr(channel, write_addr, false);
+        dma_channel_set_trans_count(channel, transfer_count, false);
+        dma_channel_set_config(channel, config, trigger);
+}
+
+static inline void dma_channel_transfer_from_buffer_now(uint channel, const volatile void *read_addr, uint32_t transfer_count) {
+        dma_channel_set_read_addr(channel, read_addr, false);
+        dma_channel_set_trans_count(channel, transfer_count, true);
+}
+
+static inline void dma_channel_transfer_to_buffer_now(uint channel, volatile void *write_addr, uint32_t transfer_count) {
+        dma_channel_set_write_addr(channel, write_addr, false);
+        dma_channel_set_trans_count(channel, transfer_count, true);
+}
+
+static inline void dma_channel_start(uint channel) {
+        sim_dma_trigger(channel);
+}
+
+static inline void dma_channel_abort(uint channel) {
+        check_dma_channel_param(channel);
+}
+
+static inline bool dma_channel_is_busy(uint channel) {
+        check_dma_channel_param(channel);
+        return false; // simulated transfers complete synchronously
+}
+
+static inline void dma_channel_wait_for_finish_blocking(uint channel) {
+        check_dma_channel_param(channel);
+}
+
+static inline uint dma_get_irq_num(uint irq_index) {
+        valid_params_if(HARDWARE_DMA, irq_index < NUM_DMA_IRQS);
+        return DMA_IRQ_0 + irq_index;
+}
+
+static inline void dma_irqn_set_channel_enabled(uint irq_index, uint channel, bool enabled) {
+        invalid_params_if(HARDWARE_DMA, irq_index >= NUM_DMA_IRQS);
+        if (enabled)
+                hw_set_bits(&dma_hw->irq_ctrl[irq_index].inte, 1u << channel);
+        else
+                hw_clear_bits(&dma_hw->irq_ctrl[irq_index].inte, 1u << channel);
+}
+
+static inline void dma_irqn_set_channel_mask_enabled(uint irq_index, uint32_t channel_mask, bool enabled) {
+        invalid_params_if(HARDWARE_DMA, irq_index >= NUM_DMA_IRQS);
+        if (enabled)
+                hw_set_bits(&dma_hw->irq_ctrl[irq_index].inte, channel_mask);
+        else
+                hw_clear_bits(&dma_hw->irq_ctrl[irq_index].inte, channel_mask);
+}
+
+static inline bool dma_irqn_get_channel_status(uint irq_index, uint channel) {
+        invalid_params_if(HARDWARE_DMA, irq_index >= NUM_DMA_IRQS);
+        check_dma_channel_param(channel);
+        return dma_hw->irq_ctrl[irq_index].ints & (1u << channel);
+}
+
+// Writing 1 to an INTSn bit clears the underlying raw INTR bit
+static inline void dma_irqn_acknowledge_channel(uint irq_index, uint channel) {
+        invalid_params_if(HARDWARE_DMA, irq_index >= NUM_DMA_IRQS);
+        check_dma_channel_param(channel);
+        hw_clear_bits(&dma_hw->intr, 1u << channel);
+}
+
+#endif
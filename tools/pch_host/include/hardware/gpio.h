@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2026 Malcolm Beattie
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _PCH_HOST_HARDWARE_GPIO_H
+#define _PCH_HOST_HARDWARE_GPIO_H
+
+#include "pico.h"
+
+// Simulated GPIO bank: pin levels are kept in memory. Output changes
+// are logged to stderr when the PCH_HOST_GPIO_TRACE environment
+// variable is set, which is how blink shows its LED on the host.
+
+#define NUM_BANK0_GPIOS 30u
+
+#define GPIO_OUT 1
+#define GPIO_IN 0
+
+enum gpio_irq_level {
+        GPIO_IRQ_LEVEL_LOW = 0x1u,
+        GPIO_IRQ_LEVEL_HIGH = 0x2u,
+        GPIO_IRQ_EDGE_FALL = 0x4u,
+        GPIO_IRQ_EDGE_RISE = 0x8u,
+};
+
+typedef void (*gpio_irq_callback_t)(uint gpio, uint32_t event_mask);
+
+void gpio_init(uint gpio);
+void gpio_init_mask(uint32_t gpio_mask);
+void gpio_set_dir(uint gpio, bool out);
+void gpio_set_dir_out_masked(uint32_t mask);
+void gpio_set_dir_in_masked(uint32_t mask);
+bool gpio_is_dir_out(uint gpio);
+void gpio_put(uint gpio, bool value);
+bool gpio_get(uint gpio);
+uint32_t gpio_get_all(void);
+void gpio_put_all(uint32_t value);
+void gpio_put_masked(uint32_t mask, uint32_t value);
+void gpio_set_mask(uint32_t mask);
+void gpio_clr_mask(uint32_t mask);
+void gpio_xor_mask(uint32_t mask);
+void gpio_set_pulls(uint gpio, bool up, bool down);
+void gpio_pull_up(uint gpio);
+void gpio_pull_down(uint gpio);
+void gpio_disable_pulls(uint gpio);
+void gpio_set_input_hysteresis_enabled(uint gpio, bool enabled);
+void gpio_set_irq_enabled(uint gpio, uint32_t event_mask, bool enabled);
+void gpio_set_irq_enabled_with_callback(uint gpio, uint32_t event_mask, bool enabled, gpio_irq_callback_t callback);
+void gpio_acknowledge_irq(uint gpio, uint32_t event_mask);
+
+// sim_gpio_set_input drives an input pin from outside the
+// simulation (for example from a benchmark or test harness).
+void sim_gpio_set_input(uint gpio, bool value);
+
+#endif
@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2026 Malcolm Beattie
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _PCH_HOST_HARDWARE_PIO_H
+#define _PCH_HOST_HARDWARE_PIO_H
+
+#include "pico.h"
+#include "hardware/address_mapped.h"
+#include "hardware/irq.h"
+
+// PIO blocks are declared so that picochan compiles unchanged. There
+// is no PIO emulation: the piochan sources are left out of the host
+// build and pch_piochan_init()/pch_channel_init_piochan() panic.
+
+#define NUM_PIOS 2u
+#define NUM_PIO_IRQS 2u
+#define NUM_PIO_STATE_MACHINES 4u
+
+typedef struct {
+        io_rw_32 ctrl;
+        io_ro_32 fstat;
+        uint32_t _pad0[2];
+        io_wo_32 txf[NUM_PIO_STATE_MACHINES];
+        io_ro_32 rxf[NUM_PIO_STATE_MACHINES];
+        io_rw_32 irq;
+} pio_hw_t;
+
+typedef pio_hw_t *PIO;
+
+extern pio_hw_t sim_pio_hw[NUM_PIOS];
+#define pio0 (&sim_pio_hw[0])
+#define pio1 (&sim_pio_hw[1])
+
+#define PIO_NUM(pio) ((uint)((pio) - sim_pio_hw))
+#define PIO_INSTANCE(n) (&sim_pio_hw[n])
+
+static inline uint pio_get_index(PIO pio) {
+        return PIO_NUM(pio);
+}
+
+static inline uint pio_get_irq_num(PIO pio, uint irqn) {
+        valid_params_if(HARDWARE_PIO, irqn < NUM_PIO_IRQS);
+        return PIO0_IRQ_0 + NUM_PIO_IRQS * PIO_NUM(pio) + irqn;
+}
+
+static inline uint pio_get_dreq(PIO pio, uint sm, bool is_tx) {
+        return PIO_NUM(pio) * 8 + (is_tx ? 0 : NUM_PIO_STATE_MACHINES) + sm;
+}
+
+#ifndef PARAM_ASSERTIONS_ENABLED_HARDWARE_PIO
+#define PARAM_ASSERTIONS_ENABLED_HARDWARE_PIO 0
+#endif
+
+#endif
@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2026 Malcolm Beattie
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _PCH_HOST_HARDWARE_STRUCTS_DMA_H
+#define _PCH_HOST_HARDWARE_STRUCTS_DMA_H
+
+#include "hardware/address_mapped.h"
+
+#define NUM_DMA_CHANNELS 12u
+#define NUM_DMA_IRQS 2u
+
+#define DMA_CH0_CTRL_TRIG_EN_BITS               0x00000001u
+#define DMA_CH0_CTRL_TRIG_HIGH_PRIORITY_BITS    0x00000002u
+#define DMA_CH0_CTRL_TRIG_DATA_SIZE_BITS        0x0000000cu
+#define DMA_CH0_CTRL_TRIG_DATA_SIZE_LSB         2u
+#define DMA_CH0_CTRL_TRIG_INCR_READ_BITS        0x00000010u
+#define DMA_CH0_CTRL_TRIG_INCR_WRITE_BITS       0x00000020u
+#define DMA_CH0_CTRL_TRIG_RING_SIZE_BITS        0x000003c0u
+#define DMA_CH0_CTRL_TRIG_RING_SEL_BITS         0x00000400u
+#define DMA_CH0_CTRL_TRIG_CHAIN_TO_BITS         0x00007800u
+#define DMA_CH0_CTRL_TRIG_CHAIN_TO_LSB          11u
+#define DMA_CH0_CTRL_TRIG_TREQ_SEL_BITS         0x001f8000u
+#define DMA_CH0_CTRL_TRIG_TREQ_SEL_LSB          15u
+#define DMA_CH0_CTRL_TRIG_TREQ_SEL_VALUE_PERMANENT 0x3fu
+#define DMA_CH0_CTRL_TRIG_IRQ_QUIET_BITS        0x00200000u
+#define DMA_CH0_CTRL_TRIG_BSWAP_BITS            0x00400000u
+#define DMA_CH0_CTRL_TRIG_SNIFF_EN_BITS         0x00800000u
+#define DMA_CH0_CTRL_TRIG_BUSY_BITS             0x01000000u
+
+typedef struct {
+        io_rw_32 read_addr;
+        io_rw_32 write_addr;
+        io_rw_32 transfer_count;
+        io_rw_32 ctrl_trig;
+} dma_channel_hw_t;
+
+typedef struct {
+        io_rw_32 inte;
+        io_rw_32 intf;
+        io_rw_32 ints;
+} dma_irq_ctrl_hw_t;
+
+typedef struct {
+        dma_channel_hw_t ch[NUM_DMA_CHANNELS];
+        io_rw_32 intr;
+        dma_irq_ctrl_hw_t irq_ctrl[NUM_DMA_IRQS];
+} dma_hw_t;
+
+extern dma_hw_t sim_dma_hw;
+#define dma_hw (&sim_dma_hw)
+
+#endif
@@ -0,0 +1,25 @@
+/*
+ * Copyright (c) 2026 Malcolm Beattie
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _PCH_HOST_HARDWARE_STRUCTS_DMA_DEBUG_H
+#define _PCH_HOST_HARDWARE_STRUCTS_DMA_DEBUG_H
+
+#include "hardware/address_mapped.h"
+#include "hardware/structs/dma.h"
+
+typedef struct {
+        io_rw_32 dbg_ctdreq;
+        io_ro_32 dbg_tcr;
+        uint32_t _pad0[14];
+} dma_debug_channel_hw_t;
+
+typedef struct {
+        dma_debug_channel_hw_t ch[NUM_DMA_CHANNELS];
+} dma_debug_hw_t;
+
+extern dma_debug_hw_t sim_dma_debug_hw;
+#define dma_debug_hw (&sim_dma_debug_hw)
+
+#endif
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2026 Malcolm Beattie
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _PCH_HOST_HARDWARE_SYNC_H
+#define _PCH_HOST_HARDWARE_SYNC_H
+
+#include <sched.h>
+#include "pico.h"
+#include "hardware/address_mapped.h"
+
+// Each simulated core is a POSIX thread and interrupts are delivered
+// to it as a signal. "Disabling interrupts" only sets a thread-local
+// flag (the simulated PRIMASK): an interrupt signal arriving while
+// it is set is recorded and the handlers are run from
+// restore_interrupts() instead. That keeps the lock/unlock pairs on
+// the hot paths free of system calls.
+extern __thread volatile int sim_irq_disabled;
+extern __thread volatile int sim_irq_deferred;
+
+void sim_irq_run_pending(void);
+
+#define NUM_SPIN_LOCKS 32u
+#define PICO_SPINLOCK_ID_STRIPED_FIRST 16u
+#define PICO_SPINLOCK_ID_CLAIM_FREE_FIRST 24u
+
+typedef volatile uint32_t spin_lock_t;
+
+static inline void __dmb(void) {
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+static inline void __mem_fence_acquire(void) {
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+}
+
+static inline void __mem_fence_release(void) {
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static inline void __nop(void) {
+        __compiler_memory_barrier();
+}
+
+void __sev(void);
+void __wfe(void);
+void __wfi(void);
+
+static inline uint32_t save_and_disable_interrupts(void) {
+        uint32_t status = sim_irq_disabled ? 0 : 1;
+        sim_irq_disabled = 1;
+        __compiler_memory_barrier();
+        return status;
+}
+
+static inline void restore_interrupts(uint32_t status) {
+        __compiler_memory_barrier();
+        if (status) {
+                sim_irq_disabled = 0;
+                __compiler_memory_barrier();
+                if (sim_irq_deferred)
+                        sim_irq_run_pending();
+        }
+}
+
+static inline void restore_interrupts_from_disabled(uint32_t status) {
+        restore_interrupts(status);
+}
+
+spin_lock_t *spin_lock_instance(uint lock_num);
+spin_lock_t *spin_lock_init(uint lock_num);
+uint spin_lock_get_num(spin_lock_t *lock);
+void spin_lock_claim(uint lock_num);
+void spin_lock_unclaim(uint lock_num);
+int spin_lock_claim_unused(bool required);
+bool spin_lock_is_claimed(uint lock_num);
+uint next_striped_spin_lock_num(void);
+
+static inline void spin_lock_unsafe_blocking(spin_lock_t *lock) {
+        uint n = 0;
+        while (__atomic_exchange_n(lock, 1, __ATOMIC_ACQUIRE)) {
+                if (++n % 1024 == 0)
+                        sched_yield();
+        }
+}
+
+static inline void spin_unlock_unsafe(spin_lock_t *lock) {
+        __atomic_store_n(lock, 0, __ATOMIC_RELEASE);
+}
+
+static inline uint32_t spin_lock_blocking(spin_lock_t *lock) {
+        uint32_t save = save_and_disable_interrupts();
+        spin_lock_unsafe_blocking(lock);
+        return save;
+}
+
+static inline bool is_spin_locked(spin_lock_t *lock) {
+        return __atomic_load_n(lock, __ATOMIC_ACQUIRE) != 0;
+}
+
+static inline void spin_unlock(spin_lock_t *lock, uint32_t saved_irq) {
+        spin_unlock_unsafe(lock);
+        restore_interrupts(saved_irq);
+}
+
+#endif
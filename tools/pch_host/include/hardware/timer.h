@@ -0,0 +1,36 @@
+/*
+ * Copyright (c) 2026 Malcolm Beattie
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _PCH_HOST_HARDWARE_TIMER_H
+#define _PCH_HOST_HARDWARE_TIMER_H
+
+#include "pico.h"
+#include "hardware/address_mapped.h"
+
+#define NUM_GENERIC_TIMERS 1u
+#define NUM_ALARMS 4u
+
+typedef struct {
+        io_rw_32 dbgpause;
+} timer_hw_t;
+
+extern timer_hw_t sim_timer_hw;
+#define timer_hw (&sim_timer_hw)
+
+uint64_t time_us_64(void);
+
+static inline uint32_t time_us_32(void) {
+        return (uint32_t)time_us_64();
+}
+
+void busy_wait_us(uint64_t delay_us);
+void busy_wait_us_32(uint32_t delay_us);
+void busy_wait_ms(uint32_t delay_ms);
+
+int hardware_alarm_claim_unused(bool required);
+void hardware_alarm_claim(uint alarm_num);
+void hardware_alarm_unclaim(uint alarm_num);
+
+#endif
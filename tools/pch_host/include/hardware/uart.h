@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2026 Malcolm Beattie
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _PCH_HOST_HARDWARE_UART_H
+#define _PCH_HOST_HARDWARE_UART_H
+
+#include "pico.h"
+#include "hardware/address_mapped.h"
+
+// UARTs are declared so that picochan compiles unchanged but the
+// simulation has no serial hardware: uart_init() panics so uartchan
+// channels cannot be configured on the host.
+
+#define NUM_UARTS 2u
+
+typedef struct {
+        io_rw_32 dr;
+        io_rw_32 rsr;
+        uint32_t _pad0[4];
+        io_ro_32 fr;
+} uart_hw_t;
+
+typedef struct uart_inst uart_inst_t;
+
+extern uart_hw_t sim_uart_hw[NUM_UARTS];
+#define uart0 ((uart_inst_t *)&sim_uart_hw[0])
+#define uart1 ((uart_inst_t *)&sim_uart_hw[1])
+
+typedef enum {
+        UART_PARITY_NONE,
+        UART_PARITY_EVEN,
+        UART_PARITY_ODD
+} uart_parity_t;
+
+static inline uint uart_get_index(uart_inst_t *uart) {
+        return uart == uart1 ? 1 : 0;
+}
+
+static inline uart_hw_t *uart_get_hw(uart_inst_t *uart) {
+        return (uart_hw_t *)uart;
+}
+
+static inline uint uart_get_dreq_num(uart_inst_t *uart, bool is_tx) {
+        return 20 + 2 * uart_get_index(uart) + (is_tx ? 0 : 1);
+}
+
+uint uart_init(uart_inst_t *uart, uint baudrate);
+void uart_set_hw_flow(uart_inst_t *uart, bool cts, bool rts);
+void uart_set_format(uart_inst_t *uart, uint data_bits, uint stop_bits, uart_parity_t parity);
+void uart_set_fifo_enabled(uart_inst_t *uart, bool enabled);
+void uart_set_translate_crlf(uart_inst_t *uart, bool translate);
+
+#endif
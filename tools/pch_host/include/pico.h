@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2026 Malcolm Beattie
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _PCH_HOST_PICO_H
+#define _PCH_HOST_PICO_H
+
+// Host (Linux) stand-in for the Pico SDK top-level header. Only the
+// subset of the SDK used by picochan and its memchan examples is
+// provided. See tools/pch_host/sim for the emulation.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <assert.h>
+#include "pico/types.h"
+#include "pico/platform/compiler.h"
+
+#define PICO_ON_DEVICE 0
+#define PICO_PCH_HOST 1
+
+#ifndef PARAM_ASSERTIONS_ENABLE_ALL
+#define PARAM_ASSERTIONS_ENABLE_ALL 0
+#endif
+
+#ifndef PARAM_ASSERTIONS_DISABLE_ALL
+#define PARAM_ASSERTIONS_DISABLE_ALL 0
+#endif
+
+#define PARAM_ASSERTIONS_ENABLED(x) ((PARAM_ASSERTIONS_ENABLED_ ## x || PARAM_ASSERTIONS_ENABLE_ALL) && !PARAM_ASSERTIONS_DISABLE_ALL)
+#define invalid_params_if(x, test) ({if (PARAM_ASSERTIONS_ENABLED(x)) assert(!(test));})
+#define valid_params_if(x, test) ({if (PARAM_ASSERTIONS_ENABLED(x)) assert(test);})
+#define hard_assert(x) assert(x)
+
+#ifndef PARAM_ASSERTIONS_ENABLED_HARDWARE_DMA
+#define PARAM_ASSERTIONS_ENABLED_HARDWARE_DMA 0
+#endif
+
+#ifndef PARAM_ASSERTIONS_ENABLED_HARDWARE_GPIO
+#define PARAM_ASSERTIONS_ENABLED_HARDWARE_GPIO 0
+#endif
+
+#ifndef PARAM_ASSERTIONS_ENABLED_HARDWARE_IRQ
+#define PARAM_ASSERTIONS_ENABLED_HARDWARE_IRQ 0
+#endif
+
+#ifndef PARAM_ASSERTIONS_ENABLED_HARDWARE_PIO
+#define PARAM_ASSERTIONS_ENABLED_HARDWARE_PIO 0
+#endif
+
+#ifndef PARAM_ASSERTIONS_ENABLED_HARDWARE_SYNC
+#define PARAM_ASSERTIONS_ENABLED_HARDWARE_SYNC 0
+#endif
+
+#ifndef PARAM_ASSERTIONS_ENABLED_HARDWARE_TIMER
+#define PARAM_ASSERTIONS_ENABLED_HARDWARE_TIMER 0
+#endif
+
+#ifndef PARAM_ASSERTIONS_ENABLED_HARDWARE_UART
+#define PARAM_ASSERTIONS_ENABLED_HARDWARE_UART 0
+#endif
+
+#define count_of(a) (sizeof(a)/sizeof((a)[0]))
+
+void __attribute__((noreturn, format(printf, 1, 2))) panic(const char *fmt, ...);
+void __attribute__((noreturn)) panic_unsupported(void);
+
+uint get_core_num(void);
+
+// tight_loop_contents is a no-op on the Pico but, since the host may
+// have fewer CPUs than there are simulated cores, here it yields so
+// that a core spinning in a busy loop lets the other core run
+void tight_loop_contents(void);
+
+#define NUM_CORES 2u
+
+#ifndef PICO_DEFAULT_LED_PIN
+#define PICO_DEFAULT_LED_PIN 25
+#endif
+
+#endif
@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2026 Malcolm Beattie
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _PCH_HOST_PICO_ASYNC_CONTEXT_H
+#define _PCH_HOST_PICO_ASYNC_CONTEXT_H
+
+#include "pico.h"
+#include "pico/time.h"
+
+// Only the "threadsafe background" flavour of async_context is
+// simulated so the type vtable of the SDK is reduced to direct calls.
+
+typedef struct async_context async_context_t;
+
+typedef struct async_work_on_timeout {
+        struct async_work_on_timeout *next;
+        void (*do_work)(async_context_t *context, struct async_work_on_timeout *timeout);
+        absolute_time_t next_time;
+        void *user_data;
+} async_at_time_worker_t;
+
+typedef struct async_when_pending_worker {
+        struct async_when_pending_worker *next;
+        void (*do_work)(async_context_t *context, struct async_when_pending_worker *worker);
+        bool work_pending;
+        void *user_data;
+} async_when_pending_worker_t;
+
+#define ASYNC_CONTEXT_FLAG_CALLBACK_FROM_NON_IRQ 0x1
+#define ASYNC_CONTEXT_FLAG_CALLBACK_FROM_IRQ 0x2
+#define ASYNC_CONTEXT_FLAG_POLLED 0x4
+
+struct async_context {
+        async_at_time_worker_t *at_time_list;
+        absolute_time_t next_time;
+        async_when_pending_worker_t *when_pending_list;
+        uint16_t flags;
+        uint8_t core_num;
+};
+
+void async_context_acquire_lock_blocking(async_context_t *context);
+void async_context_release_lock(async_context_t *context);
+void async_context_lock_check(async_context_t *context);
+uint32_t async_context_execute_sync(async_context_t *context, uint32_t (*func)(void *param), void *param);
+bool async_context_add_at_time_worker(async_context_t *context, async_at_time_worker_t *worker);
+bool async_context_remove_at_time_worker(async_context_t *context, async_at_time_worker_t *worker);
+bool async_context_add_when_pending_worker(async_context_t *context, async_when_pending_worker_t *worker);
+bool async_context_remove_when_pending_worker(async_context_t *context, async_when_pending_worker_t *worker);
+void async_context_set_work_pending(async_context_t *context, async_when_pending_worker_t *worker);
+void async_context_poll(async_context_t *context);
+void async_context_wait_until(async_context_t *context, absolute_time_t until);
+void async_context_wait_for_work_until(async_context_t *context, absolute_time_t until);
+void async_context_deinit(async_context_t *context);
+
+static inline bool async_context_add_at_time_worker_at(async_context_t *context, async_at_time_worker_t *worker, absolute_time_t at) {
+        worker->next_time = at;
+        return async_context_add_at_time_worker(context, worker);
+}
+
+static inline bool async_context_add_at_time_worker_in_ms(async_context_t *context, async_at_time_worker_t *worker, uint32_t ms) {
+        worker->next_time = make_timeout_time_ms(ms);
+        return async_context_add_at_time_worker(context, worker);
+}
+
+static inline void async_context_wait_for_work_ms(async_context_t *context, uint32_t ms) {
+        async_context_wait_for_work_until(context, make_timeout_time_ms(ms));
+}
+
+static inline uint async_context_core_num(const async_context_t *context) {
+        return context->core_num;
+}
+
+#endif
@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2026 Malcolm Beattie
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _PCH_HOST_PICO_ASYNC_CONTEXT_THREADSAFE_BACKGROUND_H
+#define _PCH_HOST_PICO_ASYNC_CONTEXT_THREADSAFE_BACKGROUND_H
+
+#include "pico/async_context.h"
+#include "hardware/irq.h"
+
+typedef struct async_context_threadsafe_background_config {
+        uint8_t low_priority_irq_handler_priority;
+        alarm_pool_t *custom_alarm_pool;
+} async_context_threadsafe_background_config_t;
+
+// Workers run from a claimed user IRQ on the core that initialised
+// the context. The context lock is recursive and owned per core: a
+// worker wakeup raised while the owning core holds the lock is
+// deferred until async_context_release_lock().
+typedef struct async_context_threadsafe_background {
+        async_context_t core;
+        alarm_pool_t *alarm_pool;
+        alarm_id_t alarm_id;
+        volatile int lock_owner;
+        uint lock_count;
+        volatile bool wake_up_pending;
+        uint8_t low_priority_irq_num;
+} async_context_threadsafe_background_t;
+
+#ifndef ASYNC_CONTEXT_THREADSAFE_BACKGROUND_DEFAULT_LOW_PRIORITY_IRQ_HANDLER_PRIORITY
+#define ASYNC_CONTEXT_THREADSAFE_BACKGROUND_DEFAULT_LOW_PRIORITY_IRQ_HANDLER_PRIORITY PICO_LOWEST_IRQ_PRIORITY
+#endif
+
+static inline async_context_threadsafe_background_config_t async_context_threadsafe_background_default_config(void) {
+        async_context_threadsafe_background_config_t config = {
+                .low_priority_irq_handler_priority = ASYNC_CONTEXT_THREADSAFE_BACKGROUND_DEFAULT_LOW_PRIORITY_IRQ_HANDLER_PRIORITY,
+                .custom_alarm_pool = NULL,
+        };
+        return config;
+}
+
+bool async_context_threadsafe_background_init(async_context_threadsafe_background_t *self, async_context_threadsafe_background_config_t *config);
+
+static inline bool async_context_threadsafe_background_init_with_defaults(async_context_threadsafe_background_t *self) {
+        async_context_threadsafe_background_config_t config = async_context_threadsafe_background_default_config();
+        return async_context_threadsafe_background_init(self, &config);
+}
+
+#endif
@@ -0,0 +1,14 @@
+/*
+ * Copyright (c) 2026 Malcolm Beattie
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _PCH_HOST_PICO_BINARY_INFO_H
+#define _PCH_HOST_PICO_BINARY_INFO_H
+
+#define bi_decl(_decl)
+#define bi_decl_if_func_used(_decl)
+#define bi_program_description(_description) 0
+#define bi_program_name(_name) 0
+
+#endif
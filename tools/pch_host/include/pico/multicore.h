@@ -0,0 +1,32 @@
+/*
+ * Copyright (c) 2026 Malcolm Beattie
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _PCH_HOST_PICO_MULTICORE_H
+#define _PCH_HOST_PICO_MULTICORE_H
+
+#include "pico.h"
+#include "hardware/irq.h"
+
+// Core 0 is the process main thread; core 1 is a second thread
+// started by multicore_launch_core1().
+
+void multicore_launch_core1(void (*entry)(void));
+void multicore_launch_core1_with_stack(void (*entry)(void), uint32_t *stack_bottom, size_t stack_size_bytes);
+void multicore_reset_core1(void);
+
+// Each core reads its own inter-core FIFO, which only the other core
+// writes. Pushing a word raises SIO_FIFO_IRQ_NUM() on the reading
+// core, which takes it while the FIFO is not empty, as on the RP2040.
+
+#define SIO_FIFO_IRQ_NUM(core) (SIO_IRQ_PROC0 + (core))
+
+bool multicore_fifo_rvalid(void);
+bool multicore_fifo_wready(void);
+void multicore_fifo_push_blocking(uint32_t data);
+uint32_t multicore_fifo_pop_blocking(void);
+void multicore_fifo_drain(void);
+void multicore_fifo_clear_irq(void);
+
+#endif
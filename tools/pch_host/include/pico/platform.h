@@ -0,0 +1,11 @@
+/*
+ * Copyright (c) 2026 Malcolm Beattie
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _PCH_HOST_PICO_PLATFORM_H
+#define _PCH_HOST_PICO_PLATFORM_H
+
+#include "pico.h"
+
+#endif
@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2026 Malcolm Beattie
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _PCH_HOST_PICO_PLATFORM_COMPILER_H
+#define _PCH_HOST_PICO_PLATFORM_COMPILER_H
+
+#include <assert.h>
+#include "pico/types.h"
+
+#ifndef __aligned
+#define __aligned(x) __attribute__((aligned(x)))
+#endif
+#ifndef __packed
+#define __packed __attribute__((packed))
+#endif
+#ifndef __unused
+#define __unused __attribute__((unused))
+#endif
+#ifndef __used
+#define __used __attribute__((used))
+#endif
+#ifndef __noinline
+#define __noinline __attribute__((noinline))
+#endif
+#define __force_inline inline __attribute__((always_inline))
+#define __isr
+
+// There is no flash/SRAM distinction on the host so section
+// placement attributes only keep their inlining behaviour.
+#define __not_in_flash(group)
+#define __not_in_flash_func(func_name) func_name
+#define __time_critical_func(func_name) func_name
+#define __no_inline_not_in_flash_func(func_name) __noinline func_name
+#define __in_flash(group)
+#define __scratch_x(group)
+#define __scratch_y(group)
+#define __uninitialized_ram(group) group
+
+#define __compiler_memory_barrier() __asm__ volatile ("" : : : "memory")
+
+#define __fast_mul(a, b) ((a) * (b))
+
+#endif
@@ -0,0 +1,22 @@
+/*
+ * Copyright (c) 2026 Malcolm Beattie
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _PCH_HOST_PICO_STDLIB_H
+#define _PCH_HOST_PICO_STDLIB_H
+
+#include <stdio.h>
+#include "pico.h"
+#include "pico/time.h"
+#include "hardware/gpio.h"
+#include "hardware/uart.h"
+
+// stdout is line buffered, as it is on the device, so that output
+// interleaves sensibly with stderr when redirected
+static inline bool stdio_init_all(void) {
+        setvbuf(stdout, NULL, _IOLBF, 0);
+        return true;
+}
+
+#endif
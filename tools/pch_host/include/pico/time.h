@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2026 Malcolm Beattie
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _PCH_HOST_PICO_TIME_H
+#define _PCH_HOST_PICO_TIME_H
+
+#include "pico.h"
+#include "hardware/timer.h"
+
+// Time is CLOCK_MONOTONIC in microseconds since the simulation
+// started. Alarm pools run their callbacks from a TIMER_IRQ_n
+// interrupt on the core that created the pool, as on the device.
+
+static inline absolute_time_t get_absolute_time(void) {
+        return from_us_since_boot(time_us_64());
+}
+
+static inline uint32_t to_ms_since_boot(absolute_time_t t) {
+        return (uint32_t)(to_us_since_boot(t) / 1000);
+}
+
+static inline absolute_time_t delayed_by_us(absolute_time_t t, uint64_t us) {
+        return from_us_since_boot(to_us_since_boot(t) + us);
+}
+
+static inline absolute_time_t delayed_by_ms(absolute_time_t t, uint32_t ms) {
+        return delayed_by_us(t, (uint64_t)ms * 1000);
+}
+
+static inline absolute_time_t make_timeout_time_us(uint64_t us) {
+        return delayed_by_us(get_absolute_time(), us);
+}
+
+static inline absolute_time_t make_timeout_time_ms(uint32_t ms) {
+        return delayed_by_ms(get_absolute_time(), ms);
+}
+
+static inline int64_t absolute_time_diff_us(absolute_time_t from, absolute_time_t to) {
+        return (int64_t)(to_us_since_boot(to) - to_us_since_boot(from));
+}
+
+static inline absolute_time_t absolute_time_min(absolute_time_t a, absolute_time_t b) {
+        return to_us_since_boot(a) < to_us_since_boot(b) ? a : b;
+}
+
+static inline bool is_at_the_end_of_time(absolute_time_t t) {
+        return to_us_since_boot(t) == to_us_since_boot(at_the_end_of_time);
+}
+
+static inline bool is_nil_time(absolute_time_t t) {
+        return !to_us_since_boot(t);
+}
+
+static inline bool time_reached(absolute_time_t t) {
+        return time_us_64() >= to_us_since_boot(t);
+}
+
+void sleep_until(absolute_time_t target);
+void sleep_us(uint64_t us);
+void sleep_ms(uint32_t ms);
+
+// best_effort_wfe_or_timeout returns true if the timeout has been
+// reached, false if woken by an event or interrupt beforehand.
+bool best_effort_wfe_or_timeout(absolute_time_t timeout_timestamp);
+
+typedef int32_t alarm_id_t;
+typedef int64_t (*alarm_callback_t)(alarm_id_t id, void *user_data);
+typedef struct alarm_pool alarm_pool_t;
+
+#define PICO_TIME_DEFAULT_ALARM_POOL_HARDWARE_ALARM_NUM 3
+#define PICO_TIME_DEFAULT_ALARM_POOL_MAX_TIMERS 16
+
+alarm_pool_t *alarm_pool_get_default(void);
+alarm_pool_t *alarm_pool_create(uint hardware_alarm_num, uint max_timers);
+alarm_pool_t *alarm_pool_create_with_unused_hardware_alarm(uint max_timers);
+uint alarm_pool_hardware_alarm_num(alarm_pool_t *pool);
+uint alarm_pool_core_num(alarm_pool_t *pool);
+void alarm_pool_destroy(alarm_pool_t *pool);
+alarm_id_t alarm_pool_add_alarm_at(alarm_pool_t *pool, absolute_time_t time, alarm_callback_t callback, void *user_data, bool fire_if_past);
+bool alarm_pool_cancel_alarm(alarm_pool_t *pool, alarm_id_t alarm_id);
+
+static inline alarm_id_t alarm_pool_add_alarm_in_us(alarm_pool_t *pool, uint64_t us, alarm_callback_t callback, void *user_data, bool fire_if_past) {
+        return alarm_pool_add_alarm_at(pool, make_timeout_time_us(us), callback, user_data, fire_if_past);
+}
+
+static inline alarm_id_t alarm_pool_add_alarm_in_ms(alarm_pool_t *pool, uint32_t ms, alarm_callback_t callback, void *user_data, bool fire_if_past) {
+        return alarm_pool_add_alarm_at(pool, make_timeout_time_ms(ms), callback, user_data, fire_if_past);
+}
+
+static inline alarm_id_t add_alarm_at(absolute_time_t time, alarm_callback_t callback, void *user_data, bool fire_if_past) {
+        return alarm_pool_add_alarm_at(alarm_pool_get_default(), time, callback, user_data, fire_if_past);
+}
+
+static inline alarm_id_t add_alarm_in_us(uint64_t us, alarm_callback_t callback, void *user_data, bool fire_if_past) {
+        return alarm_pool_add_alarm_in_us(alarm_pool_get_default(), us, callback, user_data, fire_if_past);
+}
+
+static inline alarm_id_t add_alarm_in_ms(uint32_t ms, alarm_callback_t callback, void *user_data, bool fire_if_past) {
+        return alarm_pool_add_alarm_in_ms(alarm_pool_get_default(), ms, callback, user_data, fire_if_past);
+}
+
+static inline bool cancel_alarm(alarm_id_t alarm_id) {
+        return alarm_pool_cancel_alarm(alarm_pool_get_default(), alarm_id);
+}
+
+typedef struct repeating_timer repeating_timer_t;
+typedef bool (*repeating_timer_callback_t)(repeating_timer_t *rt);
+
+struct repeating_timer {
+        int64_t delay_us;
+        alarm_pool_t *pool;
+        alarm_id_t alarm_id;
+        repeating_timer_callback_t callback;
+        void *user_data;
+};
+
+bool alarm_pool_add_repeating_timer_us(alarm_pool_t *pool, int64_t delay_us, repeating_timer_callback_t callback, void *user_data, repeating_timer_t *out);
+bool cancel_repeating_timer(repeating_timer_t *timer);
+
+static inline bool alarm_pool_add_repeating_timer_ms(alarm_pool_t *pool, int32_t delay_ms, repeating_timer_callback_t callback, void *user_data, repeating_timer_t *out) {
+        return alarm_pool_add_repeating_timer_us(pool, delay_ms * (int64_t)1000, callback, user_data, out);
+}
+
+static inline bool add_repeating_timer_us(int64_t delay_us, repeating_timer_callback_t callback, void *user_data, repeating_timer_t *out) {
+        return alarm_pool_add_repeating_timer_us(alarm_pool_get_default(), delay_us, callback, user_data, out);
+}
+
+static inline bool add_repeating_timer_ms(int32_t delay_ms, repeating_timer_callback_t callback, void *user_data, repeating_timer_t *out) {
+        return alarm_pool_add_repeating_timer_us(alarm_pool_get_default(), delay_ms * (int64_t)1000, callback, user_data, out);
+}
+
+#endif
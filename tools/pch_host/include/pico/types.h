@@ -0,0 +1,33 @@
+/*
+ * Copyright (c) 2026 Malcolm Beattie
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _PCH_HOST_PICO_TYPES_H
+#define _PCH_HOST_PICO_TYPES_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+typedef unsigned int uint;
+
+typedef uint64_t absolute_time_t;
+
+#define nil_time ((absolute_time_t)0)
+#define at_the_end_of_time ((absolute_time_t)INT64_MAX)
+
+static inline uint64_t to_us_since_boot(absolute_time_t t) {
+        return t;
+}
+
+static inline void update_us_since_boot(absolute_time_t *t, uint64_t us_since_boot) {
+        *t = us_since_boot;
+}
+
+static inline absolute_time_t from_us_since_boot(uint64_t us_since_boot) {
+        return us_since_boot;
+}
+
+#endif
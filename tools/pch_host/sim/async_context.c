@@ -0,0 +1,284 @@
+/*
+ * Copyright (c) 2026 Malcolm Beattie
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <sched.h>
+#include <string.h>
+#include "pico/async_context_threadsafe_background.h"
+#include "sim_internal.h"
+
+static async_context_threadsafe_background_t *sim_contexts[NUM_CORES][NUM_IRQS];
+
+static async_context_threadsafe_background_t *as_background(async_context_t *context) {
+        return (async_context_threadsafe_background_t *)context;
+}
+
+static void wake_up(async_context_threadsafe_background_t *self) {
+        sim_irq_raise(self->core.core_num, self->low_priority_irq_num);
+}
+
+static bool try_lock(async_context_threadsafe_background_t *self) {
+        int me = (int)get_core_num();
+        if (self->lock_owner == me) {
+                self->lock_count++;
+                return true;
+        }
+
+        int expected = -1;
+        if (!__atomic_compare_exchange_n(&self->lock_owner, &expected, me,
+                false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+                return false;
+
+        self->lock_count = 1;
+        return true;
+}
+
+void async_context_acquire_lock_blocking(async_context_t *context) {
+        async_context_threadsafe_background_t *self = as_background(context);
+        while (!try_lock(self))
+                sched_yield();
+}
+
+void async_context_release_lock(async_context_t *context) {
+        async_context_threadsafe_background_t *self = as_background(context);
+        assert(self->lock_owner == (int)get_core_num());
+        if (--self->lock_count)
+                return;
+
+        __atomic_store_n(&self->lock_owner, -1, __ATOMIC_RELEASE);
+        if (self->wake_up_pending) {
+                self->wake_up_pending = false;
+                wake_up(self);
+        }
+}
+
+void async_context_lock_check(async_context_t *context) {
+        async_context_threadsafe_background_t *self = as_background(context);
+        if (self->lock_owner != (int)get_core_num())
+                panic("async_context lock not held");
+}
+
+static int64_t alarm_handler(alarm_id_t id, void *user_data) {
+        (void)id;
+        async_context_threadsafe_background_t *self = user_data;
+        self->alarm_id = 0;
+        wake_up(self);
+        return 0;
+}
+
+// must be called with the context lock held
+static void reschedule_alarm(async_context_threadsafe_background_t *self) {
+        if (self->alarm_id > 0) {
+                alarm_pool_cancel_alarm(self->alarm_pool, self->alarm_id);
+                self->alarm_id = 0;
+        }
+
+        async_at_time_worker_t *w = self->core.at_time_list;
+        if (!w)
+                return;
+
+        self->core.next_time = w->next_time;
+        self->alarm_id = alarm_pool_add_alarm_at(self->alarm_pool,
+                w->next_time, alarm_handler, self, true);
+}
+
+static void process_under_lock(async_context_threadsafe_background_t *self) {
+        async_context_t *context = &self->core;
+        async_at_time_worker_t *tw;
+        while ((tw = context->at_time_list) != NULL
+                && time_reached(tw->next_time)) {
+                context->at_time_list = tw->next;
+                tw->next = NULL;
+                tw->do_work(context, tw);
+        }
+
+        for (async_when_pending_worker_t *w = context->when_pending_list; w; w = w->next) {
+                if (w->work_pending) {
+                        w->work_pending = false;
+                        w->do_work(context, w);
+                }
+        }
+
+        reschedule_alarm(self);
+}
+
+static void low_priority_irq_handler(void) {
+        uint irq = __get_current_exception() - VTABLE_FIRST_IRQ;
+        async_context_threadsafe_background_t *self = sim_contexts[get_core_num()][irq];
+        assert(self);
+        if (!try_lock(self)) {
+                // owner will wake us up again when it releases the lock
+                self->wake_up_pending = true;
+                return;
+        }
+
+        if (self->lock_count > 1) {
+                // interrupted thread-level code on this core holds
+                // the lock so defer until it releases it
+                self->lock_count--;
+                self->wake_up_pending = true;
+                return;
+        }
+
+        process_under_lock(self);
+        async_context_release_lock(&self->core);
+}
+
+bool async_context_threadsafe_background_init(async_context_threadsafe_background_t *self, async_context_threadsafe_background_config_t *config) {
+        memset(self, 0, sizeof(*self));
+        uint core_num = get_core_num();
+        self->core.core_num = (uint8_t)core_num;
+        self->core.flags = ASYNC_CONTEXT_FLAG_CALLBACK_FROM_IRQ
+                | ASYNC_CONTEXT_FLAG_CALLBACK_FROM_NON_IRQ;
+        self->lock_owner = -1;
+        self->alarm_pool = config->custom_alarm_pool
+                ? config->custom_alarm_pool : alarm_pool_get_default();
+
+        int irq = user_irq_claim_unused(false);
+        if (irq < 0)
+                return false;
+
+        self->low_priority_irq_num = (uint8_t)irq;
+        sim_contexts[core_num][irq] = self;
+        irq_set_exclusive_handler((uint)irq, low_priority_irq_handler);
+        irq_set_priority((uint)irq, config->low_priority_irq_handler_priority);
+        irq_set_enabled((uint)irq, true);
+        return true;
+}
+
+void async_context_deinit(async_context_t *context) {
+        async_context_threadsafe_background_t *self = as_background(context);
+        uint irq = self->low_priority_irq_num;
+        irq_set_enabled(irq, false);
+        irq_remove_handler(irq, low_priority_irq_handler);
+        user_irq_unclaim(irq);
+        sim_contexts[self->core.core_num][irq] = NULL;
+}
+
+bool async_context_add_at_time_worker(async_context_t *context, async_at_time_worker_t *worker) {
+        async_context_threadsafe_background_t *self = as_background(context);
+        async_context_acquire_lock_blocking(context);
+        async_at_time_worker_t **pp = &context->at_time_list;
+        for (async_at_time_worker_t *w = *pp; w; w = w->next) {
+                if (w == worker) {
+                        async_context_release_lock(context);
+                        return false;
+                }
+        }
+
+        while (*pp && to_us_since_boot((*pp)->next_time) <= to_us_since_boot(worker->next_time))
+                pp = &(*pp)->next;
+
+        worker->next = *pp;
+        *pp = worker;
+        reschedule_alarm(self);
+        async_context_release_lock(context);
+        return true;
+}
+
+bool async_context_remove_at_time_worker(async_context_t *context, async_at_time_worker_t *worker) {
+        async_context_threadsafe_background_t *self = as_background(context);
+        bool found = false;
+        async_context_acquire_lock_blocking(context);
+        for (async_at_time_worker_t **pp = &context->at_time_list; *pp; pp = &(*pp)->next) {
+                if (*pp == worker) {
+                        *pp = worker->next;
+                        worker->next = NULL;
+                        found = true;
+                        break;
+                }
+        }
+
+        if (found)
+                reschedule_alarm(self);
+        async_context_release_lock(context);
+        return found;
+}
+
+bool async_context_add_when_pending_worker(async_context_t *context, async_when_pending_worker_t *worker) {
+        async_context_acquire_lock_blocking(context);
+        for (async_when_pending_worker_t *w = context->when_pending_list; w; w = w->next) {
+                if (w == worker) {
+                        async_context_release_lock(context);
+                        return false;
+                }
+        }
+
+        worker->next = context->when_pending_list;
+        context->when_pending_list = worker;
+        async_context_release_lock(context);
+        return true;
+}
+
+bool async_context_remove_when_pending_worker(async_context_t *context, async_when_pending_worker_t *worker) {
+        bool found = false;
+        async_context_acquire_lock_blocking(context);
+        for (async_when_pending_worker_t **pp = &context->when_pending_list; *pp; pp = &(*pp)->next) {
+                if (*pp == worker) {
+                        *pp = worker->next;
+                        worker->next = NULL;
+                        found = true;
+                        break;
+                }
+        }
+        async_context_release_lock(context);
+        return found;
+}
+
+void async_context_set_work_pending(async_context_t *context, async_when_pending_worker_t *worker) {
+        worker->work_pending = true;
+        wake_up(as_background(context));
+}
+
+typedef struct sync_call {
+        async_when_pending_worker_t worker;
+        uint32_t (*func)(void *param);
+        void *param;
+        uint32_t rc;
+        volatile bool done;
+} sync_call_t;
+
+static void do_sync_call(async_context_t *context, async_when_pending_worker_t *worker) {
+        (void)context;
+        sync_call_t *call = (sync_call_t *)worker;
+        call->rc = call->func(call->param);
+        __atomic_store_n(&call->done, true, __ATOMIC_RELEASE);
+        __sev();
+}
+
+uint32_t async_context_execute_sync(async_context_t *context, uint32_t (*func)(void *param), void *param) {
+        if (get_core_num() == context->core_num) {
+                async_context_acquire_lock_blocking(context);
+                uint32_t rc = func(param);
+                async_context_release_lock(context);
+                return rc;
+        }
+
+        sync_call_t call = {
+                .worker = { .do_work = do_sync_call },
+                .func = func,
+                .param = param
+        };
+        async_context_add_when_pending_worker(context, &call.worker);
+        async_context_set_work_pending(context, &call.worker);
+        while (!__atomic_load_n(&call.done, __ATOMIC_ACQUIRE))
+                __wfe();
+
+        async_context_remove_when_pending_worker(context, &call.worker);
+        return call.rc;
+}
+
+void async_context_poll(async_context_t *context) {
+        (void)context; // background contexts need no polling
+}
+
+void async_context_wait_until(async_context_t *context, absolute_time_t until) {
+        (void)context;
+        sleep_until(until);
+}
+
+void async_context_wait_for_work_until(async_context_t *context, absolute_time_t until) {
+        (void)context;
+        best_effort_wfe_or_timeout(until);
+}
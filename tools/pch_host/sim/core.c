@@ -0,0 +1,549 @@
+/*
+ * Copyright (c) 2026 Malcolm Beattie
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <errno.h>
+#include <malloc.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/select.h>
+#include "pico/multicore.h"
+#include "pico/time.h"
+#include "sim_internal.h"
+
+// A simulated core is a POSIX thread. Interrupts are modelled as
+// an NVIC per core (enable and pending bitmaps plus a priority per
+// IRQ) and are delivered by running the handlers on the core's own
+// thread, either directly when the IRQ is raised by that core or
+// from the SIM_IRQ_SIGNAL handler when raised by another thread.
+// Handlers run with "interrupts enabled" at their own priority so a
+// higher-priority IRQ preempts a lower-priority one, as on the
+// Cortex-M. Each core has its own handler table, as if each had
+// its own vector table, so that both cores can use the same user IRQ
+// number for their own async_context.
+
+#define SIM_CORE1_STACK_SIZE (1024 * 1024)
+#define SIM_MAX_SHARED_IRQ_HANDLERS 4
+
+sim_core_t sim_cores[NUM_CORES];
+
+__thread int sim_core_num = -1;
+__thread volatile int sim_irq_disabled;
+__thread volatile int sim_irq_deferred;
+
+static __thread uint sim_current_priority = SIM_THREAD_MODE_PRIORITY;
+static __thread uint sim_current_exception;
+
+typedef struct sim_irq_handlers {
+        irq_handler_t   handlers[SIM_MAX_SHARED_IRQ_HANDLERS];
+        uint8_t         order_priority[SIM_MAX_SHARED_IRQ_HANDLERS];
+        uint8_t         num_handlers;
+        bool            exclusive;
+} sim_irq_handlers_t;
+
+static sim_irq_handlers_t sim_irq_handlers[NUM_CORES][NUM_IRQS];
+static uint8_t sim_irq_priority[NUM_IRQS];
+static uint8_t sim_user_irq_claimed[NUM_CORES];
+static pthread_mutex_t sim_irq_config_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void (*sim_core1_entry)(void);
+
+void panic(const char *fmt, ...) {
+        va_list ap;
+        fprintf(stderr, "*** PANIC (core %d) ***\n", sim_core_num);
+        va_start(ap, fmt);
+        vfprintf(stderr, fmt, ap);
+        va_end(ap);
+        fputc('\n', stderr);
+        abort();
+}
+
+void panic_unsupported(void) {
+        panic("not supported");
+}
+
+uint get_core_num(void) {
+        return sim_core_num < 0 ? 0 : (uint)sim_core_num;
+}
+
+void tight_loop_contents(void) {
+        sched_yield();
+}
+
+uint __get_current_exception(void) {
+        return sim_current_exception;
+}
+
+uint32_t sim_addr32(const volatile void *p) {
+        uintptr_t addr = (uintptr_t)p;
+        if (addr > UINT32_MAX)
+                panic("address %p does not fit in 32 bits: use static or heap storage for buffers", (const void *)p);
+
+        return (uint32_t)addr;
+}
+
+uint32_t sim_irq_lines(void) {
+        return sim_dma_irq_lines();
+}
+
+static int sim_find_ready_irq(sim_core_t *c) {
+        uint32_t ready = __atomic_load_n(&c->enabled, __ATOMIC_ACQUIRE)
+                & (__atomic_load_n(&c->pending, __ATOMIC_ACQUIRE)
+                        | sim_irq_lines());
+        int best = -1;
+        uint best_priority = sim_current_priority;
+        while (ready) {
+                int irq = __builtin_ctz(ready);
+                ready &= ready - 1;
+                if (sim_irq_priority[irq] < best_priority) {
+                        best = irq;
+                        best_priority = sim_irq_priority[irq];
+                }
+        }
+
+        return best;
+}
+
+static void sim_call_irq_handlers(uint irq) {
+        sim_irq_handlers_t *ih = &sim_irq_handlers[sim_core_num][irq];
+        uint n = __atomic_load_n(&ih->num_handlers, __ATOMIC_ACQUIRE);
+        if (n == 0)
+                panic("unhandled IRQ %u", irq);
+
+        for (uint i = 0; i < n; i++)
+                ih->handlers[i]();
+}
+
+static void sim_run_ready_irqs(sim_core_t *c) {
+        int irq;
+        while ((irq = sim_find_ready_irq(c)) >= 0) {
+                __atomic_fetch_and(&c->pending, ~(1u << irq),
+                        __ATOMIC_ACQ_REL);
+                uint saved_priority = sim_current_priority;
+                uint saved_exception = sim_current_exception;
+                sim_current_priority = sim_irq_priority[irq];
+                sim_current_exception = VTABLE_FIRST_IRQ + (uint)irq;
+                sim_irq_disabled = 0;
+                __compiler_memory_barrier();
+                sim_call_irq_handlers((uint)irq);
+                __compiler_memory_barrier();
+                sim_irq_disabled = 1;
+                sim_current_priority = saved_priority;
+                sim_current_exception = saved_exception;
+                c->event = true;
+        }
+}
+
+void sim_irq_run_pending(void) {
+        if (sim_core_num < 0) {
+                sim_irq_deferred = 0;
+                return;
+        }
+
+        sim_core_t *c = &sim_cores[sim_core_num];
+        do {
+                sim_irq_disabled = 1;
+                do {
+                        sim_irq_deferred = 0;
+                        __compiler_memory_barrier();
+                        sim_run_ready_irqs(c);
+                } while (sim_irq_deferred);
+                sim_irq_disabled = 0;
+                __compiler_memory_barrier();
+        } while (sim_irq_deferred);
+}
+
+static void sim_irq_signal_handler(int sig) {
+        (void)sig;
+        int saved_errno = errno;
+        if (sim_core_num >= 0) {
+                sim_cores[sim_core_num].event = true;
+                if (sim_irq_disabled)
+                        sim_irq_deferred = 1;
+                else
+                        sim_irq_run_pending();
+        }
+        errno = saved_errno;
+}
+
+static void sim_core_kick(uint core_num) {
+        if (sim_core_num == (int)core_num) {
+                if (sim_irq_disabled)
+                        sim_irq_deferred = 1;
+                else
+                        sim_irq_run_pending();
+                return;
+        }
+
+        sim_core_t *c = &sim_cores[core_num];
+        if (__atomic_load_n(&c->started, __ATOMIC_ACQUIRE))
+                pthread_kill(c->thread, SIM_IRQ_SIGNAL);
+}
+
+void sim_irq_raise(uint core_num, uint irq) {
+        assert(core_num < NUM_CORES && irq < NUM_IRQS);
+        __atomic_fetch_or(&sim_cores[core_num].pending, 1u << irq,
+                __ATOMIC_ACQ_REL);
+        sim_core_kick(core_num);
+}
+
+void sim_irq_lines_changed(uint32_t new_lines) {
+        for (uint core_num = 0; core_num < NUM_CORES; core_num++) {
+                sim_core_t *c = &sim_cores[core_num];
+                if (__atomic_load_n(&c->enabled, __ATOMIC_ACQUIRE) & new_lines)
+                        sim_core_kick(core_num);
+        }
+}
+
+void irq_set_priority(uint num, uint8_t hardware_priority) {
+        assert(num < NUM_IRQS);
+        sim_irq_priority[num] = hardware_priority;
+}
+
+uint irq_get_priority(uint num) {
+        assert(num < NUM_IRQS);
+        return sim_irq_priority[num];
+}
+
+void irq_set_enabled(uint num, bool enabled) {
+        irq_set_mask_enabled(1u << num, enabled);
+}
+
+void irq_set_mask_enabled(uint32_t mask, bool enabled) {
+        uint core_num = get_core_num();
+        sim_core_t *c = &sim_cores[core_num];
+        if (enabled) {
+                __atomic_fetch_or(&c->enabled, mask, __ATOMIC_ACQ_REL);
+                sim_core_kick(core_num);
+        } else {
+                __atomic_fetch_and(&c->enabled, ~mask, __ATOMIC_ACQ_REL);
+        }
+}
+
+bool irq_is_enabled(uint num) {
+        assert(num < NUM_IRQS);
+        sim_core_t *c = &sim_cores[get_core_num()];
+        return __atomic_load_n(&c->enabled, __ATOMIC_ACQUIRE) & (1u << num);
+}
+
+void irq_set_pending(uint num) {
+        sim_irq_raise(get_core_num(), num);
+}
+
+void irq_clear(uint num) {
+        assert(num < NUM_IRQS);
+        sim_core_t *c = &sim_cores[get_core_num()];
+        __atomic_fetch_and(&c->pending, ~(1u << num), __ATOMIC_ACQ_REL);
+}
+
+void irq_set_exclusive_handler(uint num, irq_handler_t handler) {
+        assert(num < NUM_IRQS);
+        sim_irq_handlers_t *ih = &sim_irq_handlers[sim_core_num][num];
+        pthread_mutex_lock(&sim_irq_config_mutex);
+        if (ih->num_handlers && ih->handlers[0] != handler)
+                panic("IRQ %u already has a handler", num);
+
+        ih->handlers[0] = handler;
+        ih->exclusive = true;
+        __atomic_store_n(&ih->num_handlers, 1, __ATOMIC_RELEASE);
+        pthread_mutex_unlock(&sim_irq_config_mutex);
+}
+
+irq_handler_t irq_get_exclusive_handler(uint num) {
+        assert(num < NUM_IRQS);
+        sim_irq_handlers_t *ih = &sim_irq_handlers[sim_core_num][num];
+        return ih->exclusive ? ih->handlers[0] : NULL;
+}
+
+void irq_add_shared_handler(uint num, irq_handler_t handler, uint8_t order_priority) {
+        assert(num < NUM_IRQS);
+        sim_irq_handlers_t *ih = &sim_irq_handlers[sim_core_num][num];
+        pthread_mutex_lock(&sim_irq_config_mutex);
+        if (ih->exclusive)
+                panic("IRQ %u already has an exclusive handler", num);
+        if (ih->num_handlers == SIM_MAX_SHARED_IRQ_HANDLERS)
+                panic("too many shared handlers for IRQ %u", num);
+
+        // keep handlers sorted by descending order_priority
+        uint i = ih->num_handlers;
+        while (i > 0 && ih->order_priority[i - 1] < order_priority) {
+                ih->handlers[i] = ih->handlers[i - 1];
+                ih->order_priority[i] = ih->order_priority[i - 1];
+                i--;
+        }
+
+        ih->handlers[i] = handler;
+        ih->order_priority[i] = order_priority;
+        __atomic_store_n(&ih->num_handlers, ih->num_handlers + 1,
+                __ATOMIC_RELEASE);
+        pthread_mutex_unlock(&sim_irq_config_mutex);
+}
+
+void irq_remove_handler(uint num, irq_handler_t handler) {
+        assert(num < NUM_IRQS);
+        sim_irq_handlers_t *ih = &sim_irq_handlers[sim_core_num][num];
+        pthread_mutex_lock(&sim_irq_config_mutex);
+        uint j = 0;
+        for (uint i = 0; i < ih->num_handlers; i++) {
+                if (ih->handlers[i] == handler)
+                        continue;
+
+                ih->handlers[j] = ih->handlers[i];
+                ih->order_priority[j] = ih->order_priority[i];
+                j++;
+        }
+
+        __atomic_store_n(&ih->num_handlers, j, __ATOMIC_RELEASE);
+        if (j == 0)
+                ih->exclusive = false;
+        pthread_mutex_unlock(&sim_irq_config_mutex);
+}
+
+bool irq_has_shared_handler(uint num) {
+        assert(num < NUM_IRQS);
+        sim_irq_handlers_t *ih = &sim_irq_handlers[sim_core_num][num];
+        return ih->num_handlers && !ih->exclusive;
+}
+
+void user_irq_claim(uint irq_num) {
+        assert(irq_num >= FIRST_USER_IRQ && irq_num < NUM_IRQS);
+        uint8_t bit = (uint8_t)(1u << (irq_num - FIRST_USER_IRQ));
+        uint8_t *claimed = &sim_user_irq_claimed[get_core_num()];
+        if (*claimed & bit)
+                panic("user IRQ %u already claimed", irq_num);
+
+        *claimed |= bit;
+}
+
+void user_irq_unclaim(uint irq_num) {
+        assert(irq_num >= FIRST_USER_IRQ && irq_num < NUM_IRQS);
+        uint8_t bit = (uint8_t)(1u << (irq_num - FIRST_USER_IRQ));
+        sim_user_irq_claimed[get_core_num()] &= (uint8_t)~bit;
+}
+
+int user_irq_claim_unused(bool required) {
+        uint8_t *claimed = &sim_user_irq_claimed[get_core_num()];
+        for (uint i = 0; i < NUM_USER_IRQS; i++) {
+                if (!(*claimed & (1u << i))) {
+                        *claimed |= (uint8_t)(1u << i);
+                        return (int)(FIRST_USER_IRQ + i);
+                }
+        }
+
+        if (required)
+                panic("no user IRQs available");
+
+        return -1;
+}
+
+bool user_irq_is_claimed(uint irq_num) {
+        assert(irq_num >= FIRST_USER_IRQ && irq_num < NUM_IRQS);
+        uint8_t bit = (uint8_t)(1u << (irq_num - FIRST_USER_IRQ));
+        return sim_user_irq_claimed[get_core_num()] & bit;
+}
+
+void __sev(void) {
+        for (uint core_num = 0; core_num < NUM_CORES; core_num++) {
+                sim_core_t *c = &sim_cores[core_num];
+                c->event = true;
+                if ((int)core_num != sim_core_num
+                        && __atomic_load_n(&c->started, __ATOMIC_ACQUIRE))
+                        pthread_kill(c->thread, SIM_IRQ_SIGNAL);
+        }
+}
+
+// sim_wait_for_event blocks the calling core until its event
+// register is set (by __sev() or by an interrupt having been
+// taken) or until the timeout, if any, expires. SIM_IRQ_SIGNAL is
+// blocked while testing the event register and atomically
+// unblocked while sleeping so that no wakeup can be lost.
+static void sim_wait_for_event(const struct timespec *timeout) {
+        if (sim_core_num < 0) {
+                sched_yield();
+                return;
+        }
+
+        sim_core_t *c = &sim_cores[sim_core_num];
+        sigset_t block, saved;
+        sigemptyset(&block);
+        sigaddset(&block, SIM_IRQ_SIGNAL);
+        pthread_sigmask(SIG_BLOCK, &block, &saved);
+        if (!c->event) {
+                sigset_t waitmask = saved;
+                sigdelset(&waitmask, SIM_IRQ_SIGNAL);
+                pselect(0, NULL, NULL, NULL, timeout, &waitmask);
+        }
+
+        c->event = false;
+        pthread_sigmask(SIG_SETMASK, &saved, NULL);
+}
+
+void __wfe(void) {
+        sim_wait_for_event(NULL);
+}
+
+void __wfi(void) {
+        sim_wait_for_event(NULL);
+}
+
+bool best_effort_wfe_or_timeout(absolute_time_t timeout_timestamp) {
+        int64_t us = absolute_time_diff_us(get_absolute_time(),
+                timeout_timestamp);
+        if (us <= 0)
+                return true;
+
+        struct timespec ts = {
+                .tv_sec = us / 1000000,
+                .tv_nsec = (us % 1000000) * 1000
+        };
+        sim_wait_for_event(&ts);
+        return time_reached(timeout_timestamp);
+}
+
+void *sim_alloc_low_stack(size_t size) {
+        void *p = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT | MAP_STACK,
+                -1, 0);
+        if (p == MAP_FAILED)
+                panic("cannot allocate simulated core stack");
+
+        return p;
+}
+
+void sim_core_register(uint core_num) {
+        assert(core_num < NUM_CORES);
+        sigset_t unblock;
+        sigemptyset(&unblock);
+        sigaddset(&unblock, SIM_IRQ_SIGNAL);
+        pthread_sigmask(SIG_UNBLOCK, &unblock, NULL);
+
+        sim_core_t *c = &sim_cores[core_num];
+        c->thread = pthread_self();
+        sim_core_num = (int)core_num;
+        __atomic_store_n(&c->started, true, __ATOMIC_RELEASE);
+}
+
+static void *sim_core1_thread(void *arg) {
+        (void)arg;
+        sim_core_register(1);
+        sim_core1_entry();
+        // Returning from the core 1 entry function leaves the core
+        // idle but still able to take interrupts
+        while (1)
+                __wfe();
+
+        return NULL;
+}
+
+void multicore_launch_core1_with_stack(void (*entry)(void), uint32_t *stack_bottom, size_t stack_size_bytes) {
+        if (sim_cores[1].started)
+                panic("core 1 already launched");
+
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        pthread_attr_setstack(&attr, stack_bottom, stack_size_bytes);
+        sim_core1_entry = entry;
+        pthread_t thread;
+        if (pthread_create(&thread, &attr, sim_core1_thread, NULL))
+                panic("cannot create core 1 thread");
+
+        pthread_attr_destroy(&attr);
+        while (!__atomic_load_n(&sim_cores[1].started, __ATOMIC_ACQUIRE))
+                sched_yield();
+}
+
+void multicore_launch_core1(void (*entry)(void)) {
+        void *stack = sim_alloc_low_stack(SIM_CORE1_STACK_SIZE);
+        multicore_launch_core1_with_stack(entry, stack,
+                SIM_CORE1_STACK_SIZE);
+}
+
+void multicore_reset_core1(void) {
+        panic("multicore_reset_core1 is not supported on the host");
+}
+
+// sim_fifos[n] is the inter-core FIFO that core n reads
+#define SIM_FIFO_DEPTH 8
+
+typedef struct sim_fifo {
+        uint32_t        data[SIM_FIFO_DEPTH];
+        uint32_t        head;   // written only by the pushing core
+        uint32_t        tail;   // written only by the popping core
+} sim_fifo_t;
+
+static sim_fifo_t sim_fifos[NUM_CORES];
+
+static sim_fifo_t *sim_rx_fifo(void) {
+        return &sim_fifos[get_core_num()];
+}
+
+static sim_fifo_t *sim_tx_fifo(void) {
+        return &sim_fifos[get_core_num() ^ 1];
+}
+
+bool multicore_fifo_rvalid(void) {
+        sim_fifo_t *f = sim_rx_fifo();
+        return __atomic_load_n(&f->head, __ATOMIC_ACQUIRE) != f->tail;
+}
+
+bool multicore_fifo_wready(void) {
+        sim_fifo_t *f = sim_tx_fifo();
+        return f->head - __atomic_load_n(&f->tail, __ATOMIC_ACQUIRE)
+                < SIM_FIFO_DEPTH;
+}
+
+void multicore_fifo_push_blocking(uint32_t data) {
+        while (!multicore_fifo_wready())
+                tight_loop_contents();
+
+        sim_fifo_t *f = sim_tx_fifo();
+        f->data[f->head % SIM_FIFO_DEPTH] = data;
+        __atomic_store_n(&f->head, f->head + 1, __ATOMIC_RELEASE);
+        uint core_num = get_core_num() ^ 1;
+        sim_irq_raise(core_num, SIO_FIFO_IRQ_NUM(core_num));
+        __sev();
+}
+
+uint32_t multicore_fifo_pop_blocking(void) {
+        while (!multicore_fifo_rvalid())
+                __wfe();
+
+        sim_fifo_t *f = sim_rx_fifo();
+        uint32_t data = f->data[f->tail % SIM_FIFO_DEPTH];
+        __atomic_store_n(&f->tail, f->tail + 1, __ATOMIC_RELEASE);
+        return data;
+}
+
+void multicore_fifo_drain(void) {
+        while (multicore_fifo_rvalid())
+                (void)multicore_fifo_pop_blocking();
+}
+
+void multicore_fifo_clear_irq(void) {
+        // there are no overflow or underflow flags to clear
+}
+
+__attribute__((constructor))
+static void sim_init(void) {
+        // Keep every heap allocation in the brk heap of this non-PIE
+        // executable so that addresses fit in 32-bit DMA registers
+        mallopt(M_MMAP_MAX, 0);
+        mallopt(M_ARENA_MAX, 1);
+
+        for (uint i = 0; i < NUM_IRQS; i++)
+                sim_irq_priority[i] = PICO_DEFAULT_IRQ_PRIORITY;
+
+        struct sigaction sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_handler = sim_irq_signal_handler;
+        sa.sa_flags = SA_RESTART | SA_NODEFER;
+        sigemptyset(&sa.sa_mask);
+        sigaction(SIM_IRQ_SIGNAL, &sa, NULL);
+
+        sim_time_init();
+        sim_core_register(0);
+}
@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2026 Malcolm Beattie
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <string.h>
+#include "hardware/dma.h"
+#include "sim_internal.h"
+
+// SIM_DMA_NS_PER_BYTE, if non-zero, makes DMA as slow as a link of
+// that many ns per byte instead of a memory copy: the core that
+// triggers a transfer is held for its duration before the transfer
+// completes. That is cruder than a real DMA engine, which leaves
+// the core free, but it keeps the channel busy for a time that
+// depends on the number of bytes, as a piochan or uartchan would.
+#ifndef SIM_DMA_NS_PER_BYTE
+#define SIM_DMA_NS_PER_BYTE 0
+#endif
+
+dma_hw_t sim_dma_hw;
+dma_debug_hw_t sim_dma_debug_hw;
+
+static uint32_t sim_dma_claimed;
+static uint32_t sim_dma_lines; // DMA_IRQ_n bits currently asserted
+static pthread_mutex_t sim_dma_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+void dma_channel_claim(uint channel) {
+        check_dma_channel_param(channel);
+        uint32_t bit = 1u << channel;
+        if (__atomic_fetch_or(&sim_dma_claimed, bit, __ATOMIC_ACQ_REL) & bit)
+                panic("DMA channel %u already claimed", channel);
+}
+
+void dma_claim_mask(uint32_t channel_mask) {
+        for (uint channel = 0; channel_mask; channel++, channel_mask >>= 1) {
+                if (channel_mask & 1u)
+                        dma_channel_claim(channel);
+        }
+}
+
+void dma_channel_unclaim(uint channel) {
+        check_dma_channel_param(channel);
+        __atomic_fetch_and(&sim_dma_claimed, ~(1u << channel),
+                __ATOMIC_ACQ_REL);
+}
+
+int dma_claim_unused_channel(bool required) {
+        for (uint channel = 0; channel < NUM_DMA_CHANNELS; channel++) {
+                uint32_t bit = 1u << channel;
+                if (!(__atomic_fetch_or(&sim_dma_claimed, bit, __ATOMIC_ACQ_REL) & bit))
+                        return (int)channel;
+        }
+
+        if (required)
+                panic("no DMA channels available");
+
+        return -1;
+}
+
+bool dma_channel_is_claimed(uint channel) {
+        check_dma_channel_param(channel);
+        return __atomic_load_n(&sim_dma_claimed, __ATOMIC_ACQUIRE) & (1u << channel);
+}
+
+uint32_t sim_dma_irq_lines(void) {
+        return __atomic_load_n(&sim_dma_lines, __ATOMIC_ACQUIRE);
+}
+
+// recalc_ints must be called with sim_dma_mutex held. It returns the
+// DMA_IRQ_n lines that have newly been asserted.
+static uint32_t recalc_ints(void) {
+        uint32_t intr = __atomic_load_n(&dma_hw->intr, __ATOMIC_ACQUIRE);
+        uint32_t lines = 0;
+        for (uint i = 0; i < NUM_DMA_IRQS; i++) {
+                dma_irq_ctrl_hw_t *ic = &dma_hw->irq_ctrl[i];
+                uint32_t ints = (intr & ic->inte) | ic->intf;
+                __atomic_store_n(&ic->ints, ints, __ATOMIC_RELEASE);
+                if (ints)
+                        lines |= 1u << (DMA_IRQ_0 + i);
+        }
+
+        uint32_t old_lines = __atomic_exchange_n(&sim_dma_lines, lines,
+                __ATOMIC_ACQ_REL);
+        return lines & ~old_lines;
+}
+
+void sim_dma_irq_update(void) {
+        uint32_t save;
+        sim_lock(&sim_dma_mutex, &save);
+        uint32_t new_lines = recalc_ints();
+        sim_unlock(&sim_dma_mutex, save);
+        if (new_lines)
+                sim_irq_lines_changed(new_lines);
+}
+
+void sim_hw_written(io_rw_32 *addr) {
+        const volatile void *p = addr;
+        if (p >= (const volatile void *)dma_hw
+                && p < (const volatile void *)(dma_hw + 1))
+                sim_dma_irq_update();
+}
+
+// do_transfer copies the data of a transfer and returns its size
+// in bytes
+static uint32_t do_transfer(dma_channel_hw_t *hw, uint32_t ctrl) {
+        uint size = 1u << ((ctrl & DMA_CH0_CTRL_TRIG_DATA_SIZE_BITS)
+                >> DMA_CH0_CTRL_TRIG_DATA_SIZE_LSB);
+        uint32_t count = hw->transfer_count;
+        unsigned char *src = sim_ptr32(hw->read_addr);
+        unsigned char *dst = sim_ptr32(hw->write_addr);
+        bool incr_read = ctrl & DMA_CH0_CTRL_TRIG_INCR_READ_BITS;
+        bool incr_write = ctrl & DMA_CH0_CTRL_TRIG_INCR_WRITE_BITS;
+
+        if (incr_read && incr_write) {
+                memmove(dst, src, (size_t)count * size);
+        } else {
+                for (uint32_t i = 0; i < count; i++) {
+                        memcpy(dst, src, size);
+                        if (incr_read)
+                                src += size;
+                        if (incr_write)
+                                dst += size;
+                }
+        }
+
+        if (incr_read)
+                hw->read_addr += count * size;
+        if (incr_write)
+                hw->write_addr += count * size;
+        hw->transfer_count = 0;
+        return count * size;
+}
+
+void sim_dma_trigger(uint channel) {
+        check_dma_channel_param(channel);
+        uint32_t save;
+        uint32_t new_lines = 0;
+        uint32_t bytes = 0;
+        sim_lock(&sim_dma_mutex, &save);
+
+        while (true) {
+                dma_channel_hw_t *hw = &dma_hw->ch[channel];
+                uint32_t ctrl = hw->ctrl_trig;
+                if (!(ctrl & DMA_CH0_CTRL_TRIG_EN_BITS))
+                        break;
+
+                uint treq = (ctrl & DMA_CH0_CTRL_TRIG_TREQ_SEL_BITS)
+                        >> DMA_CH0_CTRL_TRIG_TREQ_SEL_LSB;
+                if (treq != DMA_CH0_CTRL_TRIG_TREQ_SEL_VALUE_PERMANENT)
+                        panic("DMA channel %u: paced (DREQ %u) transfers are not simulated", channel, treq);
+
+                bytes += do_transfer(hw, ctrl);
+                if (!(ctrl & DMA_CH0_CTRL_TRIG_IRQ_QUIET_BITS)) {
+                        __atomic_fetch_or(&dma_hw->intr, 1u << channel,
+                                __ATOMIC_ACQ_REL);
+                        new_lines |= recalc_ints();
+                }
+
+                uint chain_to = (ctrl & DMA_CH0_CTRL_TRIG_CHAIN_TO_BITS)
+                        >> DMA_CH0_CTRL_TRIG_CHAIN_TO_LSB;
+                if (chain_to == channel)
+                        break;
+
+                channel = chain_to;
+        }
+
+        sim_unlock(&sim_dma_mutex, save);
+        if (SIM_DMA_NS_PER_BYTE)
+                sim_spin_ns((uint64_t)bytes * SIM_DMA_NS_PER_BYTE);
+        if (new_lines)
+                sim_irq_lines_changed(new_lines);
+}
@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2026 Malcolm Beattie
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "hardware/gpio.h"
+#include "hardware/timer.h"
+
+static uint32_t gpio_out_level;
+static uint32_t gpio_in_level;
+static uint32_t gpio_dir_out;
+static int gpio_trace = -1;
+
+static bool trace_enabled(void) {
+        if (gpio_trace < 0)
+                gpio_trace = getenv("PCH_HOST_GPIO_TRACE") != NULL;
+
+        return gpio_trace;
+}
+
+static void set_out_level(uint32_t new_level) {
+        uint32_t old_level = __atomic_exchange_n(&gpio_out_level, new_level,
+                __ATOMIC_RELAXED);
+        uint32_t changed = (old_level ^ new_level) & gpio_dir_out;
+        if (!changed || !trace_enabled())
+                return;
+
+        for (uint gpio = 0; gpio < NUM_BANK0_GPIOS; gpio++) {
+                if (changed & (1u << gpio)) {
+                        fprintf(stderr, "%llu gpio %u=%u\n",
+                                (unsigned long long)time_us_64(), gpio,
+                                (new_level >> gpio) & 1);
+                }
+        }
+}
+
+void gpio_init(uint gpio) {
+        gpio_set_dir(gpio, GPIO_IN);
+        gpio_put(gpio, 0);
+}
+
+void gpio_init_mask(uint32_t gpio_mask) {
+        gpio_set_dir_in_masked(gpio_mask);
+        gpio_clr_mask(gpio_mask);
+}
+
+void gpio_set_dir(uint gpio, bool out) {
+        if (out)
+                gpio_set_dir_out_masked(1u << gpio);
+        else
+                gpio_set_dir_in_masked(1u << gpio);
+}
+
+void gpio_set_dir_out_masked(uint32_t mask) {
+        __atomic_or_fetch(&gpio_dir_out, mask, __ATOMIC_RELAXED);
+}
+
+void gpio_set_dir_in_masked(uint32_t mask) {
+        __atomic_and_fetch(&gpio_dir_out, ~mask, __ATOMIC_RELAXED);
+}
+
+bool gpio_is_dir_out(uint gpio) {
+        return gpio_dir_out & (1u << gpio);
+}
+
+void gpio_put(uint gpio, bool value) {
+        gpio_put_masked(1u << gpio, value ? 1u << gpio : 0);
+}
+
+bool gpio_get(uint gpio) {
+        return gpio_get_all() & (1u << gpio);
+}
+
+uint32_t gpio_get_all(void) {
+        return (gpio_out_level & gpio_dir_out) | (gpio_in_level & ~gpio_dir_out);
+}
+
+void gpio_put_all(uint32_t value) {
+        set_out_level(value);
+}
+
+void gpio_put_masked(uint32_t mask, uint32_t value) {
+        set_out_level((gpio_out_level & ~mask) | (value & mask));
+}
+
+void gpio_set_mask(uint32_t mask) {
+        set_out_level(gpio_out_level | mask);
+}
+
+void gpio_clr_mask(uint32_t mask) {
+        set_out_level(gpio_out_level & ~mask);
+}
+
+void gpio_xor_mask(uint32_t mask) {
+        set_out_level(gpio_out_level ^ mask);
+}
+
+void gpio_set_pulls(uint gpio, bool up, bool down) {
+        (void)down;
+        sim_gpio_set_input(gpio, up);
+}
+
+void gpio_pull_up(uint gpio) {
+        gpio_set_pulls(gpio, true, false);
+}
+
+void gpio_pull_down(uint gpio) {
+        gpio_set_pulls(gpio, false, true);
+}
+
+void gpio_disable_pulls(uint gpio) {
+        gpio_set_pulls(gpio, false, false);
+}
+
+void gpio_set_input_hysteresis_enabled(uint gpio, bool enabled) {
+        (void)gpio;
+        (void)enabled;
+}
+
+void gpio_set_irq_enabled(uint gpio, uint32_t event_mask, bool enabled) {
+        (void)gpio;
+        (void)event_mask;
+        if (enabled)
+                panic_unsupported();
+}
+
+void gpio_set_irq_enabled_with_callback(uint gpio, uint32_t event_mask, bool enabled, gpio_irq_callback_t callback) {
+        (void)callback;
+        gpio_set_irq_enabled(gpio, event_mask, enabled);
+}
+
+void gpio_acknowledge_irq(uint gpio, uint32_t event_mask) {
+        (void)gpio;
+        (void)event_mask;
+}
+
+void sim_gpio_set_input(uint gpio, bool value) {
+        if (value)
+                __atomic_or_fetch(&gpio_in_level, 1u << gpio, __ATOMIC_RELAXED);
+        else
+                __atomic_and_fetch(&gpio_in_level, ~(1u << gpio), __ATOMIC_RELAXED);
+}
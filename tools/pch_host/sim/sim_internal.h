@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2026 Malcolm Beattie
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _PCH_HOST_SIM_INTERNAL_H
+#define _PCH_HOST_SIM_INTERNAL_H
+
+#include <pthread.h>
+#include <signal.h>
+#include "pico.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+
+// SIM_IRQ_SIGNAL is sent to a core thread whenever an IRQ that it
+// has enabled may have become pending. It is also used for __sev()
+// so that a core sleeping in __wfe() wakes up.
+#define SIM_IRQ_SIGNAL (SIGRTMIN + 0)
+
+#define SIM_THREAD_MODE_PRIORITY 0x100
+
+typedef struct sim_core {
+        pthread_t               thread;
+        uint32_t                enabled;        // NVIC ISER
+        uint32_t                pending;        // NVIC ISPR
+        bool                    started;
+        bool                    event;          // WFE event register
+} sim_core_t;
+
+extern sim_core_t sim_cores[NUM_CORES];
+
+// sim_core_num is the simulated core number of the calling thread
+// or -1 for helper threads that are not cores.
+extern __thread int sim_core_num;
+
+void sim_core_register(uint core_num);
+void *sim_alloc_low_stack(size_t size);
+
+// sim_irq_raise marks irq pending on core_num and interrupts it.
+void sim_irq_raise(uint core_num, uint irq);
+
+// sim_irq_lines_changed must be called when a level-triggered
+// peripheral line (DMA_IRQ_n) may have changed.
+void sim_irq_lines_changed(uint32_t new_lines);
+uint32_t sim_irq_lines(void);
+uint32_t sim_dma_irq_lines(void);
+
+void sim_time_init(void);
+
+// sim_spin_ns busy-waits for ns nanoseconds.
+void sim_spin_ns(uint64_t ns);
+
+static inline void sim_lock(pthread_mutex_t *m, uint32_t *save) {
+        *save = save_and_disable_interrupts();
+        pthread_mutex_lock(m);
+}
+
+static inline void sim_unlock(pthread_mutex_t *m, uint32_t save) {
+        pthread_mutex_unlock(m);
+        restore_interrupts(save);
+}
+
+#endif
@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2026 Malcolm Beattie
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "hardware/sync.h"
+#include "sim_internal.h"
+
+static spin_lock_t sim_spin_locks[NUM_SPIN_LOCKS];
+static uint32_t sim_spin_locks_claimed;
+static uint sim_next_striped_spin_lock;
+
+spin_lock_t *spin_lock_instance(uint lock_num) {
+        assert(lock_num < NUM_SPIN_LOCKS);
+        return &sim_spin_locks[lock_num];
+}
+
+uint spin_lock_get_num(spin_lock_t *lock) {
+        return (uint)(lock - sim_spin_locks);
+}
+
+spin_lock_t *spin_lock_init(uint lock_num) {
+        spin_lock_t *lock = spin_lock_instance(lock_num);
+        spin_unlock_unsafe(lock);
+        return lock;
+}
+
+void spin_lock_claim(uint lock_num) {
+        assert(lock_num < NUM_SPIN_LOCKS);
+        uint32_t bit = 1u << lock_num;
+        if (__atomic_fetch_or(&sim_spin_locks_claimed, bit, __ATOMIC_ACQ_REL) & bit)
+                panic("spin lock %u already claimed", lock_num);
+}
+
+void spin_lock_unclaim(uint lock_num) {
+        assert(lock_num < NUM_SPIN_LOCKS);
+        spin_unlock_unsafe(spin_lock_instance(lock_num));
+        __atomic_fetch_and(&sim_spin_locks_claimed, ~(1u << lock_num),
+                __ATOMIC_ACQ_REL);
+}
+
+int spin_lock_claim_unused(bool required) {
+        for (uint n = PICO_SPINLOCK_ID_CLAIM_FREE_FIRST; n < NUM_SPIN_LOCKS; n++) {
+                uint32_t bit = 1u << n;
+                if (!(__atomic_fetch_or(&sim_spin_locks_claimed, bit, __ATOMIC_ACQ_REL) & bit))
+                        return (int)n;
+        }
+
+        if (required)
+                panic("no spin locks available");
+
+        return -1;
+}
+
+bool spin_lock_is_claimed(uint lock_num) {
+        assert(lock_num < NUM_SPIN_LOCKS);
+        return __atomic_load_n(&sim_spin_locks_claimed, __ATOMIC_ACQUIRE) & (1u << lock_num);
+}
+
+uint next_striped_spin_lock_num(void) {
+        uint n = __atomic_fetch_add(&sim_next_striped_spin_lock, 1,
+                __ATOMIC_ACQ_REL);
+        return PICO_SPINLOCK_ID_STRIPED_FIRST + n % 8;
+}
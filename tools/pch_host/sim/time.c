@@ -0,0 +1,369 @@
+/*
+ * Copyright (c) 2026 Malcolm Beattie
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <time.h>
+#include "pico/time.h"
+#include "sim_internal.h"
+
+// Alarm pools keep their alarms in a small array. A helper "timer"
+// thread sleeps until the earliest alarm across all pools is due
+// and then raises TIMER_IRQ_n on the core that owns the pool, whose
+// handler runs every due callback exactly as the SDK does from the
+// hardware alarm interrupt.
+
+timer_hw_t sim_timer_hw;
+
+typedef struct sim_alarm {
+        alarm_id_t              id;     // 0 means slot unused
+        bool                    in_callback;
+        uint64_t                target;
+        alarm_callback_t        callback;
+        void                    *user_data;
+} sim_alarm_t;
+
+struct alarm_pool {
+        sim_alarm_t             *alarms;
+        uint                    max_timers;
+        uint                    hardware_alarm_num;
+        uint                    core_num;
+        alarm_id_t              next_id;
+        bool                    irq_raised;
+};
+
+static uint64_t sim_boot_ns;
+static alarm_pool_t *sim_alarm_pools[NUM_ALARMS];
+static alarm_pool_t *sim_default_alarm_pool;
+static uint32_t sim_hardware_alarms_claimed;
+static pthread_mutex_t sim_time_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t sim_timer_cond;
+static pthread_t sim_timer_thread;
+
+static uint64_t monotonic_ns(void) {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+uint64_t time_us_64(void) {
+        return (monotonic_ns() - sim_boot_ns) / 1000;
+}
+
+void sim_spin_ns(uint64_t ns) {
+        uint64_t target = monotonic_ns() + ns;
+        while (monotonic_ns() < target)
+                __compiler_memory_barrier();
+}
+
+void busy_wait_us(uint64_t delay_us) {
+        uint64_t target = time_us_64() + delay_us;
+        while (time_us_64() < target)
+                __compiler_memory_barrier();
+}
+
+void busy_wait_us_32(uint32_t delay_us) {
+        busy_wait_us(delay_us);
+}
+
+void busy_wait_ms(uint32_t delay_ms) {
+        busy_wait_us((uint64_t)delay_ms * 1000);
+}
+
+void sleep_until(absolute_time_t target) {
+        int64_t us;
+        while ((us = absolute_time_diff_us(get_absolute_time(), target)) > 0) {
+                struct timespec ts = {
+                        .tv_sec = us / 1000000,
+                        .tv_nsec = (us % 1000000) * 1000
+                };
+                nanosleep(&ts, NULL); // interrupts cut this short
+        }
+}
+
+void sleep_us(uint64_t us) {
+        sleep_until(make_timeout_time_us(us));
+}
+
+void sleep_ms(uint32_t ms) {
+        sleep_until(make_timeout_time_ms(ms));
+}
+
+void hardware_alarm_claim(uint alarm_num) {
+        assert(alarm_num < NUM_ALARMS);
+        uint32_t bit = 1u << alarm_num;
+        if (__atomic_fetch_or(&sim_hardware_alarms_claimed, bit, __ATOMIC_ACQ_REL) & bit)
+                panic("hardware alarm %u already claimed", alarm_num);
+}
+
+void hardware_alarm_unclaim(uint alarm_num) {
+        assert(alarm_num < NUM_ALARMS);
+        __atomic_fetch_and(&sim_hardware_alarms_claimed, ~(1u << alarm_num),
+                __ATOMIC_ACQ_REL);
+}
+
+int hardware_alarm_claim_unused(bool required) {
+        for (uint n = 0; n < NUM_ALARMS; n++) {
+                uint32_t bit = 1u << n;
+                if (!(__atomic_fetch_or(&sim_hardware_alarms_claimed, bit, __ATOMIC_ACQ_REL) & bit))
+                        return (int)n;
+        }
+
+        if (required)
+                panic("no hardware alarms available");
+
+        return -1;
+}
+
+static sim_alarm_t *find_due_alarm(alarm_pool_t *pool, uint64_t now) {
+        sim_alarm_t *due = NULL;
+        for (uint i = 0; i < pool->max_timers; i++) {
+                sim_alarm_t *a = &pool->alarms[i];
+                if (a->id == 0 || a->in_callback || a->target > now)
+                        continue;
+                if (!due || a->target < due->target)
+                        due = a;
+        }
+
+        return due;
+}
+
+static void sim_alarm_irq_handler(void) {
+        uint irq = __get_current_exception() - VTABLE_FIRST_IRQ;
+        alarm_pool_t *pool = sim_alarm_pools[irq - TIMER_IRQ_0];
+        uint32_t save;
+
+        sim_lock(&sim_time_mutex, &save);
+        pool->irq_raised = false;
+        sim_alarm_t *a;
+        while ((a = find_due_alarm(pool, time_us_64())) != NULL) {
+                alarm_id_t id = a->id;
+                uint64_t target = a->target;
+                a->in_callback = true;
+                sim_unlock(&sim_time_mutex, save);
+
+                int64_t ret = a->callback(id, a->user_data);
+
+                sim_lock(&sim_time_mutex, &save);
+                if (a->id != id)
+                        continue; // cancelled during callback
+
+                a->in_callback = false;
+                if (ret == 0)
+                        a->id = 0;
+                else if (ret < 0)
+                        a->target = target + (uint64_t)(-ret);
+                else
+                        a->target = time_us_64() + (uint64_t)ret;
+        }
+
+        pthread_cond_signal(&sim_timer_cond);
+        sim_unlock(&sim_time_mutex, save);
+}
+
+static void *sim_timer_thread_func(void *arg) {
+        (void)arg;
+        sigset_t block;
+        sigemptyset(&block);
+        sigaddset(&block, SIM_IRQ_SIGNAL);
+        pthread_sigmask(SIG_BLOCK, &block, NULL);
+
+        pthread_mutex_lock(&sim_time_mutex);
+        while (true) {
+                uint64_t now = time_us_64();
+                uint64_t earliest = UINT64_MAX;
+                for (uint n = 0; n < NUM_ALARMS; n++) {
+                        alarm_pool_t *pool = sim_alarm_pools[n];
+                        if (!pool || pool->irq_raised)
+                                continue;
+
+                        for (uint i = 0; i < pool->max_timers; i++) {
+                                sim_alarm_t *a = &pool->alarms[i];
+                                if (a->id == 0 || a->in_callback)
+                                        continue;
+                                if (a->target <= now) {
+                                        pool->irq_raised = true;
+                                        sim_irq_raise(pool->core_num,
+                                                TIMER_IRQ_0 + n);
+                                        break;
+                                }
+                                if (a->target < earliest)
+                                        earliest = a->target;
+                        }
+                }
+
+                if (earliest == UINT64_MAX) {
+                        pthread_cond_wait(&sim_timer_cond, &sim_time_mutex);
+                } else {
+                        uint64_t ns = sim_boot_ns + earliest * 1000;
+                        struct timespec ts = {
+                                .tv_sec = (time_t)(ns / 1000000000u),
+                                .tv_nsec = (long)(ns % 1000000000u)
+                        };
+                        pthread_cond_timedwait(&sim_timer_cond,
+                                &sim_time_mutex, &ts);
+                }
+        }
+
+        return NULL;
+}
+
+static alarm_pool_t *create_alarm_pool(uint hardware_alarm_num, uint max_timers, uint core_num) {
+        alarm_pool_t *pool = calloc(1, sizeof(*pool));
+        sim_alarm_t *alarms = calloc(max_timers, sizeof(*alarms));
+        if (!pool || !alarms)
+                panic("cannot allocate alarm pool");
+
+        pool->alarms = alarms;
+        pool->max_timers = max_timers;
+        pool->hardware_alarm_num = hardware_alarm_num;
+        pool->core_num = core_num;
+
+        uint irq = TIMER_IRQ_0 + hardware_alarm_num;
+        sim_alarm_pools[hardware_alarm_num] = pool;
+        irq_set_exclusive_handler(irq, sim_alarm_irq_handler);
+        __atomic_fetch_or(&sim_cores[core_num].enabled, 1u << irq,
+                __ATOMIC_ACQ_REL);
+        return pool;
+}
+
+alarm_pool_t *alarm_pool_create(uint hardware_alarm_num, uint max_timers) {
+        hardware_alarm_claim(hardware_alarm_num);
+        return create_alarm_pool(hardware_alarm_num, max_timers,
+                get_core_num());
+}
+
+alarm_pool_t *alarm_pool_create_with_unused_hardware_alarm(uint max_timers) {
+        uint n = (uint)hardware_alarm_claim_unused(true);
+        return create_alarm_pool(n, max_timers, get_core_num());
+}
+
+alarm_pool_t *alarm_pool_get_default(void) {
+        uint32_t save;
+        sim_lock(&sim_time_mutex, &save);
+        if (!sim_default_alarm_pool) {
+                sim_default_alarm_pool = create_alarm_pool(
+                        PICO_TIME_DEFAULT_ALARM_POOL_HARDWARE_ALARM_NUM,
+                        PICO_TIME_DEFAULT_ALARM_POOL_MAX_TIMERS, 0);
+        }
+        sim_unlock(&sim_time_mutex, save);
+        return sim_default_alarm_pool;
+}
+
+uint alarm_pool_hardware_alarm_num(alarm_pool_t *pool) {
+        return pool->hardware_alarm_num;
+}
+
+uint alarm_pool_core_num(alarm_pool_t *pool) {
+        return pool->core_num;
+}
+
+void alarm_pool_destroy(alarm_pool_t *pool) {
+        uint32_t save;
+        sim_lock(&sim_time_mutex, &save);
+        sim_alarm_pools[pool->hardware_alarm_num] = NULL;
+        sim_unlock(&sim_time_mutex, save);
+        irq_remove_handler(TIMER_IRQ_0 + pool->hardware_alarm_num,
+                sim_alarm_irq_handler);
+        hardware_alarm_unclaim(pool->hardware_alarm_num);
+        free(pool->alarms);
+        free(pool);
+}
+
+alarm_id_t alarm_pool_add_alarm_at(alarm_pool_t *pool, absolute_time_t time, alarm_callback_t callback, void *user_data, bool fire_if_past) {
+        if (!fire_if_past && time_reached(time))
+                return 0;
+
+        alarm_id_t id = -1;
+        uint32_t save;
+        sim_lock(&sim_time_mutex, &save);
+        for (uint i = 0; i < pool->max_timers; i++) {
+                sim_alarm_t *a = &pool->alarms[i];
+                if (a->id != 0)
+                        continue;
+
+                do {
+                        pool->next_id = (pool->next_id + 1) & INT32_MAX;
+                } while (pool->next_id == 0);
+
+                id = pool->next_id;
+                *a = (sim_alarm_t){
+                        .id = id,
+                        .target = to_us_since_boot(time),
+                        .callback = callback,
+                        .user_data = user_data
+                };
+                pthread_cond_signal(&sim_timer_cond);
+                break;
+        }
+        sim_unlock(&sim_time_mutex, save);
+        return id;
+}
+
+bool alarm_pool_cancel_alarm(alarm_pool_t *pool, alarm_id_t alarm_id) {
+        bool found = false;
+        uint32_t save;
+        sim_lock(&sim_time_mutex, &save);
+        for (uint i = 0; i < pool->max_timers; i++) {
+                sim_alarm_t *a = &pool->alarms[i];
+                if (alarm_id != 0 && a->id == alarm_id) {
+                        a->id = 0;
+                        a->in_callback = false;
+                        found = true;
+                        break;
+                }
+        }
+        sim_unlock(&sim_time_mutex, save);
+        return found;
+}
+
+static int64_t repeating_timer_callback(alarm_id_t id, void *user_data) {
+        (void)id;
+        repeating_timer_t *rt = user_data;
+        if (rt->callback(rt))
+                return rt->delay_us;
+
+        rt->alarm_id = 0;
+        return 0;
+}
+
+bool alarm_pool_add_repeating_timer_us(alarm_pool_t *pool, int64_t delay_us, repeating_timer_callback_t callback, void *user_data, repeating_timer_t *out) {
+        if (!delay_us)
+                delay_us = 1;
+
+        out->pool = pool;
+        out->callback = callback;
+        out->delay_us = delay_us;
+        out->user_data = user_data;
+        uint64_t first_delay = (uint64_t)(delay_us < 0 ? -delay_us : delay_us);
+        out->alarm_id = alarm_pool_add_alarm_in_us(pool, first_delay,
+                repeating_timer_callback, out, true);
+        return out->alarm_id > 0;
+}
+
+bool cancel_repeating_timer(repeating_timer_t *timer) {
+        bool found = false;
+        if (timer->alarm_id)
+                found = alarm_pool_cancel_alarm(timer->pool, timer->alarm_id);
+
+        timer->alarm_id = 0;
+        return found;
+}
+
+void sim_time_init(void) {
+        sim_boot_ns = monotonic_ns();
+
+        pthread_condattr_t attr;
+        pthread_condattr_init(&attr);
+        pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+        pthread_cond_init(&sim_timer_cond, &attr);
+        pthread_condattr_destroy(&attr);
+
+        // The default alarm pool always uses the same hardware alarm
+        hardware_alarm_claim(PICO_TIME_DEFAULT_ALARM_POOL_HARDWARE_ALARM_NUM);
+
+        if (pthread_create(&sim_timer_thread, NULL, sim_timer_thread_func, NULL))
+                panic("cannot create timer thread");
+}
@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2026 Malcolm Beattie
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "picochan/dmachan.h"
+
+// The host simulation has no UART or PIO hardware. The register
+// blocks exist so that code referring to uart0 or pio0 compiles but
+// any attempt to bring up a uartchan or piochan panics.
+
+uart_hw_t sim_uart_hw[NUM_UARTS];
+pio_hw_t sim_pio_hw[NUM_PIOS];
+
+uint uart_init(uart_inst_t *uart, uint baudrate) {
+        (void)uart;
+        (void)baudrate;
+        panic("uartchan is not supported on the host");
+}
+
+void uart_set_hw_flow(uart_inst_t *uart, bool cts, bool rts) {
+        (void)uart;
+        (void)cts;
+        (void)rts;
+}
+
+void uart_set_format(uart_inst_t *uart, uint data_bits, uint stop_bits, uart_parity_t parity) {
+        (void)uart;
+        (void)data_bits;
+        (void)stop_bits;
+        (void)parity;
+}
+
+void uart_set_fifo_enabled(uart_inst_t *uart, bool enabled) {
+        (void)uart;
+        (void)enabled;
+}
+
+void uart_set_translate_crlf(uart_inst_t *uart, bool translate) {
+        (void)uart;
+        (void)translate;
+}
+
+// piochan.c and pio_{rx,tx}_channel.c are not built for the host
+// since they need the PIO program header and state machine API.
+
+dmachan_rx_channel_ops_t dmachan_pio_rx_channel_ops;
+dmachan_tx_channel_ops_t dmachan_pio_tx_channel_ops;
+
+void pch_piochan_init(pch_pio_config_t *cfg) {
+        (void)cfg;
+        panic("piochan is not supported on the host");
+}
+
+void pch_channel_init_piochan(pch_channel_t *ch, uint8_t id, pch_pio_config_t *cfg, pch_piochan_config_t *pc) {
+        (void)ch;
+        (void)id;
+        (void)cfg;
+        (void)pc;
+        panic("piochan is not supported on the host");
+}
@@ -0,0 +1,252 @@
+/*
+ * Copyright (c) 2025 Malcolm Beattie
+ * SPDX-License-Identifier: MIT
+ */
+
+// pch_trace_recv is not intended to be compiled and run on the Pico.
+// It receives the stream of trace frames sent by a trace drain (see
+// picochan/trc_drain.h) with a UART sink, typically via a USB serial
+// adapter, and writes each complete frame to an output file (or
+// stdout) for pch_dump_trace -s to parse and display. Like
+// pch_dump_trace, it assumes the host is little-endian.
+//
+// Bytes received that are not part of a frame (such as noise before
+// the Pico starts or the rest of a frame received partially when the
+// receiver was started) are skipped until the start of the next
+// frame is found. Counts of frames received, bytes skipped and
+// buffers dropped on the Pico, overrun while being sent or lost in
+// transit are shown on stderr when the input ends or on SIGINT.
+//
+// For example:
+//   pch_trace_recv -b 921600 /dev/ttyUSB0 | pch_dump_trace -s -
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+#define PCH_TRC_NUM_BUFFERS 1
+#include "picochan/trc.h"
+
+#define MAX_FRAME_SIZE 32768
+
+static volatile sig_atomic_t stopping;
+
+static uint32_t frames;
+static uint32_t skipped;
+static uint32_t lost;
+static bool have_prev;
+static pch_trc_frame_t prev;
+
+static void handle_sigint(int sig) {
+        (void)sig;
+        stopping = 1;
+}
+
+static speed_t baud_to_speed(long baud) {
+        switch (baud) {
+        case 9600: return B9600;
+        case 19200: return B19200;
+        case 38400: return B38400;
+        case 57600: return B57600;
+        case 115200: return B115200;
+        case 230400: return B230400;
+        case 460800: return B460800;
+        case 921600: return B921600;
+        case 1000000: return B1000000;
+        case 2000000: return B2000000;
+        case 3000000: return B3000000;
+        }
+
+        fprintf(stderr, "unsupported baud rate %ld\n", baud);
+        exit(1);
+}
+
+// configure_tty sets fd to raw 8N1 at baud without flow control, to
+// match pch_trc_uart_sink_init(). Input that is not a tty is left as
+// it is so that a captured stream can be read from a file.
+static void configure_tty(int fd, const char *name, long baud) {
+        if (!isatty(fd))
+                return;
+
+        struct termios t;
+        if (tcgetattr(fd, &t) < 0) {
+                perror(name);
+                exit(1);
+        }
+
+        cfmakeraw(&t);
+        t.c_cflag &= ~(CSTOPB | PARENB | CRTSCTS);
+        t.c_cflag |= CLOCAL | CREAD;
+        t.c_cc[VMIN] = 1;
+        t.c_cc[VTIME] = 0;
+        speed_t speed = baud_to_speed(baud);
+        cfsetispeed(&t, speed);
+        cfsetospeed(&t, speed);
+        if (tcsetattr(fd, TCSANOW, &t) < 0) {
+                perror(name);
+                exit(1);
+        }
+
+        tcflush(fd, TCIFLUSH);
+}
+
+// read_fully reads exactly n bytes from fd into p, returning false
+// at end of input or when interrupted to stop.
+static bool read_fully(int fd, void *p, size_t n) {
+        unsigned char *cp = p;
+        while (n) {
+                ssize_t r = read(fd, cp, n);
+                if (r < 0) {
+                        if (errno == EINTR && !stopping)
+                                continue;
+                        if (errno != EINTR)
+                                perror("read");
+                        return false;
+                }
+                if (r == 0)
+                        return false;
+
+                cp += r;
+                n -= (size_t)r;
+        }
+
+        return true;
+}
+
+static void check_frame(pch_trc_frame_t *f) {
+        if (have_prev && prev.bs_magic == f->bs_magic) {
+                uint32_t dropped = f->dropped - prev.dropped;
+                uint16_t expect = (uint16_t)(prev.gen + 1);
+                // generations wrap to 0 before 65536 unless the
+                // number of buffers is a power of 2
+                if (!dropped && f->gen != expect && f->gen != 0)
+                        lost += (uint16_t)(f->gen - expect);
+        }
+
+        prev = *f;
+        have_prev = true;
+}
+
+static void print_counts(void) {
+        fprintf(stderr, "frames=%u skipped_bytes=%u lost_in_transit=%u",
+                frames, skipped, lost);
+        if (have_prev)
+                fprintf(stderr, " dropped=%u overrun=%u",
+                        prev.dropped, prev.overrun);
+        fputc('\n', stderr);
+}
+
+static void usage(void) {
+        fprintf(stderr, "Usage: pch_trace_recv [-b baud] [-n frames] [-o output_file] input\n");
+        exit(1);
+}
+
+int main(int argc, char **argv) {
+        long baud = 115200;
+        long max_frames = 0;
+        const char *outname = NULL;
+        int opt;
+
+        while ((opt = getopt(argc, argv, "b:n:o:")) != -1) {
+                switch (opt) {
+                case 'b':
+                        baud = strtol(optarg, NULL, 0);
+                        break;
+                case 'n':
+                        max_frames = strtol(optarg, NULL, 0);
+                        break;
+                case 'o':
+                        outname = optarg;
+                        break;
+                default:
+                        usage();
+                }
+        }
+
+        if (optind != argc - 1)
+                usage();
+
+        const char *inname = argv[optind];
+        int fd = 0;
+        if (strcmp(inname, "-")) {
+                fd = open(inname, O_RDONLY | O_NOCTTY);
+                if (fd < 0) {
+                        perror(inname);
+                        exit(1);
+                }
+        }
+
+        configure_tty(fd, inname, baud);
+
+        FILE *out = stdout;
+        if (outname) {
+                out = fopen(outname, "wb");
+                if (!out) {
+                        perror(outname);
+                        exit(1);
+                }
+        }
+
+        struct sigaction sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_handler = handle_sigint;
+        sigaction(SIGINT, &sa, NULL);
+
+        static unsigned char buf[MAX_FRAME_SIZE];
+        pch_trc_frame_t frame;
+        while (!stopping && (!max_frames || frames < max_frames)) {
+                if (!read_fully(fd, &frame.magic, sizeof(frame.magic)))
+                        break;
+
+                // slide along a byte at a time until the magic matches
+                bool eof = false;
+                while (frame.magic != PCH_TRC_FRAME_MAGIC) {
+                        unsigned char c;
+                        if (!read_fully(fd, &c, 1)) {
+                                eof = true;
+                                break;
+                        }
+
+                        frame.magic = (frame.magic >> 8)
+                                | ((uint32_t)c << 24);
+                        skipped++;
+                }
+                if (eof)
+                        break;
+
+                size_t rest = sizeof(frame) - sizeof(frame.magic);
+                if (!read_fully(fd, &frame.bs_magic, rest))
+                        break;
+
+                if (frame.size > MAX_FRAME_SIZE) {
+                        // not really a frame: resynchronise after it
+                        skipped += sizeof(frame);
+                        continue;
+                }
+
+                if (!read_fully(fd, buf, frame.size))
+                        break;
+
+                check_frame(&frame);
+                if (fwrite(&frame, sizeof(frame), 1, out) != 1
+                        || fwrite(buf, 1, frame.size, out) != frame.size
+                        || fflush(out) != 0) {
+                        perror(outname ? outname : "stdout");
+                        exit(1);
+                }
+                frames++;
+        }
+
+        print_counts();
+        if (out != stdout)
+                fclose(out);
+
+        return 0;
+}